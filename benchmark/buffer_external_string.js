@@ -0,0 +1,47 @@
+// Builds a cache of large strings decoded from Buffers and reports heap size
+// and full GC pause times. Compare the default run against one with
+// external strings disabled:
+//
+//   node --expose-gc benchmark/buffer_external_string.js [cacheMB] [chunkKB]
+//   node --expose-gc benchmark/buffer_external_string.js 500 2048 off
+var Buffer = require('buffer').Buffer;
+
+var cacheMB = +process.argv[2] || 500;
+var chunkKB = +process.argv[3] || 2048;
+if (process.argv[4] === 'off') Buffer.setExternalStringThreshold(0);
+
+if (typeof gc !== 'function') {
+  console.error('run with --expose-gc');
+  process.exit(1);
+}
+
+var chunk = new Buffer(chunkKB * 1024);
+for (var i = 0; i < chunk.length; i++) {
+  chunk[i] = 32 + (i % 95);
+}
+
+var cache = [];
+var count = Math.floor(cacheMB * 1024 / chunkKB);
+
+var start = Date.now();
+for (var i = 0; i < count; i++) {
+  cache.push(chunk.toString('ascii'));
+}
+var built = Date.now() - start;
+
+function pause() {
+  var t = Date.now();
+  gc();
+  return Date.now() - t;
+}
+
+var pauses = [];
+for (var i = 0; i < 5; i++) pauses.push(pause());
+
+var mem = process.memoryUsage();
+console.log('strings:     %d x %d KB', count, chunkKB);
+console.log('build:       %d ms', built);
+console.log('rss:         %d MB', Math.round(mem.rss / 1048576));
+console.log('heapTotal:   %d MB', Math.round(mem.heapTotal / 1048576));
+console.log('heapUsed:    %d MB', Math.round(mem.heapUsed / 1048576));
+console.log('gc pauses:   %s ms', pauses.join(' '));
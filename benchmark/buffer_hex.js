@@ -0,0 +1,34 @@
+// Throughput of hex encoding and decoding for buffers from 16 bytes to
+// 16MB. Reported figures are in MB of binary data per second.
+var Buffer = require('buffer').Buffer;
+
+var sizes = [16, 1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024];
+var total = 128 * 1024 * 1024; // bytes processed per measurement
+
+function bench(name, size, fn) {
+  var iterations = Math.max(1, Math.floor(total / size));
+  var start = Date.now();
+  for (var i = 0; i < iterations; i++) {
+    fn();
+  }
+  var elapsed = Math.max(1, Date.now() - start) / 1000;
+  var mb = size * iterations / (1024 * 1024);
+  console.log('%s\t%d\t%d MB/s', name, size, Math.round(mb / elapsed));
+}
+
+sizes.forEach(function(size) {
+  var b = new Buffer(size);
+  for (var i = 0; i < size; i++) {
+    b[i] = i & 0xff;
+  }
+  var str = b.toString('hex');
+  var out = new Buffer(size);
+
+  bench('encode', size, function() {
+    b.toString('hex');
+  });
+
+  bench('decode', size, function() {
+    if (out.write(str, 0, 'hex') !== size) throw new Error('short write');
+  });
+});
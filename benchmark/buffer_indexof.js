@@ -0,0 +1,47 @@
+// Throughput of Buffer#indexOf for haystacks from 1KB to 64MB. The needle
+// is placed at the very end so that every search scans the whole buffer.
+var Buffer = require('buffer').Buffer;
+
+var sizes = [1024, 16 * 1024, 256 * 1024, 4 * 1024 * 1024, 64 * 1024 * 1024];
+var needles = {
+  'byte': 0x0a,
+  'crlf': '\r\n\r\n',
+  'boundary': '----------------------------7d44e178b0434',
+  'any': ['----------------------------7d44e178b0434', '\r\n\r\n']
+};
+var total = 256 * 1024 * 1024; // bytes scanned per measurement
+
+function haystack(size) {
+  var b = new Buffer(size);
+  for (var i = 0; i < size; i++) {
+    b[i] = 97 + (i % 26);
+  }
+  return b;
+}
+
+function bench(b, name, needle) {
+  var iterations = Math.max(1, Math.floor(total / b.length));
+  var any = Array.isArray(needle);
+  var n = typeof needle === 'number' ? new Buffer([needle]) :
+          any ? new Buffer(needle[0]) : new Buffer(needle);
+  n.copy(b, b.length - n.length);
+
+  var start = Date.now();
+  for (var i = 0; i < iterations; i++) {
+    var r = any ? b.indexOfAny(needle) : b.indexOf(needle);
+    if (r !== b.length - n.length) {
+      throw new Error('wrong result');
+    }
+  }
+  var elapsed = (Date.now() - start) / 1000;
+  var mb = b.length * iterations / (1024 * 1024);
+
+  console.log('%s\t%d\t%d MB/s', name, b.length, Math.round(mb / elapsed));
+}
+
+sizes.forEach(function(size) {
+  var b = haystack(size);
+  for (var name in needles) {
+    bench(b, name, needles[name]);
+  }
+});
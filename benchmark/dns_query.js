@@ -0,0 +1,40 @@
+// DNS queries per second against a local stub server, with `concurrency`
+// queries in flight at any time. Queries bypass the lookup cache, so every
+// one of them is a packet out and a packet back through c-ares.
+//
+//   ./node benchmark/dns_query.js [concurrency] [seconds]
+var path = require('path');
+var dns = require('dns');
+var cares = process.binding('cares');
+var dnsServer = require(path.join(__dirname, '../test/fixtures/dns-server'));
+
+var concurrency = +process.argv[2] || 100;
+var seconds = +process.argv[3] || 5;
+var port = 12346;
+
+var server = dnsServer.createServer({ 'bench.test': { A: ['10.0.0.1'] } });
+server.bind(port);
+
+var channel = dns._createChannel({ servers: ['127.0.0.1'], port: port });
+var done = 0;
+var errors = 0;
+var running = true;
+var start = Date.now();
+
+function query() {
+  channel.query('bench.test', cares.A, function(err) {
+    if (err) errors++;
+    done++;
+    if (running) query();
+  });
+}
+
+for (var i = 0; i < concurrency; i++) query();
+
+setTimeout(function() {
+  running = false;
+  var elapsed = (Date.now() - start) / 1000;
+  console.log('concurrency %d: %d queries/s (%d errors)',
+              concurrency, Math.round(done / elapsed), errors);
+  server.close();
+}, seconds * 1000);
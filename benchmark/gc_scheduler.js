@@ -0,0 +1,87 @@
+// Synthetic load for comparing the idle GC schedulers. A child process runs
+// a server-like workload - bursts of requests that allocate short and
+// long-lived objects, separated by short waits - under each scheduler, and
+// the GC pauses that landed in the middle of request handling are reported.
+// Pauses taken in idle slices do not delay requests and are counted
+// separately.
+//
+//   ./node benchmark/gc_scheduler.js [seconds]
+var spawn = require('child_process').spawn;
+
+var seconds = +process.argv[2] || 10;
+
+if (process.argv[2] === 'child') {
+  child(+process.argv[3]);
+} else {
+  var modes = ['off', 'legacy', 'adaptive'];
+  (function next() {
+    var mode = modes.shift();
+    if (!mode) return;
+    var out = '';
+    var c = spawn(process.execPath,
+                  ['--gc-scheduler=' + mode, __filename, 'child', seconds]);
+    c.stdout.on('data', function(d) { out += d; });
+    c.stderr.pipe(process.stderr);
+    c.on('exit', function() {
+      var r = JSON.parse(out);
+      console.log('%s\tp99 %d ms\tmax %d ms\tin requests %d\tidle %d',
+                  mode, r.p99, r.max, r.busy, r.idle);
+      next();
+    });
+  })();
+}
+
+
+function percentile(a, p) {
+  if (a.length === 0) return 0;
+  a.sort(function(x, y) { return x - y; });
+  return a[Math.min(a.length - 1, Math.floor(a.length * p))];
+}
+
+
+function child(seconds) {
+  var retained = [];
+  var end = Date.now() + seconds * 1000;
+  var busy = [];
+  var idle = 0;
+
+  process.on('gc', function(e) {
+    if (e.idle) {
+      idle++;
+    } else {
+      busy.push(e.pause);
+    }
+  });
+
+  function request() {
+    var garbage = [];
+    for (var i = 0; i < 2000; i++) {
+      garbage.push({ id: i, name: 'request' + i, tags: [i, i + 1] });
+    }
+    // Some objects live long enough to be promoted to the old generation.
+    retained.push(garbage.slice(0, 200));
+    if (retained.length > 200) retained.shift();
+  }
+
+  function burst() {
+    var n = 1 + Math.floor(Math.random() * 5);
+    for (var i = 0; i < n; i++) request();
+
+    if (Date.now() < end) {
+      setTimeout(burst, Math.floor(Math.random() * 20));
+    } else {
+      setTimeout(report, 0);
+    }
+  }
+
+  function report() {
+    process.stdout.write(JSON.stringify({
+      p99: Math.round(percentile(busy, 0.99) * 100) / 100,
+      max: Math.round(percentile(busy, 1) * 100) / 100,
+      busy: busy.length,
+      idle: idle
+    }));
+  }
+
+  burst();
+}
@@ -0,0 +1,56 @@
+// Client requests per second against a local server, with a new connection
+// per request and with keep-alive connections reused from the agent's pool.
+//
+//   ./node benchmark/http_agent.js [seconds] [concurrency]
+var http = require('http');
+
+var seconds = +process.argv[2] || 5;
+var concurrency = +process.argv[3] || 5;
+var port = +process.env.PORT || 12346;
+
+var server = http.createServer(function(req, res) {
+  res.writeHead(200, { 'Content-Type': 'text/plain' });
+  res.end('hello world\n');
+});
+
+function run(keepAlive, cb) {
+  var agent = new http.Agent({ host: '127.0.0.1',
+                               port: port,
+                               keepAlive: keepAlive,
+                               maxSockets: concurrency,
+                               maxFreeSockets: concurrency });
+  var options = { host: '127.0.0.1', port: port, path: '/', agent: agent };
+  var done = 0;
+  var running = true;
+  var start = Date.now();
+
+  function request() {
+    http.get(options, function(res) {
+      res.on('end', function() {
+        done++;
+        if (running) request();
+      });
+    });
+  }
+
+  for (var i = 0; i < concurrency; i++) request();
+
+  setTimeout(function() {
+    running = false;
+    var elapsed = (Date.now() - start) / 1000;
+    var stats = agent.stats();
+    console.log('%s: %d req/s, %d connections',
+                keepAlive ? 'keep-alive' : 'no reuse  ',
+                Math.round(done / elapsed), stats.created);
+    setTimeout(cb, 500);
+  }, seconds * 1000);
+}
+
+server.listen(port, '127.0.0.1', function() {
+  run(false, function() {
+    run(true, function() {
+      server.close();
+      process.exit(0);
+    });
+  });
+});
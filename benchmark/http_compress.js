@@ -0,0 +1,91 @@
+// Serves the same text body uncompressed and through response.compress()
+// at a few levels, and reports requests per second, mean latency and bytes
+// on the wire for each. The server runs in a child.
+//
+//   ./node benchmark/http_compress.js [seconds] [concurrency] [size]
+var http = require('http');
+var spawn = require('child_process').spawn;
+
+var seconds = +process.argv[2] || 5;
+var concurrency = +process.argv[3] || 20;
+var size = +process.argv[4] || 64 * 1024;
+var port = +process.env.PORT || 12346;
+
+if (process.argv[2] === 'child') {
+  var body = '';
+  while (body.length < +process.argv[3]) {
+    body += 'the quick brown fox jumps over the lazy dog ' + body.length + '\n';
+  }
+  body = new Buffer(body);
+
+  http.createServer(function(req, res) {
+    var level = req.url.slice(1);
+    if (level !== 'plain') res.compress({ level: +level });
+    res.writeHead(200, { 'Content-Type': 'text/plain' });
+    res.end(body);
+  }).listen(port, function() {
+    console.log('ready');
+  });
+  return;
+}
+
+var runs = ['plain', '1', '6', '9'];
+
+var server = spawn(process.execPath, [__filename, 'child', size]);
+server.stderr.pipe(process.stderr);
+server.stdout.once('data', function() {
+  next();
+});
+
+function next() {
+  var run = runs.shift();
+  if (!run) {
+    server.kill();
+    return;
+  }
+  bench(run, next);
+}
+
+function bench(path, cb) {
+  var agent = http.getAgent({ host: '127.0.0.1', port: port });
+  agent.maxSockets = concurrency;
+
+  var headers = { 'Accept-Encoding': path === 'plain' ? 'identity' : 'gzip' };
+  var requests = 0;
+  var bytes = 0;
+  var latency = 0;
+  var running = true;
+  var active = 0;
+
+  setTimeout(function() {
+    running = false;
+  }, seconds * 1000);
+
+  for (var i = 0; i < concurrency; i++) request();
+
+  function request() {
+    var start = Date.now();
+    active++;
+    http.get({ host: '127.0.0.1', port: port, path: '/' + path,
+               headers: headers, agent: agent }, function(res) {
+      res.on('data', function(chunk) {
+        bytes += chunk.length;
+      });
+      res.on('end', function() {
+        active--;
+        requests++;
+        latency += Date.now() - start;
+        if (running) {
+          request();
+        } else if (active === 0) {
+          var name = path === 'plain' ? 'uncompressed' : 'gzip level ' + path;
+          console.log(name + ': ' +
+                      (requests / seconds).toFixed(0) + ' req/s, ' +
+                      (latency / requests).toFixed(2) + ' ms mean, ' +
+                      (bytes / requests).toFixed(0) + ' bytes/response');
+          cb();
+        }
+      });
+    });
+  }
+}
@@ -0,0 +1,91 @@
+// Requests per second from pipelining clients at depths 1, 8 and 32: each
+// connection sends `depth` requests at once and the next batch once all of
+// their responses are in. The server runs in a child.
+//
+//   ./node benchmark/http_pipeline.js [seconds] [connections]
+var http = require('http');
+var net = require('net');
+var spawn = require('child_process').spawn;
+
+var seconds = +process.argv[2] || 5;
+var connections = +process.argv[3] || 10;
+var port = +process.env.PORT || 12346;
+
+if (process.argv[2] === 'child') {
+  var body = new Buffer('hello world\n');
+  http.createServer(function(req, res) {
+    res.writeHead(200, { 'Content-Type': 'text/plain',
+                         'Content-Length': body.length });
+    res.end(body);
+  }).listen(port, function() {
+    console.log('ready');
+  });
+  return;
+}
+
+var depths = [1, 8, 32];
+
+var server = spawn(process.execPath, [__filename, 'child']);
+server.stderr.pipe(process.stderr);
+server.stdout.once('data', function() {
+  next();
+});
+
+function next() {
+  var depth = depths.shift();
+  if (!depth) {
+    server.kill();
+    return;
+  }
+  run(depth, function(requests) {
+    console.log('depth %d: %d req/s', depth, Math.round(requests / seconds));
+    next();
+  });
+}
+
+function run(depth, cb) {
+  var batch = '';
+  for (var i = 0; i < depth; i++) batch += 'GET / HTTP/1.1\r\n\r\n';
+
+  var requests = 0;
+  var running = true;
+  var open = connections;
+
+  for (i = 0; i < connections; i++) {
+    (function() {
+      var client = net.createConnection(port);
+      var pending = 0;
+      var tail = '';
+      client.setEncoding('ascii');
+
+      function send() {
+        pending = depth;
+        client.write(batch);
+      }
+
+      client.on('connect', send);
+      client.on('data', function(d) {
+        // Every response starts with its status line. The tail of the last
+        // chunk catches status lines split across two chunks.
+        d = tail + d;
+        tail = d.slice(-11);
+        var n = d.split('HTTP/1.1 200').length - 1;
+        pending -= n;
+        requests += n;
+        if (pending > 0) return;
+        if (running) {
+          send();
+        } else {
+          client.end();
+        }
+      });
+      client.on('close', function() {
+        if (--open === 0) cb(requests);
+      });
+    })();
+  }
+
+  setTimeout(function() {
+    running = false;
+  }, seconds * 1000);
+}
@@ -0,0 +1,104 @@
+// Throughput of a server sending a file with response.sendFile() and with
+// fs.createReadStream().pipe(response), and the server's CPU time per GB
+// sent. The server runs in a child; CPU time is read from /proc, so it is
+// only reported on Linux.
+//
+//   ./node benchmark/http_sendfile.js [seconds] [connections] [MB]
+var http = require('http');
+var fs = require('fs');
+var path = require('path');
+var spawn = require('child_process').spawn;
+
+var seconds = +process.argv[2] || 5;
+var connections = +process.argv[3] || 4;
+var size = (+process.argv[4] || 16) * 1024 * 1024;
+var port = +process.env.PORT || 12346;
+var file = path.join(__dirname, 'http_sendfile.tmp');
+
+if (process.argv[2] === 'child') {
+  var mode = process.argv[3];
+  var length = fs.statSync(file).size;
+  http.createServer(function(req, res) {
+    if (mode === 'sendfile') {
+      res.sendFile(file);
+    } else {
+      res.writeHead(200, { 'Content-Length': length });
+      fs.createReadStream(file).pipe(res);
+    }
+  }).listen(port, function() {
+    console.log('ready');
+  });
+  return;
+}
+
+var data = new Buffer(size);
+for (var i = 0; i < size; i++) data[i] = i & 0xff;
+fs.writeFileSync(file, data);
+
+var modes = ['sendfile', 'stream'];
+
+next();
+
+function next() {
+  var mode = modes.shift();
+  if (!mode) {
+    fs.unlinkSync(file);
+    return;
+  }
+
+  var server = spawn(process.execPath, [__filename, 'child', mode]);
+  server.stderr.pipe(process.stderr);
+  server.stdout.once('data', function() {
+    var cpu = cpuTime(server.pid);
+    run(function(bytes) {
+      var gb = bytes / (1024 * 1024 * 1024);
+      var line = mode + ': ' + Math.round(gb * 1024 / seconds) + ' MB/s';
+      if (cpu !== null) {
+        cpu = cpuTime(server.pid) - cpu;
+        line += ', ' + (cpu / gb).toFixed(2) + ' CPU s/GB';
+      }
+      console.log(line);
+      server.kill();
+      next();
+    });
+  });
+}
+
+// utime + stime of a process in seconds, or null without /proc.
+function cpuTime(pid) {
+  try {
+    var stat = fs.readFileSync('/proc/' + pid + '/stat', 'ascii');
+  } catch (e) {
+    return null;
+  }
+  // The command name may contain spaces; the fields after it do not.
+  var fields = stat.slice(stat.lastIndexOf(')') + 2).split(' ');
+  return (+fields[11] + +fields[12]) / 100;
+}
+
+function run(cb) {
+  var bytes = 0;
+  var running = true;
+  var open = connections;
+
+  for (var i = 0; i < connections; i++) get();
+
+  function get() {
+    http.get({ port: port, path: '/' }, function(res) {
+      res.on('data', function(chunk) {
+        bytes += chunk.length;
+      });
+      res.on('end', function() {
+        if (running) {
+          get();
+        } else if (--open === 0) {
+          cb(bytes);
+        }
+      });
+    });
+  }
+
+  setTimeout(function() {
+    running = false;
+  }, seconds * 1000);
+}
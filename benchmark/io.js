@@ -98,7 +98,7 @@ function nextrt() {
   if (bsizes.length <= bs) {
     fs.unlink(path, function (err) {
       if (err) throw err;
-      console.log('All done!');
+      smallfiles();
     });
     return;
   }
@@ -106,4 +106,61 @@ function nextrt() {
   bs += 1;
 }
 
-nextwt();
+// Many small files, the way a template or config loader reads them:
+// fs.readFile, fs.readFileSync, and the ReadStream that readFile used to be.
+var sdir = '/tmp/wt.small';
+var scount = 2000;
+var ssize = 2048;
+
+function smallfiles() {
+  try { fs.mkdirSync(sdir, 0755); } catch (e) {}
+  var buf = bufit(ssize);
+  for (var i = 0; i < scount; i++) {
+    fs.writeFileSync(sdir + '/' + i, buf);
+  }
+
+  var tests = [
+    ['readFile', function(file, cb) { fs.readFile(file, cb); }],
+    ['readFile utf8', function(file, cb) { fs.readFile(file, 'utf8', cb); }],
+    ['readFileSync', function(file, cb) { cb(null, fs.readFileSync(file)); }],
+    ['ReadStream', streamed]
+  ];
+
+  (function nexts() {
+    var test = tests.shift();
+    if (!test) {
+      for (var i = 0; i < scount; i++) fs.unlinkSync(sdir + '/' + i);
+      fs.rmdirSync(sdir);
+      console.log('All done!');
+      return;
+    }
+
+    var start = Date.now();
+    var pending = scount;
+    for (var i = 0; i < scount; i++) {
+      test[1](sdir + '/' + i, function(err, data) {
+        if (err) throw err;
+        if (--pending > 0) return;
+        var diff = Date.now() - start;
+        console.log('Read ' + scount + ' files of ' + ssize + ' bytes with ' +
+                    test[0] + ' in ' + diff / 1000 + 's: ' +
+                    (scount / (diff / 1000)).toFixed(0) + ' files/s');
+        nexts();
+      });
+    }
+  })();
+}
+
+function streamed(file, cb) {
+  var buffers = [];
+  var s = fs.createReadStream(file);
+  s.on('data', function(chunk) { buffers.push(chunk); });
+  s.on('error', cb);
+  s.on('end', function() { cb(null, Buffer.concat(buffers)); });
+}
+
+if (process.argv[2] === 'small') {
+  smallfiles();
+} else {
+  nextwt();
+}
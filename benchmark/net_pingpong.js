@@ -0,0 +1,95 @@
+// The two deps/uv benchmarks through the net module: ping_pongs (one
+// connection bouncing a short message) and pump (one connection writing
+// 64kb buffers as fast as it can). Each runs in a child for both backends.
+//
+//   ./node benchmark/net_pingpong.js [seconds]
+var spawn = require('child_process').spawn;
+
+var seconds = +process.argv[2] || 5;
+var port = +process.env.PORT || 12346;
+
+if (process.argv[2] === 'child') {
+  var tests = { pingpong: pingpong, pump: pump };
+  tests[process.argv[3]](+process.argv[4]);
+} else {
+  var runs = [['pingpong', []], ['pingpong', ['--use-uv']],
+              ['pump', []], ['pump', ['--use-uv']]];
+  (function next() {
+    var run = runs.shift();
+    if (!run) return;
+    var args = run[1].concat([__filename, 'child', run[0], seconds]);
+    var c = spawn(process.execPath, args);
+    c.stdout.pipe(process.stdout, { end: false });
+    c.stderr.pipe(process.stderr, { end: false });
+    c.on('exit', next);
+  })();
+}
+
+
+function backend() {
+  return process.useUV ? 'uv' : 'legacy';
+}
+
+
+function pingpong(seconds) {
+  var net = require('net');
+  var count = 0;
+  var done = false;
+
+  var server = net.createServer(function(socket) {
+    socket.setNoDelay();
+    socket.ondata = function(d, start, end) {
+      socket.write(d.slice(start, end));
+    };
+  });
+
+  server.listen(port, function() {
+    var client = net.createConnection(port);
+    client.setNoDelay();
+    client.on('connect', function() { client.write('PING'); });
+    client.ondata = function() {
+      count++;
+      if (!done) client.write('PING');
+    };
+
+    setTimeout(function() {
+      done = true;
+      console.log('pingpong\t%s\t%d roundtrips/s', backend(),
+                  Math.round(count / seconds));
+      client.destroy();
+      server.close();
+    }, seconds * 1000);
+  });
+}
+
+
+function pump(seconds) {
+  var net = require('net');
+  var chunk = new Buffer(64 * 1024);
+  var received = 0;
+  var done = false;
+
+  var server = net.createServer(function(socket) {
+    socket.ondata = function(d, start, end) {
+      received += end - start;
+    };
+  });
+
+  server.listen(port, function() {
+    var client = net.createConnection(port);
+
+    function write() {
+      while (!done && client.write(chunk));
+    }
+    client.on('connect', write);
+    client.on('drain', write);
+
+    setTimeout(function() {
+      done = true;
+      console.log('pump\t\t%s\t%d MB/s', backend(),
+                  Math.round(received / seconds / (1024 * 1024)));
+      client.destroy();
+      server.close();
+    }, seconds * 1000);
+  });
+}
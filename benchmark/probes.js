@@ -0,0 +1,29 @@
+// Cost of a probe site when no tracer is attached. Every build defines the
+// DTRACE_* functions; with probes compiled in they check the probe's
+// semaphore and return, without them they do nothing at all. Both are
+// compared against calling an empty JavaScript function. Run it again with
+// a tracer attached (e.g. `bpftrace -e 'usdt:./node:node:* {}'`) to see the
+// enabled cost.
+var n = +process.argv[2] || 1e7;
+
+var conn = {
+  fd: 5,
+  remoteAddress: '127.0.0.1',
+  remotePort: 8000,
+  bufferSize: 0
+};
+
+function empty(c, b) {}
+
+function bench(name, fn) {
+  var start = Date.now();
+  for (var i = 0; i < n; i++) fn(conn, 1);
+  var elapsed = Date.now() - start;
+  console.log('%s\t%d ns/call', name, Math.round(elapsed * 1e6 / n));
+  return elapsed;
+}
+
+bench('warmup', empty);
+var base = bench('empty function', empty);
+var probe = bench('net__socket__read', DTRACE_NET_SOCKET_READ);
+console.log('overhead\t%d ns/call', Math.round((probe - base) * 1e6 / n));
@@ -0,0 +1,59 @@
+// Cost of running the CPU profiler. The same CPU-bound workload (deep call
+// trees, many distinct functions) runs with and without a profile being
+// collected, and the slowdown is reported along with the time it takes to
+// serialize the profile.
+var profiler = require('profiler');
+
+var rounds = +process.argv[2] || 5;
+
+function fib(n) {
+  return n < 2 ? n : fib(n - 1) + fib(n - 2);
+}
+
+function sortStrings() {
+  var a = [];
+  for (var i = 0; i < 20000; i++) a.push(String(Math.random()));
+  return a.sort().length;
+}
+
+function buildObjects() {
+  var o = [];
+  for (var i = 0; i < 50000; i++) o.push({ i: i, s: 'x' + i });
+  return JSON.stringify(o).length;
+}
+
+function workload() {
+  var start = Date.now();
+  fib(27);
+  sortStrings();
+  buildObjects();
+  return Date.now() - start;
+}
+
+function measure(profiled) {
+  var best = Infinity;
+  for (var i = 0; i < rounds; i++) {
+    if (profiled) profiler.startProfiling('bench');
+    var elapsed = workload();
+    if (profiled) {
+      var t = Date.now();
+      var stacks = profiler.stopProfiling('bench', 'collapsed');
+      serialize = Math.max(serialize, Date.now() - t);
+      lines = stacks.split('\n').length - 1;
+    }
+    best = Math.min(best, elapsed);
+  }
+  return best;
+}
+
+var serialize = 0;
+var lines = 0;
+
+workload(); // warm up
+var base = measure(false);
+var profiled = measure(true);
+
+console.log('unprofiled\t%d ms', base);
+console.log('profiled\t%d ms', profiled);
+console.log('overhead\t%d%%', Math.round((profiled - base) / base * 1000) / 10);
+console.log('serialize\t%d ms (%d stacks)', serialize, lines);
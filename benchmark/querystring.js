@@ -0,0 +1,66 @@
+// querystring.parse and stringify, native against the JavaScript versions.
+// The JavaScript paths are what the module falls back to when
+// querystring.unescape or querystring.escape is replaced, so replacing them
+// with the previous implementations measures the old code.
+//
+//   ./node benchmark/querystring.js [iterations]
+var qs = require('querystring');
+var Buffer = require('buffer').Buffer;
+
+var iterations = +process.argv[2] || 20000;
+
+var inputs = {
+  'short': 'q=node&page=2',
+  'form': [],
+  'escaped': [],
+  'repeated': []
+};
+for (var i = 0; i < 50; i++) {
+  inputs.form.push('field' + i + '=value+number+' + i);
+  inputs.escaped.push('k%5B' + i + '%5D=%E2%82%AC%20' + i + '%26more');
+  inputs.repeated.push('id=' + i);
+}
+inputs.form = inputs.form.join('&');
+inputs.escaped = inputs.escaped.join('&');
+inputs.repeated = inputs.repeated.join('&');
+
+var nativeUnescape = qs.unescape;
+var nativeEscape = qs.escape;
+
+function jsUnescape(s, decodeSpaces) {
+  return qs.unescapeBuffer(s, decodeSpaces).toString();
+}
+
+function jsEscape(s) {
+  return encodeURIComponent(s);
+}
+
+function time(fn) {
+  var start = Date.now();
+  for (var i = 0; i < iterations; i++) fn();
+  var ms = Date.now() - start;
+  return Math.round(iterations / ms * 1000);
+}
+
+Object.keys(inputs).forEach(function(name) {
+  var s = inputs[name];
+  var b = new Buffer(s);
+  var obj = qs.parse(s);
+
+  qs.unescape = jsUnescape;
+  var jsParse = time(function() { qs.parse(s); });
+  qs.unescape = nativeUnescape;
+  var nativeParse = time(function() { qs.parse(s); });
+  var bufferParse = time(function() { qs.parse(b); });
+
+  qs.escape = jsEscape;
+  var jsStringify = time(function() { qs.stringify(obj); });
+  qs.escape = nativeEscape;
+  var nativeStringify = time(function() { qs.stringify(obj); });
+
+  console.log('%s (%d bytes)', name, s.length);
+  console.log('  parse      js %d/s\tnative %d/s\tbuffer %d/s',
+              jsParse, nativeParse, bufferParse);
+  console.log('  stringify  js %d/s\tnative %d/s',
+              jsStringify, nativeStringify);
+});
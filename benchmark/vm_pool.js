@@ -0,0 +1,30 @@
+// Evaluations per second of small snippets, each in a fresh global:
+// vm.runInNewContext against a context pool that gives every run a new
+// context (the default) and one that reuses them, with the code compiled
+// on every call and with a Script compiled once.
+//
+//   ./node benchmark/vm_pool.js [iterations]
+var vm = require('vm');
+
+var iterations = +process.argv[2] || 5000;
+var code = 'var total = 0; for (var i = 0; i < n; i++) total += i; total';
+var script = vm.createScript(code, 'bench.vm');
+var pool = vm.createContextPool({ size: 4 });
+var reuse = vm.createContextPool({ size: 4, maxUses: 0 });
+
+function time(fn) {
+  var start = Date.now();
+  for (var i = 0; i < iterations; i++) fn({ n: 10 });
+  var ms = Date.now() - start;
+  return Math.round(iterations / ms * 1000);
+}
+
+console.log('runInNewContext  code %d/s\tscript %d/s',
+            time(function(sandbox) { vm.runInNewContext(code, sandbox); }),
+            time(function(sandbox) { script.runInNewContext(sandbox); }));
+console.log('pool             code %d/s\tscript %d/s',
+            time(function(sandbox) { pool.run(code, sandbox); }),
+            time(function(sandbox) { pool.run(script, sandbox); }));
+console.log('pool, reused     code %d/s\tscript %d/s',
+            time(function(sandbox) { reuse.run(code, sandbox); }),
+            time(function(sandbox) { reuse.run(script, sandbox); }));
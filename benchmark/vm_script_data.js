@@ -0,0 +1,35 @@
+// Compile time per call for a large script with and without the pre-parse
+// data from script.createCachedData(). Every call uses a different file name
+// so that V8's compilation cache does not hide the parse; the data is only
+// used for the exact source it was made from.
+//
+//   ./node benchmark/vm_script_data.js [iterations] [functions]
+var vm = require('vm');
+
+var iterations = +process.argv[2] || 500;
+var functions = +process.argv[3] || 500;
+
+var code = [];
+for (var i = 0; i < functions; i++) {
+  code.push('function f' + i + '(a, b) {\n' +
+            '  var s = "' + i + '";\n' +
+            '  for (var j = 0; j < a; j++) s += b[j] + ",";\n' +
+            '  return s;\n' +
+            '}');
+}
+code = code.join('\n');
+
+var data = vm.createScript(code, 'bench.vm').createCachedData();
+
+function time(cachedData) {
+  var start = Date.now();
+  for (var i = 0; i < iterations; i++) {
+    vm.createScript(code, 'bench' + i + '.vm', cachedData);
+  }
+  return (Date.now() - start) / iterations;
+}
+
+console.log('%d bytes of code, %d bytes of cached data',
+            code.length, data.length);
+console.log('without cached data %s ms/compile', time().toFixed(3));
+console.log('with cached data    %s ms/compile', time(data).toFixed(3));
@@ -0,0 +1,61 @@
+// Idle cost of fs.watchFile with and without inotify. A child process
+// watches N files, each with the default polling interval when polling,
+// and sits idle; the CPU time it uses is read from /proc/self/stat.
+//
+//   ./node benchmark/watch_files.js [files] [seconds]
+var spawn = require('child_process').spawn;
+var fs = require('fs');
+var path = require('path');
+
+var files = +process.argv[2] || 1000;
+var seconds = +process.argv[3] || 10;
+
+if (process.argv[2] === 'child') {
+  child(process.argv[3] === 'poll', +process.argv[4], +process.argv[5]);
+} else {
+  var modes = ['poll', 'inotify'];
+  (function next() {
+    var mode = modes.shift();
+    if (!mode) return;
+    var out = '';
+    var c = spawn(process.execPath,
+                  [__filename, 'child', mode, files, seconds]);
+    c.stdout.on('data', function(d) { out += d; });
+    c.stderr.pipe(process.stderr);
+    c.on('exit', function() {
+      var r = JSON.parse(out);
+      console.log('%s\t%d files\t%d ms cpu in %d s (%s%%)', mode, files,
+                  r.cpu, seconds, (r.cpu / (seconds * 10)).toFixed(2));
+      next();
+    });
+  })();
+}
+
+function cpuTime() {
+  // utime and stime, fields 14 and 15, in clock ticks (usually 100 Hz).
+  var f = fs.readFileSync('/proc/self/stat', 'ascii');
+  f = f.slice(f.lastIndexOf(')') + 2).split(' ');
+  return (+f[11] + +f[12]) * 10;
+}
+
+function child(poll, n, seconds) {
+  var dir = path.join('/tmp', 'watch-files-' + process.pid);
+  fs.mkdirSync(dir, 0755);
+  for (var i = 0; i < n; i++) {
+    var file = path.join(dir, 'f' + i);
+    fs.writeFileSync(file, '');
+    fs.watchFile(file, { poll: poll }, function() {});
+  }
+
+  var start = cpuTime();
+  setTimeout(function() {
+    var cpu = cpuTime() - start;
+    for (var i = 0; i < n; i++) {
+      var file = path.join(dir, 'f' + i);
+      fs.unwatchFile(file);
+      fs.unlinkSync(file);
+    }
+    fs.rmdirSync(dir);
+    process.stdout.write(JSON.stringify({ cpu: cpu }));
+  }, seconds * 1000);
+}
@@ -90,14 +90,22 @@ else()
 endif()
 
 if(DTRACE)
-  if(NOT ${node_platform} MATCHES sunos)
-    message(FATAL_ERROR "DTrace support only currently available on Solaris")
+  if(${node_platform} MATCHES sunos)
+    find_program(dtrace_bin dtrace)
+    if(NOT dtrace_bin)
+      message(FATAL_ERROR "DTrace binary not found")
+    endif()
+    add_definitions(-DHAVE_DTRACE=1)
+  elseif(${node_platform} MATCHES linux)
+    # SystemTap compatible USDT probes, see src/node_probes.h
+    find_path(sdt_include sys/sdt.h)
+    if(NOT sdt_include)
+      message(FATAL_ERROR "sys/sdt.h not found, install the SystemTap SDT headers")
+    endif()
+    add_definitions(-DHAVE_SYSTEMTAP=1)
+  else()
+    message(FATAL_ERROR "DTrace support only currently available on Solaris and Linux")
   endif()
-  find_program(dtrace_bin dtrace)
-  if(NOT dtrace_bin)
-    message(FATAL_ERROR "DTrace binary not found")
-  endif()
-  add_definitions(-DHAVE_DTRACE=1)
 endif()
 
 add_definitions(
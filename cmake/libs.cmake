@@ -8,6 +8,7 @@ set(HAVE_CONFIG_H True)
 add_definitions(-DHAVE_CONFIG_H=1)
 
 find_package(OpenSSL QUIET)
+find_package(ZLIB QUIET)
 find_package(Threads)
 find_library(RT rt)
 find_library(DL dl)
@@ -47,6 +48,14 @@ if(OPENSSL_FOUND)
   set(extra_libs ${extra_libs} ${OPENSSL_LIBRARIES})
 endif()
 
+if(ZLIB_FOUND)
+  add_definitions(-DHAVE_ZLIB=1)
+  set(HAVE_ZLIB True)
+  include_directories(${ZLIB_INCLUDE_DIRS})
+  set(node_extra_src ${node_extra_src} src/node_zlib.cc)
+  set(extra_libs ${extra_libs} ${ZLIB_LIBRARIES})
+endif()
+
 include("cmake/libc-ares.cmake")
 include("cmake/libev.cmake")
 include("cmake/libv8.cmake")
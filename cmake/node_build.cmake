@@ -45,6 +45,9 @@ set(node_sources
   src/node_main.cc
   src/node.cc
   src/node_buffer.cc
+  src/node_buffer_list.cc
+  src/node_search.cc
+  src/node_hex.cc
   src/node_javascript.cc
   src/node_extensions.cc
   src/node_http_parser.cc
@@ -57,10 +60,21 @@ set(node_sources
   src/node_file.cc
   src/node_signal_watcher.cc
   src/node_stat_watcher.cc
+  src/node_inotify.cc
+  src/node_tree_watcher.cc
   src/node_stdio.cc
   src/node_timer.cc
   src/node_script.cc
   src/node_os.cc
+  src/node_profiler.cc
+  src/node_querystring.cc
+  src/node_url.cc
+  src/node_handle_wrap.cc
+  src/node_stream_wrap.cc
+  src/node_tcp_wrap.cc
+  src/node_gc_stats.cc
+  src/node_gc_scheduler.cc
+  src/node_loop_stats.cc
   src/node_dtrace.cc
   src/node_string.cc
   src/node_natives.h
@@ -19,7 +19,9 @@
 // OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
 // USE OR OTHER DEALINGS IN THE SOFTWARE.
 
-var SlowBuffer = process.binding('buffer').SlowBuffer;
+var binding = process.binding('buffer');
+var SlowBuffer = binding.SlowBuffer;
+var BufferList = binding.BufferList;
 var IEEE754 = require('buffer_ieee754');
 var assert = require('assert');
 
@@ -40,21 +42,6 @@ SlowBuffer.prototype.inspect = function() {
 };
 
 
-SlowBuffer.prototype.hexSlice = function(start, end) {
-  var len = this.length;
-
-  if (!start || start < 0) start = 0;
-  if (!end || end < 0 || end > len) end = len;
-
-  var out = '';
-  for (var i = start; i < end; i++) {
-    out += toHex(this[i]);
-  }
-  return out;
-};
-
-
-
 SlowBuffer.prototype.toString = function(encoding, start, end) {
   encoding = String(encoding || 'utf8').toLowerCase();
   start = +start || 0;
@@ -92,23 +79,6 @@ SlowBuffer.prototype.toString = function(encoding, start, end) {
 };
 
 
-SlowBuffer.prototype.hexWrite = function(string, offset) {
-  var len = string.length;
-  offset = +offset || 0;
-
-  // must be an even number of digits
-  if (len % 2) {
-    throw new Error('Invalid hex string');
-  }
-  for (var i = 0; i < len / 2; i++) {
-    var byte = parseInt(string.substr(i * 2, 2), 16);
-    if (isNaN(byte)) throw new Error('Invalid hex string');
-    this[offset + i] = byte;
-  }
-  return i;
-};
-
-
 SlowBuffer.prototype.write = function(string, offset, encoding) {
   // Support both (string, offset, encoding)
   // and the legacy (string, encoding, offset)
@@ -232,6 +202,7 @@ function isArrayIsh(subject) {
 
 exports.SlowBuffer = SlowBuffer;
 exports.Buffer = Buffer;
+exports.BufferList = BufferList;
 
 Buffer.poolSize = 8 * 1024;
 var pool;
@@ -248,6 +219,32 @@ Buffer.isBuffer = function isBuffer(b) {
 };
 
 
+// concat(list, [totalLength])
+// Allocates the result once and copies every chunk into it natively.
+Buffer.concat = function(list, length) {
+  if (!Array.isArray(list)) {
+    throw new Error('Usage: Buffer.concat(list, [length])');
+  }
+
+  if (list.length === 0) {
+    return new Buffer(0);
+  } else if (list.length === 1) {
+    return list[0];
+  }
+
+  if (typeof length !== 'number') {
+    length = 0;
+    for (var i = 0; i < list.length; i++) {
+      length += list[i].length;
+    }
+  }
+
+  var buffer = new Buffer(length);
+  SlowBuffer.concat(list, buffer);
+  return buffer;
+};
+
+
 // Inspect
 Buffer.prototype.inspect = function inspect() {
   var out = [],
@@ -374,6 +371,12 @@ Buffer.prototype.toString = function(encoding, start, end) {
 Buffer.byteLength = SlowBuffer.byteLength;
 
 
+// setExternalStringThreshold(bytes)
+// toString() results of at least this many bytes of 7-bit data are kept
+// outside the V8 heap. Returns the previous value; 0 disables.
+Buffer.setExternalStringThreshold = SlowBuffer.setExternalStringThreshold;
+
+
 // fill(value, start=0, end=buffer.length)
 Buffer.prototype.fill = function fill (value, start, end) {
   value || (value = 0);
@@ -448,6 +451,37 @@ Buffer.prototype.copy = function(target, target_start, start, end) {
 };
 
 
+// indexOf(value, offset=0)
+// value can be a byte, a string (matched as utf8) or a Buffer.
+Buffer.prototype.indexOf = function(value, offset) {
+  offset = +offset || 0;
+  if (offset < 0) offset = 0;
+  if (offset > this.length) return -1;
+
+  var i = this.parent.indexOf(value,
+                              this.offset + offset,
+                              this.offset + this.length);
+  return i < 0 ? -1 : i - this.offset;
+};
+
+
+// indexOfAny(values, offset=0)
+// Finds the first occurrence of any of the strings or Buffers in values with
+// a single pass over the buffer. Which one matched is stored in
+// Buffer._matchedNeedle.
+Buffer.prototype.indexOfAny = function(values, offset) {
+  offset = +offset || 0;
+  if (offset < 0) offset = 0;
+  if (offset > this.length) return -1;
+
+  var i = this.parent.indexOfAny(values,
+                                 this.offset + offset,
+                                 this.offset + this.length);
+  Buffer._matchedNeedle = SlowBuffer._matchedNeedle;
+  return i < 0 ? -1 : i - this.offset;
+};
+
+
 // slice(start, end)
 Buffer.prototype.slice = function(start, end) {
   if (end === undefined) end = this.length;
@@ -458,6 +492,37 @@ Buffer.prototype.slice = function(start, end) {
 };
 
 
+// BufferList
+
+// toBuffer(start=0, end=list.length)
+// Flattens (part of) the list into a single newly allocated Buffer.
+BufferList.prototype.toBuffer = function(start, end) {
+  start = +start || 0;
+  if (end === undefined || end > this.length) end = this.length;
+  if (start > end) throw new Error('oob');
+
+  var buffer = new Buffer(end - start);
+  if (buffer.length > 0) this.copy(buffer, 0, start, end);
+  return buffer;
+};
+
+
+// toString(encoding, start=0, end=list.length)
+BufferList.prototype.toString = function(encoding, start, end) {
+  return this.toBuffer(start, end).toString(encoding);
+};
+
+
+BufferList.prototype.inspect = function() {
+  var out = [],
+      len = this.length;
+  for (var i = 0; i < len; i++) {
+    out[i] = toHex(this.get(i));
+  }
+  return '<BufferList ' + out.join(' ') + '>';
+};
+
+
 // Legacy methods for backwards compatibility.
 
 Buffer.prototype.utf8Slice = function(start, end) {
@@ -21,7 +21,7 @@
 
 var util = require('util');
 var EventEmitter = require('events').EventEmitter;
-var Stream = require('net').Stream;
+var Stream = require('net_legacy').Stream;
 var InternalChildProcess = process.binding('child_process').ChildProcess;
 var constants;
 
@@ -21,75 +21,28 @@
 
 var dns = process.binding('cares');
 var net = process.binding('net');
-var IOWatcher = process.binding('io_watcher').IOWatcher;
 
 
-var watchers = {};
-var activeWatchers = {};
-var Timer = process.binding('timer').Timer;
+// Creates a c-ares channel. The channel watches its sockets and timeouts on
+// the event loop itself. `options` may carry `servers` (an array of IPv4
+// addresses), `port`, `timeout` (per try, in milliseconds) and `tries` to
+// override the system resolver configuration.
+function createChannel(options) {
+  var channelOptions = {};
 
-var timer = new Timer();
+  if (options && options.servers) channelOptions.SERVERS = options.servers;
+  if (options && options.port) channelOptions.PORT = options.port;
+  if (options && options.timeout) channelOptions.TIMEOUT = options.timeout;
+  if (options && options.tries) channelOptions.TRIES = options.tries;
 
-timer.callback = function() {
-  var sockets = Object.keys(activeWatchers);
-  for (var i = 0, l = sockets.length; i < l; i++) {
-    var socket = sockets[i];
-    var s = parseInt(socket, 10);
-    channel.processFD(watchers[socket].read ? s : dns.SOCKET_BAD,
-                      watchers[socket].write ? s : dns.SOCKET_BAD);
-  }
-  updateTimer();
-};
-
-
-function updateTimer() {
-  timer.stop();
-
-  // Were just checking to see if activeWatchers is empty or not
-  if (0 === Object.keys(activeWatchers).length) return;
-  var max = 20000;
-  var timeout = channel.timeout(max);
-  timer.start(timeout, 0);
+  return new dns.Channel(channelOptions);
 }
 
+// exported for unit tests, not for public consumption
+exports._createChannel = createChannel;
 
-var channel = new dns.Channel({SOCK_STATE_CB: function(socket, read, write) {
-  var watcher, fd;
-
-  if (process.platform == 'win32') {
-    fd = process.binding('os').openOSHandle(socket);
-  } else {
-    fd = socket;
-  }
-
-  if (socket in watchers) {
-    watcher = watchers[socket].watcher;
-  } else {
-    watcher = new IOWatcher();
-    watchers[socket] = { read: read,
-                         write: write,
-                         watcher: watcher };
-
-    watcher.callback = function(read, write)  {
-      channel.processFD(read ? socket : dns.SOCKET_BAD,
-                        write ? socket : dns.SOCKET_BAD);
-      updateTimer();
-    };
-  }
-
-  watcher.stop();
-
-  if (!(read || write)) {
-    delete activeWatchers[socket];
-    return;
-  } else {
-    watcher.set(fd, read == 1, write == 1);
-    watcher.start();
-    activeWatchers[socket] = watcher;
-  }
+var channel = createChannel();
 
-  updateTimer();
-}});
 
 exports.resolve = function(domain, type_, callback_) {
   var type, callback;
@@ -131,6 +84,40 @@ exports.getHostByAddr = function(address, family/*=4*/, callback) {
 };
 
 
+// Resolves through the channel's lookup cache. Answers that come straight
+// from the cache are still delivered asynchronously.
+function cachedLookup(domain, family, callback) {
+  var cached = channel.lookup(domain, family, callback);
+  if (cached === undefined) return;
+
+  process.nextTick(function() {
+    if (cached instanceof Error) {
+      callback(cached);
+    } else {
+      callback(null, cached);
+    }
+  });
+}
+
+
+// Lookup cache statistics: hits, negativeHits, misses, coalesced (lookups
+// that joined a query already in flight), inFlight, entries and evictions.
+exports.cacheStats = function() {
+  return channel.cacheStats();
+};
+
+
+exports.clearCache = function() {
+  channel.clearCache();
+};
+
+
+// setCacheOptions({ maxTTL: seconds, negativeTTL: seconds, size: entries })
+exports.setCacheOptions = function(options) {
+  channel.setCacheOptions(options);
+};
+
+
 // Easy DNS A/AAAA look up
 // lookup(domain, [family,] callback)
 exports.lookup = function(domain, family, callback) {
@@ -172,7 +159,7 @@ exports.lookup = function(domain, family, callback) {
   if (family) {
     // resolve names for explicit address family
     var af = familyToSym(family);
-    channel.getHostByName(domain, af, function(err, domains) {
+    cachedLookup(domain, af, function(err, domains) {
       if (!err && domains && domains.length) {
         if (family !== net.isIP(domains[0])) {
           callback(new Error('not found'), []);
@@ -187,11 +174,11 @@ exports.lookup = function(domain, family, callback) {
   }
 
   // first resolve names for v4 and if that fails, try v6
-  channel.getHostByName(domain, dns.AF_INET, function(err, domains4) {
+  cachedLookup(domain, dns.AF_INET, function(err, domains4) {
     if (domains4 && domains4.length) {
       callback(null, domains4[0], 4);
     } else {
-      channel.getHostByName(domain, dns.AF_INET6, function(err, domains6) {
+      cachedLookup(domain, dns.AF_INET6, function(err, domains6) {
         if (domains6 && domains6.length) {
           callback(null, domains6[0], 6);
         } else {
@@ -63,40 +63,35 @@ fs.Stats.prototype.isSocket = function() {
   return this._checkModeProperty(constants.S_IFSOCK);
 };
 
+// Encodings that binding.readFile turns into a string itself; the others
+// go through a Buffer.
+function isNativeFileEncoding(encoding) {
+  switch (encoding && encoding.toLowerCase()) {
+    case 'utf8':
+    case 'utf-8':
+    case 'binary':
+    case 'hex':
+      return true;
+    default:
+      return false;
+  }
+}
+
+// binding.readFile opens, sizes, reads and closes the file in one trip to
+// the thread pool.
 fs.readFile = function(path, encoding_) {
   var encoding = typeof(encoding_) === 'string' ? encoding_ : null;
   var callback = arguments[arguments.length - 1];
   if (typeof(callback) !== 'function') callback = noop;
-  var readStream = fs.createReadStream(path);
-  var buffers = [];
-  var nread = 0;
 
-  readStream.on('data', function(chunk) {
-    buffers.push(chunk);
-    nread += chunk.length;
-  });
-
-  readStream.on('error', function(er) {
-    callback(er);
-    readStream.destroy();
-  });
+  if (isNativeFileEncoding(encoding)) {
+    binding.readFile(path, encoding, callback);
+    return;
+  }
 
-  readStream.on('end', function() {
-    // copy all the buffers into one
-    var buffer;
-    switch (buffers.length) {
-      case 0: buffer = new Buffer(0); break;
-      case 1: buffer = buffers[0]; break;
-      default: // concat together
-        buffer = new Buffer(nread);
-        var n = 0;
-        buffers.forEach(function(b) {
-          var l = b.length;
-          b.copy(buffer, n, 0, l);
-          n += l;
-        });
-        break;
-    }
+  binding.readFile(path, null, function(er, result) {
+    if (er) return callback(er);
+    var buffer = new Buffer(result, result.length, 0);
     if (encoding) {
       try {
         buffer = buffer.toString(encoding);
@@ -109,42 +104,13 @@ fs.readFile = function(path, encoding_) {
 };
 
 fs.readFileSync = function(path, encoding) {
-  var fd = fs.openSync(path, constants.O_RDONLY, 0666);
-  var buffer = new Buffer(4048);
-  var buffers = [];
-  var nread = 0;
-  var lastRead = 0;
-
-  do {
-    if (lastRead) {
-      buffer._bytesRead = lastRead;
-      nread += lastRead;
-      buffers.push(buffer);
-    }
-    var buffer = new Buffer(4048);
-    lastRead = fs.readSync(fd, buffer, 0, buffer.length, null);
-  } while (lastRead > 0);
-
-  fs.closeSync(fd);
-
-  if (buffers.length > 1) {
-    var offset = 0;
-    var i;
-    buffer = new Buffer(nread);
-    buffers.forEach(function(i) {
-      if (!i._bytesRead) return;
-      i.copy(buffer, offset, 0, i._bytesRead);
-      offset += i._bytesRead;
-    });
-  } else if (buffers.length) {
-    // buffers has exactly 1 (possibly zero length) buffer, so this should
-    // be a shortcut
-    buffer = buffers[0].slice(0, buffers[0]._bytesRead);
-  } else {
-    buffer = new Buffer(0);
+  if (isNativeFileEncoding(encoding)) {
+    return binding.readFile(path, encoding);
   }
 
-  if (encoding) buffer = buffer.toString(encoding);
+  var result = binding.readFile(path, null);
+  var buffer = new Buffer(result, result.length, 0);
+  if (encoding) return buffer.toString(encoding);
   return buffer;
 };
 
@@ -368,6 +334,42 @@ fs.sendfileSync = function(outFd, inFd, inOffset, length) {
   return binding.sendfile(outFd, inFd, inOffset, length);
 };
 
+fs.mmap = function(fd, offset, length, prot, flags) {
+  if (typeof prot !== 'number') prot = constants.PROT_READ;
+  if (typeof flags !== 'number') flags = constants.MAP_SHARED;
+  var mapping = binding.mmap(fd, offset, length, prot, flags);
+  return new Buffer(mapping, mapping.length, 0);
+};
+
+function stringToAdvice(advice) {
+  if (typeof advice !== 'string') {
+    return advice;
+  }
+  switch (advice) {
+    case 'normal':
+      return constants.MADV_NORMAL;
+
+    case 'random':
+      return constants.MADV_RANDOM;
+
+    case 'sequential':
+      return constants.MADV_SEQUENTIAL;
+
+    case 'willneed':
+      return constants.MADV_WILLNEED;
+
+    case 'dontneed':
+      return constants.MADV_DONTNEED;
+
+    default:
+      throw new Error('Unknown madvise hint: ' + advice);
+  }
+}
+
+fs.madvise = function(buffer, advice) {
+  binding.madvise(buffer, stringToAdvice(advice));
+};
+
 fs.readdir = function(path, callback) {
   binding.readdir(path, callback || noop);
 };
@@ -540,49 +542,19 @@ fs.futimesSync = function(fd, atime, mtime) {
   binding.futimes(fd, atime, mtime);
 };
 
-function writeAll(fd, buffer, offset, length, callback) {
-  // write(fd, buffer, offset, length, position, callback)
-  fs.write(fd, buffer, offset, length, offset, function(writeErr, written) {
-    if (writeErr) {
-      fs.close(fd, function() {
-        if (callback) callback(writeErr);
-      });
-    } else {
-      if (written === length) {
-        fs.close(fd, callback);
-      } else {
-        writeAll(fd, buffer, offset + written, length - written, callback);
-      }
-    }
-  });
-}
-
 fs.writeFile = function(path, data, encoding_, callback) {
   var encoding = (typeof(encoding_) == 'string' ? encoding_ : 'utf8');
   var callback_ = arguments[arguments.length - 1];
-  var callback = (typeof(callback_) == 'function' ? callback_ : null);
-  fs.open(path, 'w', 0666, function(openErr, fd) {
-    if (openErr) {
-      if (callback) callback(openErr);
-    } else {
-      var buffer = Buffer.isBuffer(data) ? data : new Buffer(data, encoding);
-      writeAll(fd, buffer, 0, buffer.length, callback);
-    }
-  });
+  var callback = (typeof(callback_) == 'function' ? callback_ : noop);
+  var buffer = Buffer.isBuffer(data) ? data : new Buffer(data, encoding);
+  binding.writeFile(path, buffer, stringToFlags('w'), 0666, callback);
 };
 
 fs.writeFileSync = function(path, data, encoding) {
-  var fd = fs.openSync(path, 'w');
   if (!Buffer.isBuffer(data)) {
     data = new Buffer(data, encoding || 'utf8');
   }
-  var written = 0;
-  var length = data.length;
-  //writeSync(fd, buffer, offset, length, position)
-  while (written < length) {
-    written += fs.writeSync(fd, data, written, length - written, written);
-  }
-  fs.closeSync(fd);
+  binding.writeFile(path, data, stringToFlags('w'), 0666);
 };
 
 // Stat Change Watchers
@@ -610,7 +582,8 @@ fs.watchFile = function(filename) {
   } else {
     statWatchers[filename] = new binding.StatWatcher();
     stat = statWatchers[filename];
-    stat.start(filename, options.persistent, options.interval);
+    stat.start(filename, options.persistent, options.interval,
+               !!options.poll, options.debounce);
   }
   stat.addListener('change', listener);
   return stat;
@@ -625,6 +598,49 @@ fs.unwatchFile = function(filename) {
   }
 };
 
+// Directory Tree Watchers
+
+var treeWatchers = {};
+
+fs.watchTree = function(dirname) {
+  var tree;
+  var options;
+  var listener;
+
+  if ('object' == typeof arguments[1]) {
+    options = arguments[1];
+    listener = arguments[2];
+  } else {
+    options = {};
+    listener = arguments[1];
+  }
+
+  if (!binding.TreeWatcher) {
+    throw new Error('fs.watchTree is not supported on ' + process.platform);
+  }
+
+  if (options.persistent === undefined) options.persistent = true;
+
+  if (treeWatchers[dirname]) {
+    tree = treeWatchers[dirname];
+  } else {
+    tree = new binding.TreeWatcher();
+    tree.start(dirname, options.persistent, options.debounce);
+    treeWatchers[dirname] = tree;
+  }
+  tree.addListener('change', listener);
+  return tree;
+};
+
+fs.unwatchTree = function(dirname) {
+  var tree;
+  if (treeWatchers[dirname]) {
+    tree = treeWatchers[dirname];
+    tree.stop();
+    treeWatchers[dirname] = undefined;
+  }
+};
+
 // Realpath
 // Not using realpath(2) because it's bad.
 // See: http://insanecoding.blogspot.com/2007/11/pathmax-simply-isnt.html
@@ -22,6 +22,8 @@
 var util = require('util');
 var net = require('net');
 var stream = require('stream');
+var fs = require('fs');
+var timers = require('timers');
 var EventEmitter = require('events').EventEmitter;
 var FreeList = require('freelist').FreeList;
 var HTTPParser = process.binding('http_parser').HTTPParser;
@@ -202,6 +204,7 @@ var closeExpression = /close/i;
 var chunkExpression = /chunk/i;
 var contentLengthExpression = /Content-Length/i;
 var expectExpression = /Expect/i;
+var acceptEncodingExpression = /^\s*([^\s;]+)\s*(?:;\s*q\s*=\s*([0-9.]+))?/;
 var continueExpression = /100-continue/i;
 
 
@@ -384,11 +387,11 @@ OutgoingMessage.prototype._writeRaw = function(data, encoding) {
       }
       var c = this.output.shift();
       var e = this.outputEncodings.shift();
-      this.connection.write(c, e);
+      writeSocket(this.connection, c, e);
     }
 
     // Directly write to socket.
-    return this.connection.write(data, encoding);
+    return writeSocket(this.connection, data, encoding);
   } else {
     this._buffer(data, encoding);
     return false;
@@ -486,7 +489,8 @@ OutgoingMessage.prototype._storeHeader = function(firstLine, headers) {
   // keep-alive logic
   if (sentConnectionHeader == false) {
     if (this.shouldKeepAlive &&
-        (sentContentLengthHeader || this.useChunkedEncodingByDefault)) {
+        (sentContentLengthHeader || this.useChunkedEncodingByDefault ||
+         this.agent)) {
       messageHeader += 'Connection: keep-alive\r\n';
     } else {
       this._last = true;
@@ -668,11 +672,12 @@ OutgoingMessage.prototype.end = function(data, encoding) {
     // HACKY.
     if (this.chunkedEncoding) {
       var l = Buffer.byteLength(data, encoding).toString(16);
-      ret = this.connection.write(this._header + l + CRLF +
-                                  data + '\r\n0\r\n' +
-                                  this._trailer + '\r\n', encoding);
+      ret = writeSocket(this.connection,
+                        this._header + l + CRLF +
+                        data + '\r\n0\r\n' +
+                        this._trailer + '\r\n', encoding);
     } else {
-      ret = this.connection.write(this._header + data, encoding);
+      ret = writeSocket(this.connection, this._header + data, encoding);
     }
     this._headerSent = true;
 
@@ -746,7 +751,7 @@ OutgoingMessage.prototype._flush = function() {
     var data = this.output.shift();
     var encoding = this.outputEncodings.shift();
 
-    ret = this.socket.write(data, encoding);
+    ret = writeSocket(this.socket, data, encoding);
   }
 
   if (this.finished) {
@@ -766,6 +771,12 @@ function ServerResponse(req) {
 
   if (req.method === 'HEAD') this._hasBody = false;
 
+  // For sendFile(), which stops when the request is aborted.
+  this._req = req;
+
+  // For compress().
+  this._acceptEncoding = req.headers['accept-encoding'];
+
   if (req.httpVersionMajor < 1 || req.httpVersionMinor < 1) {
     this.useChunkedEncodingByDefault = false;
     this.shouldKeepAlive = false;
@@ -854,6 +865,11 @@ ServerResponse.prototype.writeHead = function(statusCode) {
     this.shouldKeepAlive = false;
   }
 
+  // The compressed length isn't known up front.
+  if (this._compressor && headers) {
+    headers = withoutContentLength(headers);
+  }
+
   this._storeHeader(statusLine, headers);
 };
 
@@ -863,6 +879,340 @@ ServerResponse.prototype.writeHeader = function() {
 };
 
 
+// Sends the body through gzip or deflate, whichever the request's
+// Accept-Encoding prefers, and sets Content-Encoding to match. Returns the
+// encoding, or null if the client takes neither and the body goes out as
+// is. options are passed on to zlib.
+ServerResponse.prototype.compress = function(options) {
+  if (this._header) {
+    throw new Error("Can't compress after headers are sent.");
+  }
+
+  if (this._compressor) return this.getHeader('Content-Encoding');
+
+  var encoding = acceptedEncoding(this._acceptEncoding);
+  if (!encoding) return null;
+
+  var zlib = require('zlib'); // lazy load
+  var compressor = encoding === 'gzip' ? zlib.createGzip(options) :
+                                         zlib.createDeflate(options);
+
+  var vary = this.getHeader('Vary');
+  this.setHeader('Vary', vary ? vary + ', Accept-Encoding' : 'Accept-Encoding');
+  this.setHeader('Content-Encoding', encoding);
+  this.removeHeader('Content-Length');
+
+  this._compressor = compressor;
+
+  var self = this;
+
+  compressor.on('data', function(chunk) {
+    if (!self._hasBody) return;
+    if (OutgoingMessage.prototype.write.call(self, chunk) === false) {
+      compressor.pause();
+    }
+  });
+
+  compressor.on('end', function() {
+    OutgoingMessage.prototype.end.call(self);
+  });
+
+  compressor.on('error', function(err) {
+    self.destroy(err);
+  });
+
+  // Compressor drain means it took everything written so far, socket drain
+  // means the compressed output went out.
+  compressor.on('drain', function() {
+    self.emit('drain');
+  });
+
+  this.on('drain', function() {
+    compressor.resume();
+  });
+
+  return encoding;
+};
+
+
+ServerResponse.prototype.write = function(chunk, encoding) {
+  if (!this._compressor) {
+    return OutgoingMessage.prototype.write.call(this, chunk, encoding);
+  }
+
+  if (!this._header) {
+    this._implicitHeader();
+  }
+
+  if (typeof chunk === 'string') {
+    chunk = new Buffer(chunk, encoding);
+  } else if (!Buffer.isBuffer(chunk)) {
+    throw new TypeError('first argument must be a string or Buffer');
+  }
+
+  if (chunk.length === 0) return false;
+
+  return this._compressor.write(chunk);
+};
+
+
+ServerResponse.prototype.end = function(data, encoding) {
+  if (!this._compressor) {
+    return OutgoingMessage.prototype.end.call(this, data, encoding);
+  }
+
+  if (!this._header) {
+    this._implicitHeader();
+  }
+
+  if (typeof data === 'string') {
+    data = new Buffer(data, encoding);
+  }
+
+  // OutgoingMessage.prototype.end runs once the compressor has flushed.
+  return this._compressor.end(data);
+};
+
+
+// sendFile() hands the socket at most this much per sendfile(2) call. The
+// calls run on the thread pool, so one that has to wait for the disk does
+// not hold up the other connections.
+var SENDFILE_CHUNK = 1024 * 1024;
+var READ_CHUNK = 64 * 1024;
+
+
+// Sends `length` bytes of a file, starting at `offset`, as the body of the
+// response and ends it. `file` is a path, or a descriptor that the caller
+// keeps ownership of. On plain sockets the body goes from the page cache
+// to the socket with sendfile(2); TLS, compressed and chunked responses,
+// and platforms without it, read the file and write() it instead.
+ServerResponse.prototype.sendFile = function(file, offset, length, cb) {
+  if (typeof offset === 'function') {
+    cb = offset;
+    offset = length = undefined;
+  } else if (typeof length === 'function') {
+    cb = length;
+    length = undefined;
+  }
+
+  offset = offset || 0;
+  if (typeof offset !== 'number' || offset < 0) {
+    throw new TypeError('offset must be a non-negative number');
+  }
+  if (length !== undefined && (typeof length !== 'number' || length < 0)) {
+    throw new TypeError('length must be a non-negative number');
+  }
+
+  var self = this;
+  var req = this._req;
+  var ownFd = typeof file !== 'number';
+  var fd = ownFd ? null : file;
+  var remaining = length;
+  var watcher = null;
+  var sending = false;
+  var finished = false;
+
+  if (ownFd) {
+    fs.open(file, 'r', function(err, result) {
+      if (err) return done(err);
+      fd = result;
+      stat();
+    });
+  } else {
+    stat();
+  }
+
+  function stat() {
+    if (remaining !== undefined) return start();
+
+    fs.fstat(fd, function(err, stats) {
+      if (err) return done(err);
+      remaining = Math.max(stats.size - offset, 0);
+      start();
+    });
+  }
+
+  function start() {
+    if (finished) return;
+
+    if (!self._header) {
+      if (!self._compressor && !self.getHeader('Content-Length') &&
+          !self.getHeader('Transfer-Encoding')) {
+        self.setHeader('Content-Length', remaining);
+      }
+      self._implicitHeader();
+    }
+
+    if (!self._hasBody || remaining === 0) return done(null);
+
+    var socket = self.socket;
+    if (socket && socket._httpMessage === self && !self._compressor &&
+        !self.chunkedEncoding && process.platform !== 'win32' &&
+        socket instanceof net.Stream && typeof socket.fd === 'number' &&
+        socket.fd >= 0) {
+      sendHead(socket);
+    } else {
+      readNext();
+    }
+  }
+
+  // The headers, and anything queued before them, have to be on the wire
+  // before sendfile(2) can write to the socket directly.
+  function sendHead(socket) {
+    self._send('');
+    if (socket._httpBatch) flushSocketBatch(socket);
+
+    if (socket._writeQueue && socket._writeQueue.length) {
+      socket.once('drain', function() {
+        pump(socket);
+      });
+    } else {
+      pump(socket);
+    }
+  }
+
+  function pump(socket) {
+    if (finished) return;
+
+    if (!socket.writable || typeof socket.fd !== 'number') {
+      return done(new Error('Socket closed before the file was sent'));
+    }
+
+    // Neither fd may be closed, and its number reused, while the call is
+    // in flight: done() and the socket's destroy() leave that to us.
+    sending = true;
+    socket._sendfilePending = true;
+
+    fs.sendfile(socket.fd, fd, offset, Math.min(remaining, SENDFILE_CHUNK),
+                function(err, n) {
+      sending = false;
+      socket._sendfilePending = false;
+      if (socket._sendfileFd !== undefined) {
+        fs.closeSync(socket._sendfileFd);
+        socket._sendfileFd = undefined;
+      }
+
+      if (finished) {
+        if (ownFd) fs.close(fd);
+        return;
+      }
+      if (err) {
+        if (err.code === 'EAGAIN') return waitWritable(socket);
+        return done(err);
+      }
+      if (n === 0) return done(new Error('File ended before it was sent'));
+
+      offset += n;
+      remaining -= n;
+      timers.active(socket);
+
+      if (remaining === 0) return done(null);
+      pump(socket);
+    });
+  }
+
+  function waitWritable(socket) {
+    if (!watcher) {
+      var IOWatcher = process.binding('io_watcher').IOWatcher;
+      watcher = new IOWatcher();
+      watcher.callback = function() {
+        watcher.stop();
+        pump(socket);
+      };
+    }
+    watcher.set(socket.fd, false, true);
+    watcher.start();
+  }
+
+  function readNext() {
+    if (finished) return;
+
+    var buffer = new Buffer(Math.min(remaining, READ_CHUNK));
+
+    fs.read(fd, buffer, 0, buffer.length, offset, function(err, n) {
+      if (finished) return;
+      if (err) return done(err);
+      if (n === 0) return done(new Error('File ended before it was sent'));
+
+      offset += n;
+      remaining -= n;
+
+      var flushed = self.write(n < buffer.length ? buffer.slice(0, n) : buffer);
+
+      if (remaining === 0) return done(null);
+      if (flushed === false) {
+        self.once('drain', readNext);
+      } else {
+        readNext();
+      }
+    });
+  }
+
+  function onAbort() {
+    done(new Error('Request aborted before the file was sent'));
+  }
+  req.on('close', onAbort);
+
+  function done(err) {
+    if (finished) return;
+    finished = true;
+
+    req.removeListener('close', onAbort);
+    self.removeListener('drain', readNext);
+    if (watcher) watcher.stop();
+    if (ownFd && fd !== null && !sending) fs.close(fd);
+
+    if (!err) {
+      self.end();
+    } else if (self._header || !cb) {
+      // Either part of the response is out and the rest never will be, or
+      // there is no callback to answer the request some other way.
+      req.connection.destroy();
+    }
+
+    if (cb) cb(err);
+  }
+};
+
+
+// gzip or deflate, by q-value, gzip on ties; '*' stands for both.
+function acceptedEncoding(header) {
+  if (!header) return null;
+
+  var q = {};
+  var parts = header.split(',');
+
+  for (var i = 0; i < parts.length; i++) {
+    var m = acceptEncodingExpression.exec(parts[i]);
+    if (!m) continue;
+    q[m[1].toLowerCase()] = m[2] === undefined ? 1 : parseFloat(m[2]);
+  }
+
+  var any = '*' in q ? q['*'] : 0;
+  var gzip = 'gzip' in q ? q.gzip : any;
+  var deflate = 'deflate' in q ? q.deflate : any;
+
+  if (gzip > 0 && gzip >= deflate) return 'gzip';
+  if (deflate > 0) return 'deflate';
+  return null;
+}
+
+
+function withoutContentLength(headers) {
+  if (Array.isArray(headers)) {
+    return headers.filter(function(header) {
+      return !contentLengthExpression.test(header[0]);
+    });
+  }
+
+  var result = {};
+  for (var field in headers) {
+    if (!contentLengthExpression.test(field)) result[field] = headers[field];
+  }
+  return result;
+}
+
+
 function ClientRequest(options, defaultPort) {
   OutgoingMessage.call(this);
 
@@ -890,7 +1240,8 @@ function ClientRequest(options, defaultPort) {
     }
   }
 
-  this.shouldKeepAlive = false;
+  // Agents that keep connections alive ask the server to do the same.
+  this.shouldKeepAlive = !!(options.agent && options.agent.keepAlive);
   if (method === 'GET' || method === 'HEAD') {
     this.useChunkedEncodingByDefault = false;
   } else {
@@ -946,6 +1297,95 @@ function httpSocketSetup(socket) {
 }
 
 
+// The responses to pipelined requests are batched. While a batch is open
+// on a server socket, writes are collected instead of going out one by
+// one, and closing the batch sends all of them in a single socket write.
+// Batches nest; only the outermost one writes.
+//
+// A batch holds at most this much, roughly in bytes, before it is sent.
+// Buffers of this size or more are never copied into a batch.
+var batchHighWaterMark = 16 * 1024;
+
+
+function corkSocket(socket) {
+  if (socket._httpBatch) {
+    socket._httpBatch.depth++;
+  } else {
+    socket._httpBatch = { depth: 1,
+                          chunks: [],
+                          encodings: [],
+                          length: 0,
+                          ok: true };
+  }
+}
+
+
+function uncorkSocket(socket) {
+  if (--socket._httpBatch.depth > 0) return;
+  flushSocketBatch(socket);
+  socket._httpBatch = null;
+}
+
+
+// Returns what socket.write() would: false once the socket has queued
+// data, so that callers wait for 'drain' even while a batch is open.
+function writeSocket(socket, data, encoding) {
+  var batch = socket._httpBatch;
+  if (!batch) return socket.write(data, encoding);
+
+  if (Buffer.isBuffer(data) && data.length >= batchHighWaterMark) {
+    if (!flushSocketBatch(socket)) batch.ok = false;
+    if (!socket.writable || !socket.write(data)) batch.ok = false;
+    return batch.ok;
+  }
+
+  if (data.length > 0) {
+    batch.chunks.push(data);
+    batch.encodings.push(encoding);
+    batch.length += data.length;
+  }
+
+  if (batch.length >= batchHighWaterMark && !flushSocketBatch(socket)) {
+    batch.ok = false;
+  }
+  return batch.ok;
+}
+
+
+function flushSocketBatch(socket) {
+  var batch = socket._httpBatch;
+  var chunks = batch.chunks;
+  var encodings = batch.encodings;
+
+  if (chunks.length === 0) return true;
+  batch.chunks = [];
+  batch.encodings = [];
+  batch.length = 0;
+
+  if (!socket.writable) return false;
+  if (chunks.length === 1) return socket.write(chunks[0], encodings[0]);
+
+  // Strings in a single encoding are joined, anything else is copied into
+  // one buffer.
+  var i, length = 0, joinable = true;
+  for (i = 0; i < chunks.length; i++) {
+    if (typeof chunks[i] !== 'string' || encodings[i] !== encodings[0]) {
+      joinable = false;
+      break;
+    }
+  }
+  if (joinable) return socket.write(chunks.join(''), encodings[0]);
+
+  for (i = 0; i < chunks.length; i++) {
+    if (typeof chunks[i] === 'string') {
+      chunks[i] = new Buffer(chunks[i], encodings[i] || 'utf8');
+    }
+    length += chunks[i].length;
+  }
+  return socket.write(Buffer.concat(chunks, length));
+}
+
+
 function Server(requestListener) {
   if (!(this instanceof Server)) return new Server(requestListener);
   net.Server.call(this, { allowHalfOpen: true });
@@ -967,6 +1407,11 @@ util.inherits(Server, net.Server);
 exports.Server = Server;
 
 
+// Requests read ahead of their responses on a pipelining connection. The
+// socket stops reading when there are this many.
+Server.prototype.maxPipelineDepth = 32;
+
+
 exports.createServer = function(requestListener) {
   return new Server(requestListener);
 };
@@ -977,6 +1422,11 @@ function connectionListener(socket) {
   var outgoing = [];
   var incoming = [];
   var abortError = null;
+  var paused = false;
+  var chunkRequests = 0;
+  var chunkCorked = false;
+  var maxPipelineDepth = self.maxPipelineDepth ||
+                         Server.prototype.maxPipelineDepth;
 
   function abortIncoming() {
     if (!abortError) {
@@ -1015,7 +1465,17 @@ function connectionListener(socket) {
   });
 
   socket.ondata = function(d, start, end) {
-    var ret = parser.execute(d, start, end - start);
+    // Responses made while the chunk is parsed go out together, once
+    // parser.onIncoming sees that there is more than one.
+    chunkRequests = 0;
+    chunkCorked = false;
+    try {
+      var ret = parser.execute(d, start, end - start);
+    } finally {
+      if (chunkCorked) uncorkSocket(socket);
+      chunkCorked = false;
+    }
+
     if (ret instanceof Error) {
       debug('parse error');
       socket.destroy(ret);
@@ -1074,6 +1534,18 @@ function connectionListener(socket) {
   parser.onIncoming = function(req, shouldKeepAlive) {
     incoming.push(req);
 
+    // A lone request is answered with plain socket writes.
+    if (!chunkCorked && (++chunkRequests > 1 || outgoing.length > 0)) {
+      corkSocket(socket);
+      chunkCorked = true;
+    }
+
+    if (incoming.length >= maxPipelineDepth && !paused) {
+      debug('server pipeline full');
+      paused = true;
+      socket.pause();
+    }
+
     var res = new ServerResponse(req);
     debug('server response shouldKeepAlive: ' + shouldKeepAlive);
     res.shouldKeepAlive = shouldKeepAlive;
@@ -1095,12 +1567,26 @@ function connectionListener(socket) {
       res.detachSocket(socket);
 
       if (res._last) {
+        if (socket._httpBatch) flushSocketBatch(socket);
         socket.destroySoon();
       } else {
-        // start sending the next message
+        // start sending the next message. Responses queued behind it that
+        // are already complete follow in the same write.
         var m = outgoing.shift();
-        if (m) {
+        if (m && outgoing.length === 0) {
           m.assignSocket(socket);
+        } else if (m) {
+          corkSocket(socket);
+          try {
+            m.assignSocket(socket);
+          } finally {
+            uncorkSocket(socket);
+          }
+        }
+
+        if (paused && incoming.length < maxPipelineDepth) {
+          paused = false;
+          socket.resume();
         }
       }
     });
@@ -1132,14 +1618,31 @@ function Agent(options) {
 
   this.queue = [];
   this.sockets = [];
-  this.maxSockets = Agent.defaultMaxSockets;
-
+  this.maxSockets = options.maxSockets || Agent.defaultMaxSockets;
+
+  // Keep-alive: sockets whose response has been read go to `freeSockets`
+  // instead of being closed. The most recently used one is handed out
+  // first; the oldest ones are closed by the reaper after keepAliveTimeout.
+  this.keepAlive = options.keepAlive !== undefined ? !!options.keepAlive
+                                                   : Agent.defaultKeepAlive;
+  this.maxFreeSockets = options.maxFreeSockets || Agent.defaultMaxFreeSockets;
+  this.keepAliveTimeout = options.keepAliveTimeout ||
+                          Agent.defaultKeepAliveTimeout;
+  this.freeSockets = [];
+
+  this._created = 0;
+  this._reused = 0;
+  this._reaped = 0;
+  this._idleListed = false;
 }
 util.inherits(Agent, EventEmitter);
 exports.Agent = Agent;
 
 
 Agent.defaultMaxSockets = 5;
+Agent.defaultKeepAlive = false;
+Agent.defaultMaxFreeSockets = 5;
+Agent.defaultKeepAliveTimeout = 5000;
 
 Agent.prototype.defaultPort = 80;
 Agent.prototype.appendMessage = function(options) {
@@ -1164,12 +1667,117 @@ Agent.prototype.appendMessage = function(options) {
 Agent.prototype._removeSocket = function(socket) {
   var i = this.sockets.indexOf(socket);
   if (i >= 0) this.sockets.splice(i, 1);
+
+  if (socket._httpIdleSince) {
+    socket._httpIdleSince = null;
+    i = this.freeSockets.indexOf(socket);
+    if (i >= 0) this.freeSockets.splice(i, 1);
+  }
+};
+
+
+Agent.prototype.stats = function() {
+  return { sockets: this.sockets.length,
+           freeSockets: this.freeSockets.length,
+           queued: this.queue.length,
+           created: this._created,
+           reused: this._reused,
+           reaped: this._reaped };
+};
+
+
+// Pops the most recently released socket that is still open.
+Agent.prototype._takeFreeSocket = function() {
+  var free = this.freeSockets;
+  while (free.length) {
+    var socket = free.pop();
+    socket._httpIdleSince = null;
+    if (socket.writable && socket.readable) {
+      this._reused++;
+      return socket;
+    }
+    socket.destroy();
+  }
+  return null;
+};
+
+
+// Called with a socket whose keep-alive response has been read in full.
+Agent.prototype._releaseSocket = function(socket) {
+  socket._httpIdleSince = Date.now();
+  this.freeSockets.push(socket);
+
+  this._cycle();
+
+  while (this.freeSockets.length > this.maxFreeSockets) {
+    var oldest = this.freeSockets.shift();
+    oldest._httpIdleSince = null;
+    oldest.destroy();
+  }
+
+  if (this.freeSockets.length && !this._idleListed) {
+    this._idleListed = true;
+    idleAgents.push(this);
+  }
+  if (this.freeSockets.length) {
+    armReaper(this.freeSockets[0]._httpIdleSince + this.keepAliveTimeout);
+  }
 };
 
 
+// Closes the sockets that have been idle for keepAliveTimeout and returns
+// when the next one expires, or Infinity when none are left.
+Agent.prototype._reapIdleSockets = function(now) {
+  var free = this.freeSockets;
+  while (free.length && free[0]._httpIdleSince + this.keepAliveTimeout <= now) {
+    var socket = free.shift();
+    socket._httpIdleSince = null;
+    this._reaped++;
+    socket.destroy();
+  }
+  return free.length ? free[0]._httpIdleSince + this.keepAliveTimeout
+                     : Infinity;
+};
+
+
+// A single timer reaps idle sockets for all agents. It is armed for the
+// earliest expiry and re-armed from there after each run.
+var idleAgents = [];
+var reapTimer = null;
+var reapAt = 0;
+
+function armReaper(when) {
+  if (reapTimer) {
+    if (reapAt <= when) return;
+    clearTimeout(reapTimer);
+  }
+  reapAt = when;
+  reapTimer = setTimeout(reapIdleSockets, Math.max(0, when - Date.now()));
+}
+
+function reapIdleSockets() {
+  reapTimer = null;
+
+  var now = Date.now();
+  var next = Infinity;
+  for (var i = 0; i < idleAgents.length; i++) {
+    var expiry = idleAgents[i]._reapIdleSockets(now);
+    if (expiry === Infinity) {
+      idleAgents[i]._idleListed = false;
+      idleAgents.splice(i--, 1);
+    } else if (expiry < next) {
+      next = expiry;
+    }
+  }
+
+  if (next !== Infinity) armReaper(next);
+}
+
+
 Agent.prototype._establishNewConnection = function() {
   var self = this;
   assert(this.sockets.length < this.maxSockets);
+  this._created++;
 
   // Grab a new "socket". Depending on the implementation of _getConnection
   // this could either be a raw TCP socket or a TLS stream.
@@ -1187,10 +1795,6 @@ Agent.prototype._establishNewConnection = function() {
 
   this.sockets.push(socket);
 
-  // Cycle so the request can be assigned to this new socket.
-  self._cycle();
-  assert(socket._httpMessage);
-
   // Add a parser to the socket.
   var parser = parsers.alloc();
   parser.reinitialize('response');
@@ -1202,7 +1806,7 @@ Agent.prototype._establishNewConnection = function() {
     var req;
     if (socket._httpMessage) {
       req = socket._httpMessage;
-    } else if (self.queue.length) {
+    } else if (self.queue.length && !socket._httpIdleSince) {
       req = self.queue.shift();
       assert(req._queue === self.queue);
       req._queue = null;
@@ -1317,15 +1921,13 @@ Agent.prototype._establishNewConnection = function() {
       return true;
     }
 
-    if (req.shouldKeepAlive && res.headers.connection === 'close') {
+    if (req.shouldKeepAlive &&
+        (!shouldKeepAlive || res.headers.connection === 'close')) {
       req.shouldKeepAlive = false;
     }
 
     res.addListener('end', function() {
       debug('AGENT request complete');
-      // For the moment we reconnect for every request. FIXME!
-      // All that should be required for keep-alive is to not reconnect,
-      // but outgoingFlush instead.
       if (!req.shouldKeepAlive) {
         if (socket.writable) {
           debug('AGENT socket.destroySoon()');
@@ -1340,7 +1942,11 @@ Agent.prototype._establishNewConnection = function() {
 
       assert(!socket._httpMessage);
 
-      self._cycle();
+      if (req.shouldKeepAlive && socket.writable) {
+        self._releaseSocket(socket);
+      } else {
+        self._cycle();
+      }
     });
 
     DTRACE_HTTP_CLIENT_RESPONSE(socket, self);
@@ -1348,6 +1954,8 @@ Agent.prototype._establishNewConnection = function() {
 
     return isHeadResponse;
   };
+
+  return socket;
 };
 
 
@@ -1370,48 +1978,27 @@ Agent.prototype._getConnection = function(options, cb) {
 };
 
 
-// This method attempts to shuffle items along the queue into one of the
-// waiting sockets. If a waiting socket cannot be found, it will
-// start the process of establishing one.
+// Hands queued requests to free sockets, and opens new connections for
+// them while there are fewer than maxSockets.
 Agent.prototype._cycle = function() {
-  debug('Agent _cycle sockets=' + this.sockets.length + ' queue=' + this.queue.length);
-  var self = this;
-
-  var first = this.queue[0];
-  if (!first) return;
-
-  var haveConnectingSocket = false;
-
-  // First try to find an available socket.
-  for (var i = 0; i < this.sockets.length; i++) {
-    var socket = this.sockets[i];
-    // If the socket doesn't already have a message it's sending out
-    // and the socket is available for writing or it's connecting.
-    // In particular this rules out sockets that are closing.
-    if (!socket._httpMessage &&
-        ((socket.writable && socket.readable) || socket._httpConnecting)) {
-      debug('Agent found socket, shift');
-      // We found an available connection!
-      this.queue.shift(); // remove first from queue.
-      assert(first._queue === this.queue);
-      first._queue = null;
-
-      first.assignSocket(socket);
-      httpSocketSetup(socket);
-      self._cycle(); // try to dispatch another
-      return;
+  debug('Agent _cycle sockets=' + this.sockets.length +
+        ' free=' + this.freeSockets.length + ' queue=' + this.queue.length);
+
+  while (this.queue.length) {
+    var socket = this._takeFreeSocket();
+    if (!socket) {
+      // All sockets are busy.
+      if (this.sockets.length >= this.maxSockets) return;
+      socket = this._establishNewConnection();
     }
 
-    if (socket._httpConnecting) haveConnectingSocket = true;
-  }
+    var req = this.queue.shift();
+    assert(req._queue === this.queue);
+    req._queue = null;
 
-  // If no sockets are connecting, and we have space for another we should
-  // be starting a new connection to handle this request.
-  if (!haveConnectingSocket && this.sockets.length < this.maxSockets) {
-    this._establishNewConnection();
+    req.assignSocket(socket);
+    httpSocketSetup(socket);
   }
-
-  // All sockets are filled and all sockets are busy.
 };
 
 
@@ -1451,6 +2038,12 @@ function getAgent(options) {
     } else {
       throw new TypeError('Invalid options specification to getAgent');
     }
+
+    // Only used when the agent is created.
+    _opts.keepAlive = options.keepAlive;
+    _opts.maxSockets = options.maxSockets;
+    _opts.maxFreeSockets = options.maxFreeSockets;
+    _opts.keepAliveTimeout = options.keepAliveTimeout;
   } else {
     throw new TypeError('Invalid argument to getAgent');
   }
@@ -0,0 +1,694 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// net.Socket and net.Server on top of process.binding('tcp_wrap'). Reads,
+// writes and accept() happen in C++; JavaScript only sees complete chunks,
+// write completions and new connections. See lib/net.js for when this
+// module is used instead of net_legacy.
+
+var util = require('util');
+var events = require('events');
+var stream = require('stream');
+var timers = require('timers');
+var legacy = require('net_legacy');
+
+var TCP = process.binding('tcp_wrap').TCP;
+
+var debug;
+if (process.env.NODE_DEBUG && /net/.test(process.env.NODE_DEBUG)) {
+  debug = function(x) { console.error('NET:', x); };
+} else {
+  debug = function() { };
+}
+
+// libuv queues every write and flushes it from the event loop, so write()
+// only reports the socket as backed up once this much is waiting; otherwise
+// pipe() would pause the source after every chunk.
+var kHighWaterMark = 64 * 1024;
+
+
+exports.isIP = legacy.isIP;
+exports.isIPv4 = legacy.isIPv4;
+exports.isIPv6 = legacy.isIPv6;
+
+
+function toPort(x) { return (x = Number(x)) >= 0 ? x : false; }
+
+
+function noUnixSockets() {
+  return new Error('UNIX domain sockets are not supported by the libuv ' +
+                   'backend; run without --use-uv');
+}
+
+
+function noIPv6() {
+  return new Error('IPv6 is not supported by the libuv backend; ' +
+                   'run without --use-uv');
+}
+
+
+function Socket(options) {
+  if (!(this instanceof Socket)) return new Socket(options);
+  stream.Stream.call(this);
+
+  if (typeof options == 'number' ||
+      (typeof options == 'object' && options.fd !== undefined)) {
+    throw new Error('Sockets on file descriptors are not supported by the ' +
+                    'libuv backend; use net_legacy');
+  }
+
+  this.fd = null;
+  this.type = 'tcp4';
+  this.bufferSize = 0;
+  this.allowHalfOpen = (options && options.allowHalfOpen) || false;
+
+  this._handle = null;
+  this._connecting = false;
+  this._connectQueue = null;
+  this._pendingWriteReqs = 0;
+  this._paused = false;
+
+  this.readable = this.writable = this.destroyed = false;
+}
+util.inherits(Socket, stream.Stream);
+exports.Socket = Socket;
+
+// Legacy naming.
+exports.Stream = Socket;
+
+
+exports.createConnection = function(port, host) {
+  // Paths still need the fd based implementation.
+  if (toPort(port) === false) return legacy.createConnection(port);
+
+  var s = new Socket();
+  s.connect(port, host);
+  return s;
+};
+
+
+Socket.prototype._attach = function(handle) {
+  this._handle = handle;
+  handle.socket = this;
+  handle.onread = onread;
+
+  if (this._noDelay !== undefined) handle.setNoDelay(this._noDelay);
+};
+
+
+Object.defineProperty(Socket.prototype, 'readyState', {
+  get: function() {
+    if (this._connecting) {
+      return 'opening';
+    } else if (this.readable && this.writable) {
+      return 'open';
+    } else if (this.readable && !this.writable) {
+      return 'readOnly';
+    } else if (!this.readable && this.writable) {
+      return 'writeOnly';
+    } else {
+      return 'closed';
+    }
+  }
+});
+
+
+Socket.prototype._onTimeout = function() {
+  this.emit('timeout');
+};
+
+
+Socket.prototype.setTimeout = function(msecs, callback) {
+  if (msecs > 0) {
+    timers.enroll(this, msecs);
+    if (this._handle) timers.active(this);
+    if (callback) {
+      this.once('timeout', callback);
+    }
+  } else if (msecs === 0) {
+    timers.unenroll(this);
+  }
+};
+
+
+Socket.prototype.setNoDelay = function(v) {
+  // Applied once there is a connected socket to apply it to.
+  this._noDelay = v !== false;
+  if (this._handle && !this._connecting) {
+    this._handle.setNoDelay(this._noDelay);
+  }
+};
+
+
+Socket.prototype.setKeepAlive = function(enable, time) {
+  // Not wired up on libuv handles yet.
+};
+
+
+Socket.prototype.address = function() {
+  return this._handle ? this._handle.getsockname() : null;
+};
+
+
+Socket.prototype.setEncoding = function(encoding) {
+  var StringDecoder = require('string_decoder').StringDecoder; // lazy load
+  this._decoder = new StringDecoder(encoding);
+};
+
+
+Socket.prototype.pause = function() {
+  this._paused = true;
+  if (this._handle && !this._connecting) this._handle.readStop();
+};
+
+
+Socket.prototype.resume = function() {
+  if (this.destroyed) {
+    throw new Error('Cannot resume() closed Socket.');
+  }
+  this._paused = false;
+  if (this._handle && !this._connecting && this.readable) {
+    this._handle.readStart();
+  }
+};
+
+
+// Called with (slab, offset, length) for data and (null, err) at the end of
+// the stream; err is null for a plain EOF.
+function onread(buffer, offset, length) {
+  var handle = this;
+  var self = handle.socket;
+  if (!self) return;
+
+  timers.active(self);
+
+  if (buffer) {
+    var end = offset + length;
+
+    debug('received ' + length + ' bytes');
+    DTRACE_NET_SOCKET_READ(self, length);
+
+    if (self._decoder) {
+      // emit String
+      var string = self._decoder.write(buffer.slice(offset, end));
+      if (string.length) self.emit('data', string);
+    } else {
+      // emit buffer
+      if (self._events && self._events['data']) {
+        // emit a slice
+        self.emit('data', buffer.slice(offset, end));
+      }
+    }
+
+    // Optimization: emit the original buffer with end points
+    if (self.ondata) self.ondata(buffer, offset, end);
+    return;
+  }
+
+  var err = offset;
+  if (err) {
+    if (err.code == 'ECONNRESET') {
+      self.destroy();
+    } else {
+      self.destroy(err);
+    }
+    return;
+  }
+
+  self.readable = false;
+
+  if (!self.writable) self.destroy();
+  // Note: 'close' not emitted until nextTick.
+
+  if (!self.allowHalfOpen) self.end();
+  if (self._events && self._events['end']) self.emit('end');
+  if (self.onend) self.onend();
+}
+
+
+Socket.prototype.write = function(data /* [encoding], [cb] */) {
+  var encoding, cb;
+
+  if (typeof arguments[1] == 'function') {
+    cb = arguments[1];
+  } else {
+    encoding = arguments[1];
+    cb = arguments[2];
+  }
+
+  if (!this.writable) {
+    if (this._ended) {
+      throw new Error('Socket.end() called already; cannot write.');
+    }
+    throw new Error('Socket is not writable');
+  }
+
+  if (this._connecting) {
+    // Held back until the connection is up.
+    if (!this._connectQueue) this._connectQueue = [];
+    this._connectQueue.push([data, encoding, cb]);
+    this.bufferSize += data.length;
+    DTRACE_NET_SOCKET_WRITE(this, 0);
+    return false;
+  }
+
+  return this._write(data, encoding, cb);
+};
+
+
+Socket.prototype._write = function(data, encoding, cb) {
+  var buffer = typeof data == 'string' ? new Buffer(data, encoding) : data;
+
+  if (buffer.length == 0) {
+    if (cb) process.nextTick(cb);
+    return true;
+  }
+
+  var req;
+  try {
+    req = this._handle.write(buffer);
+  } catch (e) {
+    this.destroy(e);
+    return false;
+  }
+
+  req.oncomplete = afterWrite;
+  req.cb = cb;
+  this._pendingWriteReqs++;
+
+  timers.active(this);
+  this.bufferSize = this._handle.writeQueueSize;
+  DTRACE_NET_SOCKET_WRITE(this, buffer.length);
+
+  return this.bufferSize < kHighWaterMark;
+};
+
+
+function afterWrite(err, handle, req) {
+  var self = handle.socket;
+  if (!self || self.destroyed) return;
+
+  if (err) {
+    self.destroy(err);
+    return;
+  }
+
+  timers.active(self);
+  self.bufferSize = handle.writeQueueSize;
+
+  if (req.cb) req.cb();
+
+  if (--self._pendingWriteReqs == 0) {
+    if (self._events && self._events['drain']) self.emit('drain');
+    if (self.ondrain) self.ondrain(); // Optimization
+    if (self.__destroyOnDrain) self.destroy();
+  }
+}
+
+
+Socket.prototype.end = function(data, encoding) {
+  if (!this.writable) return;
+
+  DTRACE_NET_STREAM_END(this);
+  if (data) this.write(data, encoding);
+
+  this.writable = false;
+  this._ended = true;
+
+  // Once connected the queue is flushed and the shutdown follows it.
+  if (this._connecting) return;
+
+  this._shutdown();
+};
+
+
+Socket.prototype._shutdown = function() {
+  if (!this.readable) {
+    this.destroySoon();
+    return;
+  }
+
+  // libuv sends the FIN after the queued writes.
+  var req;
+  try {
+    req = this._handle.shutdown();
+  } catch (e) {
+    this.destroy(e);
+    return;
+  }
+  req.oncomplete = afterShutdown;
+};
+
+
+function afterShutdown(err, handle, req) {
+  var self = handle.socket;
+  if (!self || self.destroyed) return;
+
+  if (err) {
+    if (err.code == 'ENOTCONN') {
+      // Allowed.
+      self.destroy();
+    } else {
+      self.destroy(err);
+    }
+  } else if (!self.readable) {
+    self.destroy();
+  }
+}
+
+
+Socket.prototype.destroySoon = function() {
+  if (this._pendingWriteReqs == 0 && !this._connectQueue) {
+    this.destroy();
+  } else {
+    this.__destroyOnDrain = true;
+  }
+};
+
+
+Socket.prototype.destroy = function(exception) {
+  var self = this;
+
+  debug('destroy');
+
+  this._connectQueue = null;
+  this._pendingWriteReqs = 0;
+  this.bufferSize = 0;
+  this._connecting = false;
+  this.readable = this.writable = false;
+
+  timers.unenroll(this);
+
+  if (this.server && !this.destroyed) {
+    this.server.connections--;
+  }
+
+  if (this._handle) {
+    this._handle.socket = null;
+    this._handle.close();
+    this._handle = null;
+    process.nextTick(function() {
+      if (exception) self.emit('error', exception);
+      self.emit('close', exception ? true : false);
+    });
+  } else if (exception && !this.destroyed) {
+    process.nextTick(function() {
+      self.emit('error', exception);
+    });
+  }
+
+  this.destroyed = true;
+};
+
+
+// var socket = new Socket();
+// socket.connect(80)               - TCP connect to port 80 on the localhost
+// socket.connect(80, 'nodejs.org') - TCP connect to port 80 on nodejs.org
+Socket.prototype.connect = function(port /* [host], [cb] */) {
+  var self = this;
+
+  if (this._handle || this._connecting) {
+    throw new Error('Socket already opened');
+  }
+
+  port = toPort(port);
+  if (port === false) throw noUnixSockets();
+
+  var host = typeof arguments[1] == 'string' ? arguments[1] : undefined;
+
+  var lastArg = arguments[arguments.length - 1];
+  if (typeof lastArg == 'function') {
+    self.addListener('connect', lastArg);
+  }
+
+  timers.active(this);
+
+  self._connecting = true;
+  self.writable = true;
+  self.destroyed = false;
+
+  require('dns').lookup(host, 4, function(err, ip, addressType) {
+    if (!self._connecting) return;
+
+    if (!err && addressType == 6) err = noIPv6();
+    if (err) {
+      self.destroy(err);
+      return;
+    }
+
+    timers.active(self);
+    ip = ip || '127.0.0.1';
+    self.remoteAddress = ip;
+    self.remotePort = port;
+    self._attach(new TCP());
+
+    debug('connecting to ' + ip + ' : ' + port);
+
+    var req;
+    try {
+      req = self._handle.connect(ip, port);
+    } catch (e) {
+      self.destroy(e);
+      return;
+    }
+    req.oncomplete = afterConnect;
+  });
+};
+
+
+function afterConnect(err, handle, req) {
+  var self = handle.socket;
+  if (!self || self.destroyed) return;
+
+  self._connecting = false;
+
+  if (err) {
+    self.destroy(err);
+    return;
+  }
+
+  self.readable = true;
+  if (self._noDelay !== undefined) handle.setNoDelay(self._noDelay);
+  if (!self._paused) handle.readStart();
+
+  try {
+    self.emit('connect');
+  } catch (e) {
+    self.destroy(e);
+    return;
+  }
+
+  // Writes made while connecting, then the end() if there was one.
+  var queue = self._connectQueue;
+  self._connectQueue = null;
+  self.bufferSize = 0;
+
+  if (queue) {
+    for (var i = 0; i < queue.length && self._handle; i++) {
+      self._write(queue[i][0], queue[i][1], queue[i][2]);
+    }
+  }
+
+  if (self._ended && self._handle) self._shutdown();
+}
+
+
+function Server(/* [ options, ] listener */) {
+  if (!(this instanceof Server)) return new Server(arguments[0], arguments[1]);
+  events.EventEmitter.call(this);
+
+  var options = {};
+  if (typeof arguments[0] == 'object') {
+    options = arguments[0];
+  }
+
+  // listener: find the last argument that is a function
+  for (var l = arguments.length - 1; l >= 0; l--) {
+    if (typeof arguments[l] == 'function') {
+      this.addListener('connection', arguments[l]);
+    }
+    if (arguments[l] !== undefined) break;
+  }
+
+  this.connections = 0;
+  this.allowHalfOpen = options.allowHalfOpen || false;
+  this._handle = null;
+}
+util.inherits(Server, events.EventEmitter);
+exports.Server = Server;
+
+
+exports.createServer = function() {
+  return new Server(arguments[0], arguments[1]);
+};
+
+
+// Listen on port 8000, accept connections from INADDR_ANY.
+// server.listen(8000);
+//
+// Listen on port 8000, accept connections to '192.168.1.2'
+// server.listen(8000, '192.168.1.2');
+Server.prototype.listen = function() {
+  var self = this;
+  if (this._handle) throw new Error('Server already opened');
+
+  var lastArg = arguments[arguments.length - 1];
+  if (typeof lastArg == 'function') {
+    self.addListener('listening', lastArg);
+  }
+
+  var port = toPort(arguments[0]);
+
+  if (arguments.length == 0 || typeof arguments[0] == 'function') {
+    // The OS assigns a port; see server.address().
+    self._doListen(0, '0.0.0.0');
+  } else if (port === false) {
+    throw noUnixSockets();
+  } else if (typeof arguments[1] != 'string') {
+    self._doListen(port, '0.0.0.0');
+  } else {
+    require('dns').lookup(arguments[1], 4, function(err, ip, addressType) {
+      if (!err && addressType == 6) err = noIPv6();
+      if (err) {
+        self.emit('error', err);
+      } else {
+        self._doListen(port, ip || '0.0.0.0');
+      }
+    });
+  }
+};
+
+
+Server.prototype.listenFD = function(fd, type) {
+  throw new Error('listenFD() is not supported by the libuv backend');
+};
+
+
+Server.prototype._doListen = function(port, ip) {
+  var self = this;
+  var handle = new TCP();
+
+  try {
+    handle.bind(ip, port);
+  } catch (err) {
+    handle.close();
+    self.emit('error', err);
+    return;
+  }
+
+  handle.onconnection = onconnection;
+  handle.server = self;
+  self._handle = handle;
+
+  // Need to the listening in the nextTick so that people potentially have
+  // time to register 'listening' listeners.
+  process.nextTick(function() {
+    // Bail if server.close() was called in the meantime.
+    if (self._handle !== handle) return;
+
+    try {
+      handle.listen(self._backlog || 128);
+    } catch (err) {
+      self.close();
+      self.emit('error', err);
+      return;
+    }
+
+    self.emit('listening');
+  });
+};
+
+
+function onconnection(clientHandle) {
+  var self = this.server;
+
+  if (self.maxConnections && self.connections >= self.maxConnections) {
+    clientHandle.close();
+    return;
+  }
+
+  var s = new Socket({ allowHalfOpen: self.allowHalfOpen });
+  s._attach(clientHandle);
+
+  try {
+    var peer = clientHandle.getpeername();
+    s.remoteAddress = peer.address;
+    s.remotePort = peer.port;
+  } catch (e) {
+    // The peer may already be gone; reads will tell.
+  }
+
+  s.readable = s.writable = true;
+  s.server = self;
+  self.connections++;
+
+  clientHandle.readStart();
+
+  DTRACE_NET_SERVER_CONNECTION(s);
+  self.emit('connection', s);
+
+  // The 'connect' event  probably should be removed for server-side
+  // sockets. It's redundant.
+  try {
+    s.emit('connect');
+  } catch (e) {
+    s.destroy(e);
+  }
+}
+
+
+// Just stop trying to accepting connections for a while.
+// Useful for throttling against DoS attacks.
+Server.prototype.pause = function(msecs) {
+  // We're already paused.
+  if (this._pauseTimer || !this._handle) return;
+
+  var self = this;
+  msecs = msecs || 1000;
+
+  this._handle.readStop();
+
+  // Wait a second before accepting more.
+  this._pauseTimer = setTimeout(function() {
+    self._pauseTimer = null;
+    if (self._handle) self._handle.listen(self._backlog || 128);
+  }, msecs);
+};
+
+
+Server.prototype.address = function() {
+  return this._handle.getsockname();
+};
+
+
+Server.prototype.close = function() {
+  if (!this._handle) throw new Error('Not running');
+
+  this._handle.close();
+  this._handle = null;
+
+  if (this._pauseTimer) {
+    clearTimeout(this._pauseTimer);
+    this._pauseTimer = null;
+  }
+
+  this.emit('close');
+};
@@ -0,0 +1,113 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var binding = process.binding('profiler');
+var fs = require('fs');
+var path = require('path');
+
+
+exports.startProfiling = function(title) {
+  binding.startProfiling(title === undefined ? '' : String(title));
+};
+
+
+// stopProfiling([title], [format])
+// format is 'tree' (the default) or 'collapsed'.
+exports.stopProfiling = function(title, format) {
+  return binding.stopProfiling(title === undefined ? '' : String(title),
+                               format || 'tree');
+};
+
+
+// Starts a profile on the first delivery of `signal` and stops it on the
+// next one, writing the collapsed stacks to
+// `<directory>/cpu-<pid>-<n>.folded`. `callback(err, filename)` is called
+// each time a profile has been written.
+exports.toggleOnSignal = function(signal, directory, callback) {
+  if (typeof directory === 'function') {
+    callback = directory;
+    directory = null;
+  }
+  directory = directory || process.cwd();
+
+  var running = false;
+  var count = 0;
+  var title = 'signal-' + signal;
+
+  process.on(signal, function() {
+    if (!running) {
+      running = true;
+      exports.startProfiling(title);
+      return;
+    }
+
+    running = false;
+    var stacks = exports.stopProfiling(title, 'collapsed');
+    var name = 'cpu-' + process.pid + '-' + (++count) + '.folded';
+    var filename = path.join(directory, name);
+    fs.writeFile(filename, stacks, function(err) {
+      if (callback) callback(err, filename);
+    });
+  });
+};
+
+
+// V8 keeps every heap snapshot until the process exits, and each one is
+// about as large as the heap was. Past this many, taking another throws.
+exports.maxSnapshots = 10;
+
+function checkSnapshotLimit() {
+  if (binding.getSnapshotsCount() >= exports.maxSnapshots) {
+    throw new Error('Heap snapshot limit reached (profiler.maxSnapshots = ' +
+                    exports.maxSnapshots + ')');
+  }
+}
+
+
+// Writes a heap snapshot to `filename`, or to `fd` when given a number.
+// The snapshot is streamed out in chunks as it is serialized.
+exports.writeHeapSnapshot = function(filename, title) {
+  checkSnapshotLimit();
+
+  if (typeof filename === 'number') {
+    return binding.takeSnapshot(filename, title);
+  }
+
+  var fd = fs.openSync(filename, 'w');
+  try {
+    return binding.takeSnapshot(fd, title);
+  } finally {
+    fs.closeSync(fd);
+  }
+};
+
+
+// Live objects grouped by constructor name, largest total size first.
+exports.countObjects = function() {
+  checkSnapshotLimit();
+
+  return binding.countObjects().sort(function(a, b) {
+    return b.size - a.size;
+  });
+};
+
+
+exports.heapStatistics = binding.getHeapStatistics;
@@ -22,7 +22,7 @@
 // Query String Utilities
 
 var QueryString = exports;
-var urlDecode = process.binding('http_parser').urlDecode;
+var binding = process.binding('querystring');
 
 
 function charCode(c) {
@@ -98,13 +98,15 @@ QueryString.unescapeBuffer = function(s, decodeSpaces) {
 
 
 QueryString.unescape = function(s, decodeSpaces) {
-  return QueryString.unescapeBuffer(s, decodeSpaces).toString();
+  return binding.unescape(s, decodeSpaces);
 };
+var defaultUnescape = QueryString.unescape;
 
 
 QueryString.escape = function(str) {
   return encodeURIComponent(str);
 };
+var defaultEscape = QueryString.escape;
 
 var stringifyPrimitive = function(v) {
   switch (typeof v) {
@@ -130,6 +132,13 @@ QueryString.stringify = QueryString.encode = function(obj, sep, eq, name) {
 
   switch (typeof obj) {
     case 'object':
+      // The native version escapes and joins in one pass; it gives up on
+      // strings encodeURIComponent would throw on.
+      if (QueryString.escape === defaultEscape &&
+          typeof sep === 'string' && typeof eq === 'string') {
+        var s = binding.stringify(obj, Object.keys(obj), sep, eq);
+        if (s !== undefined) return s;
+      }
       return Object.keys(obj).map(function(k) {
         if (Array.isArray(obj[k])) {
           return obj[k].map(function(v) {
@@ -151,16 +160,28 @@ QueryString.stringify = QueryString.encode = function(obj, sep, eq, name) {
   }
 };
 
-// Parse a key=val string.
+// Parse a key=val string, or a Buffer holding one.
 QueryString.parse = QueryString.decode = function(qs, sep, eq) {
   sep = sep || '&';
   eq = eq || '=';
   var obj = {};
 
+  // Parsed natively unless QueryString.unescape was replaced or sep or eq
+  // is something split() does not take as a plain string.
+  var useNative = QueryString.unescape === defaultUnescape &&
+                  typeof sep === 'string' && typeof eq === 'string';
+
+  if (Buffer.isBuffer(qs)) {
+    if (useNative) return binding.parse(qs, sep, eq);
+    qs = qs.toString();
+  }
+
   if (typeof qs !== 'string' || qs.length === 0) {
     return obj;
   }
 
+  if (useNative) return binding.parse(qs, sep, eq);
+
   qs.split(sep).forEach(function(kvp) {
     var x = kvp.split(eq);
     var k = QueryString.unescape(x[0], true);
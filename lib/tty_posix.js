@@ -21,7 +21,7 @@
 
 
 var binding = process.binding('stdio'),
-    net = require('net'),
+    net = require('net_legacy'),
     inherits = require('util').inherits,
     spawn = require('child_process').spawn;
 
@@ -37,7 +37,7 @@ exports.open = function(path, args) {
     env[k] = process.env[k];
   }
 
-  var stream = require('net').Stream(slaveFD);
+  var stream = require('net_legacy').Stream(slaveFD);
   stream.readable = stream.writable = true;
   stream.resume();
 
@@ -19,10 +19,13 @@
 // OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
 // USE OR OTHER DEALINGS IN THE SOFTWARE.
 
+var binding = process.binding('url');
+
 exports.parse = urlParse;
 exports.resolve = urlResolve;
 exports.resolveObject = urlResolveObject;
 exports.format = urlFormat;
+exports._jsParse = jsUrlParse;
 
 // Reference: RFC 3986, RFC 1808, RFC 2396
 
@@ -88,6 +91,46 @@ var protocolPattern = /^([a-z0-9]+:)/i,
 function urlParse(url, parseQueryString, slashesDenoteHost) {
   if (url && typeof(url) === 'object' && url.href) return url;
 
+  // Strings are parsed natively, in one pass. Anything else takes the
+  // JavaScript path, which throws the same errors it always has.
+  if (typeof url !== 'string') {
+    return jsUrlParse(url, parseQueryString, slashesDenoteHost);
+  }
+
+  var out = binding.parse(url, !!parseQueryString, !!slashesDenoteHost);
+  if (parseQueryString && typeof out.query === 'string') {
+    lazyQuery(out);
+  }
+  return out;
+}
+
+// Parses out.query the first time it is read.
+function lazyQuery(out) {
+  var query = out.query;
+  function set(value) {
+    Object.defineProperty(out, 'query', {
+      value: value,
+      writable: true,
+      enumerable: true,
+      configurable: true
+    });
+  }
+  Object.defineProperty(out, 'query', {
+    get: function() {
+      var value = querystring.parse(query);
+      set(value);
+      return value;
+    },
+    set: set,
+    enumerable: true,
+    configurable: true
+  });
+}
+
+// The reference implementation; the native parser follows it step by step.
+function jsUrlParse(url, parseQueryString, slashesDenoteHost) {
+  if (url && typeof(url) === 'object' && url.href) return url;
+
   var out = {},
       rest = url;
 
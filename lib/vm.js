@@ -20,13 +20,25 @@
 // USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 var binding = process.binding('evals');
+var Buffer = require('buffer').Buffer;
 
 exports.Script = binding.NodeScript;
-exports.createScript = function(code, ctx, name) {
-  return new exports.Script(code, ctx, name);
+exports.createScript = function(code, filename, cachedData) {
+  return new exports.Script(code, filename, cachedData);
+};
+
+exports.Script.prototype.createCachedData = function() {
+  var slow = this._createCachedData();
+  return new Buffer(slow, slow.length, 0);
 };
 
 exports.createContext = binding.NodeScript.createContext;
 exports.runInContext = binding.NodeScript.runInContext;
 exports.runInThisContext = binding.NodeScript.runInThisContext;
 exports.runInNewContext = binding.NodeScript.runInNewContext;
+
+exports.ContextPool = binding.ContextPool;
+exports.createContextPool = function(options) {
+  options = options || {};
+  return new exports.ContextPool(options.size, options.maxUses);
+};
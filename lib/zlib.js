@@ -0,0 +1,543 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var binding = process.binding('zlib');
+var Stream = require('stream').Stream;
+var util = require('util');
+
+
+// zlib constants
+Object.keys(binding).forEach(function(k) {
+  if (k.match(/^Z/)) exports[k] = binding[k];
+});
+
+// translation table for return codes.
+exports.codes = {
+  Z_OK: binding.Z_OK,
+  Z_STREAM_END: binding.Z_STREAM_END,
+  Z_NEED_DICT: binding.Z_NEED_DICT,
+  Z_ERRNO: binding.Z_ERRNO,
+  Z_STREAM_ERROR: binding.Z_STREAM_ERROR,
+  Z_DATA_ERROR: binding.Z_DATA_ERROR,
+  Z_MEM_ERROR: binding.Z_MEM_ERROR,
+  Z_BUF_ERROR: binding.Z_BUF_ERROR,
+  Z_VERSION_ERROR: binding.Z_VERSION_ERROR
+};
+
+Object.keys(exports.codes).forEach(function(k) {
+  exports.codes[exports.codes[k]] = k;
+});
+
+exports.Z_MIN_WINDOWBITS = 8;
+exports.Z_MAX_WINDOWBITS = 15;
+exports.Z_DEFAULT_WINDOWBITS = 15;
+
+// The output buffer; a new one is allocated only once the current one
+// has been filled up.
+exports.Z_MIN_CHUNK = 64;
+exports.Z_MAX_CHUNK = Infinity;
+exports.Z_DEFAULT_CHUNK = (16 * 1024);
+
+exports.Z_MIN_MEMLEVEL = 1;
+exports.Z_MAX_MEMLEVEL = 9;
+exports.Z_DEFAULT_MEMLEVEL = 8;
+
+exports.Z_MIN_LEVEL = -1;
+exports.Z_MAX_LEVEL = 9;
+exports.Z_DEFAULT_LEVEL = binding.Z_DEFAULT_COMPRESSION;
+
+
+exports.Deflate = Deflate;
+exports.Inflate = Inflate;
+exports.Gzip = Gzip;
+exports.Gunzip = Gunzip;
+exports.DeflateRaw = DeflateRaw;
+exports.InflateRaw = InflateRaw;
+exports.Unzip = Unzip;
+
+exports.createDeflate = function(o) {
+  return new Deflate(o);
+};
+
+exports.createInflate = function(o) {
+  return new Inflate(o);
+};
+
+exports.createDeflateRaw = function(o) {
+  return new DeflateRaw(o);
+};
+
+exports.createInflateRaw = function(o) {
+  return new InflateRaw(o);
+};
+
+exports.createGzip = function(o) {
+  return new Gzip(o);
+};
+
+exports.createGunzip = function(o) {
+  return new Gunzip(o);
+};
+
+exports.createUnzip = function(o) {
+  return new Unzip(o);
+};
+
+
+// Convenience methods.
+// compress/decompress a string or buffer in one step.
+exports.deflate = function(buffer, callback) {
+  zlibBuffer(new Deflate(), buffer, callback);
+};
+
+exports.deflateSync = function(buffer, opts) {
+  return zlibBufferSync(new Deflate(opts), buffer);
+};
+
+exports.gzip = function(buffer, callback) {
+  zlibBuffer(new Gzip(), buffer, callback);
+};
+
+exports.gzipSync = function(buffer, opts) {
+  return zlibBufferSync(new Gzip(opts), buffer);
+};
+
+exports.deflateRaw = function(buffer, callback) {
+  zlibBuffer(new DeflateRaw(), buffer, callback);
+};
+
+exports.deflateRawSync = function(buffer, opts) {
+  return zlibBufferSync(new DeflateRaw(opts), buffer);
+};
+
+exports.unzip = function(buffer, callback) {
+  zlibBuffer(new Unzip(), buffer, callback);
+};
+
+exports.unzipSync = function(buffer, opts) {
+  return zlibBufferSync(new Unzip(opts), buffer);
+};
+
+exports.inflate = function(buffer, callback) {
+  zlibBuffer(new Inflate(), buffer, callback);
+};
+
+exports.inflateSync = function(buffer, opts) {
+  return zlibBufferSync(new Inflate(opts), buffer);
+};
+
+exports.gunzip = function(buffer, callback) {
+  zlibBuffer(new Gunzip(), buffer, callback);
+};
+
+exports.gunzipSync = function(buffer, opts) {
+  return zlibBufferSync(new Gunzip(opts), buffer);
+};
+
+exports.inflateRaw = function(buffer, callback) {
+  zlibBuffer(new InflateRaw(), buffer, callback);
+};
+
+exports.inflateRawSync = function(buffer, opts) {
+  return zlibBufferSync(new InflateRaw(opts), buffer);
+};
+
+
+function zlibBuffer(engine, buffer, callback) {
+  var buffers = [];
+  var nread = 0;
+
+  engine.on('error', function(err) {
+    engine.removeListener('end', onEnd);
+    callback(err);
+  });
+
+  engine.on('data', function(chunk) {
+    buffers.push(chunk);
+    nread += chunk.length;
+  });
+
+  engine.on('end', onEnd);
+
+  function onEnd() {
+    callback(null, Buffer.concat(buffers, nread));
+  }
+
+  engine.end(buffer);
+}
+
+
+function zlibBufferSync(engine, buffer) {
+  if (typeof buffer === 'string') buffer = new Buffer(buffer);
+  if (!Buffer.isBuffer(buffer)) {
+    throw new TypeError('Not a string or buffer');
+  }
+
+  try {
+    return engine._processSync(buffer, binding.Z_FINISH);
+  } finally {
+    engine.close();
+  }
+}
+
+
+function checkRange(name, value, min, max) {
+  if (value < min || value > max) {
+    throw new Error('Invalid ' + name + ': ' + value);
+  }
+}
+
+
+// the Zlib class they all inherit from
+// This thing manages the queue of requests, and returns
+// true or false if there is anything in the queue when
+// you call the .write() method.
+function Zlib(opts, mode) {
+  Stream.call(this);
+
+  this._opts = opts = opts || {};
+  this._queue = [];
+  this._processing = false;
+  this._paused = false;
+  this._needDrain = false;
+  this._ended = false;
+  this._closed = false;
+  this._hadError = false;
+
+  this.readable = true;
+  this.writable = true;
+
+  this._chunkSize = opts.chunkSize || exports.Z_DEFAULT_CHUNK;
+  checkRange('chunk size', this._chunkSize,
+             exports.Z_MIN_CHUNK, exports.Z_MAX_CHUNK);
+
+  var windowBits = opts.windowBits || exports.Z_DEFAULT_WINDOWBITS;
+  checkRange('windowBits', windowBits,
+             exports.Z_MIN_WINDOWBITS, exports.Z_MAX_WINDOWBITS);
+
+  var level = typeof opts.level === 'number' ?
+              opts.level : exports.Z_DEFAULT_LEVEL;
+  checkRange('compression level', level,
+             exports.Z_MIN_LEVEL, exports.Z_MAX_LEVEL);
+
+  var memLevel = opts.memLevel || exports.Z_DEFAULT_MEMLEVEL;
+  checkRange('memLevel', memLevel,
+             exports.Z_MIN_MEMLEVEL, exports.Z_MAX_MEMLEVEL);
+
+  var strategy = typeof opts.strategy === 'number' ?
+                 opts.strategy : binding.Z_DEFAULT_STRATEGY;
+  if (strategy != binding.Z_FILTERED &&
+      strategy != binding.Z_HUFFMAN_ONLY &&
+      strategy != binding.Z_RLE &&
+      strategy != binding.Z_FIXED &&
+      strategy != binding.Z_DEFAULT_STRATEGY) {
+    throw new Error('Invalid strategy: ' + opts.strategy);
+  }
+
+  if (opts.dictionary && !Buffer.isBuffer(opts.dictionary)) {
+    throw new Error('Invalid dictionary: it should be a Buffer instance');
+  }
+
+  // Flush mode for plain write() calls; Z_SYNC_FLUSH gets every write
+  // to the other side right away, at some cost in ratio.
+  this._flushFlag = opts.flush || binding.Z_NO_FLUSH;
+
+  this._binding = new binding.Zlib(mode);
+
+  var self = this;
+  this._binding.onerror = function(err) {
+    // there is no way to cleanly recover.
+    // continuing only obscures problems.
+    self._hadError = true;
+    self._processing = false;
+    self._queue = [];
+    err.code = exports.codes[err.errno];
+    self.emit('error', err);
+    self.close();
+  };
+
+  this._binding.init(windowBits, level, memLevel, strategy, opts.dictionary);
+
+  this._buffer = new Buffer(this._chunkSize);
+  this._offset = 0;
+}
+util.inherits(Zlib, Stream);
+
+
+// generic zlib
+// minimal 2-byte header
+function Deflate(opts) {
+  if (!(this instanceof Deflate)) return new Deflate(opts);
+  Zlib.call(this, opts, binding.DEFLATE);
+}
+util.inherits(Deflate, Zlib);
+
+function Inflate(opts) {
+  if (!(this instanceof Inflate)) return new Inflate(opts);
+  Zlib.call(this, opts, binding.INFLATE);
+}
+util.inherits(Inflate, Zlib);
+
+
+// gzip - bigger header, same deflate compression
+function Gzip(opts) {
+  if (!(this instanceof Gzip)) return new Gzip(opts);
+  Zlib.call(this, opts, binding.GZIP);
+}
+util.inherits(Gzip, Zlib);
+
+function Gunzip(opts) {
+  if (!(this instanceof Gunzip)) return new Gunzip(opts);
+  Zlib.call(this, opts, binding.GUNZIP);
+}
+util.inherits(Gunzip, Zlib);
+
+
+// raw - no header
+function DeflateRaw(opts) {
+  if (!(this instanceof DeflateRaw)) return new DeflateRaw(opts);
+  Zlib.call(this, opts, binding.DEFLATERAW);
+}
+util.inherits(DeflateRaw, Zlib);
+
+function InflateRaw(opts) {
+  if (!(this instanceof InflateRaw)) return new InflateRaw(opts);
+  Zlib.call(this, opts, binding.INFLATERAW);
+}
+util.inherits(InflateRaw, Zlib);
+
+
+// auto-detect header.
+function Unzip(opts) {
+  if (!(this instanceof Unzip)) return new Unzip(opts);
+  Zlib.call(this, opts, binding.UNZIP);
+}
+util.inherits(Unzip, Zlib);
+
+
+Zlib.prototype.write = function(chunk, cb) {
+  if (this._hadError) return true;
+
+  if (this._ended) {
+    return this.emit('error', new Error('Cannot write after end'));
+  }
+
+  if (typeof chunk === 'function') {
+    cb = chunk;
+    chunk = null;
+  }
+
+  return this._push(chunk, this._flushFlag, cb);
+};
+
+
+// Pushes out everything written so far, e.g. one server-sent event.
+Zlib.prototype.flush = function(cb) {
+  if (this._hadError) return true;
+
+  if (this._ended) {
+    return this.emit('error', new Error('Cannot flush after end'));
+  }
+
+  return this._push(null, binding.Z_SYNC_FLUSH, cb);
+};
+
+
+Zlib.prototype.end = function(chunk, cb) {
+  if (this._hadError || this._ended) return true;
+
+  if (typeof chunk === 'function') {
+    cb = chunk;
+    chunk = null;
+  }
+
+  var self = this;
+  var ret = this._push(chunk, binding.Z_FINISH, function() {
+    self.emit('end');
+    self.close();
+    if (cb) cb();
+  });
+
+  this._ended = true;
+  this.writable = false;
+  return ret;
+};
+
+
+Zlib.prototype._push = function(chunk, flushFlag, cb) {
+  if (!chunk) {
+    chunk = null;
+  } else if (typeof chunk === 'string') {
+    chunk = new Buffer(chunk);
+  } else if (!Buffer.isBuffer(chunk)) {
+    return this.emit('error', new Error('Invalid argument'));
+  }
+
+  var empty = this._queue.length === 0 && !this._processing;
+  this._queue.push([chunk, flushFlag, cb]);
+  this._process();
+  if (!empty) this._needDrain = true;
+  return empty;
+};
+
+
+Zlib.prototype._process = function() {
+  if (this._processing || this._paused || this._closed) return;
+
+  if (this._queue.length === 0) {
+    if (this._needDrain) {
+      this._needDrain = false;
+      this.emit('drain');
+    }
+    return;
+  }
+
+  var req = this._queue.shift();
+  var chunk = req[0];
+  var flushFlag = req[1];
+  var cb = req[2];
+
+  var availInBefore = chunk ? chunk.length : 0;
+  var availOutBefore = this._chunkSize - this._offset;
+  var inOff = 0;
+  var self = this;
+
+  this._processing = true;
+  this._binding.callback = callback;
+  this._binding.write(flushFlag,
+                      chunk, inOff, availInBefore,
+                      this._buffer, this._offset, availOutBefore);
+
+  function callback(availInAfter, availOutAfter) {
+    if (self._hadError || self._closed) return;
+
+    var have = availOutBefore - availOutAfter;
+
+    if (have > 0) {
+      var out = self._buffer.slice(self._offset, self._offset + have);
+      self._offset += have;
+      self.emit('data', out);
+    }
+
+    if (availOutAfter !== 0) {
+      // All of this chunk went in.
+      self._processing = false;
+      if (cb) cb();
+      self._process();
+      return;
+    }
+
+    // The output buffer is full; the slices handed out keep it alive.
+    self._buffer = new Buffer(self._chunkSize);
+    self._offset = 0;
+    availOutBefore = self._chunkSize;
+
+    inOff += (availInBefore - availInAfter);
+    availInBefore = availInAfter;
+
+    self._binding.write(flushFlag,
+                        chunk, inOff, availInBefore,
+                        self._buffer, self._offset, availOutBefore);
+  }
+};
+
+
+Zlib.prototype._processSync = function(chunk, flushFlag) {
+  var buffers = [];
+  var nread = 0;
+  var availInBefore = chunk.length;
+  var inOff = 0;
+
+  while (true) {
+    var availOutBefore = this._chunkSize - this._offset;
+    var res;
+
+    try {
+      res = this._binding.writeSync(flushFlag,
+                                    chunk, inOff, availInBefore,
+                                    this._buffer, this._offset,
+                                    availOutBefore);
+    } catch (err) {
+      if (err.errno !== undefined) err.code = exports.codes[err.errno];
+      throw err;
+    }
+
+    var availInAfter = res[0];
+    var availOutAfter = res[1];
+    var have = availOutBefore - availOutAfter;
+
+    if (have > 0) {
+      buffers.push(this._buffer.slice(this._offset, this._offset + have));
+      nread += have;
+      this._offset += have;
+    }
+
+    if (availOutAfter !== 0) break;
+
+    this._buffer = new Buffer(this._chunkSize);
+    this._offset = 0;
+
+    inOff += (availInBefore - availInAfter);
+    availInBefore = availInAfter;
+  }
+
+  return Buffer.concat(buffers, nread);
+};
+
+
+Zlib.prototype.pause = function() {
+  this._paused = true;
+  this.emit('pause');
+};
+
+
+Zlib.prototype.resume = function() {
+  this._paused = false;
+  this.emit('resume');
+  this._process();
+};
+
+
+// Starts over on the same windows, e.g. for the next response.
+Zlib.prototype.reset = function() {
+  return this._binding.reset();
+};
+
+
+Zlib.prototype.destroy = function() {
+  this.close();
+};
+
+
+Zlib.prototype.close = function(callback) {
+  if (callback) this.once('close', callback);
+
+  if (this._closed) return;
+
+  this._closed = true;
+  this.readable = this.writable = false;
+  this._binding.close();
+
+  var self = this;
+  process.nextTick(function() {
+    self.emit('close');
+  });
+};
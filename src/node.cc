@@ -63,6 +63,7 @@
 #include <node_http_parser.h>
 #include <node_signal_watcher.h>
 #include <node_stat_watcher.h>
+#include <node_stream_wrap.h>
 #include <node_timer.h>
 #include <node_child_process.h>
 #include <node_constants.h>
@@ -70,6 +71,10 @@
 #include <node_javascript.h>
 #include <node_version.h>
 #include <node_string.h>
+#include <node_hex.h>
+#include <node_gc_stats.h>
+#include <node_gc_scheduler.h>
+#include <node_loop_stats.h>
 #ifdef HAVE_OPENSSL
 # include <node_crypto.h>
 #endif
@@ -110,6 +115,7 @@ static int option_end_index = 0;
 static bool use_debug_agent = false;
 static bool debug_wait_connect = false;
 static bool cov = false;
+static bool use_uv = false;
 static int debug_port=5858;
 static int max_stack_size = 0;
 
@@ -127,81 +133,6 @@ static ev_idle  eio_poller;
 // scoped at file-level rather than method-level to avoid excess stack usage.
 static char getbuf[PATH_MAX + 1];
 
-// We need to notify V8 when we're idle so that it can run the garbage
-// collector. The interface to this is V8::IdleNotification(). It returns
-// true if the heap hasn't be fully compacted, and needs to be run again.
-// Returning false means that it doesn't have anymore work to do.
-//
-// A rather convoluted algorithm has been devised to determine when Node is
-// idle. You'll have to figure it out for yourself.
-static ev_check gc_check;
-static ev_idle  gc_idle;
-static ev_timer gc_timer;
-bool need_gc;
-
-
-#define FAST_TICK 0.7
-#define GC_WAIT_TIME 5.
-#define RPM_SAMPLES 100
-#define TICK_TIME(n) tick_times[(tick_time_head - (n)) % RPM_SAMPLES]
-static ev_tstamp tick_times[RPM_SAMPLES];
-static int tick_time_head;
-
-static void StartGCTimer () {
-  if (!ev_is_active(&gc_timer)) {
-    ev_timer_start(EV_DEFAULT_UC_ &gc_timer);
-    ev_unref(EV_DEFAULT_UC);
-  }
-}
-
-static void StopGCTimer () {
-  if (ev_is_active(&gc_timer)) {
-    ev_ref(EV_DEFAULT_UC);
-    ev_timer_stop(EV_DEFAULT_UC_ &gc_timer);
-  }
-}
-
-static void Idle(EV_P_ ev_idle *watcher, int revents) {
-  assert(watcher == &gc_idle);
-  assert(revents == EV_IDLE);
-
-  //fprintf(stderr, "idle\n");
-
-  if (V8::IdleNotification()) {
-    ev_idle_stop(EV_A_ watcher);
-    StopGCTimer();
-  }
-}
-
-
-// Called directly after every call to select() (or epoll, or whatever)
-static void Check(EV_P_ ev_check *watcher, int revents) {
-  assert(watcher == &gc_check);
-  assert(revents == EV_CHECK);
-
-  tick_times[tick_time_head] = ev_now(EV_DEFAULT_UC);
-  tick_time_head = (tick_time_head + 1) % RPM_SAMPLES;
-
-  StartGCTimer();
-
-  for (int i = 0; i < (int)(GC_WAIT_TIME/FAST_TICK); i++) {
-    double d = TICK_TIME(i+1) - TICK_TIME(i+2);
-    //printf("d = %f\n", d);
-    // If in the last 5 ticks the difference between
-    // ticks was less than 0.7 seconds, then continue.
-    if (d < FAST_TICK) {
-      //printf("---\n");
-      return;
-    }
-  }
-
-  // Otherwise start the gc!
-
-  //fprintf(stderr, "start idle 2\n");
-  ev_idle_start(EV_A_ &gc_idle);
-}
-
-
 static void Spin(uv_handle_t* handle, int status) {
   assert(handle == &tick_spinner);
   assert(status == 0);
@@ -242,10 +173,13 @@ static void Tick(void) {
 
   TryCatch try_catch;
 
-  cb->Call(process, 0, NULL);
+  // _tickCallback returns the number of callbacks it ran.
+  Local<Value> ran = cb->Call(process, 0, NULL);
 
   if (try_catch.HasCaught()) {
     FatalException(try_catch);
+  } else if (ran->IsNumber()) {
+    LoopStats::RecordTickDepth(ran->NumberValue());
   }
 }
 
@@ -254,12 +188,14 @@ static void PrepareTick(uv_handle_t* handle, int status) {
   assert(handle == &prepare_tick_watcher);
   assert(status == 0);
   Tick();
+  LoopStats::BeforePoll();
 }
 
 
 static void CheckTick(uv_handle_t* handle, int status) {
   assert(handle == &check_tick_watcher);
   assert(status == 0);
+  LoopStats::AfterPoll();
   Tick();
 }
 
@@ -1126,7 +1062,36 @@ Local<Value> Encode(const void *buf, size_t len, enum encoding encoding) {
 
   if (!len) return scope.Close(String::Empty());
 
+  if (encoding == HEX) {
+    size_t out_len = len * 2;
+    char *out = static_cast<char*>(malloc(out_len));
+    if (out == NULL) {
+      ThrowException(Exception::Error(String::New("Out of memory")));
+      return Local<Value>();
+    }
+    EncodeHex(static_cast<const char*>(buf), len, out);
+
+    Local<String> chunk;
+    if (external_string_threshold && out_len >= external_string_threshold) {
+      chunk = ImmutableAsciiCopy::Adopt(out, out_len);
+    } else {
+      chunk = String::New(out, out_len);
+      free(out);
+    }
+    return scope.Close(chunk);
+  }
+
+  // Large 7-bit payloads become external strings backed by an off-heap copy.
+  Local<String> external = ImmutableAsciiCopy::New((const char*)buf, len);
+  if (!external.IsEmpty()) return scope.Close(external);
+
   if (encoding == BINARY) {
+    // Bytes below 0x80 mean the same thing in every one-byte encoding, so
+    // skip the widening copy below.
+    if (IsAscii((const char*)buf, len)) {
+      return scope.Close(String::New((const char*)buf, len));
+    }
+
     const unsigned char *cbuf = static_cast<const unsigned char*>(buf);
     uint16_t * twobytebuf = new uint16_t[len];
     for (size_t i = 0; i < len; i++) {
@@ -1199,6 +1164,17 @@ ssize_t DecodeWrite(char *buf,
     return buflen;
   }
 
+  if (encoding == HEX) {
+    // Read the digits as two-byte characters so that non-ASCII input is
+    // rejected instead of being folded into the ASCII range.
+    size_t digits = MIN(buflen, (size_t)str->Length() / 2) * 2;
+    uint16_t *twobytebuf = new uint16_t[digits + 1];
+    str->Write(twobytebuf, 0, digits, String::HINT_MANY_WRITES_EXPECTED);
+    size_t written = DecodeHex(twobytebuf, digits, buf);
+    delete [] twobytebuf;
+    return written;
+  }
+
   // THIS IS AWFUL!!! FIXME
 
   assert(encoding == BINARY);
@@ -1224,6 +1200,7 @@ void DisplayExceptionLine (TryCatch &try_catch) {
   Handle<Message> message = try_catch.Message();
 
   node::Stdio::DisableRawMode(STDIN_FILENO);
+  node::Stdio::FlushStderr();
   fprintf(stderr, "\n");
 
   if (!message.IsEmpty()) {
@@ -1502,31 +1479,6 @@ v8::Handle<v8::Value> Exit(const v8::Arguments& args) {
 }
 
 
-static void CheckStatus(EV_P_ ev_timer *watcher, int revents) {
-  assert(watcher == &gc_timer);
-  assert(revents == EV_TIMEOUT);
-
-  // check memory
-  if (!ev_is_active(&gc_idle)) {
-    HeapStatistics stats;
-    V8::GetHeapStatistics(&stats);
-    if (stats.total_heap_size() > 1024 * 1024 * 128) {
-      // larger than 128 megs, just start the idle watcher
-      ev_idle_start(EV_A_ &gc_idle);
-      return;
-    }
-  }
-
-  double d = ev_now(EV_DEFAULT_UC) - TICK_TIME(3);
-
-  //printfb("timer d = %f\n", d);
-
-  if (d  >= GC_WAIT_TIME - 1.) {
-    //fprintf(stderr, "start idle\n");
-    ev_idle_start(EV_A_ &gc_idle);
-  }
-}
-
 static Handle<Value> Uptime(const Arguments& args) {
   HandleScope scope;
   assert(args.Length() == 0);
@@ -2046,6 +1998,7 @@ Handle<Object> SetupProcessObject(int argc, char *argv[]) {
 
   process->Set(String::NewSymbol("pid"), Integer::New(getpid()));
   process->Set(String::NewSymbol("cov"), cov ? True() : False());
+  process->Set(String::NewSymbol("useUV"), use_uv ? True() : False());
 
   // -e, --eval
   if (eval_string) {
@@ -2084,6 +2037,15 @@ Handle<Object> SetupProcessObject(int argc, char *argv[]) {
   NODE_SET_METHOD(process, "uptime", Uptime);
   NODE_SET_METHOD(process, "memoryUsage", MemoryUsage);
 
+  GCStats::Initialize(process);
+  NODE_SET_METHOD(process, "gcStats", GCStats::Get);
+  NODE_SET_METHOD(process, "_setGCEvents", GCStats::SetEvents);
+  NODE_SET_METHOD(process, "gcSchedulerStats", GCScheduler::GetStats);
+
+  LoopStats::Initialize();
+  NODE_SET_METHOD(process, "loopStats", LoopStats::Get);
+  NODE_SET_METHOD(process, "dumpLoopStats", LoopStats::Dump);
+
   NODE_SET_METHOD(process, "binding", Binding);
 
   // Assign the EventEmitter. It was created in main().
@@ -2188,7 +2150,12 @@ static void PrintHelp() {
          "  --v8-options         print v8 command line options\n"
          "  --vars               print various compiled-in variables\n"
          "  --max-stack-size=val set max v8 stack size (bytes)\n"
+         "  --gc-scheduler=name  when to collect garbage while idle:\n"
+         "                       adaptive (default), legacy or off\n"
+         "  --gc-idle-slice=ms   longest idle collection slice (10)\n"
+         "  --gc-idle-timeout=s  idle time before releasing memory (5)\n"
          "  --cov                code coverage; writes node-cov.json \n"
+         "  --use-uv             run TCP sockets on libuv (IPv4 only)\n"
          "\n"
          "Enviromental variables:\n"
          "NODE_PATH              ':'-separated list of directories\n"
@@ -2197,6 +2164,7 @@ static void PrintHelp() {
          "NODE_MODULE_CONTEXTS   Set to 1 to load modules in their own\n"
          "                       global contexts.\n"
          "NODE_DISABLE_COLORS    Set to 1 to disable colors in the REPL\n"
+         "NODE_USE_UV            Set to 1 to do the same as --use-uv\n"
          "\n"
          "Documentation can be found at http://nodejs.org/\n");
 }
@@ -2214,6 +2182,9 @@ static void ParseArgs(int argc, char **argv) {
     } else if (!strcmp(arg, "--cov")) {
       cov = true;
       argv[i] = const_cast<char*>("");
+    } else if (!strcmp(arg, "--use-uv")) {
+      use_uv = true;
+      argv[i] = const_cast<char*>("");
     } else if (strcmp(arg, "--version") == 0 || strcmp(arg, "-v") == 0) {
       printf("%s\n", NODE_VERSION);
       exit(0);
@@ -2226,6 +2197,8 @@ static void ParseArgs(int argc, char **argv) {
       p = 1 + strchr(arg, '=');
       max_stack_size = atoi(p);
       argv[i] = const_cast<char*>("");
+    } else if (GCScheduler::ParseOption(arg)) {
+      argv[i] = const_cast<char*>("");
     } else if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
       PrintHelp();
       exit(0);
@@ -2358,12 +2331,8 @@ char** Init(int argc, char *argv[]) {
 
   uv_idle_init(&node::tick_spinner, NULL, NULL);
 
-  ev_check_init(&node::gc_check, node::Check);
-  ev_check_start(EV_DEFAULT_UC_ &node::gc_check);
-  ev_unref(EV_DEFAULT_UC);
-
-  ev_idle_init(&node::gc_idle, node::Idle);
-  ev_timer_init(&node::gc_timer, node::CheckStatus, 5., 5.);
+  // Hand idle time to V8's garbage collector.
+  node::GCScheduler::Initialize();
 
 
   // Setup the EIO thread pool
@@ -2431,17 +2400,9 @@ void EmitExit(v8::Handle<v8::Object> process) {
 }
 
 
-uv_buf UVAlloc(uv_handle_t* handle, size_t suggested_size) {
-  char* base = (char*)malloc(suggested_size);
-  uv_buf buf;
-  buf.base = base;
-  buf.len = suggested_size;
-  return buf;
-}
-
-
 int Start(int argc, char *argv[]) {
-  uv_init(UVAlloc);
+  // Reads on libuv streams go into StreamWrap's slab.
+  uv_init(StreamWrap::Alloc);
   v8::V8::Initialize();
   v8::HandleScope handle_scope;
 
@@ -168,7 +168,7 @@
 
     process._tickCallback = function() {
       var l = nextTickQueue.length;
-      if (l === 0) return;
+      if (l === 0) return 0;
 
       try {
         for (var i = 0; i < l; i++) {
@@ -184,6 +184,7 @@
       }
 
       nextTickQueue.splice(0, l);
+      return l;
     };
 
     process.nextTick = function(callback) {
@@ -194,7 +195,7 @@
 
   startup.processStdio = function() {
     var binding = process.binding('stdio'),
-        net = NativeModule.require('net'),
+        net = NativeModule.require('net_legacy'),
         fs = NativeModule.require('fs'),
         tty = NativeModule.require('tty');
 
@@ -221,9 +222,20 @@
     var stderr = process.stderr = new events.EventEmitter();
     stderr.writable = true;
     stderr.readable = false;
-    stderr.write = process.binding('stdio').writeError;
+    stderr.write = binding.writeError;
     stderr.end = stderr.destroy = stderr.destroySoon = function() { };
 
+    // Pipes, sockets and ttys get a ring buffer instead of blocking.
+    if (binding.setStderrOverflow) {
+      stderr.setOverflow = binding.setStderrOverflow;
+      stderr.__defineGetter__('bufferSize', function() {
+        return binding.stderrStats().buffered;
+      });
+      stderr.__defineGetter__('droppedBytes', function() {
+        return binding.stderrStats().dropped;
+      });
+    }
+
     // process.stdin
 
     var fd = binding.openStdin();
@@ -290,6 +302,8 @@
         } else if (this.listeners(type).length === 1) {
           signalWatchers[type].start();
         }
+      } else if (type === 'gc' && this.listeners(type).length === 1) {
+        process._setGCEvents(true);
       }
 
       return ret;
@@ -303,6 +317,8 @@
         if (this.listeners(type).length === 0) {
           signalWatchers[type].stop();
         }
+      } else if (type === 'gc' && this.listeners(type).length === 0) {
+        process._setGCEvents(false);
       }
 
       return ret;
@@ -22,6 +22,10 @@
 
 #include <node.h>
 #include <node_buffer.h>
+#include <node_buffer_list.h>
+#include <node_search.h>
+#include <node_hex.h>
+#include <node_string.h>
 
 #include <v8.h>
 
@@ -69,6 +73,7 @@ using namespace v8;
 static Persistent<String> length_symbol;
 static Persistent<String> chars_written_sym;
 static Persistent<String> write_sym;
+static Persistent<String> matched_needle_sym;
 Persistent<FunctionTemplate> Buffer::constructor_template;
 
 
@@ -256,7 +261,8 @@ Handle<Value> Buffer::AsciiSlice(const Arguments &args) {
   SLICE_ARGS(args[0], args[1])
 
   char* data = parent->data_ + start;
-  Local<String> string = String::New(data, end - start);
+  Local<String> string = ImmutableAsciiCopy::New(data, end - start);
+  if (string.IsEmpty()) string = String::New(data, end - start);
 
   return scope.Close(string);
 }
@@ -267,7 +273,8 @@ Handle<Value> Buffer::Utf8Slice(const Arguments &args) {
   Buffer *parent = ObjectWrap::Unwrap<Buffer>(args.This());
   SLICE_ARGS(args[0], args[1])
   char *data = parent->data_ + start;
-  Local<String> string = String::New(data, end - start);
+  Local<String> string = ImmutableAsciiCopy::New(data, end - start);
+  if (string.IsEmpty()) string = String::New(data, end - start);
   return scope.Close(string);
 }
 
@@ -280,6 +287,15 @@ Handle<Value> Buffer::Ucs2Slice(const Arguments &args) {
   return scope.Close(string);
 }
 
+Handle<Value> Buffer::HexSlice(const Arguments &args) {
+  HandleScope scope;
+  Buffer *parent = ObjectWrap::Unwrap<Buffer>(args.This());
+  SLICE_ARGS(args[0], args[1])
+  char *data = parent->data_ + start;
+  Local<Value> string = Encode(data, end - start, HEX);
+  return scope.Close(string);
+}
+
 static const char *base64_table = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
                                   "abcdefghijklmnopqrstuvwxyz"
                                   "0123456789+/";
@@ -456,6 +472,155 @@ Handle<Value> Buffer::Copy(const Arguments &args) {
 }
 
 
+// var bytesCopied = SlowBuffer.concat(list, target);
+// Copies every Buffer in list back to back into target with one memcpy()
+// per chunk. The caller allocates target once at the combined size.
+Handle<Value> Buffer::Concat(const Arguments &args) {
+  HandleScope scope;
+
+  if (!args[0]->IsArray()) {
+    return ThrowException(Exception::TypeError(String::New(
+            "First arg should be an Array")));
+  }
+
+  if (!Buffer::HasInstance(args[1])) {
+    return ThrowException(Exception::TypeError(String::New(
+            "Second arg should be a Buffer")));
+  }
+
+  Local<Array> list = Local<Array>::Cast(args[0]);
+  Local<Object> target = args[1]->ToObject();
+  char *target_data = Buffer::Data(target);
+  size_t target_length = Buffer::Length(target);
+
+  uint32_t n = list->Length();
+  size_t copied = 0;
+
+  for (uint32_t i = 0; i < n && copied < target_length; i++) {
+    Local<Value> chunk = list->Get(i);
+    if (!Buffer::HasInstance(chunk)) {
+      return ThrowException(Exception::TypeError(String::New(
+              "All list elements must be Buffers")));
+    }
+    Local<Object> obj = chunk->ToObject();
+    size_t len = MIN(Buffer::Length(obj), target_length - copied);
+    memcpy(target_data + copied, Buffer::Data(obj), len);
+    copied += len;
+  }
+
+  return scope.Close(Integer::NewFromUnsigned(copied));
+}
+
+
+#define SEARCH_ARGS(start_arg, end_arg)                              \
+  int32_t start = start_arg->Int32Value();                           \
+  int32_t end = end_arg->IsUndefined() ? parent->length_             \
+                                       : end_arg->Int32Value();      \
+  if (start < 0) start = 0;                                          \
+  if (end < 0 || (size_t)end > parent->length_) end = parent->length_; \
+  if (start > end) {                                                 \
+    return scope.Close(Integer::New(-1));                            \
+  }
+
+
+// var index = buffer.indexOf(byte|string|buffer, start=0, end=length);
+// Returns the absolute index of the first match in [start, end), or -1.
+// Strings are matched as UTF-8.
+Handle<Value> Buffer::IndexOf(const Arguments &args) {
+  HandleScope scope;
+  Buffer *parent = ObjectWrap::Unwrap<Buffer>(args.This());
+  SEARCH_ARGS(args[1], args[2])
+
+  const char *haystack = parent->data_ + start;
+  size_t haystack_length = end - start;
+  ssize_t r;
+
+  if (args[0]->IsNumber()) {
+    r = SearchByte(haystack, haystack_length, args[0]->Int32Value() & 0xff);
+  } else if (args[0]->IsString()) {
+    String::Utf8Value needle(args[0]->ToString());
+    r = SearchString(haystack, haystack_length, *needle, needle.length());
+  } else if (Buffer::HasInstance(args[0])) {
+    Local<Object> needle = args[0]->ToObject();
+    r = SearchString(haystack, haystack_length,
+                     Buffer::Data(needle), Buffer::Length(needle));
+  } else {
+    return ThrowException(Exception::TypeError(String::New(
+            "Argument must be a number, string or Buffer")));
+  }
+
+  return scope.Close(Integer::New(r < 0 ? -1 : r + start));
+}
+
+
+// var index = buffer.indexOfAny([string|buffer, ...], start=0, end=length);
+// Scans once for whichever needle occurs first. The position of that
+// needle in the array is stored in SlowBuffer._matchedNeedle.
+Handle<Value> Buffer::IndexOfAny(const Arguments &args) {
+  HandleScope scope;
+  Buffer *parent = ObjectWrap::Unwrap<Buffer>(args.This());
+
+  if (!args[0]->IsArray()) {
+    return ThrowException(Exception::TypeError(String::New(
+            "First arg should be an Array")));
+  }
+
+  SEARCH_ARGS(args[1], args[2])
+
+  Local<Array> list = Local<Array>::Cast(args[0]);
+  int count = list->Length();
+
+  // Flatten all needles into one block so that strings only have to be
+  // encoded once, up front.
+  size_t total = 0;
+  for (int i = 0; i < count; i++) {
+    Local<Value> v = list->Get(i);
+    if (v->IsString()) {
+      total += v->ToString()->Utf8Length();
+    } else if (Buffer::HasInstance(v)) {
+      total += Buffer::Length(v->ToObject());
+    } else {
+      return ThrowException(Exception::TypeError(String::New(
+              "Needles must be strings or Buffers")));
+    }
+  }
+
+  char *storage = new char[total + 1];
+  const char **needles = new const char*[count];
+  size_t *lengths = new size_t[count];
+  size_t used = 0;
+
+  for (int i = 0; i < count; i++) {
+    Local<Value> v = list->Get(i);
+    char *p = storage + used;
+    if (v->IsString()) {
+      Local<String> str = v->ToString();
+      lengths[i] = str->Utf8Length();
+      str->WriteUtf8(p, lengths[i], NULL, String::HINT_MANY_WRITES_EXPECTED);
+    } else {
+      Local<Object> obj = v->ToObject();
+      lengths[i] = Buffer::Length(obj);
+      memcpy(p, Buffer::Data(obj), lengths[i]);
+    }
+    needles[i] = p;
+    used += lengths[i];
+  }
+
+  int which = -1;
+  ssize_t r = SearchMulti(parent->data_ + start, end - start,
+                          needles, lengths, count, &which);
+
+  delete [] storage;
+  delete [] needles;
+  delete [] lengths;
+
+  constructor_template->GetFunction()->Set(matched_needle_sym,
+                                           Integer::New(r < 0 ? -1 : which));
+
+  return scope.Close(Integer::New(r < 0 ? -1 : r + start));
+}
+
+
 // var charsWritten = buffer.utf8Write(string, offset, [maxLength]);
 Handle<Value> Buffer::Utf8Write(const Arguments &args) {
   HandleScope scope;
@@ -534,6 +699,50 @@ Handle<Value> Buffer::Ucs2Write(const Arguments &args) {
 }
 
 
+// var bytesWritten = buffer.hexWrite(string, offset, [maxLength]);
+Handle<Value> Buffer::HexWrite(const Arguments &args) {
+  HandleScope scope;
+  Buffer *buffer = ObjectWrap::Unwrap<Buffer>(args.This());
+
+  if (!args[0]->IsString()) {
+    return ThrowException(Exception::TypeError(String::New(
+            "Argument must be a string")));
+  }
+
+  Local<String> s = args[0]->ToString();
+
+  // must be an even number of digits
+  if (s->Length() % 2) {
+    return ThrowException(Exception::Error(String::New(
+            "Invalid hex string")));
+  }
+
+  size_t offset = args[1]->Uint32Value();
+
+  if (s->Length() > 0 && offset >= buffer->length_) {
+    return ThrowException(Exception::TypeError(String::New(
+            "Offset is out of bounds")));
+  }
+
+  size_t max_length = args[2]->IsUndefined() ? buffer->length_ - offset
+                                             : args[2]->Uint32Value();
+  max_length = MIN(buffer->length_ - offset, max_length);
+
+  size_t bytes = MIN((size_t)s->Length() / 2, max_length);
+  size_t written = DecodeWrite(buffer->data_ + offset, bytes, s, HEX);
+
+  if (written < bytes) {
+    return ThrowException(Exception::Error(String::New(
+            "Invalid hex string")));
+  }
+
+  constructor_template->GetFunction()->Set(chars_written_sym,
+                                           Integer::New(written * 2));
+
+  return scope.Close(Integer::New(written));
+}
+
+
 // var charsWritten = buffer.asciiWrite(string, offset);
 Handle<Value> Buffer::AsciiWrite(const Arguments &args) {
   HandleScope scope;
@@ -699,6 +908,22 @@ Handle<Value> Buffer::ByteLength(const Arguments &args) {
 }
 
 
+// var previous = SlowBuffer.setExternalStringThreshold(bytes);
+Handle<Value> Buffer::SetExternalStringThreshold(const Arguments &args) {
+  HandleScope scope;
+
+  if (!args[0]->IsNumber() || args[0]->IntegerValue() < 0) {
+    return ThrowException(Exception::TypeError(String::New(
+            "Argument must be a non-negative number")));
+  }
+
+  size_t previous = external_string_threshold;
+  external_string_threshold = args[0]->IntegerValue();
+
+  return scope.Close(Number::New(previous));
+}
+
+
 Handle<Value> Buffer::MakeFastBuffer(const Arguments &args) {
   HandleScope scope;
 
@@ -735,6 +960,7 @@ void Buffer::Initialize(Handle<Object> target) {
 
   length_symbol = Persistent<String>::New(String::NewSymbol("length"));
   chars_written_sym = Persistent<String>::New(String::NewSymbol("_charsWritten"));
+  matched_needle_sym = NODE_PSYMBOL("_matchedNeedle");
 
   Local<FunctionTemplate> t = FunctionTemplate::New(Buffer::New);
   constructor_template = Persistent<FunctionTemplate>::New(t);
@@ -746,6 +972,7 @@ void Buffer::Initialize(Handle<Object> target) {
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "asciiSlice", Buffer::AsciiSlice);
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "base64Slice", Buffer::Base64Slice);
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "ucs2Slice", Buffer::Ucs2Slice);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "hexSlice", Buffer::HexSlice);
   // TODO NODE_SET_PROTOTYPE_METHOD(t, "utf16Slice", Utf16Slice);
   // copy
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "utf8Slice", Buffer::Utf8Slice);
@@ -755,8 +982,11 @@ void Buffer::Initialize(Handle<Object> target) {
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "binaryWrite", Buffer::BinaryWrite);
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "base64Write", Buffer::Base64Write);
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "ucs2Write", Buffer::Ucs2Write);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "hexWrite", Buffer::HexWrite);
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "fill", Buffer::Fill);
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "copy", Buffer::Copy);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "indexOf", Buffer::IndexOf);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "indexOfAny", Buffer::IndexOfAny);
 
   NODE_SET_METHOD(constructor_template->GetFunction(),
                   "byteLength",
@@ -764,8 +994,16 @@ void Buffer::Initialize(Handle<Object> target) {
   NODE_SET_METHOD(constructor_template->GetFunction(),
                   "makeFastBuffer",
                   Buffer::MakeFastBuffer);
+  NODE_SET_METHOD(constructor_template->GetFunction(),
+                  "concat",
+                  Buffer::Concat);
+  NODE_SET_METHOD(constructor_template->GetFunction(),
+                  "setExternalStringThreshold",
+                  Buffer::SetExternalStringThreshold);
 
   target->Set(String::NewSymbol("SlowBuffer"), constructor_template->GetFunction());
+
+  BufferList::Initialize(target);
 }
 
 
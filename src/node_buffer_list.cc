@@ -0,0 +1,417 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <node.h>
+#include <node_buffer.h>
+#include <node_buffer_list.h>
+#include <node_search.h>
+
+#include <v8.h>
+
+#include <assert.h>
+#include <string.h> // memchr, memcmp, memcpy
+
+#define MIN(a,b) ((a) < (b) ? (a) : (b))
+
+namespace node {
+
+using namespace v8;
+
+static Persistent<String> length_symbol;
+Persistent<FunctionTemplate> BufferList::constructor_template;
+
+
+BufferList::BufferList(Handle<Object> wrapper) : ObjectWrap() {
+  Wrap(wrapper);
+  head_ = tail_ = NULL;
+  length_ = 0;
+  UpdateLength();
+}
+
+
+BufferList::~BufferList() {
+  Clear();
+}
+
+
+void BufferList::UpdateLength() {
+  handle_->Set(length_symbol, Integer::NewFromUnsigned(length_));
+}
+
+
+void BufferList::Push(Handle<Object> buffer, char *data, size_t length) {
+  // Empty chunks are never stored; every chunk in the list has at least
+  // one byte, which keeps the cross-chunk scanning loops simple.
+  if (length == 0) return;
+
+  Chunk *c = new Chunk;
+  c->handle = Persistent<Object>::New(buffer);
+  c->data = data;
+  c->length = length;
+  c->next = NULL;
+
+  if (tail_) {
+    tail_->next = c;
+  } else {
+    head_ = c;
+  }
+  tail_ = c;
+  length_ += length;
+}
+
+
+void BufferList::Shift(size_t n) {
+  while (n > 0 && head_) {
+    Chunk *c = head_;
+
+    if (n < c->length) {
+      c->data += n;
+      c->length -= n;
+      length_ -= n;
+      return;
+    }
+
+    n -= c->length;
+    length_ -= c->length;
+    head_ = c->next;
+    if (head_ == NULL) tail_ = NULL;
+
+    c->handle.Dispose();
+    c->handle.Clear();
+    delete c;
+  }
+}
+
+
+void BufferList::Clear() {
+  Shift(length_);
+  assert(head_ == NULL);
+  assert(length_ == 0);
+}
+
+
+BufferList::Chunk* BufferList::Seek(size_t offset, size_t *pos) {
+  Chunk *c = head_;
+  while (c && offset >= c->length) {
+    offset -= c->length;
+    c = c->next;
+  }
+  *pos = offset;
+  return c;
+}
+
+
+// Returns the absolute index of the first occurrence of needle at or after
+// offset, or -1. Each chunk is first searched on its own with the regular
+// search kernel. Only the last needle_length - 1 positions of a chunk can
+// start a match that straddles a boundary; those candidates are located
+// with memchr() on the first needle byte and verified by following the
+// chunk chain.
+ssize_t BufferList::Search(const char *needle,
+                           size_t needle_length,
+                           size_t offset) {
+  if (needle_length == 0) return offset <= length_ ? offset : -1;
+  if (offset >= length_ || needle_length > length_ - offset) return -1;
+
+  size_t pos;
+  Chunk *c = Seek(offset, &pos);
+  size_t base = offset - pos; // absolute index of c->data[0]
+
+  while (c) {
+    if (c->length - pos >= needle_length) {
+      ssize_t r = SearchString(c->data + pos, c->length - pos,
+                               needle, needle_length);
+      if (r >= 0) return base + pos + r;
+      pos = c->length - needle_length + 1;
+    }
+
+    while (pos < c->length) {
+      const char *p = static_cast<const char*>(
+          memchr(c->data + pos, needle[0], c->length - pos));
+      if (p == NULL) break;
+
+      pos = p - c->data;
+      if (base + pos + needle_length > length_) return -1;
+
+      Chunk *m = c;
+      size_t mpos = pos + 1;
+      size_t matched = 1;
+
+      while (matched < needle_length) {
+        if (mpos == m->length) {
+          // Enough bytes remain (checked above) so there is a next chunk.
+          m = m->next;
+          mpos = 0;
+        }
+        size_t n = MIN(needle_length - matched, m->length - mpos);
+        if (memcmp(m->data + mpos, needle + matched, n) != 0) break;
+        matched += n;
+        mpos += n;
+      }
+
+      if (matched == needle_length) return base + pos;
+      pos++;
+    }
+
+    base += c->length;
+    c = c->next;
+    pos = 0;
+  }
+
+  return -1;
+}
+
+
+size_t BufferList::CopyOut(char *dst, size_t start, size_t end) {
+  size_t pos;
+  Chunk *c = Seek(start, &pos);
+  size_t copied = 0;
+  size_t want = end - start;
+
+  while (c && copied < want) {
+    size_t n = MIN(want - copied, c->length - pos);
+    memcpy(dst + copied, c->data + pos, n);
+    copied += n;
+    c = c->next;
+    pos = 0;
+  }
+
+  return copied;
+}
+
+
+Handle<Value> BufferList::New(const Arguments &args) {
+  if (!args.IsConstructCall()) {
+    return FromConstructorTemplate(constructor_template, args);
+  }
+
+  HandleScope scope;
+
+  BufferList *list = new BufferList(args.This());
+
+  // var list = new BufferList([chunk1, chunk2]);
+  if (args[0]->IsArray()) {
+    Local<Array> chunks = Local<Array>::Cast(args[0]);
+    uint32_t n = chunks->Length();
+    for (uint32_t i = 0; i < n; i++) {
+      Local<Value> chunk = chunks->Get(i);
+      if (!Buffer::HasInstance(chunk)) {
+        list->Clear();
+        return ThrowException(Exception::TypeError(String::New(
+                "All list elements must be Buffers")));
+      }
+      Local<Object> obj = chunk->ToObject();
+      list->Push(obj, Buffer::Data(obj), Buffer::Length(obj));
+    }
+    list->UpdateLength();
+  }
+
+  return args.This();
+}
+
+
+// var length = list.append(buffer);
+Handle<Value> BufferList::Append(const Arguments &args) {
+  HandleScope scope;
+  BufferList *list = ObjectWrap::Unwrap<BufferList>(args.This());
+
+  if (!Buffer::HasInstance(args[0])) {
+    return ThrowException(Exception::TypeError(String::New(
+            "Argument must be a Buffer")));
+  }
+
+  Local<Object> obj = args[0]->ToObject();
+  list->Push(obj, Buffer::Data(obj), Buffer::Length(obj));
+  list->UpdateLength();
+
+  return scope.Close(Integer::NewFromUnsigned(list->length_));
+}
+
+
+// var byte = list.get(index);
+Handle<Value> BufferList::Get(const Arguments &args) {
+  HandleScope scope;
+  BufferList *list = ObjectWrap::Unwrap<BufferList>(args.This());
+
+  if (!args[0]->IsInt32() || args[0]->Int32Value() < 0) {
+    return ThrowException(Exception::TypeError(String::New(
+            "Bad argument.")));
+  }
+
+  size_t pos;
+  Chunk *c = list->Seek(args[0]->Uint32Value(), &pos);
+  if (c == NULL) return Undefined();
+
+  return scope.Close(Integer::New(static_cast<unsigned char>(c->data[pos])));
+}
+
+
+// var index = list.indexOf(byte|string|buffer, offset=0);
+Handle<Value> BufferList::IndexOf(const Arguments &args) {
+  HandleScope scope;
+  BufferList *list = ObjectWrap::Unwrap<BufferList>(args.This());
+
+  int32_t offset = args[1]->Int32Value();
+  if (offset < 0) offset = 0;
+
+  ssize_t r;
+
+  if (args[0]->IsNumber()) {
+    char c = static_cast<char>(args[0]->Int32Value());
+    r = list->Search(&c, 1, offset);
+  } else if (args[0]->IsString()) {
+    String::Utf8Value needle(args[0]->ToString());
+    r = list->Search(*needle, needle.length(), offset);
+  } else if (Buffer::HasInstance(args[0])) {
+    Local<Object> needle = args[0]->ToObject();
+    r = list->Search(Buffer::Data(needle), Buffer::Length(needle), offset);
+  } else {
+    return ThrowException(Exception::TypeError(String::New(
+            "Argument must be a number, string or Buffer")));
+  }
+
+  return scope.Close(Integer::New(r));
+}
+
+
+// var sublist = list.slice(start, end);
+Handle<Value> BufferList::Slice(const Arguments &args) {
+  HandleScope scope;
+  BufferList *list = ObjectWrap::Unwrap<BufferList>(args.This());
+
+  int32_t start = args[0]->Int32Value();
+  int32_t end = args[1]->IsUndefined() ? list->length_ : args[1]->Int32Value();
+
+  if (start < 0 || end < 0 || start > end) {
+    return ThrowException(Exception::Error(String::New("oob")));
+  }
+  if ((size_t)end > list->length_) {
+    return ThrowException(Exception::Error(String::New("oob")));
+  }
+
+  Local<Object> obj = constructor_template->GetFunction()->NewInstance();
+  BufferList *sub = ObjectWrap::Unwrap<BufferList>(obj);
+
+  size_t pos;
+  size_t want = end - start;
+  Chunk *c = list->Seek(start, &pos);
+
+  while (c && sub->length_ < want) {
+    size_t n = MIN(want - sub->length_, c->length - pos);
+    sub->Push(c->handle, c->data + pos, n);
+    c = c->next;
+    pos = 0;
+  }
+  sub->UpdateLength();
+
+  return scope.Close(obj);
+}
+
+
+// list.consume(n); drops the first n bytes
+Handle<Value> BufferList::Consume(const Arguments &args) {
+  HandleScope scope;
+  BufferList *list = ObjectWrap::Unwrap<BufferList>(args.This());
+
+  if (!args[0]->IsInt32() || args[0]->Int32Value() < 0) {
+    return ThrowException(Exception::TypeError(String::New(
+            "Bad argument.")));
+  }
+
+  list->Shift(args[0]->Uint32Value());
+  list->UpdateLength();
+
+  return scope.Close(Integer::NewFromUnsigned(list->length_));
+}
+
+
+// var bytesCopied = list.copy(target, targetStart, sourceStart, sourceEnd);
+Handle<Value> BufferList::Copy(const Arguments &args) {
+  HandleScope scope;
+  BufferList *list = ObjectWrap::Unwrap<BufferList>(args.This());
+
+  if (!Buffer::HasInstance(args[0])) {
+    return ThrowException(Exception::TypeError(String::New(
+            "First arg should be a Buffer")));
+  }
+
+  Local<Object> target = args[0]->ToObject();
+  char *target_data = Buffer::Data(target);
+  size_t target_length = Buffer::Length(target);
+
+  int32_t target_start = args[1]->Int32Value();
+  int32_t source_start = args[2]->Int32Value();
+  int32_t source_end = args[3]->IsInt32() ? args[3]->Int32Value()
+                                          : list->length_;
+
+  if (source_end < source_start) {
+    return ThrowException(Exception::Error(String::New(
+            "sourceEnd < sourceStart")));
+  }
+
+  if (source_end == source_start) {
+    return scope.Close(Integer::New(0));
+  }
+
+  if (target_start < 0 || (size_t)target_start >= target_length) {
+    return ThrowException(Exception::Error(String::New(
+            "targetStart out of bounds")));
+  }
+
+  if (source_start < 0 || (size_t)source_end > list->length_) {
+    return ThrowException(Exception::Error(String::New(
+            "source range out of bounds")));
+  }
+
+  size_t to_copy = MIN((size_t)(source_end - source_start),
+                       target_length - target_start);
+
+  size_t copied = list->CopyOut(target_data + target_start,
+                                source_start,
+                                source_start + to_copy);
+
+  return scope.Close(Integer::NewFromUnsigned(copied));
+}
+
+
+void BufferList::Initialize(Handle<Object> target) {
+  HandleScope scope;
+
+  length_symbol = NODE_PSYMBOL("length");
+
+  Local<FunctionTemplate> t = FunctionTemplate::New(BufferList::New);
+  constructor_template = Persistent<FunctionTemplate>::New(t);
+  constructor_template->InstanceTemplate()->SetInternalFieldCount(1);
+  constructor_template->SetClassName(String::NewSymbol("BufferList"));
+
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "append", BufferList::Append);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "get", BufferList::Get);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "indexOf", BufferList::IndexOf);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "slice", BufferList::Slice);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "consume", BufferList::Consume);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "copy", BufferList::Copy);
+
+  target->Set(String::NewSymbol("BufferList"),
+              constructor_template->GetFunction());
+}
+
+
+}  // namespace node
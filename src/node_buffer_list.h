@@ -0,0 +1,86 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef NODE_BUFFER_LIST_H_
+#define NODE_BUFFER_LIST_H_
+
+#include <node.h>
+#include <node_object_wrap.h>
+#include <v8.h>
+
+namespace node {
+
+/* A BufferList is a rope of Buffers. Appending a chunk is O(1) and never
+ * copies memory; the list only keeps a reference to each chunk so that its
+ * backing store stays alive. Searching, slicing and consuming bytes work
+ * across chunk boundaries without flattening the list first.
+ *
+ *   var list = new BufferList();
+ *   list.append(chunk);
+ *   var i = list.indexOf('\r\n\r\n');
+ *   var head = list.slice(0, i).toBuffer();
+ *   list.consume(i + 4);
+ */
+class BufferList : public ObjectWrap {
+ public:
+  static void Initialize(v8::Handle<v8::Object> target);
+
+  ~BufferList();
+
+ private:
+  struct Chunk {
+    v8::Persistent<v8::Object> handle;
+    char *data;
+    size_t length;
+    Chunk *next;
+  };
+
+  static v8::Persistent<v8::FunctionTemplate> constructor_template;
+
+  static v8::Handle<v8::Value> New(const v8::Arguments &args);
+  static v8::Handle<v8::Value> Append(const v8::Arguments &args);
+  static v8::Handle<v8::Value> Get(const v8::Arguments &args);
+  static v8::Handle<v8::Value> IndexOf(const v8::Arguments &args);
+  static v8::Handle<v8::Value> Slice(const v8::Arguments &args);
+  static v8::Handle<v8::Value> Consume(const v8::Arguments &args);
+  static v8::Handle<v8::Value> Copy(const v8::Arguments &args);
+
+  BufferList(v8::Handle<v8::Object> wrapper);
+
+  void Push(v8::Handle<v8::Object> buffer, char *data, size_t length);
+  void Shift(size_t n);
+  void Clear();
+  void UpdateLength();
+
+  // Finds the chunk holding byte `offset` and the position inside it.
+  Chunk* Seek(size_t offset, size_t *pos);
+
+  ssize_t Search(const char *needle, size_t needle_length, size_t offset);
+  size_t CopyOut(char *dst, size_t start, size_t end);
+
+  Chunk *head_;
+  Chunk *tail_;
+  size_t length_;
+};
+
+}  // namespace node
+
+#endif  // NODE_BUFFER_LIST_H_
@@ -22,10 +22,14 @@
 #include <node_cares.h>
 
 #include <node.h>
+#include <node_probes.h>
 #include <v8.h>
 #include <ares.h>
 
 #include <sys/types.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
 
 #ifdef __POSIX__
 # include <sys/socket.h>
@@ -37,6 +41,7 @@
 
 #ifdef __MINGW32__
 # include <nameser.h>
+# include <io.h>
 #endif
 
 #ifdef __OpenBSD__
@@ -65,6 +70,54 @@ namespace node {
 using namespace v8;
 
 
+#define CACHE_BUCKETS 256
+#define CACHE_MAX_ADDRS 32
+
+// Defaults for the lookup cache. Positive answers live for the smallest TTL
+// in the answer, capped at max_ttl; NXDOMAIN and NODATA answers live for
+// negative_ttl. Hosts file answers are re-read every few seconds.
+#define CACHE_DEFAULT_SIZE 1024
+#define CACHE_DEFAULT_MAX_TTL 300
+#define CACHE_DEFAULT_NEGATIVE_TTL 10
+#define CACHE_HOSTS_TTL 5
+
+class Channel;
+
+// A callback waiting for an in-flight lookup.
+struct LookupWaiter {
+  Persistent<Function> cb;
+  LookupWaiter *next;
+};
+
+// One (name, family) pair. An entry is either in flight, in which case
+// `waiters` holds the callbacks to run when the answer arrives, or holds a
+// cached answer (addresses or an ares error) until `expires`.
+struct CacheEntry {
+  Channel *channel;
+  char *name;
+  int family;
+  unsigned int hash;
+  CacheEntry *hash_next;
+  CacheEntry *lru_prev;
+  CacheEntry *lru_next;
+  bool in_flight;
+  LookupWaiter *waiters;
+  LookupWaiter *waiters_tail;
+  ev_tstamp expires;
+  int status;
+  int naddrs;
+  unsigned char *addrs;
+};
+
+// A socket c-ares wants watched, and the watcher for it.
+struct SocketWatcher {
+  ev_io io;
+  Channel *channel;
+  ares_socket_t sock;
+  SocketWatcher *next;
+};
+
+
 class Channel : public ObjectWrap {
  public:
   static void Initialize(Handle<Object> target);
@@ -76,13 +129,52 @@ class Channel : public ObjectWrap {
   static Handle<Value> Query(const Arguments& args);
   static Handle<Value> GetHostByName(const Arguments& args);
   static Handle<Value> GetHostByAddr(const Arguments& args);
-  static Handle<Value> Timeout(const Arguments& args);
-  static Handle<Value> ProcessFD(const Arguments& args);
+  static Handle<Value> Lookup(const Arguments& args);
+  static Handle<Value> CacheStats(const Arguments& args);
+  static Handle<Value> ClearCache(const Arguments& args);
+  static Handle<Value> SetCacheOptions(const Arguments& args);
+
+  Channel();
+  ~Channel();
+
+  CacheEntry* FindEntry(const char *name, int family, unsigned int hash);
+  CacheEntry* AddEntry(const char *name, int family, unsigned int hash);
+  void RemoveEntry(CacheEntry *e);
+  void TouchEntry(CacheEntry *e);
+  void StoreEntry(CacheEntry *e, int status, const unsigned char *addrs,
+                  int naddrs, ev_tstamp ttl);
+  void Evict(int max_entries);
+
+  SocketWatcher* FindWatcher(ares_socket_t sock);
+  void UpdateTimer();
 
   ares_channel channel;
 
+  // c-ares sockets are watched here rather than in JavaScript; the only
+  // calls into JavaScript are the ones delivering results.
+  SocketWatcher *watchers_;
+  ev_timer timer_;
+
+  CacheEntry *buckets_[CACHE_BUCKETS];
+  CacheEntry *lru_head_;
+  CacheEntry *lru_tail_;
+  int entries_;
+  int max_entries_;
+  ev_tstamp max_ttl_;
+  ev_tstamp negative_ttl_;
+
+  double hits_;
+  double negative_hits_;
+  double misses_;
+  double coalesced_;
+  double evictions_;
+  int in_flight_;
+
   static void SockStateCb(void *data, ares_socket_t sock, int read, int write);
+  static void OnSocket(EV_P_ ev_io *w, int revents);
+  static void OnTimeout(EV_P_ ev_timer *w, int revents);
   static void QueryCb(void *arg, int status, int timeouts, unsigned char* abuf, int alen);
+  static void LookupCb(void *arg, int status, int timeouts, unsigned char* abuf, int alen);
 };
 
 
@@ -108,8 +200,14 @@ static Persistent<String> priority_symbol;
 static Persistent<String> weight_symbol;
 static Persistent<String> port_symbol;
 static Persistent<String> name_symbol;
-static Persistent<String> callback_symbol;
 static Persistent<String> exchange_symbol;
+static Persistent<String> hits_symbol;
+static Persistent<String> negative_hits_symbol;
+static Persistent<String> misses_symbol;
+static Persistent<String> coalesced_symbol;
+static Persistent<String> in_flight_symbol;
+static Persistent<String> entries_symbol;
+static Persistent<String> evictions_symbol;
 
 
 void Cares::Initialize(Handle<Object> target) {
@@ -224,7 +322,7 @@ static inline const char *ares_errno_string(int errorno) {
 }
 
 
-static void ResolveError(Persistent<Function> &cb, int status) {
+static Local<Value> ResolveErrorValue(int status) {
   HandleScope scope;
 
   Local<String> code = String::NewSymbol(ares_errno_string(status));
@@ -239,6 +337,18 @@ static void ResolveError(Persistent<Function> &cb, int status) {
   obj->Set(String::NewSymbol("errno"), Integer::New(status));
   obj->Set(String::NewSymbol("code"), code);
 
+  return scope.Close(e);
+}
+
+
+static void ResolveError(Persistent<Function> &cb, int status) {
+  // The channel is being destroyed, possibly by the garbage collector.
+  if (status == ARES_EDESTRUCTION) return;
+
+  HandleScope scope;
+
+  Local<Value> e = ResolveErrorValue(status);
+
   TryCatch try_catch;
 
   cb->Call(v8::Context::GetCurrent()->Global(), 1, &e);
@@ -492,6 +602,10 @@ void Channel::QueryCb(void *arg,
                       int alen) {
   QueryArg *query_arg = static_cast<QueryArg*>(arg);
 
+  if (NODE_DNS_QUERY_DONE_ENABLED()) {
+    NODE_DNS_QUERY_DONE(query_arg, status);
+  }
+
   HandleScope scope;
 
   if (status != ARES_SUCCESS) {
@@ -517,12 +631,56 @@ void Channel::Initialize(Handle<Object> target) {
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "getHostByName", Channel::GetHostByName);
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "getHostByAddr", Channel::GetHostByAddr);
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "query", Channel::Query);
-  NODE_SET_PROTOTYPE_METHOD(constructor_template, "timeout", Channel::Timeout);
-  NODE_SET_PROTOTYPE_METHOD(constructor_template, "processFD", Channel::ProcessFD);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "lookup", Channel::Lookup);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "cacheStats", Channel::CacheStats);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "clearCache", Channel::ClearCache);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "setCacheOptions", Channel::SetCacheOptions);
 
   target->Set(String::NewSymbol("Channel"), constructor_template->GetFunction());
 
-  callback_symbol = NODE_PSYMBOL("callback");
+  hits_symbol = NODE_PSYMBOL("hits");
+  negative_hits_symbol = NODE_PSYMBOL("negativeHits");
+  misses_symbol = NODE_PSYMBOL("misses");
+  coalesced_symbol = NODE_PSYMBOL("coalesced");
+  in_flight_symbol = NODE_PSYMBOL("inFlight");
+  entries_symbol = NODE_PSYMBOL("entries");
+  evictions_symbol = NODE_PSYMBOL("evictions");
+}
+
+
+Channel::Channel() {
+  for (int i = 0; i < CACHE_BUCKETS; i++) buckets_[i] = NULL;
+  lru_head_ = lru_tail_ = NULL;
+  entries_ = 0;
+  max_entries_ = CACHE_DEFAULT_SIZE;
+  max_ttl_ = CACHE_DEFAULT_MAX_TTL;
+  negative_ttl_ = CACHE_DEFAULT_NEGATIVE_TTL;
+  hits_ = negative_hits_ = misses_ = coalesced_ = evictions_ = 0;
+  in_flight_ = 0;
+  watchers_ = NULL;
+  ev_init(&timer_, Channel::OnTimeout);
+  timer_.data = this;
+  channel = NULL;
+}
+
+
+Channel::~Channel() {
+  ev_timer_stop(EV_DEFAULT_UC_ &timer_);
+
+  // The channel keeps itself alive while c-ares has sockets open, so there
+  // should be none left by now.
+  while (watchers_ != NULL) {
+    SocketWatcher *w = watchers_;
+    watchers_ = w->next;
+    ev_io_stop(EV_DEFAULT_UC_ &w->io);
+    delete w;
+  }
+
+  // Anything still pending fails with ARES_EDESTRUCTION, which is not
+  // reported to JavaScript. That also finishes the in-flight lookups, so
+  // the whole cache can go after it.
+  if (channel != NULL) ares_destroy(channel);
+  Evict(0);
 }
 
 
@@ -534,11 +692,15 @@ Handle<Value> Channel::New(const Arguments& args) {
   HandleScope scope;
 
   struct ares_options options;
-  int optmask = 0;
+  struct in_addr *servers = NULL;
+  int optmask = ARES_OPT_SOCK_STATE_CB;
 
   Channel *c = new Channel();
   c->Wrap(args.This());
 
+  options.sock_state_cb_data = c;
+  options.sock_state_cb = Channel::SockStateCb;
+
   if (args.Length() > 0) {
     if(!args[0]->IsObject()) {
       return ThrowException(Exception::TypeError(
@@ -547,16 +709,48 @@ Handle<Value> Channel::New(const Arguments& args) {
 
     Local<Object> options_o = Local<Object>::Cast(args[0]);
 
-    Local<Value> cb = options_o->Get(String::NewSymbol("SOCK_STATE_CB"));
-    if (!cb.IsEmpty()) {
-      c->handle_->Set(callback_symbol, cb);
-      options.sock_state_cb_data = c;
-      options.sock_state_cb = Channel::SockStateCb;
-      optmask |= ARES_OPT_SOCK_STATE_CB;
+    Local<Value> servers_v = options_o->Get(String::NewSymbol("SERVERS"));
+    if (servers_v->IsArray()) {
+      Local<Array> servers_a = Local<Array>::Cast(servers_v);
+      int nservers = servers_a->Length();
+      if (nservers > 0) {
+        servers = new struct in_addr[nservers];
+        for (int i = 0; i < nservers; i++) {
+          String::Utf8Value server(servers_a->Get(i)->ToString());
+          if (inet_pton(AF_INET, *server, &servers[i]) != 1) {
+            delete [] servers;
+            return ThrowException(Exception::TypeError(
+                  String::New("Invalid IPv4 server address")));
+          }
+        }
+        options.servers = servers;
+        options.nservers = nservers;
+        optmask |= ARES_OPT_SERVERS;
+      }
+    }
+
+    Local<Value> port_v = options_o->Get(String::NewSymbol("PORT"));
+    if (port_v->IsInt32()) {
+      options.udp_port = htons(port_v->Int32Value());
+      options.tcp_port = htons(port_v->Int32Value());
+      optmask |= ARES_OPT_UDP_PORT | ARES_OPT_TCP_PORT;
+    }
+
+    Local<Value> timeout_v = options_o->Get(String::NewSymbol("TIMEOUT"));
+    if (timeout_v->IsInt32()) {
+      options.timeout = timeout_v->Int32Value();
+      optmask |= ARES_OPT_TIMEOUTMS;
+    }
+
+    Local<Value> tries_v = options_o->Get(String::NewSymbol("TRIES"));
+    if (tries_v->IsInt32()) {
+      options.tries = tries_v->Int32Value();
+      optmask |= ARES_OPT_TRIES;
     }
   }
 
   ares_init_options(&c->channel, &options, optmask);
+  delete [] servers;
 
   return args.This();
 }
@@ -641,6 +835,10 @@ Handle<Value> Channel::Query(const Arguments& args) {
 
   QueryArg *query_arg = new QueryArg(args[2], parse_cb);
 
+  if (NODE_DNS_QUERY_START_ENABLED()) {
+    NODE_DNS_QUERY_START(query_arg, *name, type);
+  }
+
   ares_query(c->channel, *name, ns_c_in, type, QueryCb, query_arg);
 
   return Undefined();
@@ -729,84 +927,552 @@ Handle<Value> Channel::GetHostByName(const Arguments& args) {
 }
 
 
-Handle<Value> Channel::Timeout(const Arguments& args) {
+static inline int AddressLength(int family) {
+  return family == AF_INET6 ? sizeof(struct in6_addr) : sizeof(struct in_addr);
+}
+
+
+static Local<Array> AddressesToArray(int family,
+                                     const unsigned char *addrs,
+                                     int naddrs) {
   HandleScope scope;
-  Channel *c = ObjectWrap::Unwrap<Channel>(args.Holder());
-  assert(c);
+  Local<Array> addresses = Array::New(naddrs);
+  int len = AddressLength(family);
 
-  if (!args[0]->IsInt32()) {
-    return ThrowException(Exception::Error(
-          String::New("First argument must be an integer number of milliseconds")));
+  char ip[INET6_ADDRSTRLEN];
+  for (int i = 0; i < naddrs; i++) {
+    inet_ntop(family, addrs + i * len, ip, sizeof(ip));
+    addresses->Set(Integer::New(i), String::New(ip));
+  }
+
+  return scope.Close(addresses);
+}
+
+
+// Extracts the addresses of an A or AAAA answer and the smallest TTL among
+// them. An answer without any address for the family counts as NODATA.
+static int ParseAddresses(int family,
+                          unsigned char *abuf,
+                          int alen,
+                          unsigned char *addrs,
+                          int *naddrs,
+                          int *ttl) {
+  int status, n = CACHE_MAX_ADDRS;
+  int len = AddressLength(family);
+  int ttls[CACHE_MAX_ADDRS];
+
+  if (family == AF_INET6) {
+    struct ares_addr6ttl a[CACHE_MAX_ADDRS];
+    status = ares_parse_aaaa_reply(abuf, alen, NULL, a, &n);
+    for (int i = 0; status == ARES_SUCCESS && i < n; i++) {
+      memcpy(addrs + i * len, &a[i].ip6addr, len);
+      ttls[i] = a[i].ttl;
+    }
+  } else {
+    struct ares_addrttl a[CACHE_MAX_ADDRS];
+    status = ares_parse_a_reply(abuf, alen, NULL, a, &n);
+    for (int i = 0; status == ARES_SUCCESS && i < n; i++) {
+      memcpy(addrs + i * len, &a[i].ipaddr, len);
+      ttls[i] = a[i].ttl;
+    }
+  }
+
+  if (status != ARES_SUCCESS) return status;
+  if (n == 0) return ARES_ENODATA;
+
+  *naddrs = n;
+  *ttl = ttls[0];
+  for (int i = 1; i < n; i++) {
+    if (ttls[i] < *ttl) *ttl = ttls[i];
+  }
+  if (*ttl < 0) *ttl = 0;
+
+  return ARES_SUCCESS;
+}
+
+
+// FNV-1a over the lower-cased name; `key` receives the lower-cased copy.
+static unsigned int HashName(const char *name, char *key) {
+  unsigned int hash = 2166136261u;
+  for (; *name; name++, key++) {
+    *key = tolower((unsigned char)*name);
+    hash = (hash ^ (unsigned char)*key) * 16777619u;
+  }
+  *key = '\0';
+  return hash;
+}
+
+
+CacheEntry* Channel::FindEntry(const char *name,
+                               int family,
+                               unsigned int hash) {
+  CacheEntry *e = buckets_[hash % CACHE_BUCKETS];
+  for (; e; e = e->hash_next) {
+    if (e->hash == hash && e->family == family && !strcmp(e->name, name)) {
+      return e;
+    }
+  }
+  return NULL;
+}
+
+
+CacheEntry* Channel::AddEntry(const char *name,
+                              int family,
+                              unsigned int hash) {
+  if (entries_ >= max_entries_) Evict(max_entries_ - 1);
+
+  CacheEntry *e = new CacheEntry;
+  e->channel = this;
+  e->name = strdup(name);
+  e->family = family;
+  e->hash = hash;
+  e->in_flight = false;
+  e->waiters = e->waiters_tail = NULL;
+  e->expires = 0;
+  e->status = ARES_SUCCESS;
+  e->naddrs = 0;
+  e->addrs = NULL;
+
+  CacheEntry **bucket = &buckets_[hash % CACHE_BUCKETS];
+  e->hash_next = *bucket;
+  *bucket = e;
+
+  e->lru_prev = NULL;
+  e->lru_next = lru_head_;
+  if (lru_head_) lru_head_->lru_prev = e;
+  lru_head_ = e;
+  if (!lru_tail_) lru_tail_ = e;
+
+  entries_++;
+  return e;
+}
+
+
+void Channel::RemoveEntry(CacheEntry *e) {
+  assert(!e->in_flight);
+
+  CacheEntry **p = &buckets_[e->hash % CACHE_BUCKETS];
+  while (*p != e) p = &(*p)->hash_next;
+  *p = e->hash_next;
+
+  if (e->lru_prev) e->lru_prev->lru_next = e->lru_next;
+  else lru_head_ = e->lru_next;
+  if (e->lru_next) e->lru_next->lru_prev = e->lru_prev;
+  else lru_tail_ = e->lru_prev;
+
+  entries_--;
+  free(e->name);
+  delete [] e->addrs;
+  delete e;
+}
+
+
+void Channel::TouchEntry(CacheEntry *e) {
+  if (e == lru_head_) return;
+
+  e->lru_prev->lru_next = e->lru_next;
+  if (e->lru_next) e->lru_next->lru_prev = e->lru_prev;
+  else lru_tail_ = e->lru_prev;
+
+  e->lru_prev = NULL;
+  e->lru_next = lru_head_;
+  lru_head_->lru_prev = e;
+  lru_head_ = e;
+}
+
+
+void Channel::StoreEntry(CacheEntry *e,
+                         int status,
+                         const unsigned char *addrs,
+                         int naddrs,
+                         ev_tstamp ttl) {
+  int len = AddressLength(e->family);
+
+  delete [] e->addrs;
+  e->addrs = NULL;
+  if (naddrs > 0) {
+    e->addrs = new unsigned char[naddrs * len];
+    memcpy(e->addrs, addrs, naddrs * len);
+  }
+  e->naddrs = naddrs;
+  e->status = status;
+  e->expires = ev_now(EV_DEFAULT_UC) + ttl;
+}
+
+
+// Drops least recently used answers until at most `max_entries` remain.
+// Lookups that are still in flight are never dropped.
+void Channel::Evict(int max_entries) {
+  CacheEntry *e = lru_tail_;
+  while (e && entries_ > max_entries) {
+    CacheEntry *prev = e->lru_prev;
+    if (!e->in_flight) {
+      RemoveEntry(e);
+      evictions_++;
+    }
+    e = prev;
+  }
+}
+
+
+void Channel::LookupCb(void *arg,
+                       int status,
+                       int timeouts,
+                       unsigned char* abuf,
+                       int alen) {
+  CacheEntry *e = static_cast<CacheEntry*>(arg);
+  Channel *c = e->channel;
+  int family = e->family;
+
+  if (NODE_DNS_QUERY_DONE_ENABLED()) {
+    NODE_DNS_QUERY_DONE(e, status);
+  }
+
+  HandleScope scope;
+
+  unsigned char addrs[CACHE_MAX_ADDRS * sizeof(struct in6_addr)];
+  int naddrs = 0;
+  int ttl = 0;
+
+  if (status == ARES_SUCCESS) {
+    status = ParseAddresses(family, abuf, alen, addrs, &naddrs, &ttl);
   }
 
-  struct timeval tvbuf, maxtv, *ret;
+  LookupWaiter *waiters = e->waiters;
+  e->waiters = e->waiters_tail = NULL;
+  e->in_flight = false;
+  c->in_flight_--;
+
+  // Only definite answers are cached; timeouts and server failures are
+  // retried by the next lookup.
+  ev_tstamp lifetime = 0;
+  if (status == ARES_SUCCESS) {
+    lifetime = ttl < c->max_ttl_ ? ttl : c->max_ttl_;
+  } else if (status == ARES_ENOTFOUND || status == ARES_ENODATA) {
+    lifetime = c->negative_ttl_;
+  }
 
-  int64_t time = args[0]->IntegerValue();
-  maxtv.tv_sec = time/1000;
-  maxtv.tv_usec = (time % 1000) * 1000;
+  if (lifetime > 0 && c->max_entries_ > 0) {
+    c->StoreEntry(e, status, addrs, naddrs, lifetime);
+  } else {
+    c->RemoveEntry(e);
+  }
 
-  ret = ares_timeout(c->channel, &maxtv, &tvbuf);
+  // The callbacks may look up or flush this name again, so `e` is not
+  // touched from here on.
+  while (waiters) {
+    LookupWaiter *w = waiters;
+    waiters = w->next;
+
+    if (status == ARES_SUCCESS) {
+      Local<Value> argv[2] = { Local<Value>::New(Null()),
+                               AddressesToArray(family, addrs, naddrs) };
+      cb_call(w->cb, 2, argv);
+    } else {
+      ResolveError(w->cb, status);
+    }
 
-  return scope.Close(Integer::New(ret->tv_sec * 1000 + ret->tv_usec / 1000));
+    w->cb.Dispose();
+    delete w;
+  }
 }
 
 
-Handle<Value> Channel::ProcessFD(const Arguments& args) {
+// var result = channel.lookup(name, family, callback);
+//
+// Resolves `name` through the lookup cache. Cached answers are returned
+// synchronously - an array of addresses or an Error - and `callback` is not
+// called. Otherwise undefined is returned and `callback(err, addresses)` is
+// called once the answer arrives; concurrent lookups of the same name share
+// a single query.
+Handle<Value> Channel::Lookup(const Arguments& args) {
   HandleScope scope;
   Channel *c = ObjectWrap::Unwrap<Channel>(args.Holder());
   assert(c);
 
-  int read_fd, write_fd;
+  if (!args[0]->IsString()) {
+    return ThrowException(Exception::Error(
+          String::New("First argument must be a name")));
+  }
 
-  if (!args[0]->IsInt32()) {
+  if (!args[1]->IsInt32()) {
     return ThrowException(Exception::Error(
-          String::New("First argument must be a file descriptor or SOCKET_BAD")));
+          String::New("Second argument must be a family")));
   }
 
-  read_fd = args[0]->Int32Value();
+  if (!args[2]->IsFunction()) {
+    return ThrowException(Exception::Error(
+          String::New("Third argument must be a callback")));
+  }
 
-  if (args.Length() > 1) {
+  int family = args[1]->Int32Value();
+  if (family != AF_INET6 && family != AF_INET) {
+    return ThrowException(Exception::Error(
+          String::New("Unsupported address family")));
+  }
 
-    if (!args[1]->IsInt32()) {
-      return ThrowException(Exception::Error(
-            String::New("Second argument must be a file descriptor or SOCKET_BAD")));
+  String::Utf8Value name(args[0]->ToString());
+  char *key = new char[name.length() + 1];
+  unsigned int hash = HashName(*name, key);
+
+  CacheEntry *e = c->FindEntry(key, family, hash);
+
+  if (e && e->in_flight) {
+    delete [] key;
+    LookupWaiter *w = new LookupWaiter;
+    w->cb = Persistent<Function>::New(Local<Function>::Cast(args[2]));
+    w->next = NULL;
+    e->waiters_tail->next = w;
+    e->waiters_tail = w;
+    c->coalesced_++;
+    return Undefined();
+  }
+
+  if (e && e->expires > ev_now(EV_DEFAULT_UC)) {
+    delete [] key;
+    c->TouchEntry(e);
+    if (e->status != ARES_SUCCESS) {
+      c->negative_hits_++;
+      return scope.Close(ResolveErrorValue(e->status));
     }
-    write_fd = args[1]->Int32Value();
+    c->hits_++;
+    return scope.Close(AddressesToArray(family, e->addrs, e->naddrs));
+  }
 
-  } else {
-    write_fd = ARES_SOCKET_BAD;
+  c->misses_++;
+
+  if (!e) e = c->AddEntry(key, family, hash);
+  else c->TouchEntry(e);
+  delete [] key;
+
+  // Like ares_gethostbyname(), consult the hosts file before the network.
+  struct hostent *host;
+  if (ares_gethostbyname_file(c->channel, e->name, family, &host) ==
+      ARES_SUCCESS) {
+    int len = AddressLength(family);
+    unsigned char addrs[CACHE_MAX_ADDRS * sizeof(struct in6_addr)];
+    int naddrs = 0;
+    for (; host->h_addr_list[naddrs] && naddrs < CACHE_MAX_ADDRS; naddrs++) {
+      memcpy(addrs + naddrs * len, host->h_addr_list[naddrs], len);
+    }
+    ares_free_hostent(host);
+
+    Local<Array> addresses = AddressesToArray(family, addrs, naddrs);
+    if (c->max_entries_ > 0) {
+      c->StoreEntry(e, ARES_SUCCESS, addrs, naddrs, CACHE_HOSTS_TTL);
+    } else {
+      c->RemoveEntry(e);
+    }
+    return scope.Close(addresses);
+  }
+
+  LookupWaiter *w = new LookupWaiter;
+  w->cb = Persistent<Function>::New(Local<Function>::Cast(args[2]));
+  w->next = NULL;
+  e->waiters = e->waiters_tail = w;
+  e->in_flight = true;
+  c->in_flight_++;
+
+  int type = family == AF_INET6 ? ns_t_aaaa : ns_t_a;
+
+  if (NODE_DNS_QUERY_START_ENABLED()) {
+    NODE_DNS_QUERY_START(e, e->name, type);
+  }
+
+  ares_search(c->channel, e->name, ns_c_in, type, LookupCb, e);
+
+  return Undefined();
+}
+
+
+Handle<Value> Channel::CacheStats(const Arguments& args) {
+  HandleScope scope;
+  Channel *c = ObjectWrap::Unwrap<Channel>(args.Holder());
+  assert(c);
+
+  Local<Object> stats = Object::New();
+  stats->Set(hits_symbol, Number::New(c->hits_));
+  stats->Set(negative_hits_symbol, Number::New(c->negative_hits_));
+  stats->Set(misses_symbol, Number::New(c->misses_));
+  stats->Set(coalesced_symbol, Number::New(c->coalesced_));
+  stats->Set(in_flight_symbol, Integer::New(c->in_flight_));
+  stats->Set(entries_symbol, Integer::New(c->entries_ - c->in_flight_));
+  stats->Set(evictions_symbol, Number::New(c->evictions_));
+
+  return scope.Close(stats);
+}
+
+
+Handle<Value> Channel::ClearCache(const Arguments& args) {
+  HandleScope scope;
+  Channel *c = ObjectWrap::Unwrap<Channel>(args.Holder());
+  assert(c);
+
+  double evictions = c->evictions_;
+  c->Evict(0);
+  c->evictions_ = evictions;
+
+  return Undefined();
+}
+
+
+// channel.setCacheOptions({ maxTTL: seconds, negativeTTL: seconds,
+//                           size: entries })
+// Options that are left out keep their current value.
+Handle<Value> Channel::SetCacheOptions(const Arguments& args) {
+  HandleScope scope;
+  Channel *c = ObjectWrap::Unwrap<Channel>(args.Holder());
+  assert(c);
+
+  if (!args[0]->IsObject()) {
+    return ThrowException(Exception::TypeError(
+          String::New("First argument must be an object")));
   }
 
-  ares_process_fd(c->channel, read_fd, write_fd);
+  Local<Object> options = args[0]->ToObject();
+  Local<Value> max_ttl = options->Get(String::NewSymbol("maxTTL"));
+  Local<Value> negative_ttl = options->Get(String::NewSymbol("negativeTTL"));
+  Local<Value> size = options->Get(String::NewSymbol("size"));
+
+  if ((!max_ttl->IsUndefined() &&
+       (!max_ttl->IsNumber() || max_ttl->NumberValue() < 0)) ||
+      (!negative_ttl->IsUndefined() &&
+       (!negative_ttl->IsNumber() || negative_ttl->NumberValue() < 0)) ||
+      (!size->IsUndefined() &&
+       (!size->IsInt32() || size->Int32Value() < 0))) {
+    return ThrowException(Exception::TypeError(
+          String::New("Cache options must be non-negative numbers")));
+  }
+
+  if (!max_ttl->IsUndefined()) c->max_ttl_ = max_ttl->NumberValue();
+  if (!negative_ttl->IsUndefined()) {
+    c->negative_ttl_ = negative_ttl->NumberValue();
+  }
+  if (!size->IsUndefined()) {
+    c->max_entries_ = size->Int32Value();
+    c->Evict(c->max_entries_);
+  }
 
   return Undefined();
 }
 
 
+SocketWatcher* Channel::FindWatcher(ares_socket_t sock) {
+  for (SocketWatcher *w = watchers_; w != NULL; w = w->next) {
+    if (w->sock == sock) return w;
+  }
+  return NULL;
+}
+
+
+// Arms the timer for c-ares' next timeout while any socket is watched.
+void Channel::UpdateTimer() {
+  if (watchers_ == NULL) {
+    ev_timer_stop(EV_DEFAULT_UC_ &timer_);
+    return;
+  }
+
+  struct timeval maxtv, tvbuf, *tv;
+  maxtv.tv_sec = 20;
+  maxtv.tv_usec = 0;
+  tv = ares_timeout(channel, &maxtv, &tvbuf);
+
+  // ev_timer_again() with a zero repeat would stop the timer instead.
+  timer_.repeat = tv->tv_sec + tv->tv_usec / 1e6;
+  if (timer_.repeat <= 0.) timer_.repeat = 1e-6;
+  ev_timer_again(EV_DEFAULT_UC_ &timer_);
+}
+
+
 void Channel::SockStateCb(void *data, ares_socket_t sock, int read, int write) {
   Channel *c = static_cast<Channel*>(data);
-  HandleScope scope;
+  SocketWatcher *w = c->FindWatcher(sock);
 
-  Local<Value> callback_v = c->handle_->Get(callback_symbol);
-  if (!callback_v->IsFunction()) return;
-  Local<Function> callback = Local<Function>::Cast(callback_v);
+  if (!read && !write) {
+    // c-ares is done with the socket.
+    if (w != NULL) {
+      ev_io_stop(EV_DEFAULT_UC_ &w->io);
 
-  Local<Value> argv[3];
+      SocketWatcher **p = &c->watchers_;
+      while (*p != w) p = &(*p)->next;
+      *p = w->next;
+      delete w;
 
-  argv[0] = Integer::New(sock);
-  argv[1] = Integer::New(read);
-  argv[2] = Integer::New(write);
+      if (c->watchers_ == NULL) c->Unref();
+    }
+    c->UpdateTimer();
+    return;
+  }
 
-  TryCatch try_catch;
+  if (w == NULL) {
+    int fd;
+#ifdef __MINGW32__
+    fd = _open_osfhandle(sock, 0);
+#else
+    fd = sock;
+#endif
 
-  callback->Call(c->handle_, 3, argv);
+    w = new SocketWatcher;
+    w->channel = c;
+    w->sock = sock;
+    ev_io_init(&w->io, Channel::OnSocket, fd, 0);
+    w->io.data = w;
 
-  if (try_catch.HasCaught()) {
-    FatalException(try_catch);
+    // Keep the channel alive while it has sockets open.
+    if (c->watchers_ == NULL) c->Ref();
+    w->next = c->watchers_;
+    c->watchers_ = w;
+  } else {
+    ev_io_stop(EV_DEFAULT_UC_ &w->io);
   }
+
+  int events = 0;
+  if (read) events |= EV_READ;
+  if (write) events |= EV_WRITE;
+
+  ev_io_set(&w->io, w->io.fd, events);
+  ev_io_start(EV_DEFAULT_UC_ &w->io);
+
+  c->UpdateTimer();
+}
+
+
+void Channel::OnSocket(EV_P_ ev_io *watcher, int revents) {
+  SocketWatcher *w = static_cast<SocketWatcher*>(watcher->data);
+  Channel *c = w->channel;
+  ares_socket_t sock = w->sock;
+
+  HandleScope scope;
+
+  // The result callbacks run JavaScript, and SockStateCb may drop the
+  // channel's own reference meanwhile. Hold one so that a garbage
+  // collection in between cannot delete the channel under us.
+  c->Ref();
+
+  // May close the socket, and so free `w`, through SockStateCb.
+  ares_process_fd(c->channel,
+                  revents & EV_READ ? sock : ARES_SOCKET_BAD,
+                  revents & EV_WRITE ? sock : ARES_SOCKET_BAD);
+
+  c->UpdateTimer();
+  c->Unref();
 }
 
 
+void Channel::OnTimeout(EV_P_ ev_timer *watcher, int revents) {
+  Channel *c = static_cast<Channel*>(watcher->data);
+
+  HandleScope scope;
+
+  // See OnSocket().
+  c->Ref();
+
+  // With no socket to read or write c-ares only handles expired queries.
+  ares_process_fd(c->channel, ARES_SOCKET_BAD, ARES_SOCKET_BAD);
+
+  c->UpdateTimer();
+  c->Unref();
+}
 
 
 }  // namespace node
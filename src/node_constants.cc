@@ -30,6 +30,10 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 
+#ifdef __POSIX__
+# include <sys/mman.h>
+#endif
+
 #ifdef __MINGW32__
 # include <platform_win32.h>
 # include <platform_win32_winsock.h>
@@ -161,6 +165,55 @@ void DefineConstants(Handle<Object> target) {
   NODE_DEFINE_CONSTANT(target, S_IXOTH);
 #endif
 
+  // memory mapping
+#ifdef PROT_NONE
+  NODE_DEFINE_CONSTANT(target, PROT_NONE);
+#endif
+
+#ifdef PROT_READ
+  NODE_DEFINE_CONSTANT(target, PROT_READ);
+#endif
+
+#ifdef PROT_WRITE
+  NODE_DEFINE_CONSTANT(target, PROT_WRITE);
+#endif
+
+#ifdef PROT_EXEC
+  NODE_DEFINE_CONSTANT(target, PROT_EXEC);
+#endif
+
+#ifdef MAP_SHARED
+  NODE_DEFINE_CONSTANT(target, MAP_SHARED);
+#endif
+
+#ifdef MAP_PRIVATE
+  NODE_DEFINE_CONSTANT(target, MAP_PRIVATE);
+#endif
+
+#ifdef MAP_POPULATE
+  NODE_DEFINE_CONSTANT(target, MAP_POPULATE);
+#endif
+
+#ifdef MADV_NORMAL
+  NODE_DEFINE_CONSTANT(target, MADV_NORMAL);
+#endif
+
+#ifdef MADV_RANDOM
+  NODE_DEFINE_CONSTANT(target, MADV_RANDOM);
+#endif
+
+#ifdef MADV_SEQUENTIAL
+  NODE_DEFINE_CONSTANT(target, MADV_SEQUENTIAL);
+#endif
+
+#ifdef MADV_WILLNEED
+  NODE_DEFINE_CONSTANT(target, MADV_WILLNEED);
+#endif
+
+#ifdef MADV_DONTNEED
+  NODE_DEFINE_CONSTANT(target, MADV_DONTNEED);
+#endif
+
 #ifdef E2BIG
   NODE_DEFINE_CONSTANT(target, E2BIG);
 #endif
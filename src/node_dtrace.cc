@@ -21,27 +21,33 @@
 
 #include <node_dtrace.h>
 
-#ifdef HAVE_DTRACE
-#include "node_provider.h"
-#else
-#define NODE_HTTP_SERVER_REQUEST(arg0, arg1)
-#define NODE_HTTP_SERVER_REQUEST_ENABLED() (0)
-#define NODE_HTTP_SERVER_RESPONSE(arg0)
-#define NODE_HTTP_SERVER_RESPONSE_ENABLED() (0)
-#define NODE_HTTP_CLIENT_REQUEST(arg0, arg1)
-#define NODE_HTTP_CLIENT_REQUEST_ENABLED() (0)
-#define NODE_HTTP_CLIENT_RESPONSE(arg0)
-#define NODE_HTTP_CLIENT_RESPONSE_ENABLED() (0)
-#define NODE_NET_SERVER_CONNECTION(arg0)
-#define NODE_NET_SERVER_CONNECTION_ENABLED() (0)
-#define NODE_NET_STREAM_END(arg0)
-#define NODE_NET_STREAM_END_ENABLED() (0)
-#define NODE_NET_SOCKET_READ(arg0, arg1)
-#define NODE_NET_SOCKET_READ_ENABLED() (0)
-#define NODE_NET_SOCKET_WRITE(arg0, arg1)
-#define NODE_NET_SOCKET_WRITE_ENABLED() (0)
-#define NODE_GC_START(arg0, arg1)
-#define NODE_GC_DONE(arg0, arg1)
+#include <node_probes.h>
+
+#ifdef HAVE_SYSTEMTAP
+// The semaphores behind NODE_*_ENABLED(). They live in the .probes section
+// where SystemTap and other USDT consumers expect them and count the
+// tracers attached to each probe.
+#define NODE_SEMAPHORE(name) \
+  unsigned short NODE_PROBE_SEMAPHORE(name) \
+  __attribute__((section(".probes"))) = 0
+
+extern "C" {
+NODE_SEMAPHORE(net__server__connection);
+NODE_SEMAPHORE(net__stream__end);
+NODE_SEMAPHORE(net__socket__read);
+NODE_SEMAPHORE(net__socket__write);
+NODE_SEMAPHORE(http__server__request);
+NODE_SEMAPHORE(http__server__response);
+NODE_SEMAPHORE(http__client__request);
+NODE_SEMAPHORE(http__client__response);
+NODE_SEMAPHORE(gc__start);
+NODE_SEMAPHORE(gc__done);
+NODE_SEMAPHORE(fs__request__start);
+NODE_SEMAPHORE(fs__request__done);
+NODE_SEMAPHORE(dns__query__start);
+NODE_SEMAPHORE(dns__query__done);
+NODE_SEMAPHORE(timer__fire);
+}
 #endif
 
 namespace node {
@@ -299,7 +305,7 @@ void InitDTrace(Handle<Object> target) {
     target->Set(String::NewSymbol(tab[i].name), tab[i].templ->GetFunction());
   }
 
-#ifdef HAVE_DTRACE
+#if defined(HAVE_DTRACE) || defined(HAVE_SYSTEMTAP)
   v8::V8::AddGCPrologueCallback((GCPrologueCallback)dtrace_gc_start);
   v8::V8::AddGCEpilogueCallback((GCEpilogueCallback)dtrace_gc_done);
 #endif
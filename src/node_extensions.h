@@ -34,5 +34,12 @@ NODE_EXT_LIST_ITEM(node_http_parser)
 NODE_EXT_LIST_ITEM(node_signal_watcher)
 NODE_EXT_LIST_ITEM(node_stdio)
 NODE_EXT_LIST_ITEM(node_os)
+NODE_EXT_LIST_ITEM(node_profiler)
+NODE_EXT_LIST_ITEM(node_querystring)
+NODE_EXT_LIST_ITEM(node_url)
+NODE_EXT_LIST_ITEM(node_tcp_wrap)
+#ifdef HAVE_ZLIB
+NODE_EXT_LIST_ITEM(node_zlib)
+#endif
 NODE_EXT_LIST_END
 
@@ -23,6 +23,8 @@
 #include <node_file.h>
 #include <node_buffer.h>
 #include <node_stat_watcher.h>
+#include <node_tree_watcher.h>
+#include <node_probes.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -36,6 +38,10 @@
 #include <errno.h>
 #include <limits.h>
 
+#ifdef __POSIX__
+# include <sys/mman.h>
+#endif
+
 #ifdef __MINGW32__
 # include <platform_win32.h>
 #endif
@@ -90,6 +96,12 @@ static int After(eio_req *req) {
 
   ev_unref(EV_DEFAULT_UC);
 
+  // Failed requests report the negated errno.
+  if (NODE_FS_REQUEST_DONE_ENABLED()) {
+    NODE_FS_REQUEST_DONE(req, req->type,
+        req->result == -1 ? -req->errorno : (int)req->result);
+  }
+
   // there is always at least one argument. "error"
   int argc = 1;
 
@@ -213,6 +225,10 @@ static int After(eio_req *req) {
   eio_req *req = eio_##func(__VA_ARGS__, EIO_PRI_DEFAULT, After,  \
     cb_persist(callback));                                        \
   assert(req);                                                    \
+  if (NODE_FS_REQUEST_START_ENABLED()) {                          \
+    NODE_FS_REQUEST_START(req, req->type,                         \
+                          static_cast<char*>(req->ptr1));         \
+  }                                                               \
   ev_ref(EV_DEFAULT_UC);                                          \
   return Undefined();
 
@@ -585,18 +601,19 @@ static Handle<Value> MKDir(const Arguments& args) {
 static Handle<Value> SendFile(const Arguments& args) {
   HandleScope scope;
 
+  // Offsets and lengths are doubles so that files past 4GB can be sent.
   if (args.Length() < 4 ||
       !args[0]->IsUint32() ||
       !args[1]->IsUint32() ||
-      !args[2]->IsUint32() ||
-      !args[3]->IsUint32()) {
+      !args[2]->IsNumber() || args[2]->IntegerValue() < 0 ||
+      !args[3]->IsNumber() || args[3]->IntegerValue() < 0) {
     return THROW_BAD_ARGS;
   }
 
   int out_fd = args[0]->Uint32Value();
   int in_fd = args[1]->Uint32Value();
-  off_t in_offset = args[2]->Uint32Value();
-  size_t length = args[3]->Uint32Value();
+  off_t in_offset = args[2]->IntegerValue();
+  size_t length = args[3]->IntegerValue();
 
   if (args[4]->IsFunction()) {
     ASYNC_CALL(sendfile, args[4], out_fd, in_fd, in_offset, length)
@@ -668,7 +685,7 @@ static Handle<Value> Open(const Arguments& args) {
   }
 }
 
-#define GET_OFFSET(a) (a)->IsInt32() ? (a)->IntegerValue() : -1;
+#define GET_OFFSET(a) (a)->IsNumber() ? (a)->IntegerValue() : -1;
 
 // bytesWritten = write(fd, data, position, enc, callback)
 // Wrapper for write(2).
@@ -974,6 +991,411 @@ static Handle<Value> FUTimes(const Arguments& args) {
 }
 
 
+#ifdef __POSIX__
+// A mapping is page aligned while the Buffer handed out may start anywhere
+// inside its first page, so remember the real extent for munmap(). The live
+// mappings are kept in a list so that madvise() can tell them apart from
+// memory it must not touch.
+struct MappedRegion {
+  void *base;
+  size_t length;
+  MappedRegion *prev;
+  MappedRegion *next;
+};
+
+static MappedRegion *mapped_regions;
+
+
+static void Unmap(char *data, void *hint) {
+  MappedRegion *region = static_cast<MappedRegion*>(hint);
+  munmap(region->base, region->length);
+  V8::AdjustAmountOfExternalAllocatedMemory(-(int)region->length);
+
+  if (region->prev) {
+    region->prev->next = region->next;
+  } else {
+    mapped_regions = region->next;
+  }
+  if (region->next) region->next->prev = region->prev;
+
+  delete region;
+}
+
+
+// The live mapping that holds all of [data, data + length), if any.
+static MappedRegion* FindMappedRegion(char *data, size_t length) {
+  char *end = data + length;
+  for (MappedRegion *r = mapped_regions; r != NULL; r = r->next) {
+    char *base = static_cast<char*>(r->base);
+    if (data >= base && end <= base + r->length) return r;
+  }
+  return NULL;
+}
+
+
+// var buffer = binding.mmap(fd, offset, length, prot, flags);
+static Handle<Value> Mmap(const Arguments& args) {
+  HandleScope scope;
+
+  if (args.Length() < 5 ||
+      !args[0]->IsInt32() ||
+      !args[1]->IsNumber() ||
+      !args[2]->IsUint32() ||
+      !args[3]->IsInt32() ||
+      !args[4]->IsInt32()) {
+    return THROW_BAD_ARGS;
+  }
+
+  int fd = args[0]->Int32Value();
+  int64_t offset = args[1]->IntegerValue();
+  size_t length = args[2]->Uint32Value();
+  int prot = args[3]->Int32Value();
+  int flags = args[4]->Int32Value();
+
+  if (offset < 0 || length == 0) {
+    return THROW_BAD_ARGS;
+  }
+
+  off_t page_size = sysconf(_SC_PAGESIZE);
+  off_t slack = offset % page_size;
+  size_t map_length = length + slack;
+
+  void *base = mmap(NULL, map_length, prot, flags, fd, offset - slack);
+  if (base == MAP_FAILED) {
+    return ThrowException(ErrnoException(errno, "mmap"));
+  }
+
+  MappedRegion *region = new MappedRegion;
+  region->base = base;
+  region->length = map_length;
+  region->prev = NULL;
+  region->next = mapped_regions;
+  if (mapped_regions) mapped_regions->prev = region;
+  mapped_regions = region;
+
+  // The pages are not on the V8 heap but they do pin file cache and address
+  // space; report them so that dead mappings are collected promptly.
+  V8::AdjustAmountOfExternalAllocatedMemory(map_length);
+
+  Buffer *buffer = Buffer::New(static_cast<char*>(base) + slack, length,
+                               Unmap, region);
+  return scope.Close(buffer->handle_);
+}
+
+
+// binding.madvise(buffer, advice);
+static Handle<Value> Madvise(const Arguments& args) {
+  HandleScope scope;
+
+  if (args.Length() < 2 ||
+      !Buffer::HasInstance(args[0]) ||
+      !args[1]->IsInt32()) {
+    return THROW_BAD_ARGS;
+  }
+
+  Local<Object> buffer = args[0]->ToObject();
+  char *data = Buffer::Data(buffer);
+  size_t length = Buffer::Length(buffer);
+  int advice = args[1]->Int32Value();
+
+  if (length == 0) return Undefined();
+
+  // Advice such as MADV_DONTNEED throws away the contents of anonymous and
+  // private pages, so it is only given for memory that fs.mmap() mapped.
+  if (FindMappedRegion(data, length) == NULL) {
+    return ThrowException(Exception::Error(
+          String::New("madvise() needs a buffer returned by fs.mmap()")));
+  }
+
+  // madvise() wants a page aligned start; widen the range to cover the
+  // whole pages the buffer touches. Those all belong to the mapping, as
+  // it is page aligned itself.
+  uintptr_t page_size = sysconf(_SC_PAGESIZE);
+  uintptr_t start = reinterpret_cast<uintptr_t>(data) & ~(page_size - 1);
+  uintptr_t end = reinterpret_cast<uintptr_t>(data) + length;
+
+  if (madvise(reinterpret_cast<void*>(start), end - start, advice) != 0) {
+    return ThrowException(ErrnoException(errno, "madvise"));
+  }
+
+  return Undefined();
+}
+#endif  // __POSIX__
+
+
+// readFile() and writeFile() in one trip to the thread pool each: open,
+// fstat, read or write everything, close. A read allocates its result once,
+// at the size fstat reports, and hands it to JS without a copy.
+struct FileJob {
+  Persistent<Function> callback;
+  Persistent<Object> buffer;  // keeps the data of a write alive
+  char *path;
+  char *data;
+  size_t length;
+  int flags;
+  mode_t mode;
+  bool has_encoding;
+  enum encoding encoding;
+  int errorno;
+  const char *syscall;
+};
+
+
+static FileJob* NewFileJob(Handle<Value> path) {
+  String::Utf8Value path_v(path->ToString());
+  FileJob *job = new FileJob;
+  job->path = strdup(*path_v);
+  job->data = NULL;
+  job->length = 0;
+  job->flags = 0;
+  job->mode = 0;
+  job->has_encoding = false;
+  job->encoding = UTF8;
+  job->errorno = 0;
+  job->syscall = NULL;
+  return job;
+}
+
+
+static void DeleteFileJob(FileJob *job) {
+  if (!job->callback.IsEmpty()) job->callback.Dispose();
+  if (!job->buffer.IsEmpty()) {
+    job->buffer.Dispose();
+  } else {
+    // A read that never made it to JS.
+    free(job->data);
+  }
+  free(job->path);
+  delete job;
+}
+
+
+static bool FileJobFailed(FileJob *job, const char *syscall, int fd) {
+  job->errorno = errno;
+  job->syscall = syscall;
+  if (fd >= 0) close(fd);
+  return false;
+}
+
+
+// Runs in the thread pool, or inline for readFileSync().
+static bool ReadWholeFile(FileJob *job) {
+  int fd = open(job->path, O_RDONLY);
+  if (fd < 0) return FileJobFailed(job, "open", fd);
+  SetCloseOnExec(fd);
+
+  // One spare byte so that a file of the expected size ends with a zero
+  // read instead of a reallocation. Files that don't know their size,
+  // like those in /proc, start small and grow.
+  NODE_STAT_STRUCT s;
+  size_t capacity = 8192;
+  if (NODE_FSTAT(fd, &s) == 0 && S_ISREG(s.st_mode)) {
+    capacity = s.st_size + 1;
+  }
+
+  char *data = static_cast<char*>(malloc(capacity));
+  if (data == NULL) return FileJobFailed(job, "malloc", fd);
+
+  size_t length = 0;
+
+  for (;;) {
+    if (length == capacity) {
+      char *grown = static_cast<char*>(realloc(data, capacity * 2));
+      if (grown == NULL) {
+        free(data);
+        return FileJobFailed(job, "realloc", fd);
+      }
+      data = grown;
+      capacity *= 2;
+    }
+
+    ssize_t n = read(fd, data + length, capacity - length);
+    if (n == 0) break;
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      free(data);
+      return FileJobFailed(job, "read", fd);
+    }
+    length += n;
+  }
+
+  close(fd);
+
+  job->data = data;
+  job->length = length;
+  return true;
+}
+
+
+// Runs in the thread pool, or inline for writeFileSync().
+static bool WriteWholeFile(FileJob *job) {
+  int fd = open(job->path, job->flags, job->mode);
+  if (fd < 0) return FileJobFailed(job, "open", fd);
+  SetCloseOnExec(fd);
+
+  size_t written = 0;
+
+  while (written < job->length) {
+    ssize_t n = write(fd, job->data + written, job->length - written);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return FileJobFailed(job, "write", fd);
+    }
+    written += n;
+  }
+
+  if (close(fd) != 0) return FileJobFailed(job, "close", -1);
+  return true;
+}
+
+
+static void FreeFileData(char *data, void *hint) {
+  free(data);
+  V8::AdjustAmountOfExternalAllocatedMemory(
+      -static_cast<int>(reinterpret_cast<intptr_t>(hint)));
+}
+
+
+// The contents as a string when an encoding was asked for, else as a
+// SlowBuffer that owns the malloc()ed data.
+static Local<Value> FileJobResult(FileJob *job) {
+  HandleScope scope;
+  Local<Value> result;
+
+  if (job->has_encoding) {
+    result = Encode(job->data, job->length, job->encoding);
+  } else {
+    V8::AdjustAmountOfExternalAllocatedMemory(job->length);
+    Buffer *buffer = Buffer::New(job->data, job->length, FreeFileData,
+                                 reinterpret_cast<void*>(job->length));
+    job->data = NULL;
+    result = Local<Object>::New(buffer->handle_);
+  }
+
+  return scope.Close(result);
+}
+
+
+static int DoReadFile(eio_req *req) {
+  // Note: this function is executed in the thread pool! CAREFUL
+  ReadWholeFile(static_cast<FileJob*>(req->data));
+  return 0;
+}
+
+
+static int DoWriteFile(eio_req *req) {
+  // Note: this function is executed in the thread pool! CAREFUL
+  WriteWholeFile(static_cast<FileJob*>(req->data));
+  return 0;
+}
+
+
+static int AfterFileJob(eio_req *req) {
+  HandleScope scope;
+  FileJob *job = static_cast<FileJob*>(req->data);
+
+  ev_unref(EV_DEFAULT_UC);
+
+  Local<Value> argv[2];
+  int argc = 1;
+
+  if (job->errorno != 0) {
+    argv[0] = ErrnoException(job->errorno, job->syscall, "", job->path);
+  } else {
+    argv[0] = Local<Value>::New(Null());
+    if (job->buffer.IsEmpty()) {
+      argv[1] = FileJobResult(job);
+      argc = 2;
+    }
+  }
+
+  TryCatch try_catch;
+
+  job->callback->Call(v8::Context::GetCurrent()->Global(), argc, argv);
+
+  if (try_catch.HasCaught()) {
+    FatalException(try_catch);
+  }
+
+  DeleteFileJob(job);
+  return 0;
+}
+
+
+// var buffer = binding.readFile(path, [encoding], [callback]);
+// Without an encoding the result is a SlowBuffer.
+static Handle<Value> ReadFile(const Arguments& args) {
+  HandleScope scope;
+
+  if (args.Length() < 1 || !args[0]->IsString()) {
+    return THROW_BAD_ARGS;
+  }
+
+  FileJob *job = NewFileJob(args[0]);
+
+  if (args[1]->IsString()) {
+    job->has_encoding = true;
+    job->encoding = ParseEncoding(args[1], UTF8);
+  }
+
+  if (args[2]->IsFunction()) {
+    job->callback = Persistent<Function>::New(Local<Function>::Cast(args[2]));
+    eio_custom(DoReadFile, EIO_PRI_DEFAULT, AfterFileJob, job);
+    ev_ref(EV_DEFAULT_UC);
+    return Undefined();
+  }
+
+  if (!ReadWholeFile(job)) {
+    Local<Value> e = ErrnoException(job->errorno, job->syscall, "", job->path);
+    DeleteFileJob(job);
+    return ThrowException(e);
+  }
+
+  Local<Value> result = FileJobResult(job);
+  DeleteFileJob(job);
+  return scope.Close(result);
+}
+
+
+// binding.writeFile(path, buffer, flags, mode, [callback]);
+static Handle<Value> WriteFile(const Arguments& args) {
+  HandleScope scope;
+
+  if (args.Length() < 4 ||
+      !args[0]->IsString() ||
+      !Buffer::HasInstance(args[1]) ||
+      !args[2]->IsInt32() ||
+      !args[3]->IsInt32()) {
+    return THROW_BAD_ARGS;
+  }
+
+  Local<Object> buffer = args[1]->ToObject();
+
+  FileJob *job = NewFileJob(args[0]);
+  job->buffer = Persistent<Object>::New(buffer);
+  job->data = Buffer::Data(buffer);
+  job->length = Buffer::Length(buffer);
+  job->flags = args[2]->Int32Value();
+  job->mode = static_cast<mode_t>(args[3]->Int32Value());
+
+  if (args[4]->IsFunction()) {
+    job->callback = Persistent<Function>::New(Local<Function>::Cast(args[4]));
+    eio_custom(DoWriteFile, EIO_PRI_DEFAULT, AfterFileJob, job);
+    ev_ref(EV_DEFAULT_UC);
+    return Undefined();
+  }
+
+  if (!WriteWholeFile(job)) {
+    Local<Value> e = ErrnoException(job->errorno, job->syscall, "", job->path);
+    DeleteFileJob(job);
+    return ThrowException(e);
+  }
+
+  DeleteFileJob(job);
+  return Undefined();
+}
+
+
 void File::Initialize(Handle<Object> target) {
   HandleScope scope;
 
@@ -1000,6 +1422,8 @@ void File::Initialize(Handle<Object> target) {
 #endif // __POSIX__
   NODE_SET_METHOD(target, "unlink", Unlink);
   NODE_SET_METHOD(target, "write", Write);
+  NODE_SET_METHOD(target, "readFile", ReadFile);
+  NODE_SET_METHOD(target, "writeFile", WriteFile);
 
   NODE_SET_METHOD(target, "chmod", Chmod);
   NODE_SET_METHOD(target, "fchmod", FChmod);
@@ -1014,6 +1438,11 @@ void File::Initialize(Handle<Object> target) {
   NODE_SET_METHOD(target, "utimes", UTimes);
   NODE_SET_METHOD(target, "futimes", FUTimes);
 
+#ifdef __POSIX__
+  NODE_SET_METHOD(target, "mmap", Mmap);
+  NODE_SET_METHOD(target, "madvise", Madvise);
+#endif // __POSIX__
+
   errno_symbol = NODE_PSYMBOL("errno");
   encoding_symbol = NODE_PSYMBOL("node:encoding");
   buf_symbol = NODE_PSYMBOL("__buf");
@@ -1027,6 +1456,9 @@ void InitFs(Handle<Object> target) {
   target->Set(String::NewSymbol("Stats"),
                stats_constructor_template->GetFunction());
   StatWatcher::Initialize(target);
+#ifdef HAVE_INOTIFY
+  TreeWatcher::Initialize(target);
+#endif
   File::Initialize(target);
 
 #ifdef __MINGW32__
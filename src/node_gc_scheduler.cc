@@ -0,0 +1,409 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <node_gc_scheduler.h>
+#include <node_gc_stats.h>
+
+#include <v8.h>
+#include <ev.h>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace node {
+
+using namespace v8;
+
+enum SchedulerMode { GC_ADAPTIVE, GC_LEGACY, GC_OFF };
+
+static SchedulerMode mode = GC_ADAPTIVE;
+
+// Longest slice spent on idle notifications before the loop blocks, and how
+// long the loop has to be completely idle before V8 is told to release as
+// much memory as it can. Both in seconds; set with --gc-idle-slice (ms)
+// and --gc-idle-timeout (s).
+static double max_slice = 0.010;
+static double idle_timeout = 5.;
+
+// Smallest slice the budget shrinks to after a slice delayed work.
+#define MIN_SLICE 0.001
+// A poll shorter than this after a slice means work was already waiting.
+#define SHORT_WAIT 0.0005
+// Weight of the newest sample in the busy and idle moving averages.
+#define EWMA_WEIGHT 0.2
+// Bounds the idle notifications in a single slice; V8 does at most one
+// collection per notification and needs eight for a full cycle.
+#define MAX_NOTIFICATIONS 10
+
+static ev_prepare gc_prepare;
+static ev_check gc_check;
+static ev_timer gc_timer;
+static ev_idle gc_idle;
+
+static ev_tstamp block_start;   // when the loop last went to poll
+static ev_tstamp last_wake;     // when poll last returned
+static double busy_avg;         // seconds between waking and blocking
+static double idle_avg;         // seconds spent in poll
+static double budget;           // current slice budget, seconds
+
+static bool slice_taken;        // the current poll follows a slice
+static bool cycle_done;         // V8 reported nothing left to collect
+static double done_collections; // GCStats::Collections() at that point
+
+static double iterations;
+static double timer_iterations;
+static bool low_memory_sent;
+static double low_memory_collections;
+
+static double slices;
+static double slice_time;
+static double longest_slice;
+static double delayed_slices;
+static double low_memory_notifications;
+
+static Persistent<String> scheduler_symbol;
+static Persistent<String> utilization_symbol;
+static Persistent<String> busy_average_symbol;
+static Persistent<String> idle_average_symbol;
+static Persistent<String> budget_symbol;
+static Persistent<String> slices_symbol;
+static Persistent<String> slice_time_symbol;
+static Persistent<String> max_slice_symbol;
+static Persistent<String> delayed_slices_symbol;
+static Persistent<String> low_memory_symbol;
+
+
+static inline double Ewma(double avg, double sample) {
+  return avg + EWMA_WEIGHT * (sample - avg);
+}
+
+
+static inline bool IdleNotification() {
+  GCStats::idle_notifications++;
+  GCStats::in_idle_notification = true;
+  bool done = V8::IdleNotification();
+  GCStats::in_idle_notification = false;
+  return done;
+}
+
+
+// What the next idle collection is expected to cost, in seconds. Full
+// collections dominate so they are assumed once one has been seen.
+static double PredictedPause() {
+  double ms = GCStats::AveragePause(kGCTypeMarkSweepCompact);
+  if (ms == 0) ms = GCStats::AveragePause(kGCTypeScavenge);
+  return ms / 1000;
+}
+
+
+// Spends at most `slice` seconds on idle notifications.
+static void RunSlice(double slice) {
+  double cost = PredictedPause();
+  if (cost > slice) return;
+
+  ev_tstamp start = ev_time();
+  ev_tstamp now = start;
+
+  for (int i = 0; i < MAX_NOTIFICATIONS; i++) {
+    bool done = IdleNotification();
+    now = ev_time();
+
+    if (done) {
+      cycle_done = true;
+      done_collections = GCStats::Collections();
+      break;
+    }
+
+    if (now - start + cost > slice) break;
+  }
+
+  double spent = now - start;
+  slices++;
+  slice_time += spent;
+  if (spent > longest_slice) longest_slice = spent;
+  slice_taken = true;
+}
+
+
+// Called right before the loop blocks in poll.
+static void Prepare(EV_P_ ev_prepare *watcher, int revents) {
+  assert(watcher == &gc_prepare);
+  assert(revents == EV_PREPARE);
+
+  ev_tstamp now = ev_time();
+  if (last_wake > 0) busy_avg = Ewma(busy_avg, now - last_wake);
+
+  // Collections since the last finished cycle mean there is garbage again.
+  if (cycle_done && GCStats::Collections() > done_collections) {
+    cycle_done = false;
+  }
+
+  if (!cycle_done && idle_avg > 0) {
+    // Use a share of the expected wait that shrinks as the loop gets
+    // busier, and never more than the budget.
+    double utilization = busy_avg / (busy_avg + idle_avg);
+    double slice = idle_avg * (1 - utilization);
+    if (slice > budget) slice = budget;
+
+    RunSlice(slice);
+    now = ev_time();
+  }
+
+  block_start = now;
+}
+
+
+// Called right after poll returns.
+static void Check(EV_P_ ev_check *watcher, int revents) {
+  assert(watcher == &gc_check);
+  assert(revents == EV_CHECK);
+
+  ev_tstamp now = ev_time();
+  double idle = now - block_start;
+  idle_avg = Ewma(idle_avg, idle);
+  last_wake = now;
+  iterations++;
+
+  if (slice_taken) {
+    slice_taken = false;
+    if (idle < SHORT_WAIT) {
+      // Work arrived while we were collecting: back off.
+      delayed_slices++;
+      budget /= 2;
+      if (budget < MIN_SLICE) budget = MIN_SLICE;
+    } else {
+      budget += MIN_SLICE;
+      if (budget > max_slice) budget = max_slice;
+    }
+  }
+}
+
+
+// Fires every idle_timeout seconds. If the loop did nothing else in the
+// meantime the process is idle: let V8 give back what memory it can, once
+// per idle period.
+static void Timeout(EV_P_ ev_timer *watcher, int revents) {
+  assert(watcher == &gc_timer);
+  assert(revents == EV_TIMEOUT);
+
+  // The wakeup for this timer is the only iteration an idle loop makes.
+  bool idle = iterations - timer_iterations <= 1;
+  timer_iterations = iterations;
+
+  if (low_memory_sent && GCStats::Collections() > low_memory_collections) {
+    low_memory_sent = false;
+  }
+
+  if (idle && !low_memory_sent) {
+    low_memory_notifications++;
+    V8::LowMemoryNotification();
+    low_memory_sent = true;
+    low_memory_collections = GCStats::Collections();
+    cycle_done = true;
+    done_collections = low_memory_collections;
+  }
+}
+
+
+// The legacy scheduler: start the idle watcher once the loop has ticked
+// slower than FAST_TICK for GC_WAIT_TIME seconds, or the heap is large, and
+// keep notifying V8 until it has nothing left to do.
+
+#define FAST_TICK 0.7
+#define GC_WAIT_TIME 5.
+#define RPM_SAMPLES 100
+#define TICK_TIME(n) tick_times[(tick_time_head - (n)) % RPM_SAMPLES]
+static ev_tstamp tick_times[RPM_SAMPLES];
+static int tick_time_head;
+
+static void StartGCTimer () {
+  if (!ev_is_active(&gc_timer)) {
+    ev_timer_start(EV_DEFAULT_UC_ &gc_timer);
+    ev_unref(EV_DEFAULT_UC);
+  }
+}
+
+static void StopGCTimer () {
+  if (ev_is_active(&gc_timer)) {
+    ev_ref(EV_DEFAULT_UC);
+    ev_timer_stop(EV_DEFAULT_UC_ &gc_timer);
+  }
+}
+
+static void LegacyIdle(EV_P_ ev_idle *watcher, int revents) {
+  assert(watcher == &gc_idle);
+  assert(revents == EV_IDLE);
+
+  if (IdleNotification()) {
+    ev_idle_stop(EV_A_ watcher);
+    StopGCTimer();
+  }
+}
+
+
+static void LegacyCheck(EV_P_ ev_check *watcher, int revents) {
+  assert(watcher == &gc_check);
+  assert(revents == EV_CHECK);
+
+  tick_times[tick_time_head] = ev_now(EV_DEFAULT_UC);
+  tick_time_head = (tick_time_head + 1) % RPM_SAMPLES;
+
+  StartGCTimer();
+
+  for (int i = 0; i < (int)(GC_WAIT_TIME/FAST_TICK); i++) {
+    double d = TICK_TIME(i+1) - TICK_TIME(i+2);
+    // If in the last 5 ticks the difference between
+    // ticks was less than 0.7 seconds, then continue.
+    if (d < FAST_TICK) {
+      return;
+    }
+  }
+
+  // Otherwise start the gc!
+  ev_idle_start(EV_A_ &gc_idle);
+}
+
+
+static void LegacyCheckStatus(EV_P_ ev_timer *watcher, int revents) {
+  assert(watcher == &gc_timer);
+  assert(revents == EV_TIMEOUT);
+
+  // check memory
+  if (!ev_is_active(&gc_idle)) {
+    HeapStatistics stats;
+    V8::GetHeapStatistics(&stats);
+    if (stats.total_heap_size() > 1024 * 1024 * 128) {
+      // larger than 128 megs, just start the idle watcher
+      ev_idle_start(EV_A_ &gc_idle);
+      return;
+    }
+  }
+
+  double d = ev_now(EV_DEFAULT_UC) - TICK_TIME(3);
+
+  if (d  >= GC_WAIT_TIME - 1.) {
+    ev_idle_start(EV_A_ &gc_idle);
+  }
+}
+
+
+bool GCScheduler::ParseOption(const char *arg) {
+  const char *p = strchr(arg, '=');
+
+  if (strstr(arg, "--gc-scheduler=") == arg) {
+    if (!strcmp(p + 1, "adaptive")) {
+      mode = GC_ADAPTIVE;
+    } else if (!strcmp(p + 1, "legacy")) {
+      mode = GC_LEGACY;
+    } else if (!strcmp(p + 1, "off")) {
+      mode = GC_OFF;
+    } else {
+      fprintf(stderr, "Unknown GC scheduler: %s\n", p + 1);
+      exit(1);
+    }
+  } else if (strstr(arg, "--gc-idle-slice=") == arg) {
+    max_slice = atof(p + 1) / 1000;
+    if (max_slice < MIN_SLICE) max_slice = MIN_SLICE;
+  } else if (strstr(arg, "--gc-idle-timeout=") == arg) {
+    idle_timeout = atof(p + 1);
+    if (idle_timeout <= 0) idle_timeout = 5.;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+
+void GCScheduler::Initialize() {
+  budget = max_slice;
+
+  switch (mode) {
+    case GC_ADAPTIVE:
+      ev_prepare_init(&gc_prepare, Prepare);
+      ev_prepare_start(EV_DEFAULT_UC_ &gc_prepare);
+      ev_unref(EV_DEFAULT_UC);
+
+      ev_check_init(&gc_check, Check);
+      ev_check_start(EV_DEFAULT_UC_ &gc_check);
+      ev_unref(EV_DEFAULT_UC);
+
+      ev_timer_init(&gc_timer, Timeout, idle_timeout, idle_timeout);
+      ev_timer_start(EV_DEFAULT_UC_ &gc_timer);
+      ev_unref(EV_DEFAULT_UC);
+      break;
+
+    case GC_LEGACY:
+      ev_check_init(&gc_check, LegacyCheck);
+      ev_check_start(EV_DEFAULT_UC_ &gc_check);
+      ev_unref(EV_DEFAULT_UC);
+
+      ev_idle_init(&gc_idle, LegacyIdle);
+      ev_timer_init(&gc_timer, LegacyCheckStatus, 5., 5.);
+      break;
+
+    case GC_OFF:
+      break;
+  }
+}
+
+
+Handle<Value> GCScheduler::GetStats(const Arguments& args) {
+  HandleScope scope;
+
+  if (scheduler_symbol.IsEmpty()) {
+    scheduler_symbol = NODE_PSYMBOL("scheduler");
+    utilization_symbol = NODE_PSYMBOL("utilization");
+    busy_average_symbol = NODE_PSYMBOL("busyAverage");
+    idle_average_symbol = NODE_PSYMBOL("idleAverage");
+    budget_symbol = NODE_PSYMBOL("budget");
+    slices_symbol = NODE_PSYMBOL("slices");
+    slice_time_symbol = NODE_PSYMBOL("sliceTime");
+    max_slice_symbol = NODE_PSYMBOL("maxSlice");
+    delayed_slices_symbol = NODE_PSYMBOL("delayedSlices");
+    low_memory_symbol = NODE_PSYMBOL("lowMemoryNotifications");
+  }
+
+  const char *name = mode == GC_ADAPTIVE ? "adaptive" :
+                     mode == GC_LEGACY ? "legacy" : "off";
+
+  double total = busy_avg + idle_avg;
+
+  Local<Object> result = Object::New();
+  result->Set(scheduler_symbol, String::New(name));
+  result->Set(utilization_symbol, Number::New(total > 0 ? busy_avg / total
+                                                        : 0));
+  result->Set(busy_average_symbol, Number::New(busy_avg * 1000));
+  result->Set(idle_average_symbol, Number::New(idle_avg * 1000));
+  result->Set(budget_symbol, Number::New(budget * 1000));
+  result->Set(slices_symbol, Number::New(slices));
+  result->Set(slice_time_symbol, Number::New(slice_time * 1000));
+  result->Set(max_slice_symbol, Number::New(longest_slice * 1000));
+  result->Set(delayed_slices_symbol, Number::New(delayed_slices));
+  result->Set(low_memory_symbol, Number::New(low_memory_notifications));
+
+  return scope.Close(result);
+}
+
+
+}  // namespace node
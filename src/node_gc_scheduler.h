@@ -0,0 +1,53 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef NODE_GC_SCHEDULER_H_
+#define NODE_GC_SCHEDULER_H_
+
+#include <node.h>
+#include <v8.h>
+
+namespace node {
+
+// Decides when Node hands idle time to V8's garbage collector through
+// V8::IdleNotification() and V8::LowMemoryNotification().
+//
+// The default "adaptive" scheduler measures how long the event loop is busy
+// and how long it waits in poll, and spends bounded slices of the measured
+// waiting time on idle notifications just before the loop blocks. Slices
+// that delay work which arrived in the meantime shrink the next slice.
+// "legacy" is the old tick rate heuristic, "off" never notifies V8.
+class GCScheduler {
+ public:
+  // Handles the --gc-* command line options. Returns false if arg is not
+  // one of them.
+  static bool ParseOption(const char *arg);
+
+  // Starts the watchers. Must be called after the default loop exists.
+  static void Initialize();
+
+  // process.gcSchedulerStats()
+  static v8::Handle<v8::Value> GetStats(const v8::Arguments& args);
+};
+
+}  // namespace node
+
+#endif  // NODE_GC_SCHEDULER_H_
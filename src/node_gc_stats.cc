@@ -0,0 +1,326 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <node_gc_stats.h>
+
+#include <v8.h>
+#include <ev.h>
+
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+
+#define GC_EVENTS 256
+
+// Upper bounds, in milliseconds, of the pause histogram buckets. The last
+// bucket counts everything above the last bound.
+static const double histogram_bounds[] = {
+  0.1, 0.2, 0.5, 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000
+};
+#define HISTOGRAM_BUCKETS \
+  (sizeof(histogram_bounds) / sizeof(*histogram_bounds) + 1)
+
+namespace node {
+
+using namespace v8;
+
+struct GCEvent {
+  GCType type;
+  bool compacted;
+  bool idle;
+  double start;         // wall clock, ms since the epoch
+  double pause;         // ms
+  size_t heap_before;
+  size_t heap_after;
+};
+
+struct GCTypeStats {
+  double count;
+  double total_pause;
+  double max_pause;
+  double histogram[HISTOGRAM_BUCKETS];
+};
+
+bool GCStats::in_idle_notification = false;
+double GCStats::idle_notifications = 0;
+
+static GCEvent events[GC_EVENTS];
+static double events_total;     // events ever recorded
+static double events_emitted;   // events handed to process.emit('gc')
+
+static GCTypeStats scavenge_stats;
+static GCTypeStats mark_sweep_stats;
+
+static double gc_start_wall;
+static double gc_start_mono;
+static size_t gc_heap_before;
+
+static ev_prepare emit_watcher;
+static Persistent<Object> process_obj;
+
+static Persistent<String> type_symbol;
+static Persistent<String> start_symbol;
+static Persistent<String> pause_symbol;
+static Persistent<String> heap_before_symbol;
+static Persistent<String> heap_after_symbol;
+static Persistent<String> compacted_symbol;
+static Persistent<String> idle_symbol;
+static Persistent<String> count_symbol;
+static Persistent<String> total_pause_symbol;
+static Persistent<String> max_pause_symbol;
+static Persistent<String> histogram_symbol;
+static Persistent<String> scavenge_symbol;
+static Persistent<String> mark_sweep_symbol;
+static Persistent<String> buckets_symbol;
+static Persistent<String> idle_notifications_symbol;
+static Persistent<String> events_symbol;
+static Persistent<String> dropped_symbol;
+static Persistent<String> gc_symbol;
+static Persistent<String> emit_symbol;
+
+
+static inline double WallTime() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1e3 + tv.tv_usec / 1e3;
+}
+
+
+static inline double MonotonicTime() {
+#if defined(__POSIX__) && defined(CLOCK_MONOTONIC) && !defined(__APPLE__)
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+#else
+  return WallTime();
+#endif
+}
+
+
+static inline size_t UsedHeapSize() {
+  HeapStatistics stats;
+  V8::GetHeapStatistics(&stats);
+  return stats.used_heap_size();
+}
+
+
+// The GC callbacks must not touch the V8 heap; they only fill in the
+// static structures above.
+static void Prologue(GCType type, GCCallbackFlags flags) {
+  gc_start_wall = WallTime();
+  gc_start_mono = MonotonicTime();
+  gc_heap_before = UsedHeapSize();
+}
+
+
+static void Epilogue(GCType type, GCCallbackFlags flags) {
+  double pause = MonotonicTime() - gc_start_mono;
+  if (pause < 0) pause = 0;
+
+  GCEvent *e = &events[(size_t)events_total % GC_EVENTS];
+  e->type = type;
+  e->compacted = (flags & kGCCallbackFlagCompacted) != 0;
+  e->idle = GCStats::in_idle_notification;
+  e->start = gc_start_wall;
+  e->pause = pause;
+  e->heap_before = gc_heap_before;
+  e->heap_after = UsedHeapSize();
+  events_total++;
+
+  GCTypeStats *s = type == kGCTypeScavenge ? &scavenge_stats
+                                           : &mark_sweep_stats;
+  s->count++;
+  s->total_pause += pause;
+  if (pause > s->max_pause) s->max_pause = pause;
+
+  size_t bucket = 0;
+  while (bucket < HISTOGRAM_BUCKETS - 1 && pause > histogram_bounds[bucket]) {
+    bucket++;
+  }
+  s->histogram[bucket]++;
+}
+
+
+static Local<Object> EventToObject(const GCEvent *e) {
+  HandleScope scope;
+
+  Local<Object> obj = Object::New();
+  obj->Set(type_symbol, e->type == kGCTypeScavenge ? scavenge_symbol
+                                                   : mark_sweep_symbol);
+  obj->Set(start_symbol, Number::New(e->start));
+  obj->Set(pause_symbol, Number::New(e->pause));
+  obj->Set(heap_before_symbol, Number::New(e->heap_before));
+  obj->Set(heap_after_symbol, Number::New(e->heap_after));
+  obj->Set(compacted_symbol, Boolean::New(e->compacted));
+  obj->Set(idle_symbol, Boolean::New(e->idle));
+
+  return scope.Close(obj);
+}
+
+
+static Local<Object> TypeStatsToObject(const GCTypeStats *s) {
+  HandleScope scope;
+
+  Local<Array> histogram = Array::New(HISTOGRAM_BUCKETS);
+  for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+    histogram->Set(Integer::New(i), Number::New(s->histogram[i]));
+  }
+
+  Local<Object> obj = Object::New();
+  obj->Set(count_symbol, Number::New(s->count));
+  obj->Set(total_pause_symbol, Number::New(s->total_pause));
+  obj->Set(max_pause_symbol, Number::New(s->max_pause));
+  obj->Set(histogram_symbol, histogram);
+
+  return scope.Close(obj);
+}
+
+
+// Runs before the loop blocks, i.e. after the JavaScript that triggered
+// the collections has returned.
+static void EmitEvents(EV_P_ ev_prepare *watcher, int revents) {
+  assert(watcher == &emit_watcher);
+  assert(revents == EV_PREPARE);
+
+  if (events_emitted == events_total) return;
+
+  // Events that were overwritten in the ring before they could be emitted
+  // are skipped.
+  if (events_total - events_emitted > GC_EVENTS) {
+    events_emitted = events_total - GC_EVENTS;
+  }
+
+  HandleScope scope;
+
+  Local<Value> emit_v = process_obj->Get(emit_symbol);
+  if (!emit_v->IsFunction()) return;
+  Local<Function> emit = Local<Function>::Cast(emit_v);
+
+  // Emitting may allocate and so record new collections; only emit what
+  // was there on entry.
+  double end = events_total;
+  while (events_emitted < end) {
+    const GCEvent *e = &events[(size_t)events_emitted % GC_EVENTS];
+    events_emitted++;
+
+    Local<Value> argv[2] = { Local<Value>::New(gc_symbol), EventToObject(e) };
+
+    TryCatch try_catch;
+    emit->Call(process_obj, 2, argv);
+    if (try_catch.HasCaught()) {
+      FatalException(try_catch);
+    }
+  }
+}
+
+
+double GCStats::Collections() {
+  return events_total;
+}
+
+
+double GCStats::AveragePause(GCType type) {
+  const GCTypeStats *s = type == kGCTypeScavenge ? &scavenge_stats
+                                                 : &mark_sweep_stats;
+  return s->count > 0 ? s->total_pause / s->count : 0;
+}
+
+
+Handle<Value> GCStats::Get(const Arguments& args) {
+  HandleScope scope;
+
+  Local<Array> buckets = Array::New(HISTOGRAM_BUCKETS - 1);
+  for (size_t i = 0; i < HISTOGRAM_BUCKETS - 1; i++) {
+    buckets->Set(Integer::New(i), Number::New(histogram_bounds[i]));
+  }
+
+  size_t n = events_total < GC_EVENTS ? (size_t)events_total : GC_EVENTS;
+  Local<Array> recent = Array::New(n);
+  for (size_t i = 0; i < n; i++) {
+    size_t index = (size_t)(events_total - n + i) % GC_EVENTS;
+    recent->Set(Integer::New(i), EventToObject(&events[index]));
+  }
+
+  Local<Object> result = Object::New();
+  result->Set(scavenge_symbol, TypeStatsToObject(&scavenge_stats));
+  result->Set(mark_sweep_symbol, TypeStatsToObject(&mark_sweep_stats));
+  result->Set(buckets_symbol, buckets);
+  result->Set(idle_notifications_symbol, Number::New(idle_notifications));
+  result->Set(events_symbol, recent);
+  result->Set(dropped_symbol, Number::New(events_total - n));
+
+  return scope.Close(result);
+}
+
+
+Handle<Value> GCStats::SetEvents(const Arguments& args) {
+  HandleScope scope;
+
+  if (args[0]->IsTrue()) {
+    if (!ev_is_active(&emit_watcher)) {
+      // Only collections from here on are emitted.
+      events_emitted = events_total;
+      ev_prepare_start(EV_DEFAULT_UC_ &emit_watcher);
+      ev_unref(EV_DEFAULT_UC);
+    }
+  } else if (ev_is_active(&emit_watcher)) {
+    ev_ref(EV_DEFAULT_UC);
+    ev_prepare_stop(EV_DEFAULT_UC_ &emit_watcher);
+  }
+
+  return Undefined();
+}
+
+
+void GCStats::Initialize(Handle<Object> process) {
+  HandleScope scope;
+
+  process_obj = Persistent<Object>::New(process);
+
+  type_symbol = NODE_PSYMBOL("type");
+  start_symbol = NODE_PSYMBOL("start");
+  pause_symbol = NODE_PSYMBOL("pause");
+  heap_before_symbol = NODE_PSYMBOL("heapBefore");
+  heap_after_symbol = NODE_PSYMBOL("heapAfter");
+  compacted_symbol = NODE_PSYMBOL("compacted");
+  idle_symbol = NODE_PSYMBOL("idle");
+  count_symbol = NODE_PSYMBOL("count");
+  total_pause_symbol = NODE_PSYMBOL("totalPause");
+  max_pause_symbol = NODE_PSYMBOL("maxPause");
+  histogram_symbol = NODE_PSYMBOL("histogram");
+  scavenge_symbol = NODE_PSYMBOL("scavenge");
+  mark_sweep_symbol = NODE_PSYMBOL("markSweepCompact");
+  buckets_symbol = NODE_PSYMBOL("buckets");
+  idle_notifications_symbol = NODE_PSYMBOL("idleNotifications");
+  events_symbol = NODE_PSYMBOL("events");
+  dropped_symbol = NODE_PSYMBOL("dropped");
+  gc_symbol = NODE_PSYMBOL("gc");
+  emit_symbol = NODE_PSYMBOL("emit");
+
+  ev_prepare_init(&emit_watcher, EmitEvents);
+
+  V8::AddGCPrologueCallback(Prologue);
+  V8::AddGCEpilogueCallback(Epilogue);
+}
+
+
+}  // namespace node
@@ -0,0 +1,57 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef NODE_GC_STATS_H_
+#define NODE_GC_STATS_H_
+
+#include <node.h>
+#include <v8.h>
+
+namespace node {
+
+// Records every V8 garbage collection - type, pause, heap size before and
+// after - in a ring buffer and per-type pause histograms. Exposed as
+// process.gcStats(); when enabled, events are also emitted as
+// process.on('gc') after the collection has finished.
+class GCStats {
+ public:
+  static void Initialize(v8::Handle<v8::Object> process);
+
+  // process.gcStats()
+  static v8::Handle<v8::Value> Get(const v8::Arguments& args);
+  // process._setGCEvents(enabled)
+  static v8::Handle<v8::Value> SetEvents(const v8::Arguments& args);
+
+  // Number of collections recorded so far.
+  static double Collections();
+  // Mean pause, in milliseconds, of the given collector; 0 if it has not
+  // run yet.
+  static double AveragePause(v8::GCType type);
+
+  // Set while V8::IdleNotification() runs so that collections it triggers
+  // are marked as idle-time collections.
+  static bool in_idle_notification;
+  static double idle_notifications;
+};
+
+}  // namespace node
+
+#endif  // NODE_GC_STATS_H_
@@ -0,0 +1,97 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <node_handle_wrap.h>
+
+#include <assert.h>
+
+namespace node {
+
+using namespace v8;
+
+
+HandleWrap::HandleWrap(Handle<Object> object, uv_handle_t *handle)
+    : ObjectWrap(), uv_handle_(handle), closing_(false) {
+  Wrap(object);
+  // Released in AfterClose(); an open handle must not lose its object.
+  Ref();
+}
+
+
+HandleWrap::~HandleWrap() {
+  assert(closing_);
+}
+
+
+Handle<Value> HandleWrap::Close(const Arguments& args) {
+  HandleScope scope;
+  HandleWrap *wrap = ObjectWrap::Unwrap<HandleWrap>(args.Holder());
+
+  if (wrap->closing_) return Undefined();
+  wrap->closing_ = true;
+
+  // uv_close() leaves the reading flag set, which would let a read callback
+  // that closes its own stream go around for another read.
+  if (wrap->uv_handle_->type == UV_TCP) uv_read_stop(wrap->uv_handle_);
+
+  uv_close(wrap->uv_handle_);
+  return Undefined();
+}
+
+
+void HandleWrap::AfterClose(uv_handle_t *handle, int status) {
+  HandleWrap *wrap = static_cast<HandleWrap*>(handle->data);
+  assert(wrap->uv_handle_ == handle);
+
+  wrap->closing_ = true;
+  wrap->OnClose();
+  wrap->Unref();
+}
+
+
+void MakeCallback(Handle<Object> object,
+                  Handle<String> symbol,
+                  int argc,
+                  Handle<Value> argv[]) {
+  HandleScope scope;
+
+  Local<Value> callback_v = object->Get(symbol);
+  if (!callback_v->IsFunction()) return;
+
+  Local<Function> callback = Local<Function>::Cast(callback_v);
+
+  TryCatch try_catch;
+
+  callback->Call(object, argc, argv);
+
+  if (try_catch.HasCaught()) {
+    FatalException(try_catch);
+  }
+}
+
+
+Local<Value> UVException(const char *syscall) {
+  uv_err_t err = uv_last_error();
+  return ErrnoException(err.sys_errno_, syscall);
+}
+
+
+}  // namespace node
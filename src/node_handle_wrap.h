@@ -0,0 +1,76 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef NODE_HANDLE_WRAP_H_
+#define NODE_HANDLE_WRAP_H_
+
+#include <node.h>
+#include <node_object_wrap.h>
+#include <v8.h>
+#include <uv.h>
+
+namespace node {
+
+// Base class for the objects that process.binding('tcp_wrap') hands to
+// JavaScript. It owns one uv_handle_t and keeps its JS object alive until
+// libuv has finished closing the handle.
+//
+//   var handle = new TCP();
+//   handle.close();
+//
+class HandleWrap : public ObjectWrap {
+ public:
+  static v8::Handle<v8::Value> Close(const v8::Arguments& args);
+
+ protected:
+  HandleWrap(v8::Handle<v8::Object> object, uv_handle_t *handle);
+  virtual ~HandleWrap();
+
+  // Called once libuv is done with the handle, before the object is released.
+  virtual void OnClose() {}
+
+  // libuv closes a handle by itself after some errors; this records that so
+  // a later close() from JavaScript does not close it twice.
+  void SetClosing() { closing_ = true; }
+  bool IsClosing() const { return closing_; }
+
+  static void AfterClose(uv_handle_t *handle, int status);
+
+  uv_handle_t *uv_handle_;
+
+ private:
+  bool closing_;
+};
+
+
+// Calls object[symbol](argv...) from a libuv callback and reports exceptions
+// the same way the other watchers do.
+void MakeCallback(v8::Handle<v8::Object> object,
+                  v8::Handle<v8::String> symbol,
+                  int argc,
+                  v8::Handle<v8::Value> argv[]);
+
+// An exception for the last libuv error, shaped like ErrnoException().
+v8::Local<v8::Value> UVException(const char *syscall);
+
+}  // namespace node
+
+#endif  // NODE_HANDLE_WRAP_H_
@@ -0,0 +1,121 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <node_hex.h>
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
+namespace node {
+
+
+static const char hex_digits[] = "0123456789abcdef";
+
+static const int8_t unhex_table[256] =
+  {-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  , 0, 1, 2, 3, 4, 5, 6, 7, 8, 9,-1,-1,-1,-1,-1,-1
+  ,-1,10,11,12,13,14,15,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,10,11,12,13,14,15,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  ,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  };
+
+
+void EncodeHex(const char *src, size_t len, char *dst) {
+  const unsigned char *s = reinterpret_cast<const unsigned char*>(src);
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  // 16 bytes at a time: split into nibbles, interleave high and low nibble
+  // and map 0-9 to '0'-'9' and 10-15 to 'a'-'f' with a compare and add.
+  const __m128i low_mask = _mm_set1_epi8(0x0f);
+  const __m128i nine = _mm_set1_epi8(9);
+  const __m128i zero_char = _mm_set1_epi8('0');
+  const __m128i letter_gap = _mm_set1_epi8('a' - '0' - 10);
+
+  for (; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), low_mask);
+    __m128i lo = _mm_and_si128(v, low_mask);
+
+    __m128i a = _mm_unpacklo_epi8(hi, lo);
+    __m128i b = _mm_unpackhi_epi8(hi, lo);
+
+    a = _mm_add_epi8(_mm_add_epi8(a, zero_char),
+                     _mm_and_si128(_mm_cmpgt_epi8(a, nine), letter_gap));
+    b = _mm_add_epi8(_mm_add_epi8(b, zero_char),
+                     _mm_and_si128(_mm_cmpgt_epi8(b, nine), letter_gap));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i), a);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i + 16), b);
+  }
+#endif
+
+  for (; i < len; i++) {
+    dst[2 * i] = hex_digits[s[i] >> 4];
+    dst[2 * i + 1] = hex_digits[s[i] & 0x0f];
+  }
+}
+
+
+template <typename T>
+static inline int unhex(T c) {
+  return static_cast<unsigned>(c) < 256 ? unhex_table[c & 0xff] : -1;
+}
+
+
+template <typename T>
+static size_t DecodeHexImpl(const T *src, size_t len, char *dst) {
+  size_t n = len / 2;
+
+  for (size_t i = 0; i < n; i++) {
+    int hi = unhex(src[2 * i]);
+    int lo = unhex(src[2 * i + 1]);
+    if ((hi | lo) < 0) return i;
+    dst[i] = (hi << 4) | lo;
+  }
+
+  return n;
+}
+
+
+size_t DecodeHex(const char *src, size_t len, char *dst) {
+  return DecodeHexImpl(reinterpret_cast<const unsigned char*>(src), len, dst);
+}
+
+
+size_t DecodeHex(const uint16_t *src, size_t len, char *dst) {
+  return DecodeHexImpl(src, len, dst);
+}
+
+
+}  // namespace node
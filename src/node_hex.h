@@ -0,0 +1,42 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef NODE_HEX_H_
+#define NODE_HEX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace node {
+
+// Writes the lower case hex representation of len bytes of src to dst,
+// which must have room for 2 * len characters.
+void EncodeHex(const char *src, size_t len, char *dst);
+
+// Decodes len hex digits (upper or lower case) from src into dst, which
+// must have room for len / 2 bytes. Decoding stops at the first pair that
+// is not valid hex. Returns the number of bytes written.
+size_t DecodeHex(const char *src, size_t len, char *dst);
+size_t DecodeHex(const uint16_t *src, size_t len, char *dst);
+
+}  // namespace node
+
+#endif  // NODE_HEX_H_
@@ -0,0 +1,218 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <node_inotify.h>
+
+#ifdef HAVE_INOTIFY
+
+#include <node.h>
+#include <ev.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+
+#define WATCH_MASK (IN_ATTRIB | IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | \
+                    IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |            \
+                    IN_DELETE_SELF | IN_MOVE_SELF)
+
+#define WATCH_BUCKETS 256
+
+namespace node {
+
+struct InotifyListener {
+  Inotify::Callback cb;
+  void *data;
+  InotifyListener *next;
+};
+
+struct InotifyWatch {
+  int wd;
+  InotifyListener *listeners;
+  InotifyWatch *next;
+};
+
+static int inotify_fd = -1;
+static ev_io inotify_watcher;
+static InotifyWatch *watches[WATCH_BUCKETS];
+
+static char event_buf[64 * 1024]
+    __attribute__((aligned(__alignof__(struct inotify_event))));
+
+
+static InotifyWatch **FindWatch(int wd) {
+  InotifyWatch **link = &watches[(unsigned)wd % WATCH_BUCKETS];
+  while (*link && (*link)->wd != wd) link = &(*link)->next;
+  return link;
+}
+
+
+static void FreeWatch(InotifyWatch **link) {
+  InotifyWatch *w = *link;
+  *link = w->next;
+
+  while (w->listeners) {
+    InotifyListener *l = w->listeners;
+    w->listeners = l->next;
+    delete l;
+  }
+  delete w;
+}
+
+
+static void Dispatch(InotifyWatch *w, uint32_t mask, const char *name) {
+  for (InotifyListener *l = w->listeners; l; l = l->next) {
+    l->cb(l->data, w->wd, mask, name);
+  }
+}
+
+
+static void OnReadable(EV_P_ ev_io *watcher, int revents) {
+  assert(watcher == &inotify_watcher);
+  assert(revents == EV_READ);
+
+  for (;;) {
+    ssize_t n = read(inotify_fd, event_buf, sizeof event_buf);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return;  // EAGAIN
+    }
+    if (n == 0) return;
+
+    for (char *p = event_buf; p < event_buf + n; ) {
+      struct inotify_event *e = reinterpret_cast<struct inotify_event*>(p);
+      p += sizeof *e + e->len;
+
+      if (e->mask & IN_Q_OVERFLOW) {
+        for (int i = 0; i < WATCH_BUCKETS; i++) {
+          for (InotifyWatch *w = watches[i]; w; w = w->next) {
+            Dispatch(w, IN_Q_OVERFLOW, NULL);
+          }
+        }
+        continue;
+      }
+
+      InotifyWatch **link = FindWatch(e->wd);
+      if (!*link) continue;
+
+      Dispatch(*link, e->mask, e->len > 0 ? e->name : NULL);
+
+      if (e->mask & IN_IGNORED) FreeWatch(link);
+    }
+  }
+}
+
+
+static bool Init() {
+  if (inotify_fd >= 0) return true;
+
+  int fd = inotify_init();
+  if (fd < 0) return false;
+
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  inotify_fd = fd;
+
+  ev_io_init(&inotify_watcher, OnReadable, fd, EV_READ);
+  ev_io_start(EV_DEFAULT_UC_ &inotify_watcher);
+  ev_unref(EV_DEFAULT_UC);
+
+  return true;
+}
+
+
+int Inotify::Watch(const char *path, bool follow, Callback cb, void *data) {
+  if (!Init()) return -1;
+
+  uint32_t mask = WATCH_MASK | (follow ? 0 : IN_DONT_FOLLOW);
+  int wd = inotify_add_watch(inotify_fd, path, mask);
+  if (wd < 0) return -1;
+
+  InotifyWatch **link = FindWatch(wd);
+  if (!*link) {
+    InotifyWatch *w = new InotifyWatch;
+    w->wd = wd;
+    w->listeners = NULL;
+    w->next = NULL;
+    *link = w;
+  }
+
+  InotifyListener *l = new InotifyListener;
+  l->cb = cb;
+  l->data = data;
+  l->next = (*link)->listeners;
+  (*link)->listeners = l;
+
+  return wd;
+}
+
+
+void Inotify::Unwatch(int wd, Callback cb, void *data) {
+  if (wd < 0) return;
+
+  InotifyWatch **link = FindWatch(wd);
+  if (!*link) return;
+
+  InotifyListener **l = &(*link)->listeners;
+  while (*l && ((*l)->cb != cb || (*l)->data != data)) l = &(*l)->next;
+  if (!*l) return;
+
+  InotifyListener *found = *l;
+  *l = found->next;
+  delete found;
+
+  if ((*link)->listeners == NULL) {
+    inotify_rm_watch(inotify_fd, wd);
+    FreeWatch(link);
+  }
+}
+
+
+bool Inotify::Supported(const char *path) {
+  struct statfs sfs;
+  if (statfs(path, &sfs) < 0) return true;
+
+  switch ((unsigned long)sfs.f_type) {
+    case 0x6969:      // nfs
+    case 0x517b:      // smb
+    case 0xff534d42:  // cifs
+    case 0xfe534d42:  // smb2
+    case 0x65735546:  // fuse
+    case 0x73757245:  // coda
+    case 0x5346414f:  // afs
+    case 0x01021997:  // 9p
+    case 0x564c:      // ncp
+    case 0x00c36400:  // ceph
+    case 0x01161970:  // gfs2
+    case 0x7461636f:  // ocfs2
+      return false;
+    default:
+      return true;
+  }
+}
+
+
+}  // namespace node
+
+#endif  // HAVE_INOTIFY
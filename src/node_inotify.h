@@ -0,0 +1,66 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef NODE_INOTIFY_H_
+#define NODE_INOTIFY_H_
+
+#ifdef __linux__
+# define HAVE_INOTIFY 1
+#endif
+
+#ifdef HAVE_INOTIFY
+
+#include <stdint.h>
+#include <sys/inotify.h>
+
+namespace node {
+
+// All file watches share one inotify descriptor, read from one unref'd
+// ev_io. The kernel hands out a single watch descriptor per inode, so every
+// listener interested in the same file or directory is attached to the same
+// entry and the watch is removed when the last one leaves.
+//
+// Listeners are called with the raw event mask and, for events on the
+// entries of a watched directory, the entry's name. IN_IGNORED means the
+// kernel dropped the watch (the inode is gone): the listener must forget
+// the wd without calling Unwatch(). IN_Q_OVERFLOW is delivered to every
+// listener with a wd of -1. Listeners must not call Watch() or Unwatch()
+// from the callback; they are expected to record the event and act on it
+// later, e.g. from a timer.
+class Inotify {
+ public:
+  typedef void (*Callback)(void *data, int wd, uint32_t mask,
+                           const char *name);
+
+  // Returns the watch descriptor, or -1 with errno set.
+  static int Watch(const char *path, bool follow, Callback cb, void *data);
+  static void Unwatch(int wd, Callback cb, void *data);
+
+  // False for network and FUSE filesystems, where changes made elsewhere
+  // are not reported and the caller should poll instead.
+  static bool Supported(const char *path);
+};
+
+}  // namespace node
+
+#endif  // HAVE_INOTIFY
+
+#endif  // NODE_INOTIFY_H_
@@ -0,0 +1,379 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <node_loop_stats.h>
+
+#include <v8.h>
+#include <ev.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// Bucket i counts values in [2^(i-1), 2^i); bucket 0 counts values below 1.
+// Times are recorded in microseconds, so the last bucket starts at ~18
+// minutes.
+#define BUCKETS 32
+
+namespace node {
+
+using namespace v8;
+
+struct Histogram {
+  double count;
+  double sum;
+  double max;
+  double buckets[BUCKETS];
+};
+
+struct Metrics {
+  double iterations;
+  Histogram busy;       // us from poll returning to the next poll
+  Histogram wait;       // us spent in poll
+  Histogram lateness;   // us between a timer's due time and its callback
+  Histogram depth;      // nextTick callbacks run per tick
+};
+
+// `total` is what process.loopStats() reports; `window` is reset every time
+// it is dumped.
+static Metrics total;
+static Metrics window;
+
+static ev_tstamp block_start;
+static ev_tstamp last_wake;
+
+static ev_timer dump_timer;
+static int dump_fd = -1;
+static int dump_fd_flags = -1;    // to restore, if we set O_NONBLOCK
+static double dump_dropped;       // lines lost since the last one written
+
+// The rest of a line that the fd only took part of. It goes out before the
+// next line so that a reader never sees a torn one.
+static char dump_pending[1024];
+static size_t dump_pending_len;
+
+static Persistent<String> iterations_symbol;
+static Persistent<String> utilization_symbol;
+static Persistent<String> busy_symbol;
+static Persistent<String> wait_symbol;
+static Persistent<String> lateness_symbol;
+static Persistent<String> depth_symbol;
+static Persistent<String> count_symbol;
+static Persistent<String> mean_symbol;
+static Persistent<String> max_symbol;
+static Persistent<String> p50_symbol;
+static Persistent<String> p90_symbol;
+static Persistent<String> p99_symbol;
+static Persistent<String> buckets_symbol;
+
+
+static inline void Add(Histogram *h, double value) {
+  if (value < 0) value = 0;
+
+  int bucket = 0;
+  if (value >= 1) {
+    frexp(value, &bucket);
+    if (bucket >= BUCKETS) bucket = BUCKETS - 1;
+  }
+
+  h->count++;
+  h->sum += value;
+  if (value > h->max) h->max = value;
+  h->buckets[bucket]++;
+}
+
+
+static inline void Record(Histogram Metrics::*h, double value) {
+  Add(&(total.*h), value);
+  Add(&(window.*h), value);
+}
+
+
+// Upper bound of the bucket holding the p-th quantile, capped at the
+// largest value seen.
+static double Quantile(const Histogram *h, double p) {
+  if (h->count == 0) return 0;
+
+  double target = h->count * p;
+  double seen = 0;
+
+  for (int i = 0; i < BUCKETS; i++) {
+    seen += h->buckets[i];
+    if (seen >= target) {
+      double bound = ldexp(1, i);
+      return bound < h->max ? bound : h->max;
+    }
+  }
+
+  return h->max;
+}
+
+
+static inline double Utilization(const Metrics *m) {
+  double t = m->busy.sum + m->wait.sum;
+  return t > 0 ? m->busy.sum / t : 0;
+}
+
+
+void LoopStats::BeforePoll() {
+  block_start = ev_time();
+  if (last_wake > 0) {
+    Record(&Metrics::busy, (block_start - last_wake) * 1e6);
+  }
+}
+
+
+void LoopStats::AfterPoll() {
+  last_wake = ev_now(EV_DEFAULT_UC);
+  total.iterations++;
+  window.iterations++;
+  if (block_start > 0) {
+    Record(&Metrics::wait, (last_wake - block_start) * 1e6);
+  }
+}
+
+
+void LoopStats::RecordTimerLateness(ev_tstamp seconds) {
+  Record(&Metrics::lateness, seconds * 1e6);
+}
+
+
+void LoopStats::RecordTickDepth(double callbacks) {
+  Record(&Metrics::depth, callbacks);
+}
+
+
+static Local<Object> HistogramToObject(const Histogram *h, double scale) {
+  HandleScope scope;
+
+  Local<Array> buckets = Array::New(BUCKETS);
+  for (int i = 0; i < BUCKETS; i++) {
+    buckets->Set(Integer::New(i), Number::New(h->buckets[i]));
+  }
+
+  Local<Object> obj = Object::New();
+  obj->Set(count_symbol, Number::New(h->count));
+  obj->Set(mean_symbol,
+           Number::New(h->count > 0 ? h->sum / h->count * scale : 0));
+  obj->Set(max_symbol, Number::New(h->max * scale));
+  obj->Set(p50_symbol, Number::New(Quantile(h, 0.5) * scale));
+  obj->Set(p90_symbol, Number::New(Quantile(h, 0.9) * scale));
+  obj->Set(p99_symbol, Number::New(Quantile(h, 0.99) * scale));
+  obj->Set(buckets_symbol, buckets);
+
+  return scope.Close(obj);
+}
+
+
+Handle<Value> LoopStats::Get(const Arguments& args) {
+  HandleScope scope;
+
+  Local<Object> result = Object::New();
+  result->Set(iterations_symbol, Number::New(total.iterations));
+  result->Set(utilization_symbol, Number::New(Utilization(&total)));
+  result->Set(busy_symbol, HistogramToObject(&total.busy, 1e-3));
+  result->Set(wait_symbol, HistogramToObject(&total.wait, 1e-3));
+  result->Set(lateness_symbol, HistogramToObject(&total.lateness, 1e-3));
+  result->Set(depth_symbol, HistogramToObject(&total.depth, 1));
+
+  if (args[0]->IsTrue()) {
+    memset(&total, 0, sizeof total);
+  }
+
+  return scope.Close(result);
+}
+
+
+static int FormatHistogram(char *buf, size_t len, const char *name,
+                           const Histogram *h, double scale) {
+  return snprintf(buf, len,
+                  ",\"%s\":{\"count\":%.0f,\"mean\":%.3f,\"p50\":%.3f,"
+                  "\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f}",
+                  name,
+                  h->count,
+                  h->count > 0 ? h->sum / h->count * scale : 0,
+                  Quantile(h, 0.5) * scale,
+                  Quantile(h, 0.9) * scale,
+                  Quantile(h, 0.99) * scale,
+                  h->max * scale);
+}
+
+
+// Writes as much of buf to dump_fd as it takes without blocking.
+static size_t WriteSome(const char *buf, size_t len) {
+  size_t written = 0;
+  while (written < len) {
+    ssize_t n = write(dump_fd, buf + written, len - written);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    written += n;
+  }
+  return written;
+}
+
+
+// Writes the metrics gathered since the last dump to dump_fd as one line of
+// JSON, then starts a new window.
+static void DumpWindow(EV_P_ ev_timer *watcher, int revents) {
+  assert(watcher == &dump_timer);
+  assert(revents == EV_TIMEOUT);
+
+  char line[sizeof dump_pending];
+  size_t len = 0;
+  int r;
+
+#define APPEND(call)                                            \
+  r = call;                                                     \
+  if (r < 0 || (size_t)r >= sizeof line - len) goto reset;      \
+  len += r;
+
+  APPEND(snprintf(line, sizeof line,
+                  "{\"time\":%.0f,\"iterations\":%.0f,\"utilization\":%.4f"
+                  ",\"dropped\":%.0f",
+                  ev_now(EV_A) * 1000, window.iterations,
+                  Utilization(&window), dump_dropped))
+  APPEND(FormatHistogram(line + len, sizeof line - len, "busy",
+                         &window.busy, 1e-3))
+  APPEND(FormatHistogram(line + len, sizeof line - len, "wait",
+                         &window.wait, 1e-3))
+  APPEND(FormatHistogram(line + len, sizeof line - len, "timerLateness",
+                         &window.lateness, 1e-3))
+  APPEND(FormatHistogram(line + len, sizeof line - len, "tickDepth",
+                         &window.depth, 1))
+  APPEND(snprintf(line + len, sizeof line - len, "}\n"))
+
+#undef APPEND
+
+  {
+    // A reader that cannot keep up loses whole lines rather than stalling
+    // the loop. Pipes take lines this short all at once or not at all; what
+    // a socket leaves of one is finished before anything else is written.
+    if (dump_pending_len > 0) {
+      size_t n = WriteSome(dump_pending, dump_pending_len);
+      dump_pending_len -= n;
+      memmove(dump_pending, dump_pending + n, dump_pending_len);
+      if (dump_pending_len > 0) {
+        dump_dropped++;
+        goto reset;
+      }
+    }
+
+    size_t n = WriteSome(line, len);
+    if (n == 0) {
+      dump_dropped++;
+    } else {
+      dump_dropped = 0;
+      dump_pending_len = len - n;
+      memcpy(dump_pending, line + n, dump_pending_len);
+    }
+  }
+
+reset:
+  memset(&window, 0, sizeof window);
+}
+
+
+Handle<Value> LoopStats::Dump(const Arguments& args) {
+  HandleScope scope;
+
+  if (ev_is_active(&dump_timer)) {
+    ev_ref(EV_DEFAULT_UC);
+    ev_timer_stop(EV_DEFAULT_UC_ &dump_timer);
+  }
+#ifdef __POSIX__
+  if (dump_fd >= 0 && dump_fd_flags >= 0) {
+    fcntl(dump_fd, F_SETFL, dump_fd_flags);
+  }
+#endif
+  dump_fd = -1;
+  dump_fd_flags = -1;
+  dump_dropped = 0;
+  dump_pending_len = 0;
+
+  if (args.Length() == 0 || args[0]->IsNull() || args[0]->IsUndefined()) {
+    return Undefined();
+  }
+
+  if (!args[0]->IsInt32() || args[0]->Int32Value() < 0) {
+    return ThrowException(Exception::TypeError(
+          String::New("Bad argument: fd must be a file descriptor")));
+  }
+
+  double interval = args[1]->IsNumber() ? args[1]->NumberValue() : 1000;
+  if (!(interval > 0)) {
+    return ThrowException(Exception::TypeError(
+          String::New("Bad argument: interval must be positive")));
+  }
+
+  dump_fd = args[0]->Int32Value();
+  memset(&window, 0, sizeof window);
+
+#ifdef __POSIX__
+  // The flag belongs to the open file, which may be shared with e.g. stdout,
+  // so it is put back when dumping stops.
+  int flags = fcntl(dump_fd, F_GETFL);
+  if (flags < 0) {
+    int err = errno;
+    dump_fd = -1;
+    return ThrowException(ErrnoException(err, "fcntl"));
+  }
+  if (!(flags & O_NONBLOCK)) {
+    fcntl(dump_fd, F_SETFL, flags | O_NONBLOCK);
+    dump_fd_flags = flags;
+  }
+#endif
+
+  ev_timer_set(&dump_timer, interval / 1000, interval / 1000);
+  ev_timer_start(EV_DEFAULT_UC_ &dump_timer);
+  ev_unref(EV_DEFAULT_UC);
+
+  return Undefined();
+}
+
+
+void LoopStats::Initialize() {
+  HandleScope scope;
+
+  iterations_symbol = NODE_PSYMBOL("iterations");
+  utilization_symbol = NODE_PSYMBOL("utilization");
+  busy_symbol = NODE_PSYMBOL("busy");
+  wait_symbol = NODE_PSYMBOL("wait");
+  lateness_symbol = NODE_PSYMBOL("timerLateness");
+  depth_symbol = NODE_PSYMBOL("tickDepth");
+  count_symbol = NODE_PSYMBOL("count");
+  mean_symbol = NODE_PSYMBOL("mean");
+  max_symbol = NODE_PSYMBOL("max");
+  p50_symbol = NODE_PSYMBOL("p50");
+  p90_symbol = NODE_PSYMBOL("p90");
+  p99_symbol = NODE_PSYMBOL("p99");
+  buckets_symbol = NODE_PSYMBOL("buckets");
+
+  ev_timer_init(&dump_timer, DumpWindow, 1., 1.);
+}
+
+
+}  // namespace node
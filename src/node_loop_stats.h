@@ -0,0 +1,54 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef NODE_LOOP_STATS_H_
+#define NODE_LOOP_STATS_H_
+
+#include <node.h>
+#include <v8.h>
+#include <ev.h>
+
+namespace node {
+
+// Per-iteration event loop metrics: time spent running callbacks, time spent
+// waiting in poll, how late timers fire and how many nextTick callbacks each
+// tick runs. Everything is recorded on the loop thread into fixed
+// histograms, so recording never allocates or locks.
+class LoopStats {
+ public:
+  static void Initialize();
+
+  // Bracket the poll: called when the prepare and check tick watchers run.
+  static void BeforePoll();
+  static void AfterPoll();
+
+  static void RecordTimerLateness(ev_tstamp seconds);
+  static void RecordTickDepth(double callbacks);
+
+  // process.loopStats([reset])
+  static v8::Handle<v8::Value> Get(const v8::Arguments& args);
+  // process.dumpLoopStats([fd, interval])
+  static v8::Handle<v8::Value> Dump(const v8::Arguments& args);
+};
+
+}  // namespace node
+
+#endif  // NODE_LOOP_STATS_H_
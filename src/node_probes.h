@@ -0,0 +1,152 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef NODE_PROBES_H_
+#define NODE_PROBES_H_
+
+// The probe points of the "node" provider defined in node_provider.d.
+//
+// With DTrace the macros come from the header dtrace generates. On Linux,
+// --with-dtrace builds SystemTap compatible USDT probes from <sys/sdt.h>
+// instead; they can be listed and attached to with stap, perf or bpftrace:
+//
+//   stap -L 'process("/usr/local/bin/node").mark("*")'
+//   bpftrace -l 'usdt:/usr/local/bin/node:*'
+//
+// Every probe has a semaphore that the tracer increments while it is
+// attached, so NODE_*_ENABLED() is a single load and branch; callers check it
+// before collecting the probe arguments. Without either the probes compile
+// to nothing.
+
+#if defined(HAVE_DTRACE)
+
+#include "node_provider.h"
+
+#elif defined(HAVE_SYSTEMTAP)
+
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#define NODE_PROBE_SEMAPHORE(name) node_##name##_semaphore
+#define NODE_PROBE_ENABLED(name) \
+  __builtin_expect(NODE_PROBE_SEMAPHORE(name), 0)
+
+extern "C" {
+extern unsigned short NODE_PROBE_SEMAPHORE(net__server__connection);
+extern unsigned short NODE_PROBE_SEMAPHORE(net__stream__end);
+extern unsigned short NODE_PROBE_SEMAPHORE(net__socket__read);
+extern unsigned short NODE_PROBE_SEMAPHORE(net__socket__write);
+extern unsigned short NODE_PROBE_SEMAPHORE(http__server__request);
+extern unsigned short NODE_PROBE_SEMAPHORE(http__server__response);
+extern unsigned short NODE_PROBE_SEMAPHORE(http__client__request);
+extern unsigned short NODE_PROBE_SEMAPHORE(http__client__response);
+extern unsigned short NODE_PROBE_SEMAPHORE(gc__start);
+extern unsigned short NODE_PROBE_SEMAPHORE(gc__done);
+extern unsigned short NODE_PROBE_SEMAPHORE(fs__request__start);
+extern unsigned short NODE_PROBE_SEMAPHORE(fs__request__done);
+extern unsigned short NODE_PROBE_SEMAPHORE(dns__query__start);
+extern unsigned short NODE_PROBE_SEMAPHORE(dns__query__done);
+extern unsigned short NODE_PROBE_SEMAPHORE(timer__fire);
+}
+
+#define NODE_NET_SERVER_CONNECTION(arg0) \
+  STAP_PROBE1(node, net__server__connection, arg0)
+#define NODE_NET_SERVER_CONNECTION_ENABLED() \
+  NODE_PROBE_ENABLED(net__server__connection)
+#define NODE_NET_STREAM_END(arg0) STAP_PROBE1(node, net__stream__end, arg0)
+#define NODE_NET_STREAM_END_ENABLED() NODE_PROBE_ENABLED(net__stream__end)
+#define NODE_NET_SOCKET_READ(arg0, arg1) \
+  STAP_PROBE2(node, net__socket__read, arg0, arg1)
+#define NODE_NET_SOCKET_READ_ENABLED() NODE_PROBE_ENABLED(net__socket__read)
+#define NODE_NET_SOCKET_WRITE(arg0, arg1) \
+  STAP_PROBE2(node, net__socket__write, arg0, arg1)
+#define NODE_NET_SOCKET_WRITE_ENABLED() NODE_PROBE_ENABLED(net__socket__write)
+#define NODE_HTTP_SERVER_REQUEST(arg0, arg1) \
+  STAP_PROBE2(node, http__server__request, arg0, arg1)
+#define NODE_HTTP_SERVER_REQUEST_ENABLED() \
+  NODE_PROBE_ENABLED(http__server__request)
+#define NODE_HTTP_SERVER_RESPONSE(arg0) \
+  STAP_PROBE1(node, http__server__response, arg0)
+#define NODE_HTTP_SERVER_RESPONSE_ENABLED() \
+  NODE_PROBE_ENABLED(http__server__response)
+#define NODE_HTTP_CLIENT_REQUEST(arg0, arg1) \
+  STAP_PROBE2(node, http__client__request, arg0, arg1)
+#define NODE_HTTP_CLIENT_REQUEST_ENABLED() \
+  NODE_PROBE_ENABLED(http__client__request)
+#define NODE_HTTP_CLIENT_RESPONSE(arg0) \
+  STAP_PROBE1(node, http__client__response, arg0)
+#define NODE_HTTP_CLIENT_RESPONSE_ENABLED() \
+  NODE_PROBE_ENABLED(http__client__response)
+#define NODE_GC_START(arg0, arg1) STAP_PROBE2(node, gc__start, arg0, arg1)
+#define NODE_GC_START_ENABLED() NODE_PROBE_ENABLED(gc__start)
+#define NODE_GC_DONE(arg0, arg1) STAP_PROBE2(node, gc__done, arg0, arg1)
+#define NODE_GC_DONE_ENABLED() NODE_PROBE_ENABLED(gc__done)
+#define NODE_FS_REQUEST_START(arg0, arg1, arg2) \
+  STAP_PROBE3(node, fs__request__start, arg0, arg1, arg2)
+#define NODE_FS_REQUEST_START_ENABLED() NODE_PROBE_ENABLED(fs__request__start)
+#define NODE_FS_REQUEST_DONE(arg0, arg1, arg2) \
+  STAP_PROBE3(node, fs__request__done, arg0, arg1, arg2)
+#define NODE_FS_REQUEST_DONE_ENABLED() NODE_PROBE_ENABLED(fs__request__done)
+#define NODE_DNS_QUERY_START(arg0, arg1, arg2) \
+  STAP_PROBE3(node, dns__query__start, arg0, arg1, arg2)
+#define NODE_DNS_QUERY_START_ENABLED() NODE_PROBE_ENABLED(dns__query__start)
+#define NODE_DNS_QUERY_DONE(arg0, arg1) \
+  STAP_PROBE2(node, dns__query__done, arg0, arg1)
+#define NODE_DNS_QUERY_DONE_ENABLED() NODE_PROBE_ENABLED(dns__query__done)
+#define NODE_TIMER_FIRE(arg0, arg1) STAP_PROBE2(node, timer__fire, arg0, arg1)
+#define NODE_TIMER_FIRE_ENABLED() NODE_PROBE_ENABLED(timer__fire)
+
+#else
+
+#define NODE_NET_SERVER_CONNECTION(arg0)
+#define NODE_NET_SERVER_CONNECTION_ENABLED() (0)
+#define NODE_NET_STREAM_END(arg0)
+#define NODE_NET_STREAM_END_ENABLED() (0)
+#define NODE_NET_SOCKET_READ(arg0, arg1)
+#define NODE_NET_SOCKET_READ_ENABLED() (0)
+#define NODE_NET_SOCKET_WRITE(arg0, arg1)
+#define NODE_NET_SOCKET_WRITE_ENABLED() (0)
+#define NODE_HTTP_SERVER_REQUEST(arg0, arg1)
+#define NODE_HTTP_SERVER_REQUEST_ENABLED() (0)
+#define NODE_HTTP_SERVER_RESPONSE(arg0)
+#define NODE_HTTP_SERVER_RESPONSE_ENABLED() (0)
+#define NODE_HTTP_CLIENT_REQUEST(arg0, arg1)
+#define NODE_HTTP_CLIENT_REQUEST_ENABLED() (0)
+#define NODE_HTTP_CLIENT_RESPONSE(arg0)
+#define NODE_HTTP_CLIENT_RESPONSE_ENABLED() (0)
+#define NODE_GC_START(arg0, arg1)
+#define NODE_GC_START_ENABLED() (0)
+#define NODE_GC_DONE(arg0, arg1)
+#define NODE_GC_DONE_ENABLED() (0)
+#define NODE_FS_REQUEST_START(arg0, arg1, arg2)
+#define NODE_FS_REQUEST_START_ENABLED() (0)
+#define NODE_FS_REQUEST_DONE(arg0, arg1, arg2)
+#define NODE_FS_REQUEST_DONE_ENABLED() (0)
+#define NODE_DNS_QUERY_START(arg0, arg1, arg2)
+#define NODE_DNS_QUERY_START_ENABLED() (0)
+#define NODE_DNS_QUERY_DONE(arg0, arg1)
+#define NODE_DNS_QUERY_DONE_ENABLED() (0)
+#define NODE_TIMER_FIRE(arg0, arg1)
+#define NODE_TIMER_FIRE_ENABLED() (0)
+
+#endif
+
+#endif  // NODE_PROBES_H_
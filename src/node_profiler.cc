@@ -0,0 +1,409 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <node_profiler.h>
+
+#include <v8.h>
+#include <v8-profiler.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef __POSIX__
+# include <unistd.h>
+# include <poll.h>
+#endif
+
+namespace node {
+
+using namespace v8;
+
+static Persistent<String> title_symbol;
+static Persistent<String> uid_symbol;
+static Persistent<String> head_symbol;
+static Persistent<String> function_name_symbol;
+static Persistent<String> url_symbol;
+static Persistent<String> line_number_symbol;
+static Persistent<String> call_uid_symbol;
+static Persistent<String> self_samples_symbol;
+static Persistent<String> total_samples_symbol;
+static Persistent<String> children_symbol;
+static Persistent<String> collapsed_symbol;
+static Persistent<String> bytes_symbol;
+static Persistent<String> name_symbol;
+static Persistent<String> count_symbol;
+static Persistent<String> size_symbol;
+static Persistent<String> total_heap_size_symbol;
+static Persistent<String> total_heap_size_executable_symbol;
+static Persistent<String> used_heap_size_symbol;
+static Persistent<String> heap_size_limit_symbol;
+
+
+static Local<Object> NodeToObject(const CpuProfileNode *node) {
+  HandleScope scope;
+
+  Local<Object> obj = Object::New();
+  obj->Set(function_name_symbol, node->GetFunctionName());
+  obj->Set(url_symbol, node->GetScriptResourceName());
+  obj->Set(line_number_symbol, Integer::New(node->GetLineNumber()));
+  obj->Set(call_uid_symbol, Integer::NewFromUnsigned(node->GetCallUid()));
+  obj->Set(self_samples_symbol, Number::New(node->GetSelfSamplesCount()));
+  obj->Set(total_samples_symbol, Number::New(node->GetTotalSamplesCount()));
+
+  int count = node->GetChildrenCount();
+  Local<Array> children = Array::New(count);
+  for (int i = 0; i < count; i++) {
+    children->Set(Integer::New(i), NodeToObject(node->GetChild(i)));
+  }
+  obj->Set(children_symbol, children);
+
+  return scope.Close(obj);
+}
+
+
+// Growable output buffer for the collapsed stack format.
+struct Output {
+  char *data;
+  size_t length;
+  size_t capacity;
+};
+
+
+static void Append(Output *out, const char *s, size_t len) {
+  if (out->length + len > out->capacity) {
+    size_t capacity = out->capacity ? out->capacity : 4096;
+    while (capacity < out->length + len) capacity *= 2;
+    out->data = static_cast<char*>(realloc(out->data, capacity));
+    out->capacity = capacity;
+  }
+  memcpy(out->data + out->length, s, len);
+  out->length += len;
+}
+
+
+// Appends "name file:line" for one frame. ';' separates frames in the
+// collapsed format, so it is replaced in names.
+static void AppendFrame(Output *out, const CpuProfileNode *node) {
+  String::Utf8Value name(node->GetFunctionName());
+  String::Utf8Value url(node->GetScriptResourceName());
+
+  size_t start = out->length;
+  if (name.length() > 0) {
+    Append(out, *name, name.length());
+  } else {
+    Append(out, "(anonymous)", sizeof("(anonymous)") - 1);
+  }
+
+  if (url.length() > 0) {
+    char line[32];
+    int n = snprintf(line, sizeof(line), ":%d", node->GetLineNumber());
+    Append(out, " ", 1);
+    Append(out, *url, url.length());
+    Append(out, line, n);
+  }
+
+  for (size_t i = start; i < out->length; i++) {
+    if (out->data[i] == ';') out->data[i] = ':';
+  }
+}
+
+
+// Writes one "frame;frame;frame samples" line for every node with self
+// samples. `stack` holds the frames of the path leading to `node`.
+static void Collapse(Output *out, Output *stack, const CpuProfileNode *node) {
+  size_t mark = stack->length;
+
+  if (stack->length > 0) Append(stack, ";", 1);
+  AppendFrame(stack, node);
+
+  double samples = node->GetSelfSamplesCount();
+  if (samples > 0) {
+    char count[32];
+    int n = snprintf(count, sizeof(count), " %.0f\n", samples);
+    Append(out, stack->data, stack->length);
+    Append(out, count, n);
+  }
+
+  int children = node->GetChildrenCount();
+  for (int i = 0; i < children; i++) {
+    Collapse(out, stack, node->GetChild(i));
+  }
+
+  stack->length = mark;
+}
+
+
+static Local<String> ProfileToCollapsed(const CpuProfile *profile) {
+  HandleScope scope;
+
+  Output out = { NULL, 0, 0 };
+  Output stack = { NULL, 0, 0 };
+
+  // The root node is a synthetic "(root)" entry; start below it.
+  const CpuProfileNode *root = profile->GetTopDownRoot();
+  int children = root->GetChildrenCount();
+  for (int i = 0; i < children; i++) {
+    Collapse(&out, &stack, root->GetChild(i));
+  }
+
+  Local<String> result = String::New(out.data ? out.data : "", out.length);
+  free(out.data);
+  free(stack.data);
+
+  return scope.Close(result);
+}
+
+
+// profiler.startProfiling([title])
+static Handle<Value> StartProfiling(const Arguments& args) {
+  HandleScope scope;
+
+  Local<String> title = args[0]->IsUndefined() ? String::Empty()
+                                               : args[0]->ToString();
+  CpuProfiler::StartProfiling(title);
+
+  return Undefined();
+}
+
+
+// profiler.stopProfiling([title], [format])
+//
+// Returns the profile as { title, uid, head } where head is the top-down
+// call tree, or, with format 'collapsed', as a string with one
+// "frame;frame;frame samples" line per stack. Returns undefined when no
+// profile with that title is running.
+static Handle<Value> StopProfiling(const Arguments& args) {
+  HandleScope scope;
+
+  Local<String> title = args[0]->IsUndefined() ? String::Empty()
+                                               : args[0]->ToString();
+  const CpuProfile *profile = CpuProfiler::StopProfiling(title);
+  if (profile == NULL) return Undefined();
+
+  if (args[1]->IsString() && args[1]->ToString()->Equals(collapsed_symbol)) {
+    return scope.Close(ProfileToCollapsed(profile));
+  }
+
+  Local<Object> result = Object::New();
+  result->Set(title_symbol, profile->GetTitle());
+  result->Set(uid_symbol, Integer::NewFromUnsigned(profile->GetUid()));
+  result->Set(head_symbol, NodeToObject(profile->GetTopDownRoot()));
+
+  return scope.Close(result);
+}
+
+
+static Handle<Value> GetProfilesCount(const Arguments& args) {
+  HandleScope scope;
+  return scope.Close(Integer::New(CpuProfiler::GetProfilesCount()));
+}
+
+
+// V8 has no way to delete a heap snapshot; every one taken, including the
+// aggregated ones behind countObjects(), stays in memory for good.
+static Handle<Value> GetSnapshotsCount(const Arguments& args) {
+  HandleScope scope;
+  return scope.Close(Integer::New(HeapProfiler::GetSnapshotsCount()));
+}
+
+
+#ifdef __POSIX__
+// Streams a serialized heap snapshot to a file descriptor one chunk at a
+// time, so the only extra memory is V8's chunk buffer. Non-blocking
+// descriptors are waited on with poll().
+class FdOutputStream : public OutputStream {
+ public:
+  explicit FdOutputStream(int fd) : fd_(fd), errno_(0), bytes_(0) {}
+
+  void EndOfStream() {}
+
+  int GetChunkSize() { return 64 * 1024; }
+
+  WriteResult WriteAsciiChunk(char *data, int size) {
+    while (size > 0) {
+      ssize_t n = write(fd_, data, size);
+      if (n < 0) {
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          struct pollfd pfd = { fd_, POLLOUT, 0 };
+          poll(&pfd, 1, -1);
+          continue;
+        }
+        errno_ = errno;
+        return kAbort;
+      }
+      data += n;
+      size -= n;
+      bytes_ += n;
+    }
+    return kContinue;
+  }
+
+  int error() const { return errno_; }
+  double bytes() const { return bytes_; }
+
+ private:
+  int fd_;
+  int errno_;
+  double bytes_;
+};
+
+
+// profiler.takeSnapshot(fd, [title])
+//
+// Takes a full heap snapshot and writes it to `fd` in V8's JSON snapshot
+// format, the one the Chrome developer tools load. Returns
+// { title, uid, bytes }.
+static Handle<Value> TakeSnapshot(const Arguments& args) {
+  HandleScope scope;
+
+  if (!args[0]->IsInt32()) {
+    return ThrowException(Exception::TypeError(
+          String::New("First argument must be a file descriptor")));
+  }
+
+  int fd = args[0]->Int32Value();
+  Local<String> title = args[1]->IsUndefined() ? String::Empty()
+                                               : args[1]->ToString();
+
+  const HeapSnapshot *snapshot = HeapProfiler::TakeSnapshot(title);
+
+  FdOutputStream stream(fd);
+  snapshot->Serialize(&stream, HeapSnapshot::kJSON);
+
+  if (stream.error()) {
+    return ThrowException(ErrnoException(stream.error(), "write"));
+  }
+
+  Local<Object> result = Object::New();
+  result->Set(title_symbol, snapshot->GetTitle());
+  result->Set(uid_symbol, Integer::NewFromUnsigned(snapshot->GetUid()));
+  result->Set(bytes_symbol, Number::New(stream.bytes()));
+
+  return scope.Close(result);
+}
+#endif  // __POSIX__
+
+
+// profiler.countObjects()
+//
+// Returns [{ name, count, size }, ...]: the number of live objects and
+// their shallow size in bytes, grouped by constructor name.
+static Handle<Value> CountObjects(const Arguments& args) {
+  HandleScope scope;
+
+  const HeapSnapshot *snapshot =
+      HeapProfiler::TakeSnapshot(String::Empty(), HeapSnapshot::kAggregated);
+  const HeapGraphNode *root = snapshot->GetRoot();
+
+  // The aggregated snapshot may have several root children for one
+  // constructor, some of them empty. Merge them by name and leave the empty
+  // ones out.
+  Local<Object> by_name = Object::New();
+  Local<Array> result = Array::New();
+  int length = 0;
+
+  int count = root->GetChildrenCount();
+  for (int i = 0; i < count; i++) {
+    const HeapGraphNode *node = root->GetChild(i)->GetToNode();
+    int instances = node->GetInstancesCount();
+    int size = node->GetSelfSize();
+    if (instances == 0) continue;
+
+    Handle<String> name = node->GetName();
+    if (by_name->HasRealNamedProperty(name)) {
+      Local<Object> entry = by_name->Get(name)->ToObject();
+      entry->Set(count_symbol, Integer::New(
+            entry->Get(count_symbol)->Int32Value() + instances));
+      entry->Set(size_symbol, Integer::New(
+            entry->Get(size_symbol)->Int32Value() + size));
+      continue;
+    }
+
+    Local<Object> entry = Object::New();
+    entry->Set(name_symbol, name);
+    entry->Set(count_symbol, Integer::New(instances));
+    entry->Set(size_symbol, Integer::New(size));
+    by_name->ForceSet(name, entry);
+    result->Set(Integer::New(length++), entry);
+  }
+
+  return scope.Close(result);
+}
+
+
+static Handle<Value> GetHeapStatistics(const Arguments& args) {
+  HandleScope scope;
+
+  HeapStatistics s;
+  V8::GetHeapStatistics(&s);
+
+  Local<Object> result = Object::New();
+  result->Set(total_heap_size_symbol, Number::New(s.total_heap_size()));
+  result->Set(total_heap_size_executable_symbol,
+              Number::New(s.total_heap_size_executable()));
+  result->Set(used_heap_size_symbol, Number::New(s.used_heap_size()));
+  result->Set(heap_size_limit_symbol, Number::New(s.heap_size_limit()));
+
+  return scope.Close(result);
+}
+
+
+void Profiler::Initialize(Handle<Object> target) {
+  HandleScope scope;
+
+  title_symbol = NODE_PSYMBOL("title");
+  uid_symbol = NODE_PSYMBOL("uid");
+  head_symbol = NODE_PSYMBOL("head");
+  function_name_symbol = NODE_PSYMBOL("functionName");
+  url_symbol = NODE_PSYMBOL("url");
+  line_number_symbol = NODE_PSYMBOL("lineNumber");
+  call_uid_symbol = NODE_PSYMBOL("callUID");
+  self_samples_symbol = NODE_PSYMBOL("selfSamples");
+  total_samples_symbol = NODE_PSYMBOL("totalSamples");
+  children_symbol = NODE_PSYMBOL("children");
+  collapsed_symbol = NODE_PSYMBOL("collapsed");
+  bytes_symbol = NODE_PSYMBOL("bytes");
+  name_symbol = NODE_PSYMBOL("name");
+  count_symbol = NODE_PSYMBOL("count");
+  size_symbol = NODE_PSYMBOL("size");
+  total_heap_size_symbol = NODE_PSYMBOL("totalHeapSize");
+  total_heap_size_executable_symbol = NODE_PSYMBOL("totalHeapSizeExecutable");
+  used_heap_size_symbol = NODE_PSYMBOL("usedHeapSize");
+  heap_size_limit_symbol = NODE_PSYMBOL("heapSizeLimit");
+
+  NODE_SET_METHOD(target, "startProfiling", StartProfiling);
+  NODE_SET_METHOD(target, "stopProfiling", StopProfiling);
+  NODE_SET_METHOD(target, "getProfilesCount", GetProfilesCount);
+  NODE_SET_METHOD(target, "getSnapshotsCount", GetSnapshotsCount);
+#ifdef __POSIX__
+  NODE_SET_METHOD(target, "takeSnapshot", TakeSnapshot);
+#endif
+  NODE_SET_METHOD(target, "countObjects", CountObjects);
+  NODE_SET_METHOD(target, "getHeapStatistics", GetHeapStatistics);
+}
+
+
+}  // namespace node
+
+NODE_MODULE(node_profiler, node::Profiler::Initialize);
@@ -0,0 +1,396 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <node_querystring.h>
+#include <node_buffer.h>
+#include <node_string.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace node {
+
+using namespace v8;
+
+
+static inline int Unhex(unsigned char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  c |= 0x20;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+
+size_t UrlDecode(const char *src, size_t len, char *dst, bool decode_spaces) {
+  const unsigned char *s = reinterpret_cast<const unsigned char*>(src);
+  size_t i = 0, o = 0;
+
+  while (i < len) {
+    unsigned char c = s[i++];
+
+    if (c == '+' && decode_spaces) {
+      dst[o++] = ' ';
+    } else if (c != '%') {
+      dst[o++] = c;
+    } else if (i == len) {
+      dst[o++] = '%';
+    } else {
+      // Same recovery as unescapeBuffer: a bad digit is copied through
+      // along with what came before it, and is not examined again.
+      int hi = Unhex(s[i++]);
+      if (hi < 0) {
+        dst[o++] = '%';
+        dst[o++] = s[i - 1];
+      } else if (i == len) {
+        dst[o++] = '%';
+        dst[o++] = s[i - 1];
+      } else {
+        int lo = Unhex(s[i++]);
+        if (lo < 0) {
+          dst[o++] = '%';
+          dst[o++] = s[i - 2];
+          dst[o++] = s[i - 1];
+        } else {
+          dst[o++] = static_cast<char>(hi << 4 | lo);
+        }
+      }
+    }
+  }
+
+  return o;
+}
+
+
+static const char* Find(const char *s, const char *end,
+                        const char *pat, size_t pat_len) {
+  if (pat_len == 1) {
+    return static_cast<const char*>(memchr(s, *pat, end - s));
+  }
+  while (static_cast<size_t>(end - s) >= pat_len) {
+    s = static_cast<const char*>(memchr(s, *pat, end - s - pat_len + 1));
+    if (s == NULL) return NULL;
+    if (memcmp(s, pat, pat_len) == 0) return s;
+    s++;
+  }
+  return NULL;
+}
+
+
+static Local<String> Decode(const char *s, size_t len, char *scratch) {
+  size_t n = UrlDecode(s, len, scratch, true);
+  return n ? String::New(scratch, n) : String::Empty();
+}
+
+
+// Same as the JavaScript version: the first value is stored as is, later
+// ones turn it into an array.
+static void AddPair(Local<Object> obj, Local<String> key, Local<String> value) {
+  if (!obj->Has(key)) {
+    obj->Set(key, value);
+    return;
+  }
+
+  Local<Value> prev = obj->Get(key);
+  if (prev->IsArray()) {
+    Local<Array> a = Local<Array>::Cast(prev);
+    a->Set(a->Length(), value);
+  } else {
+    Local<Array> a = Array::New(2);
+    a->Set(0, prev);
+    a->Set(1, value);
+    obj->Set(key, a);
+  }
+}
+
+
+// parse(input, sep, eq)
+// input is a string or a Buffer of UTF-8; sep and eq are strings.
+static Handle<Value> Parse(const Arguments& args) {
+  HandleScope scope;
+
+  bool is_buffer = Buffer::HasInstance(args[0]);
+  if (!is_buffer && !args[0]->IsString()) {
+    return ThrowException(Exception::TypeError(
+          String::New("Argument must be a string or Buffer")));
+  }
+
+  String::Utf8Value sep(args[1]->ToString());
+  String::Utf8Value eq(args[2]->ToString());
+  if (sep.length() == 0 || eq.length() == 0) {
+    return ThrowException(Exception::TypeError(String::New("Bad arguments")));
+  }
+
+  String::Utf8Value str(is_buffer ? Handle<Value>(String::Empty()) : args[0]);
+  const char *data;
+  size_t len;
+  if (is_buffer) {
+    Local<Object> buffer = args[0]->ToObject();
+    data = Buffer::Data(buffer);
+    len = Buffer::Length(buffer);
+  } else {
+    data = *str;
+    len = str.length();
+  }
+
+  Local<Object> obj = Object::New();
+  if (len == 0) return scope.Close(obj);
+
+  // Nothing decodes to more bytes than it takes up in the input.
+  char stack_scratch[1024];
+  char *scratch = stack_scratch;
+  if (len > sizeof stack_scratch) {
+    scratch = static_cast<char*>(malloc(len));
+    if (scratch == NULL) {
+      return ThrowException(Exception::Error(String::New("Out of memory")));
+    }
+  }
+
+  const char *end = data + len;
+  const char *p = data;
+
+  for (;;) {
+    HandleScope pair_scope;
+
+    const char *pair_end = Find(p, end, *sep, sep.length());
+    if (pair_end == NULL) pair_end = end;
+
+    const char *key_end = Find(p, pair_end, *eq, eq.length());
+    const char *value = key_end ? key_end + eq.length() : pair_end;
+    if (key_end == NULL) key_end = pair_end;
+
+    AddPair(obj,
+            Decode(p, key_end - p, scratch),
+            Decode(value, pair_end - value, scratch));
+
+    if (pair_end == end) break;
+    p = pair_end + sep.length();
+  }
+
+  if (scratch != stack_scratch) free(scratch);
+
+  return scope.Close(obj);
+}
+
+
+// unescape(str, decodeSpaces)
+static Handle<Value> Unescape(const Arguments& args) {
+  HandleScope scope;
+
+  String::Utf8Value str(args[0]->ToString());
+  size_t n = UrlDecode(*str, str.length(), *str, args[1]->IsTrue());
+
+  return scope.Close(String::New(*str, n));
+}
+
+
+// Characters encodeURIComponent leaves alone.
+static const char unreserved[128] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 1, 0, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0,   //  !'()*-.
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0,   // 0-9
+  0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,   // A-O
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 1,   // P-Z _
+  0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,   // a-o
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 1, 0    // p-z ~
+};
+
+static const char upper_hex[] = "0123456789ABCDEF";
+
+
+// A growable output buffer for Stringify.
+class Output {
+ public:
+  Output() : data_(NULL), len_(0), cap_(0), failed_(false) {}
+  ~Output() { free(data_); }
+
+  void Append(const char *s, size_t n) {
+    if (!Reserve(n)) return;
+    memcpy(data_ + len_, s, n);
+    len_ += n;
+  }
+
+  void AppendEscaped(uint32_t c) {
+    char *p = Reserve(3) ? data_ + len_ : NULL;
+    if (p == NULL) return;
+    p[0] = '%';
+    p[1] = upper_hex[c >> 4];
+    p[2] = upper_hex[c & 15];
+    len_ += 3;
+  }
+
+  // Appends s the way encodeURIComponent would encode it. Returns false
+  // on an unpaired surrogate, for which encodeURIComponent throws.
+  bool AppendComponent(Handle<String> s) {
+    String::Value v(s);
+    const uint16_t *u = *v;
+    int n = v.length();
+
+    for (int i = 0; i < n; i++) {
+      uint32_t c = u[i];
+      if (c < 0x80) {
+        if (unreserved[c]) {
+          char ch = static_cast<char>(c);
+          Append(&ch, 1);
+        } else {
+          AppendEscaped(c);
+        }
+      } else if (c < 0x800) {
+        AppendEscaped(0xc0 | c >> 6);
+        AppendEscaped(0x80 | (c & 0x3f));
+      } else if (c >= 0xd800 && c <= 0xdfff) {
+        if (c > 0xdbff || i + 1 == n ||
+            u[i + 1] < 0xdc00 || u[i + 1] > 0xdfff) {
+          return false;
+        }
+        c = 0x10000 + ((c - 0xd800) << 10) + (u[++i] - 0xdc00);
+        AppendEscaped(0xf0 | c >> 18);
+        AppendEscaped(0x80 | (c >> 12 & 0x3f));
+        AppendEscaped(0x80 | (c >> 6 & 0x3f));
+        AppendEscaped(0x80 | (c & 0x3f));
+      } else {
+        AppendEscaped(0xe0 | c >> 12);
+        AppendEscaped(0x80 | (c >> 6 & 0x3f));
+        AppendEscaped(0x80 | (c & 0x3f));
+      }
+    }
+
+    return true;
+  }
+
+  // QueryString.escape(stringifyPrimitive(v))
+  bool AppendPrimitive(Handle<Value> v) {
+    if (v->IsString()) return AppendComponent(v->ToString());
+    if (v->IsBoolean()) {
+      if (v->IsTrue()) {
+        Append("true", 4);
+      } else {
+        Append("false", 5);
+      }
+    } else if (v->IsNumber()) {
+      double d = v->NumberValue();
+      // isFinite(); NaN compares false with everything.
+      if (d - d == 0) return AppendComponent(v->ToString());
+    }
+    return true;
+  }
+
+  bool failed() const { return failed_; }
+
+  // Returns the contents as a string; the buffer is given to the string
+  // when it is made external.
+  Local<String> ToString() {
+    if (len_ == 0) return String::Empty();
+    if (external_string_threshold && len_ >= external_string_threshold) {
+      char *data = data_;
+      data_ = NULL;
+      return ImmutableAsciiCopy::Adopt(data, len_);
+    }
+    return String::New(data_, len_);
+  }
+
+ private:
+  bool Reserve(size_t n) {
+    if (failed_) return false;
+    if (len_ + n <= cap_) return true;
+
+    size_t cap = cap_ ? cap_ : 256;
+    while (cap < len_ + n) cap *= 2;
+    char *data = static_cast<char*>(realloc(data_, cap));
+    if (data == NULL) {
+      failed_ = true;
+      return false;
+    }
+    data_ = data;
+    cap_ = cap;
+    return true;
+  }
+
+  char *data_;
+  size_t len_;
+  size_t cap_;
+  bool failed_;
+};
+
+
+// stringify(obj, keys, sep, eq)
+// keys is Object.keys(obj). Returns undefined if some key or value cannot
+// be encoded, so that the caller's encodeURIComponent throws the error.
+static Handle<Value> Stringify(const Arguments& args) {
+  HandleScope scope;
+
+  if (!args[0]->IsObject() || !args[1]->IsArray()) {
+    return ThrowException(Exception::TypeError(String::New("Bad arguments")));
+  }
+
+  Local<Object> obj = args[0]->ToObject();
+  Local<Array> keys = Local<Array>::Cast(args[1]);
+  String::Utf8Value sep(args[2]->ToString());
+  String::Utf8Value eq(args[3]->ToString());
+
+  Output out;
+  uint32_t n = keys->Length();
+
+  for (uint32_t i = 0; i < n; i++) {
+    HandleScope key_scope;
+
+    if (i > 0) out.Append(*sep, sep.length());
+
+    Local<Value> key = keys->Get(i);
+    Local<Value> value = obj->Get(key);
+
+    if (value->IsArray()) {
+      Local<Array> values = Local<Array>::Cast(value);
+      uint32_t m = values->Length();
+      for (uint32_t j = 0; j < m; j++) {
+        if (j > 0) out.Append(*sep, sep.length());
+        if (!out.AppendPrimitive(key)) return Undefined();
+        out.Append(*eq, eq.length());
+        if (!out.AppendPrimitive(values->Get(j))) return Undefined();
+      }
+    } else {
+      if (!out.AppendPrimitive(key)) return Undefined();
+      out.Append(*eq, eq.length());
+      if (!out.AppendPrimitive(value)) return Undefined();
+    }
+  }
+
+  if (out.failed()) {
+    return ThrowException(Exception::Error(String::New("Out of memory")));
+  }
+
+  return scope.Close(out.ToString());
+}
+
+
+void QueryString::Initialize(Handle<Object> target) {
+  HandleScope scope;
+
+  NODE_SET_METHOD(target, "parse", Parse);
+  NODE_SET_METHOD(target, "unescape", Unescape);
+  NODE_SET_METHOD(target, "stringify", Stringify);
+}
+
+
+}  // namespace node
+
+NODE_MODULE(node_querystring, node::QueryString::Initialize);
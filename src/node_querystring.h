@@ -0,0 +1,44 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef NODE_QUERYSTRING_H_
+#define NODE_QUERYSTRING_H_
+
+#include <node.h>
+#include <v8.h>
+#include <stddef.h>
+
+namespace node {
+
+// Percent-decodes len bytes of src into dst, which must have room for len
+// bytes; with decode_spaces set '+' becomes a space. Malformed escapes are
+// copied through unchanged, as QueryString.unescapeBuffer does. Returns the
+// number of bytes written. src and dst may be the same buffer.
+size_t UrlDecode(const char *src, size_t len, char *dst, bool decode_spaces);
+
+class QueryString {
+ public:
+  static void Initialize(v8::Handle<v8::Object> target);
+};
+
+}  // namespace node
+
+#endif  // NODE_QUERYSTRING_H_
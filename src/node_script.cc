@@ -21,12 +21,16 @@
 
 #include <node.h>
 #include <node_script.h>
+#include <node_buffer.h>
 #include <assert.h>
+#include <string.h>
 
 namespace node {
 
 using v8::Context;
 using v8::Script;
+using v8::ScriptData;
+using v8::ScriptOrigin;
 using v8::Value;
 using v8::Handle;
 using v8::HandleScope;
@@ -40,7 +44,14 @@ using v8::Local;
 using v8::Array;
 using v8::Persistent;
 using v8::Integer;
+using v8::Function;
 using v8::FunctionTemplate;
+using v8::ObjectTemplate;
+using v8::External;
+using v8::AccessorInfo;
+using v8::Boolean;
+using v8::True;
+using v8::Undefined;
 
 
 class WrappedContext : ObjectWrap {
@@ -81,7 +92,7 @@ class WrappedScript : ObjectWrap {
  protected:
   static Persistent<FunctionTemplate> constructor_template;
 
-  WrappedScript() : ObjectWrap() {}
+  WrappedScript() : ObjectWrap(), script_data_(NULL) {}
   ~WrappedScript();
 
   static Handle<Value> New(const Arguments& args);
@@ -92,8 +103,79 @@ class WrappedScript : ObjectWrap {
   static Handle<Value> CompileRunInContext(const Arguments& args);
   static Handle<Value> CompileRunInThisContext(const Arguments& args);
   static Handle<Value> CompileRunInNewContext(const Arguments& args);
+  static Handle<Value> CreateCachedData(const Arguments& args);
 
   Persistent<Script> script_;
+  Persistent<String> source_;
+  ScriptData *script_data_;
+
+  friend class WrappedContextPool;
+};
+
+
+// A set of contexts that are reused across runs instead of being created
+// and torn down for every call like runInNewContext() does. The global of
+// a pooled context forwards property access to the sandbox of the current
+// run through an interceptor, so nothing is copied in.
+class WrappedContextPool : ObjectWrap {
+ public:
+  static void Initialize(Handle<Object> target);
+
+ protected:
+  struct PooledContext {
+    Persistent<Context> context;
+    // The context's own Object.getOwnPropertyNames and
+    // getOwnPropertyDescriptor, which a run cannot replace.
+    Persistent<Function> own_names;
+    Persistent<Function> own_desc;
+    // How the global held each of the pool's names, as Describe() puts it.
+    Persistent<Array> props;
+    PooledContext *next;
+    int uses;
+  };
+
+  static Persistent<FunctionTemplate> constructor_template;
+  static Persistent<ObjectTemplate> global_template;
+  static Persistent<String> sandbox_symbol;
+
+  WrappedContextPool(int size, int max_uses);
+  ~WrappedContextPool();
+
+  static Handle<Value> New(const Arguments& args);
+  static Handle<Value> Run(const Arguments& args);
+  static Handle<Value> Stats(const Arguments& args);
+  static Handle<Value> Dispose(const Arguments& args);
+
+  static Handle<Value> GlobalGetter(Local<String> property,
+                                    const AccessorInfo& info);
+  static Handle<Value> GlobalSetter(Local<String> property,
+                                    Local<Value> value,
+                                    const AccessorInfo& info);
+  static Handle<Integer> GlobalQuery(Local<String> property,
+                                     const AccessorInfo& info);
+  static Handle<Boolean> GlobalDeleter(Local<String> property,
+                                       const AccessorInfo& info);
+  static Handle<Array> GlobalEnumerator(const AccessorInfo& info);
+  static Local<Object> CurrentSandbox(const AccessorInfo& info);
+
+  PooledContext* Create();
+  PooledContext* Acquire();
+  bool Reset(PooledContext *pc, Handle<Object> sandbox, bool check);
+  void Release(PooledContext *pc);
+  void Destroy(PooledContext *pc);
+  void DisposeAll();
+
+  // The own property names of a global as created, and the same as keys of
+  // an object for lookups. They are the same for every context, so they are
+  // only looked up once.
+  Persistent<Array> names_;
+  Persistent<Object> known_;
+  PooledContext *idle_;
+  int size_;
+  int max_uses_;
+  int idle_count_;
+  int created_;
+  int retired_;  // because a run redefined a global
 };
 
 
@@ -142,11 +224,14 @@ Persistent<Context> WrappedContext::GetV8Context() {
 
 
 Persistent<FunctionTemplate> WrappedScript::constructor_template;
+static Persistent<String> cached_data_rejected_symbol;
 
 
 void WrappedScript::Initialize(Handle<Object> target) {
   HandleScope scope;
 
+  cached_data_rejected_symbol = NODE_PSYMBOL("cachedDataRejected");
+
   Local<FunctionTemplate> t = FunctionTemplate::New(WrappedScript::New);
   constructor_template = Persistent<FunctionTemplate>::New(t);
   constructor_template->InstanceTemplate()->SetInternalFieldCount(1);
@@ -171,6 +256,10 @@ void WrappedScript::Initialize(Handle<Object> target) {
                             "runInNewContext",
                             WrappedScript::RunInNewContext);
 
+  NODE_SET_PROTOTYPE_METHOD(constructor_template,
+                            "_createCachedData",
+                            WrappedScript::CreateCachedData);
+
   NODE_SET_METHOD(constructor_template,
                   "createContext",
                   WrappedScript::CreateContext);
@@ -209,6 +298,106 @@ Handle<Value> WrappedScript::New(const Arguments& args) {
 
 WrappedScript::~WrappedScript() {
   script_.Dispose();
+  source_.Dispose();
+  delete script_data_;
+}
+
+
+// Cached data is V8's pre-parse data behind this header. V8 only checks
+// the magic number and version of pre-parse data and then trusts the
+// function positions in it, so data made from any other source, or
+// damaged on the way, must never reach it.
+struct CachedDataHeader {
+  char magic[4];
+  char version[32];
+  uint32_t source_length;
+  uint32_t source_hash;
+  uint32_t data_length;
+  uint32_t data_hash;
+};
+
+static const char cached_data_magic[4] = { 'N', 'S', 'C', 'D' };
+
+
+// FNV-1a
+static uint32_t Hash(const void *data, size_t length) {
+  const unsigned char *p = static_cast<const unsigned char*>(data);
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ p[i]) * 16777619u;
+  }
+  return hash;
+}
+
+
+static void InitCachedDataHeader(CachedDataHeader *header,
+                                 Handle<String> source,
+                                 const char *data,
+                                 int length) {
+  String::Value chars(source);
+
+  memset(header, 0, sizeof *header);
+  memcpy(header->magic, cached_data_magic, sizeof header->magic);
+  strncpy(header->version, v8::V8::GetVersion(), sizeof header->version - 1);
+  header->source_length = chars.length();
+  header->source_hash = Hash(*chars, chars.length() * sizeof **chars);
+  header->data_length = length;
+  header->data_hash = Hash(data, length);
+}
+
+
+// The pre-parse data in `buffer` if it was made for `source` by this
+// version of V8, NULL otherwise.
+static ScriptData* CachedScriptData(Handle<Object> buffer,
+                                    Handle<String> source) {
+  size_t length = Buffer::Length(buffer);
+  const char *data = Buffer::Data(buffer);
+
+  if (length <= sizeof(CachedDataHeader)) return NULL;
+
+  CachedDataHeader header, expected;
+  memcpy(&header, data, sizeof header);
+  data += sizeof header;
+  length -= sizeof header;
+
+  InitCachedDataHeader(&expected, source, data, length);
+  if (memcmp(&header, &expected, sizeof header) != 0) return NULL;
+
+  return ScriptData::New(data, length);
+}
+
+
+// Pre-parse data for the script's source, for passing back to
+// new Script(code, filename, data) in this or another process. It is made
+// on the first call and kept.
+Handle<Value> WrappedScript::CreateCachedData(const Arguments& args) {
+  HandleScope scope;
+
+  WrappedScript *n_script = ObjectWrap::Unwrap<WrappedScript>(args.Holder());
+  if (n_script->source_.IsEmpty()) {
+    return ThrowException(Exception::Error(
+          String::New("'this' must be a result of previous "
+                      "new Script(code) call.")));
+  }
+
+  if (n_script->script_data_ == NULL) {
+    n_script->script_data_ = ScriptData::PreCompile(n_script->source_);
+  }
+
+  ScriptData *data = n_script->script_data_;
+  if (data->HasError()) {
+    return ThrowException(Exception::SyntaxError(
+          String::New("Cannot create cached data for invalid code.")));
+  }
+
+  CachedDataHeader header;
+  InitCachedDataHeader(&header, n_script->source_, data->Data(),
+                       data->Length());
+
+  Buffer *buffer = Buffer::New(sizeof header + data->Length());
+  memcpy(Buffer::Data(buffer), &header, sizeof header);
+  memcpy(Buffer::Data(buffer) + sizeof header, data->Data(), data->Length());
+  return scope.Close(buffer->handle_);
 }
 
 
@@ -352,10 +541,24 @@ Handle<Value> WrappedScript::EvalMachine(const Arguments& args) {
   Handle<Script> script;
 
   if (input_flag == compileCode) {
+    // Data from script.createCachedData() saves the pre-parse. Data made
+    // from other code or by another version of V8 is dropped.
+    ScriptData *pre_data = NULL;
+    const int cached_data_index = filename_index + 1;
+    if (output_flag == wrapExternal &&
+        args.Length() > cached_data_index &&
+        Buffer::HasInstance(args[cached_data_index])) {
+      pre_data = CachedScriptData(args[cached_data_index]->ToObject(), code);
+      args.Holder()->Set(cached_data_rejected_symbol,
+                         Boolean::New(pre_data == NULL));
+    }
+
     // well, here WrappedScript::New would suffice in all cases, but maybe
     // Compile has a little better performance where possible
+    ScriptOrigin origin(filename);
     script = output_flag == returnResult ? Script::Compile(code, filename)
-                                         : Script::New(code, filename);
+                                         : Script::New(code, &origin, pre_data);
+    delete pre_data;
     if (script.IsEmpty()) {
       // FIXME UGLY HACK TO DISPLAY SYNTAX ERRORS.
       if (display_error) DisplayExceptionLine(try_catch);
@@ -395,6 +598,9 @@ Handle<Value> WrappedScript::EvalMachine(const Arguments& args) {
             String::New("Must be called as a method of Script.")));
     }
     n_script->script_ = Persistent<Script>::New(script);
+    if (input_flag == compileCode) {
+      n_script->source_ = Persistent<String>::New(code);
+    }
     result = args.This();
   }
 
@@ -423,11 +629,503 @@ Handle<Value> WrappedScript::EvalMachine(const Arguments& args) {
 }
 
 
+Persistent<FunctionTemplate> WrappedContextPool::constructor_template;
+Persistent<ObjectTemplate> WrappedContextPool::global_template;
+Persistent<String> WrappedContextPool::sandbox_symbol;
+
+static Persistent<String> value_symbol;
+static Persistent<String> get_symbol;
+static Persistent<String> set_symbol;
+
+
+void WrappedContextPool::Initialize(Handle<Object> target) {
+  HandleScope scope;
+
+  Local<FunctionTemplate> t = FunctionTemplate::New(WrappedContextPool::New);
+  constructor_template = Persistent<FunctionTemplate>::New(t);
+  constructor_template->InstanceTemplate()->SetInternalFieldCount(1);
+  constructor_template->SetClassName(String::NewSymbol("ContextPool"));
+
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "run",
+                            WrappedContextPool::Run);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "stats",
+                            WrappedContextPool::Stats);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "dispose",
+                            WrappedContextPool::Dispose);
+
+  Local<ObjectTemplate> g = ObjectTemplate::New();
+  g->SetNamedPropertyHandler(GlobalGetter,
+                             GlobalSetter,
+                             GlobalQuery,
+                             GlobalDeleter,
+                             GlobalEnumerator);
+  global_template = Persistent<ObjectTemplate>::New(g);
+
+  sandbox_symbol = NODE_PSYMBOL("sandbox");
+  value_symbol = NODE_PSYMBOL("value");
+  get_symbol = NODE_PSYMBOL("get");
+  set_symbol = NODE_PSYMBOL("set");
+
+  target->Set(String::NewSymbol("ContextPool"),
+              constructor_template->GetFunction());
+}
+
+
+Handle<Value> WrappedContextPool::New(const Arguments& args) {
+  if (!args.IsConstructCall()) {
+    return FromConstructorTemplate(constructor_template, args);
+  }
+
+  HandleScope scope;
+
+  int size = args[0]->IsNumber() ? args[0]->Int32Value() : 4;
+  int max_uses = args[1]->IsNumber() ? args[1]->Int32Value() : 1;
+
+  if (size < 0 || max_uses < 0) {
+    return ThrowException(Exception::RangeError(
+          String::New("size and maxUses must not be negative.")));
+  }
+
+  WrappedContextPool *pool = new WrappedContextPool(size, max_uses);
+  pool->Wrap(args.This());
+
+  return args.This();
+}
+
+
+WrappedContextPool::WrappedContextPool(int size, int max_uses)
+    : ObjectWrap(), idle_(NULL), size_(size), max_uses_(max_uses),
+      idle_count_(0), created_(0), retired_(0) {
+  for (int i = 0; i < size_; i++) {
+    PooledContext *pc = Create();
+    pc->next = idle_;
+    idle_ = pc;
+    idle_count_++;
+  }
+}
+
+
+WrappedContextPool::~WrappedContextPool() {
+  DisposeAll();
+  if (!names_.IsEmpty()) {
+    names_.Dispose();
+    known_.Dispose();
+  }
+}
+
+
+// Unlike the contexts of runInNewContext(), a pooled context is never
+// populated: its global intercepts every named property and serves the
+// ones the sandbox owns from the sandbox itself. Anything the sandbox does
+// not have falls through to the real global, i.e. the builtins. Between
+// runs there is no sandbox and the interceptor does nothing.
+Local<Object> WrappedContextPool::CurrentSandbox(const AccessorInfo& info) {
+  Local<Value> sandbox = info.Holder()->GetHiddenValue(sandbox_symbol);
+  if (sandbox.IsEmpty() || !sandbox->IsObject()) return Local<Object>();
+  return sandbox->ToObject();
+}
+
+
+Handle<Value> WrappedContextPool::GlobalGetter(Local<String> property,
+                                               const AccessorInfo& info) {
+  HandleScope scope;
+  Local<Object> sandbox = CurrentSandbox(info);
+
+  if (sandbox.IsEmpty() || !sandbox->HasRealNamedProperty(property)) {
+    return Handle<Value>();
+  }
+
+  Local<Value> value = sandbox->Get(property);
+  if (value == sandbox) return scope.Close(Context::GetCurrent()->Global());
+  return scope.Close(value);
+}
+
+
+Handle<Value> WrappedContextPool::GlobalSetter(Local<String> property,
+                                               Local<Value> value,
+                                               const AccessorInfo& info) {
+  HandleScope scope;
+  Local<Object> sandbox = CurrentSandbox(info);
+
+  if (sandbox.IsEmpty()) return Handle<Value>();
+
+  if (value == Context::GetCurrent()->Global()) {
+    sandbox->Set(property, sandbox);
+  } else {
+    sandbox->Set(property, value);
+  }
+  return scope.Close(value);
+}
+
+
+Handle<Integer> WrappedContextPool::GlobalQuery(Local<String> property,
+                                                const AccessorInfo& info) {
+  HandleScope scope;
+  Local<Object> sandbox = CurrentSandbox(info);
+
+  if (sandbox.IsEmpty() || !sandbox->HasRealNamedProperty(property)) {
+    return Handle<Integer>();
+  }
+
+  return scope.Close(Integer::New(v8::None));
+}
+
+
+Handle<Boolean> WrappedContextPool::GlobalDeleter(Local<String> property,
+                                                  const AccessorInfo& info) {
+  HandleScope scope;
+  Local<Object> sandbox = CurrentSandbox(info);
+
+  if (sandbox.IsEmpty() || !sandbox->HasRealNamedProperty(property)) {
+    return Handle<Boolean>();
+  }
+
+  return scope.Close(Boolean::New(sandbox->Delete(property)));
+}
+
+
+Handle<Array> WrappedContextPool::GlobalEnumerator(const AccessorInfo& info) {
+  HandleScope scope;
+  Local<Object> sandbox = CurrentSandbox(info);
+
+  if (sandbox.IsEmpty()) return Handle<Array>();
+
+  return scope.Close(sandbox->GetPropertyNames());
+}
+
+
+// The own property names of `obj`, non-enumerable ones included.
+static Local<Array> OwnNames(Handle<Function> own_names, Handle<Object> obj) {
+  Handle<Value> argv[1] = { obj };
+  Local<Value> names = own_names->Call(obj, 1, argv);
+  if (names.IsEmpty() || !names->IsArray()) return Local<Array>();
+  return Local<Array>::Cast(names);
+}
+
+
+// Stores how `obj` holds `name` at out[index] and out[index + 1]: the value
+// and null for a data property, the getter and setter for an accessor.
+// Accessors are not called, so ones like RegExp.$1 that change with every
+// match still compare equal.
+static void Describe(Handle<Function> own_desc,
+                     Handle<Object> obj,
+                     Handle<Value> name,
+                     Handle<Array> out,
+                     uint32_t index) {
+  // Named data properties are read directly, which is much cheaper than
+  // calling into getOwnPropertyDescriptor().
+  Local<String> key = name->ToString();
+  if (key->ToArrayIndex().IsEmpty() &&
+      !obj->HasRealNamedCallbackProperty(key)) {
+    Local<Value> value = obj->GetRealNamedProperty(key);
+    out->Set(index, value.IsEmpty() ? Handle<Value>(Undefined()) : value);
+    out->Set(index + 1, v8::Null());
+    return;
+  }
+
+  Handle<Value> argv[2] = { obj, name };
+  Local<Value> desc_v = own_desc->Call(obj, 2, argv);
+
+  if (desc_v.IsEmpty() || !desc_v->IsObject()) {
+    out->Set(index, Undefined());
+    out->Set(index + 1, Undefined());
+    return;
+  }
+
+  Local<Object> desc = desc_v->ToObject();
+  if (desc->HasRealNamedProperty(value_symbol)) {
+    out->Set(index, desc->Get(value_symbol));
+    out->Set(index + 1, v8::Null());
+  } else {
+    out->Set(index, desc->Get(get_symbol));
+    out->Set(index + 1, desc->Get(set_symbol));
+  }
+}
+
+
+static bool SameValue(Handle<Value> a, Handle<Value> b) {
+  if (a->IsNumber() && b->IsNumber() &&
+      a->NumberValue() != a->NumberValue()) {
+    return b->NumberValue() != b->NumberValue();  // NaN
+  }
+  return a->StrictEquals(b);
+}
+
+
+// Whether `obj` still holds each of `names` as `props` says.
+static bool SameProperties(Handle<Function> own_desc,
+                           Handle<Object> obj,
+                           Handle<Array> names,
+                           Handle<Array> props) {
+  Local<Array> now = Array::New(2);
+  for (uint32_t i = 0; i < names->Length(); i++) {
+    Describe(own_desc, obj, names->Get(i), now, 0);
+    if (!SameValue(now->Get(0), props->Get(i * 2)) ||
+        !SameValue(now->Get(1), props->Get(i * 2 + 1))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+WrappedContextPool::PooledContext* WrappedContextPool::Create() {
+  HandleScope scope;
+
+  PooledContext *pc = new PooledContext;
+  pc->context = Context::New(NULL, global_template);
+
+  {
+    Context::Scope context_scope(pc->context);
+    Local<Object> global = pc->context->Global();
+
+    Local<Object> object_ctor =
+        global->Get(String::NewSymbol("Object"))->ToObject();
+    Local<Function> own_names = Local<Function>::Cast(
+        object_ctor->Get(String::NewSymbol("getOwnPropertyNames")));
+    Local<Function> own_desc = Local<Function>::Cast(
+        object_ctor->Get(String::NewSymbol("getOwnPropertyDescriptor")));
+    pc->own_names = Persistent<Function>::New(own_names);
+    pc->own_desc = Persistent<Function>::New(own_desc);
+
+    if (names_.IsEmpty()) {
+      names_ = Persistent<Array>::New(OwnNames(own_names, global));
+      known_ = Persistent<Object>::New(Object::New());
+      for (uint32_t i = 0; i < names_->Length(); i++) {
+        known_->Set(names_->Get(i), True());
+      }
+    }
+    Local<Array> names = Local<Array>::New(names_);
+
+    // Only needed to check a context before it is used again.
+    if (max_uses_ != 1) {
+      Local<Array> props = Array::New(names->Length() * 2);
+      for (uint32_t i = 0; i < names->Length(); i++) {
+        Describe(own_desc, global, names->Get(i), props, i * 2);
+      }
+      pc->props = Persistent<Array>::New(props);
+    }
+  }
+
+  pc->next = NULL;
+  pc->uses = 0;
+  created_++;
+
+  return pc;
+}
+
+
+WrappedContextPool::PooledContext* WrappedContextPool::Acquire() {
+  PooledContext *pc = idle_;
+
+  if (pc == NULL) return Create();
+
+  idle_ = pc->next;
+  idle_count_--;
+  return pc;
+}
+
+
+// Moves what the run declared on the global onto the sandbox. With `check`,
+// returns whether the global's own properties are otherwise as they were
+// created, so that the context can be used again. Checking the builtins
+// behind them as well would cost more than creating a new context, so that
+// is left to maxUses.
+bool WrappedContextPool::Reset(PooledContext *pc,
+                               Handle<Object> sandbox,
+                               bool check) {
+  HandleScope scope;
+
+  // Getters the run defined may throw.
+  TryCatch try_catch;
+
+  Local<Object> global = pc->context->Global();
+  Local<Array> names = Local<Array>::New(names_);
+
+  Local<Array> current = OwnNames(pc->own_names, global);
+  if (current.IsEmpty()) return false;
+
+  // var and function declarations, and properties defined with
+  // Object.defineProperty(), do not go through the interceptor and land on
+  // the real global. Move them onto the sandbox, which is where
+  // runInNewContext() would have put them. Once the global has had
+  // properties added it may list them in any order, so the names it was
+  // created with are told apart by lookup.
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < current->Length(); i++) {
+    Local<Value> key = current->Get(i);
+    Local<String> name = key->ToString();
+
+    if (known_->HasRealNamedProperty(name)) {
+      kept++;
+      continue;
+    }
+
+    Local<Value> value = global->Get(key);
+
+    // `var x;` must not clobber a value the sandbox already has.
+    if (!value->IsUndefined() || !sandbox->HasRealNamedProperty(name)) {
+      sandbox->Set(key, value == global ? Handle<Value>(sandbox) : value);
+    }
+    global->ForceDelete(key);
+  }
+
+  bool intact = kept == names->Length();
+
+  if (!check || !intact || try_catch.HasCaught()) return false;
+
+  Local<Array> props = Local<Array>::New(pc->props);
+  return SameProperties(pc->own_desc, global, names, props) &&
+         !try_catch.HasCaught();
+}
+
+
+void WrappedContextPool::Release(PooledContext *pc) {
+  HandleScope scope;
+
+  Local<Object> global = pc->context->Global();
+  Local<Object> sandbox = global->GetHiddenValue(sandbox_symbol)->ToObject();
+
+  // With no sandbox the interceptor is out of the way and the global shows
+  // only its own properties.
+  global->DeleteHiddenValue(sandbox_symbol);
+
+  pc->uses++;
+  bool again = max_uses_ == 0 || pc->uses < max_uses_;
+  bool reusable = Reset(pc, sandbox, again);
+
+  pc->context->Exit();
+
+  if (again && !reusable) retired_++;
+
+  if (!reusable || idle_count_ >= size_) {
+    Destroy(pc);
+    return;
+  }
+
+  pc->next = idle_;
+  idle_ = pc;
+  idle_count_++;
+}
+
+
+void WrappedContextPool::Destroy(PooledContext *pc) {
+  if (!pc->props.IsEmpty()) pc->props.Dispose();
+  pc->own_names.Dispose();
+  pc->own_desc.Dispose();
+  pc->context->DetachGlobal();
+  pc->context.Dispose();
+  delete pc;
+}
+
+
+void WrappedContextPool::DisposeAll() {
+  while (idle_ != NULL) {
+    PooledContext *pc = idle_;
+    idle_ = pc->next;
+    Destroy(pc);
+  }
+  idle_count_ = 0;
+}
+
+
+Handle<Value> WrappedContextPool::Run(const Arguments& args) {
+  HandleScope scope;
+
+  WrappedContextPool *pool =
+      ObjectWrap::Unwrap<WrappedContextPool>(args.Holder());
+
+  if (args.Length() < 1) {
+    return ThrowException(Exception::TypeError(
+          String::New("needs at least 'code' argument.")));
+  }
+
+  // A Script made by vm.createScript() is not bound to any context, so it
+  // is compiled once and runs in whichever context it is handed.
+  WrappedScript *n_script = NULL;
+  Local<String> code;
+  if (WrappedScript::constructor_template->HasInstance(args[0])) {
+    n_script = ObjectWrap::Unwrap<WrappedScript>(args[0]->ToObject());
+    if (n_script->script_.IsEmpty()) {
+      return ThrowException(Exception::Error(
+            String::New("Script was not compiled.")));
+    }
+  } else {
+    code = args[0]->ToString();
+  }
+
+  Local<Object> sandbox = args[1]->IsObject() ? args[1]->ToObject()
+                                              : Object::New();
+
+  Local<String> filename = args.Length() > 2 && args[2]->IsString()
+                           ? args[2]->ToString()
+                           : String::New("evalmachine.<anonymous>");
+
+  bool display_error = args.Length() > 1 &&
+                       args[args.Length() - 1]->IsBoolean() &&
+                       args[args.Length() - 1]->BooleanValue();
+
+  PooledContext *pc = pool->Acquire();
+  pc->context->Enter();
+  pc->context->Global()->SetHiddenValue(sandbox_symbol, sandbox);
+
+  TryCatch try_catch;
+
+  Handle<Value> result;
+  Handle<Script> script = n_script != NULL
+                          ? Handle<Script>(n_script->script_)
+                          : Script::Compile(code, filename);
+
+  if (script.IsEmpty()) {
+    if (display_error) DisplayExceptionLine(try_catch);
+  } else {
+    result = script->Run();
+  }
+
+  pool->Release(pc);
+
+  if (result.IsEmpty()) return try_catch.ReThrow();
+
+  return scope.Close(result);
+}
+
+
+Handle<Value> WrappedContextPool::Stats(const Arguments& args) {
+  HandleScope scope;
+
+  WrappedContextPool *pool =
+      ObjectWrap::Unwrap<WrappedContextPool>(args.Holder());
+
+  Local<Object> stats = Object::New();
+  stats->Set(String::NewSymbol("size"), Integer::New(pool->size_));
+  stats->Set(String::NewSymbol("idle"), Integer::New(pool->idle_count_));
+  stats->Set(String::NewSymbol("created"), Integer::New(pool->created_));
+  stats->Set(String::NewSymbol("retired"), Integer::New(pool->retired_));
+
+  return scope.Close(stats);
+}
+
+
+Handle<Value> WrappedContextPool::Dispose(const Arguments& args) {
+  HandleScope scope;
+
+  WrappedContextPool *pool =
+      ObjectWrap::Unwrap<WrappedContextPool>(args.Holder());
+
+  // Runs after this still work, each in a context of its own.
+  pool->size_ = 0;
+  pool->DisposeAll();
+
+  return Undefined();
+}
+
+
 void InitEvals(Handle<Object> target) {
   HandleScope scope;
 
   WrappedContext::Initialize(target);
   WrappedScript::Initialize(target);
+  WrappedContextPool::Initialize(target);
 }
 
 
@@ -0,0 +1,183 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <node_search.h>
+
+#include <assert.h>
+#include <string.h> // memchr, memcmp
+
+// Below these sizes building a Horspool skip table costs more than it saves
+// and the memchr() + memcmp() loop is faster.
+#define HORSPOOL_MIN_NEEDLE 4
+#define HORSPOOL_MIN_HAYSTACK 256
+
+namespace node {
+
+
+ssize_t SearchByte(const char *haystack, size_t haystack_length,
+                   unsigned char c) {
+  const void *p = memchr(haystack, c, haystack_length);
+  return p ? static_cast<const char*>(p) - haystack : -1;
+}
+
+
+static ssize_t SearchShort(const char *haystack, size_t haystack_length,
+                           const char *needle, size_t needle_length) {
+  const char *p = haystack;
+  const char *last = haystack + haystack_length - needle_length;
+
+  while (p <= last) {
+    p = static_cast<const char*>(memchr(p, needle[0], last - p + 1));
+    if (p == NULL) return -1;
+    if (memcmp(p + 1, needle + 1, needle_length - 1) == 0) {
+      return p - haystack;
+    }
+    p++;
+  }
+
+  return -1;
+}
+
+
+static ssize_t SearchHorspool(const unsigned char *haystack,
+                              size_t haystack_length,
+                              const unsigned char *needle,
+                              size_t needle_length) {
+  size_t skip[256];
+  size_t last = needle_length - 1;
+
+  for (int i = 0; i < 256; i++) skip[i] = needle_length;
+  for (size_t i = 0; i < last; i++) skip[needle[i]] = last - i;
+
+  const unsigned char last_byte = needle[last];
+  size_t pos = 0;
+
+  while (pos <= haystack_length - needle_length) {
+    unsigned char c = haystack[pos + last];
+    if (c == last_byte && memcmp(haystack + pos, needle, last) == 0) {
+      return pos;
+    }
+    pos += skip[c];
+  }
+
+  return -1;
+}
+
+
+ssize_t SearchString(const char *haystack, size_t haystack_length,
+                     const char *needle, size_t needle_length) {
+  if (needle_length == 0) return 0;
+  if (needle_length > haystack_length) return -1;
+
+  if (needle_length == 1) {
+    return SearchByte(haystack, haystack_length, needle[0]);
+  }
+
+  if (needle_length < HORSPOOL_MIN_NEEDLE ||
+      haystack_length < HORSPOOL_MIN_HAYSTACK) {
+    return SearchShort(haystack, haystack_length, needle, needle_length);
+  }
+
+  return SearchHorspool(reinterpret_cast<const unsigned char*>(haystack),
+                        haystack_length,
+                        reinterpret_cast<const unsigned char*>(needle),
+                        needle_length);
+}
+
+
+// Set-Horspool: one skip table for all needles, built over the first
+// `window` bytes of each, where window is the length of the shortest
+// needle. A shift is only taken when no needle can start inside it, so the
+// first match found is the leftmost one.
+ssize_t SearchMulti(const char *haystack, size_t haystack_length,
+                    const char * const *needles, const size_t *needle_lengths,
+                    int needle_count, int *which) {
+  if (needle_count <= 0) return -1;
+
+  if (needle_count == 1) {
+    *which = 0;
+    return SearchString(haystack, haystack_length,
+                        needles[0], needle_lengths[0]);
+  }
+
+  size_t window = needle_lengths[0];
+  for (int k = 0; k < needle_count; k++) {
+    if (needle_lengths[k] == 0) {
+      // An empty needle matches at offset 0; earlier needles which also
+      // match there take precedence.
+      for (int j = 0; j < k; j++) {
+        if (needle_lengths[j] <= haystack_length &&
+            memcmp(haystack, needles[j], needle_lengths[j]) == 0) {
+          k = j;
+          break;
+        }
+      }
+      *which = k;
+      return 0;
+    }
+    if (needle_lengths[k] < window) window = needle_lengths[k];
+  }
+
+  if (window > haystack_length) return -1;
+
+  const unsigned char *h = reinterpret_cast<const unsigned char*>(haystack);
+  size_t last = window - 1;
+  size_t skip[256];
+  bool tail[256];
+
+  for (int i = 0; i < 256; i++) {
+    skip[i] = window;
+    tail[i] = false;
+  }
+
+  for (int k = 0; k < needle_count; k++) {
+    const unsigned char *n = reinterpret_cast<const unsigned char*>(needles[k]);
+    for (size_t i = 0; i < last; i++) {
+      if (last - i < skip[n[i]]) skip[n[i]] = last - i;
+    }
+    tail[n[last]] = true;
+  }
+
+  size_t pos = 0;
+
+  while (pos <= haystack_length - window) {
+    unsigned char c = h[pos + last];
+
+    if (tail[c]) {
+      for (int k = 0; k < needle_count; k++) {
+        size_t len = needle_lengths[k];
+        if (len > haystack_length - pos) continue;
+        if (static_cast<unsigned char>(needles[k][last]) != c) continue;
+        if (memcmp(haystack + pos, needles[k], len) == 0) {
+          *which = k;
+          return pos;
+        }
+      }
+    }
+
+    pos += skip[c];
+  }
+
+  return -1;
+}
+
+
+}  // namespace node
@@ -0,0 +1,53 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef NODE_SEARCH_H_
+#define NODE_SEARCH_H_
+
+#include <sys/types.h> // ssize_t
+#include <stddef.h>
+
+namespace node {
+
+// Byte string search kernels shared by Buffer and BufferList. All of them
+// return the offset of the first match inside haystack, or -1.
+
+// Single byte. Uses memchr(), which libc implements with SSE2 or wider
+// vector instructions where the CPU has them.
+ssize_t SearchByte(const char *haystack, size_t haystack_length,
+                   unsigned char c);
+
+// Needle of any length. Short needles are located with memchr() on their
+// first byte and verified with memcmp(); longer needles use
+// Boyer-Moore-Horspool so that most haystack bytes are never inspected.
+ssize_t SearchString(const char *haystack, size_t haystack_length,
+                     const char *needle, size_t needle_length);
+
+// Any of several needles, in a single pass. Returns the leftmost match;
+// when several needles match at the same offset the first one in the
+// needles array wins. Its index is stored in *which.
+ssize_t SearchMulti(const char *haystack, size_t haystack_length,
+                    const char * const *needles, const size_t *needle_lengths,
+                    int needle_count, int *which);
+
+}  // namespace node
+
+#endif  // NODE_SEARCH_H_
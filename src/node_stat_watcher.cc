@@ -24,6 +24,8 @@
 #include <assert.h>
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <sys/stat.h>
 
 namespace node {
 
@@ -33,6 +35,7 @@ Persistent<FunctionTemplate> StatWatcher::constructor_template;
 
 static Persistent<String> change_symbol;
 static Persistent<String> stop_symbol;
+static Persistent<String> backend_symbol;
 
 void StatWatcher::Initialize(Handle<Object> target) {
   HandleScope scope;
@@ -45,6 +48,7 @@ void StatWatcher::Initialize(Handle<Object> target) {
 
   change_symbol = NODE_PSYMBOL("change");
   stop_symbol = NODE_PSYMBOL("stop");
+  backend_symbol = NODE_PSYMBOL("backend");
 
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "start", StatWatcher::Start);
   NODE_SET_PROTOTYPE_METHOD(constructor_template, "stop", StatWatcher::Stop);
@@ -95,14 +99,25 @@ Handle<Value> StatWatcher::Start(const Arguments& args) {
     interval = NODE_V8_UNIXTIME(args[2]);
   }
 
-  ev_stat_set(&handler->watcher_, handler->path_, interval);
-  ev_stat_start(EV_DEFAULT_UC_ &handler->watcher_);
-
   handler->persistent_ = args[1]->IsTrue();
 
-  if (!handler->persistent_) {
-    ev_unref(EV_DEFAULT_UC);
+  const char *backend = "poll";
+
+#ifdef HAVE_INOTIFY
+  // args[3] forces polling, args[4] is the debounce delay in ms.
+  ev_tstamp debounce = 0.05;
+  if (args[4]->IsNumber() && args[4]->NumberValue() >= 0) {
+    debounce = NODE_V8_UNIXTIME(args[4]);
   }
+  handler->interval_ = interval;
+
+  if (!args[3]->IsTrue() && handler->StartInotify(debounce)) {
+    backend = "inotify";
+  } else
+#endif
+  handler->StartPolling(interval);
+
+  args.Holder()->Set(backend_symbol, String::New(backend));
 
   handler->Ref();
 
@@ -110,6 +125,16 @@ Handle<Value> StatWatcher::Start(const Arguments& args) {
 }
 
 
+void StatWatcher::StartPolling(ev_tstamp interval) {
+  ev_stat_set(&watcher_, path_, interval);
+  ev_stat_start(EV_DEFAULT_UC_ &watcher_);
+
+  if (!persistent_) {
+    ev_unref(EV_DEFAULT_UC);
+  }
+}
+
+
 Handle<Value> StatWatcher::Stop(const Arguments& args) {
   HandleScope scope;
   StatWatcher *handler = ObjectWrap::Unwrap<StatWatcher>(args.Holder());
@@ -120,6 +145,16 @@ Handle<Value> StatWatcher::Stop(const Arguments& args) {
 
 
 void StatWatcher::Stop () {
+#ifdef HAVE_INOTIFY
+  if (inotify_) {
+    StopInotify();
+    free(path_);
+    path_ = NULL;
+    Unref();
+    return;
+  }
+#endif
+
   if (watcher_.active) {
     if (!persistent_) ev_ref(EV_DEFAULT_UC);
     ev_stat_stop(EV_DEFAULT_UC_ &watcher_);
@@ -130,4 +165,147 @@ void StatWatcher::Stop () {
 }
 
 
+#ifdef HAVE_INOTIFY
+
+// Same fields as libev compares, so both backends report the same changes.
+static bool StatChanged(const struct stat *a, const struct stat *b) {
+  return a->st_dev != b->st_dev ||
+         a->st_ino != b->st_ino ||
+         a->st_mode != b->st_mode ||
+         a->st_nlink != b->st_nlink ||
+         a->st_uid != b->st_uid ||
+         a->st_gid != b->st_gid ||
+         a->st_rdev != b->st_rdev ||
+         a->st_size != b->st_size ||
+         a->st_atime != b->st_atime ||
+         a->st_mtime != b->st_mtime ||
+         a->st_ctime != b->st_ctime;
+}
+
+
+// Like ev_stat: lstat(), and all zeroes if the file does not exist.
+static void Lstat(const char *path, struct stat *s) {
+  if (lstat(path, s) < 0) {
+    memset(s, 0, sizeof *s);
+  }
+}
+
+
+bool StatWatcher::StartInotify(ev_tstamp debounce) {
+  char dir[PATH_MAX];
+  const char *slash = strrchr(path_, '/');
+
+  if (slash == NULL) {
+    strcpy(dir, ".");
+    basename_ = path_;
+  } else {
+    size_t len = slash == path_ ? 1 : slash - path_;
+    if (len >= sizeof dir) return false;
+    memcpy(dir, path_, len);
+    dir[len] = '\0';
+    basename_ = slash + 1;
+  }
+
+  if (*basename_ == '\0' || !Inotify::Supported(dir)) return false;
+
+  dir_wd_ = Inotify::Watch(dir, true, OnInotify, this);
+  if (dir_wd_ < 0) return false;
+
+  Lstat(path_, &attr_);
+  WatchFile();
+
+  ev_timer_set(&debounce_, debounce, 0.);
+  inotify_ = true;
+
+  if (persistent_) ev_ref(EV_DEFAULT_UC);
+
+  return true;
+}
+
+
+void StatWatcher::WatchFile() {
+  file_wd_ = Inotify::Watch(path_, false, OnInotify, this);
+}
+
+
+void StatWatcher::StopInotify() {
+  assert(inotify_);
+
+  Inotify::Unwatch(file_wd_, OnInotify, this);
+  Inotify::Unwatch(dir_wd_, OnInotify, this);
+  file_wd_ = dir_wd_ = -1;
+
+  if (ev_is_active(&debounce_)) {
+    ev_ref(EV_DEFAULT_UC);
+    ev_timer_stop(EV_DEFAULT_UC_ &debounce_);
+  }
+
+  if (persistent_) ev_unref(EV_DEFAULT_UC);
+
+  inotify_ = false;
+}
+
+
+void StatWatcher::OnInotify(void *data, int wd, uint32_t mask,
+                            const char *name) {
+  StatWatcher *handler = static_cast<StatWatcher*>(data);
+
+  if (wd == handler->file_wd_) {
+    if (mask & IN_IGNORED) handler->file_wd_ = -1;
+  } else if (wd == handler->dir_wd_) {
+    if (mask & IN_IGNORED) {
+      handler->dir_wd_ = -1;
+    } else if (name == NULL || strcmp(name, handler->basename_) != 0) {
+      // Some other entry of the directory.
+      return;
+    }
+  }
+
+  if (!ev_is_active(&handler->debounce_)) {
+    ev_timer_start(EV_DEFAULT_UC_ &handler->debounce_);
+    ev_unref(EV_DEFAULT_UC);
+  }
+}
+
+
+void StatWatcher::OnDebounce(EV_P_ ev_timer *watcher, int revents) {
+  StatWatcher *handler = static_cast<StatWatcher*>(watcher->data);
+  assert(watcher == &handler->debounce_);
+  assert(revents == EV_TIMEOUT);
+
+  // The timer has stopped by itself.
+  ev_ref(EV_DEFAULT_UC);
+
+  HandleScope scope;
+
+  struct stat prev = handler->attr_;
+  Lstat(handler->path_, &handler->attr_);
+
+  // Follow the file when it was replaced, e.g. by an atomic rename.
+  if (handler->file_wd_ < 0 ||
+      handler->attr_.st_ino != prev.st_ino ||
+      handler->attr_.st_dev != prev.st_dev) {
+    Inotify::Unwatch(handler->file_wd_, OnInotify, handler);
+    handler->WatchFile();
+  }
+
+  if (handler->dir_wd_ < 0) {
+    // The directory itself went away; nothing will tell us when it comes
+    // back, so poll from now on.
+    handler->StopInotify();
+    handler->StartPolling(handler->interval_);
+    handler->handle_->Set(backend_symbol, String::New("poll"));
+  }
+
+  if (!StatChanged(&prev, &handler->attr_)) return;
+
+  Handle<Value> argv[2];
+  argv[0] = Handle<Value>(BuildStatsObject(&handler->attr_));
+  argv[1] = Handle<Value>(BuildStatsObject(&prev));
+  handler->Emit(change_symbol, 2, argv);
+}
+
+#endif  // HAVE_INOTIFY
+
+
 }  // namespace node
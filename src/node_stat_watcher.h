@@ -24,6 +24,7 @@
 
 #include <node.h>
 #include <node_events.h>
+#include <node_inotify.h>
 #include <ev.h>
 
 namespace node {
@@ -40,6 +41,12 @@ class StatWatcher : EventEmitter {
     path_ = NULL;
     ev_init(&watcher_, StatWatcher::Callback);
     watcher_.data = this;
+#ifdef HAVE_INOTIFY
+    inotify_ = false;
+    file_wd_ = dir_wd_ = -1;
+    ev_init(&debounce_, StatWatcher::OnDebounce);
+    debounce_.data = this;
+#endif
   }
 
   ~StatWatcher() {
@@ -54,11 +61,33 @@ class StatWatcher : EventEmitter {
  private:
   static void Callback(EV_P_ ev_stat *watcher, int revents);
 
+  void StartPolling(ev_tstamp interval);
   void Stop();
 
   ev_stat watcher_;
   bool persistent_;
   char *path_;
+
+#ifdef HAVE_INOTIFY
+  // The inotify backend watches both the file and its directory, so that
+  // the file being created, deleted or replaced by a rename is noticed.
+  // Events only start the debounce timer; the file is stat()ed once it
+  // expires and 'change' emitted if anything differs.
+  static void OnInotify(void *data, int wd, uint32_t mask, const char *name);
+  static void OnDebounce(EV_P_ ev_timer *watcher, int revents);
+
+  bool StartInotify(ev_tstamp debounce);
+  void WatchFile();
+  void StopInotify();
+
+  bool inotify_;
+  int file_wd_;
+  int dir_wd_;
+  const char *basename_;      // points into path_
+  ev_tstamp interval_;        // for falling back to polling
+  ev_timer debounce_;
+  struct stat attr_;
+#endif
 };
 
 }  // namespace node
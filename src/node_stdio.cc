@@ -21,6 +21,7 @@
 
 #include <node_stdio.h>
 #include <node_events.h>
+#include <node_buffer.h>
 
 #include <unistd.h>
 #include <fcntl.h>
@@ -38,7 +39,11 @@
 
 #include <termios.h>
 #include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <assert.h>
 
 using namespace v8;
 namespace node {
@@ -164,31 +169,363 @@ static Handle<Value> IsATTY (const Arguments& args) {
 }
 
 
-/* STDERR IS ALWAY SYNC ALWAYS UTF8 */
-static Handle<Value> WriteError (const Arguments& args) {
-  HandleScope scope;
+static bool IsBlocking(int fd) {
+  if (isatty(fd)) return false;
+  struct stat s;
+  if (fstat(fd, &s)) {
+    perror("fstat");
+    return true;
+  }
+  return !S_ISSOCK(s.st_mode) && !S_ISFIFO(s.st_mode);
+}
 
-  if (args.Length() < 1) {
-    return Undefined();
+
+// stderr used to be written synchronously, sleeping on EAGAIN, so a slow
+// reader on the other end of a pipe stalled the whole process. Now what a
+// pipe, socket or tty doesn't take right away waits in a ring buffer that
+// an ev_io watcher drains. Files are still written directly; they don't
+// have readers to wait for.
+//
+// What happens when the ring is full is up to the overflow policy: block
+// until the reader catches up (the default), drop the write, or grow the
+// ring.
+enum Overflow { OVERFLOW_BLOCK, OVERFLOW_DROP, OVERFLOW_GROW };
+
+#define STDERR_RING_SIZE (1024 * 1024)
+#define MIN(a,b) ((a) < (b) ? (a) : (b))
+
+static bool stderr_checked = false;
+static bool stderr_nonblocking = false;
+static int stderr_flags = -1;
+static enum Overflow stderr_overflow = OVERFLOW_BLOCK;
+static char *stderr_ring = NULL;
+static size_t stderr_capacity = STDERR_RING_SIZE;
+static size_t stderr_head = 0;  // offset of the oldest byte
+static size_t stderr_size = 0;  // bytes buffered
+static uint64_t stderr_written = 0;
+static uint64_t stderr_dropped = 0;
+static ev_io stderr_watcher;
+
+
+static void OnStderrWritable(EV_P_ ev_io *watcher, int revents);
+
+
+static void CheckStderr() {
+  if (stderr_checked) return;
+  stderr_checked = true;
+
+  ev_io_init(&stderr_watcher, OnStderrWritable, STDERR_FILENO, EV_WRITE);
+
+  if (IsBlocking(STDERR_FILENO)) return;
+
+  int flags = fcntl(STDERR_FILENO, F_GETFL, 0);
+  if (flags == -1) return;
+
+  if (!(flags & O_NONBLOCK)) {
+    if (fcntl(STDERR_FILENO, F_SETFL, flags | O_NONBLOCK) == -1) return;
+    stderr_flags = flags;
   }
 
-  String::Utf8Value msg(args[0]->ToString());
+  stderr_nonblocking = true;
+}
+
 
+static ssize_t WriteSome(const char *data, size_t length) {
   ssize_t r;
+  do {
+    r = write(STDERR_FILENO, data, length);
+  } while (r < 0 && errno == EINTR);
+  return r;
+}
+
+
+static void WaitWritable() {
+  struct pollfd p;
+  p.fd = STDERR_FILENO;
+  p.events = POLLOUT;
+  p.revents = 0;
+  poll(&p, 1, -1);
+}
+
+
+// Returns -1 with errno set on a real write error.
+static int WriteAllBlocking(const char *data, size_t length) {
   size_t written = 0;
-  while (written < (size_t) msg.length()) {
-    r = write(STDERR_FILENO, (*msg) + written, msg.length() - written);
+
+  while (written < length) {
+    ssize_t r = WriteSome(data + written, length - written);
     if (r < 0) {
-      if (errno == EAGAIN || errno == EIO) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        WaitWritable();
+        continue;
+      }
+      if (errno == EIO) {
         usleep(100);
         continue;
       }
-      return ThrowException(ErrnoException(errno, "write"));
+      return -1;
     }
-    written += (size_t)r;
+    written += r;
+    stderr_written += r;
   }
 
-  return True();
+  return 0;
+}
+
+
+static void UpdateStderrWatcher() {
+  bool active = ev_is_active(&stderr_watcher);
+
+  if (stderr_size > 0 && !active) {
+    ev_io_start(EV_DEFAULT_UC_ &stderr_watcher);
+    // Leftover output alone doesn't keep the process alive; it is written
+    // out at exit.
+    ev_unref(EV_DEFAULT_UC);
+  } else if (stderr_size == 0 && active) {
+    ev_ref(EV_DEFAULT_UC);
+    ev_io_stop(EV_DEFAULT_UC_ &stderr_watcher);
+  }
+}
+
+
+// Copies the buffered bytes, oldest first, into a new ring of the given
+// size.
+static bool ResizeRing(size_t capacity) {
+  assert(capacity >= stderr_size);
+
+  char *ring = static_cast<char*>(malloc(capacity));
+  if (ring == NULL) return false;
+
+  size_t first = MIN(stderr_size, stderr_capacity - stderr_head);
+  if (stderr_size > 0) {
+    memcpy(ring, stderr_ring + stderr_head, first);
+    memcpy(ring + first, stderr_ring, stderr_size - first);
+  }
+
+  free(stderr_ring);
+  stderr_ring = ring;
+  stderr_capacity = capacity;
+  stderr_head = 0;
+  return true;
+}
+
+
+static void PushRing(const char *data, size_t length) {
+  assert(stderr_size + length <= stderr_capacity);
+
+  size_t tail = (stderr_head + stderr_size) % stderr_capacity;
+  size_t first = MIN(length, stderr_capacity - tail);
+
+  memcpy(stderr_ring + tail, data, first);
+  memcpy(stderr_ring, data + first, length - first);
+  stderr_size += length;
+}
+
+
+// Writes out as much of the ring as the fd takes.
+static void FlushRing() {
+  while (stderr_size > 0) {
+    size_t chunk = MIN(stderr_size, stderr_capacity - stderr_head);
+    ssize_t r = WriteSome(stderr_ring + stderr_head, chunk);
+
+    if (r < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+      // Nobody is reading any more (EPIPE and the like); what is left
+      // can't be delivered.
+      stderr_dropped += stderr_size;
+      stderr_size = 0;
+      break;
+    }
+
+    stderr_head = (stderr_head + r) % stderr_capacity;
+    stderr_size -= r;
+    stderr_written += r;
+  }
+
+  if (stderr_size == 0) stderr_head = 0;
+
+  UpdateStderrWatcher();
+}
+
+
+static void OnStderrWritable(EV_P_ ev_io *watcher, int revents) {
+  assert(watcher == &stderr_watcher);
+  FlushRing();
+}
+
+
+// Returns 1 when the data was written or buffered, 0 when it was dropped
+// and -1 with errno set on a write error.
+static int StderrWrite(const char *data, size_t length) {
+  CheckStderr();
+
+  if (!stderr_nonblocking) return WriteAllBlocking(data, length) ? -1 : 1;
+
+  // Only write directly when nothing is queued, or output would be
+  // reordered.
+  if (stderr_size == 0) {
+    ssize_t r = WriteSome(data, length);
+    if (r < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) return -1;
+      r = 0;
+    }
+    stderr_written += r;
+    data += r;
+    length -= r;
+    if (length == 0) return 1;
+  }
+
+  if (stderr_size + length > stderr_capacity) {
+    switch (stderr_overflow) {
+      case OVERFLOW_BLOCK:
+        while (stderr_size > 0 && stderr_size + length > stderr_capacity) {
+          WaitWritable();
+          FlushRing();
+        }
+        if (length > stderr_capacity) {
+          return WriteAllBlocking(data, length) ? -1 : 1;
+        }
+        break;
+
+      case OVERFLOW_GROW: {
+        size_t capacity = stderr_capacity;
+        while (capacity < stderr_size + length) capacity *= 2;
+        if (!ResizeRing(capacity)) {
+          stderr_dropped += length;
+          return 0;
+        }
+        break;
+      }
+
+      case OVERFLOW_DROP:
+        stderr_dropped += length;
+        return 0;
+    }
+  }
+
+  if (stderr_ring == NULL) {
+    stderr_ring = static_cast<char*>(malloc(stderr_capacity));
+    if (stderr_ring == NULL) {
+      stderr_dropped += length;
+      return 0;
+    }
+  }
+
+  PushRing(data, length);
+  UpdateStderrWatcher();
+  return 1;
+}
+
+
+// Blocks until everything buffered for stderr is written and puts the fd
+// back in blocking mode, so that fprintf(stderr) lands after it. The next
+// write sets things up again.
+void Stdio::FlushStderr() {
+  if (!stderr_checked) return;
+
+  while (stderr_size > 0) {
+    WaitWritable();
+    FlushRing();
+  }
+
+  if (stderr_flags != -1) {
+    fcntl(STDERR_FILENO, F_SETFL, stderr_flags);
+    stderr_flags = -1;
+  }
+
+  stderr_nonblocking = false;
+  stderr_checked = false;
+}
+
+
+// process.binding('stdio').writeError(data, [encoding]);
+// Returns false if the data was dropped.
+static Handle<Value> WriteError (const Arguments& args) {
+  HandleScope scope;
+
+  if (args.Length() < 1) {
+    return Undefined();
+  }
+
+  int r;
+
+  if (Buffer::HasInstance(args[0])) {
+    Local<Object> buffer = args[0]->ToObject();
+    r = StderrWrite(Buffer::Data(buffer), Buffer::Length(buffer));
+  } else {
+    enum encoding encoding = ParseEncoding(args[1], UTF8);
+
+    if (encoding == UTF8) {
+      String::Utf8Value msg(args[0]->ToString());
+      r = StderrWrite(*msg, msg.length());
+    } else {
+      Local<String> msg = args[0]->ToString();
+      ssize_t length = DecodeBytes(msg, encoding);
+      char *data = new char[length];
+      DecodeWrite(data, length, msg, encoding);
+      r = StderrWrite(data, length);
+      delete [] data;
+    }
+  }
+
+  if (r < 0) return ThrowException(ErrnoException(errno, "write"));
+
+  return r ? True() : False();
+}
+
+
+// process.binding('stdio').setStderrOverflow(policy, [size]);
+// policy is 'block', 'drop' or 'grow'; size is that of the ring buffer.
+static Handle<Value> SetStderrOverflow (const Arguments& args) {
+  HandleScope scope;
+
+  String::Utf8Value policy(args[0]->ToString());
+
+  if (strcmp(*policy, "block") == 0) {
+    stderr_overflow = OVERFLOW_BLOCK;
+  } else if (strcmp(*policy, "drop") == 0) {
+    stderr_overflow = OVERFLOW_DROP;
+  } else if (strcmp(*policy, "grow") == 0) {
+    stderr_overflow = OVERFLOW_GROW;
+  } else {
+    return ThrowException(Exception::TypeError(
+          String::New("Overflow policy must be 'block', 'drop' or 'grow'")));
+  }
+
+  if (args[1]->IsUint32()) {
+    size_t capacity = args[1]->Uint32Value();
+
+    if (capacity == 0 || capacity < stderr_size) {
+      return ThrowException(Exception::RangeError(
+            String::New("Buffer size is smaller than what is buffered")));
+    }
+
+    if (stderr_ring == NULL) {
+      stderr_capacity = capacity;
+    } else if (!ResizeRing(capacity)) {
+      return ThrowException(ErrnoException(ENOMEM, "malloc"));
+    }
+  }
+
+  return Undefined();
+}
+
+
+// process.binding('stdio').stderrStats();
+static Handle<Value> StderrStats (const Arguments& args) {
+  HandleScope scope;
+
+  Local<Object> stats = Object::New();
+  stats->Set(String::NewSymbol("buffered"),
+             Integer::NewFromUnsigned(stderr_size));
+  stats->Set(String::NewSymbol("capacity"),
+             Integer::NewFromUnsigned(stderr_capacity));
+  stats->Set(String::NewSymbol("written"),
+             Number::New(static_cast<double>(stderr_written)));
+  stats->Set(String::NewSymbol("dropped"),
+             Number::New(static_cast<double>(stderr_dropped)));
+
+  return scope.Close(stats);
 }
 
 
@@ -215,17 +552,6 @@ static Handle<Value> OpenStdin(const Arguments& args) {
 }
 
 
-static bool IsBlocking(int fd) {
-  if (isatty(fd)) return false;
-  struct stat s;
-  if (fstat(fd, &s)) {
-    perror("fstat");
-    return true;
-  }
-  return !S_ISSOCK(s.st_mode) && !S_ISFIFO(s.st_mode);
-}
-
-
 static Handle<Value> IsStdinBlocking(const Arguments& arg) {
   return IsBlocking(STDIN_FILENO) ? True() : False();
 }
@@ -275,6 +601,8 @@ typedef void (*sighandler)(int);
 
 
 void Stdio::Flush() {
+  FlushStderr();
+
   if (stdin_flags != -1) {
     fcntl(STDIN_FILENO, F_SETFL, stdin_flags & ~O_NONBLOCK);
   }
@@ -310,6 +638,8 @@ void Stdio::Initialize(v8::Handle<v8::Object> target) {
   target->Set(String::NewSymbol("stdinFD"), Integer::New(STDIN_FILENO));
 
   NODE_SET_METHOD(target, "writeError", WriteError);
+  NODE_SET_METHOD(target, "setStderrOverflow", SetStderrOverflow);
+  NODE_SET_METHOD(target, "stderrStats", StderrStats);
   NODE_SET_METHOD(target, "openStdin", OpenStdin);
   NODE_SET_METHOD(target, "isStdoutBlocking", IsStdoutBlocking);
   NODE_SET_METHOD(target, "isStdinBlocking", IsStdinBlocking);
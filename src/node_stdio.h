@@ -31,6 +31,7 @@ class Stdio  {
 public:
   static void Initialize (v8::Handle<v8::Object> target);
   static void Flush ();
+  static void FlushStderr ();
   static void DisableRawMode(int fd);
 };
 
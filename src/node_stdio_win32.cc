@@ -148,6 +148,10 @@ void Stdio::Flush() {
 }
 
 
+void Stdio::FlushStderr() {
+}
+
+
 /*
  * STDERR should always be blocking
  */
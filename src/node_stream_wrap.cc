@@ -0,0 +1,293 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <node_stream_wrap.h>
+#include <node_buffer.h>
+
+#include <assert.h>
+#include <errno.h>
+
+namespace node {
+
+using namespace v8;
+
+// Reads are carved out of one large SlowBuffer; JavaScript gets a slice of
+// it per chunk instead of a buffer per read.
+#define SLAB_SIZE (1024 * 1024)
+
+static Persistent<Object> slab;
+static size_t slab_used;
+
+static Persistent<String> onread_symbol;
+static Persistent<String> oncomplete_symbol;
+static Persistent<String> buffer_symbol;
+static Persistent<String> write_queue_size_symbol;
+
+
+ReqWrap::ReqWrap(StreamWrap *stream, const char *syscall, void *cb)
+    : stream_(stream), syscall_(syscall), prev_(NULL) {
+  object_ = Persistent<Object>::New(Object::New());
+
+  uv_req_init(&req_, stream->uv_handle_, cb);
+  req_.data = this;
+
+  next_ = stream->reqs_;
+  if (next_) next_->prev_ = this;
+  stream->reqs_ = this;
+}
+
+
+ReqWrap::~ReqWrap() {
+  if (prev_) {
+    prev_->next_ = next_;
+  } else {
+    stream_->reqs_ = next_;
+  }
+  if (next_) next_->prev_ = prev_;
+
+  object_.Dispose();
+  object_.Clear();
+}
+
+
+void ReqWrap::Complete(int status) {
+  HandleScope scope;
+
+  Handle<Value> argv[3];
+  argv[0] = status == 0 ? Handle<Value>(Null()) : UVException(syscall_);
+  argv[1] = stream_->handle_;
+  argv[2] = object_;
+
+  MakeCallback(object_, oncomplete_symbol, 3, argv);
+
+  delete this;
+}
+
+
+void StreamWrap::Initialize(Handle<Object> target) {
+  HandleScope scope;
+
+  onread_symbol = NODE_PSYMBOL("onread");
+  oncomplete_symbol = NODE_PSYMBOL("oncomplete");
+  buffer_symbol = NODE_PSYMBOL("buffer");
+  write_queue_size_symbol = NODE_PSYMBOL("writeQueueSize");
+}
+
+
+StreamWrap::StreamWrap(Handle<Object> object, uv_handle_t *handle)
+    : HandleWrap(object, handle), reqs_(NULL), shut_(false) {
+}
+
+
+StreamWrap::~StreamWrap() {
+  assert(reqs_ == NULL);
+}
+
+
+void StreamWrap::OnClose() {
+  // libuv forgets requests that were still queued on a closed handle.
+  while (reqs_) delete reqs_;
+}
+
+
+void StreamWrap::UpdateWriteQueueSize() {
+  HandleScope scope;
+  handle_->Set(write_queue_size_symbol,
+               Integer::NewFromUnsigned(uv_handle_->write_queue_size));
+}
+
+
+uv_buf StreamWrap::Alloc(uv_handle_t *handle, size_t suggested_size) {
+  assert(suggested_size <= SLAB_SIZE);
+
+  if (slab.IsEmpty() || slab_used + suggested_size > SLAB_SIZE) {
+    HandleScope scope;
+
+    // Slices handed out earlier keep the old slab alive.
+    if (!slab.IsEmpty()) {
+      slab.Dispose();
+      slab.Clear();
+    }
+
+    Buffer *b = Buffer::New(SLAB_SIZE);
+    slab = Persistent<Object>::New(b->handle_);
+    slab_used = 0;
+  }
+
+  uv_buf buf;
+  buf.base = Buffer::Data(slab) + slab_used;
+  buf.len = suggested_size;
+  return buf;
+}
+
+
+void StreamWrap::OnRead(uv_handle_t *handle, int nread, uv_buf buf) {
+  StreamWrap *wrap = static_cast<StreamWrap*>(handle->data);
+  assert(wrap->uv_handle_ == handle);
+
+  // EAGAIN; the space is handed out again on the next read.
+  if (nread == 0) return;
+
+  HandleScope scope;
+
+  if (nread < 0) {
+    Handle<Value> argv[2];
+    argv[0] = Null();
+
+    if (uv_last_error().code == UV_EOF) {
+      argv[1] = Null();
+      // Once both sides are shut down libuv closes the handle itself.
+      if (wrap->shut_) wrap->SetClosing();
+    } else {
+      argv[1] = UVException("read");
+      wrap->SetClosing();
+    }
+
+    MakeCallback(wrap->handle_, onread_symbol, 2, argv);
+    return;
+  }
+
+  assert(buf.base == Buffer::Data(slab) + slab_used);
+
+  Handle<Value> argv[3];
+  argv[0] = slab;
+  argv[1] = Integer::NewFromUnsigned(slab_used);
+  argv[2] = Integer::New(nread);
+
+  slab_used += nread;
+
+  MakeCallback(wrap->handle_, onread_symbol, 3, argv);
+}
+
+
+Handle<Value> StreamWrap::ReadStart(const Arguments& args) {
+  HandleScope scope;
+  StreamWrap *wrap = ObjectWrap::Unwrap<StreamWrap>(args.Holder());
+
+  if (wrap->IsClosing()) {
+    return ThrowException(ErrnoException(EBADF, "read"));
+  }
+
+  if (uv_read_start(wrap->uv_handle_, OnRead)) {
+    return ThrowException(UVException("read"));
+  }
+
+  return Undefined();
+}
+
+
+Handle<Value> StreamWrap::ReadStop(const Arguments& args) {
+  HandleScope scope;
+  StreamWrap *wrap = ObjectWrap::Unwrap<StreamWrap>(args.Holder());
+
+  if (!wrap->IsClosing()) uv_read_stop(wrap->uv_handle_);
+
+  return Undefined();
+}
+
+
+// var req = handle.write(buffer);
+Handle<Value> StreamWrap::Write(const Arguments& args) {
+  HandleScope scope;
+  StreamWrap *wrap = ObjectWrap::Unwrap<StreamWrap>(args.Holder());
+
+  if (!Buffer::HasInstance(args[0])) {
+    return ThrowException(Exception::TypeError(
+          String::New("First argument should be a buffer")));
+  }
+
+  Local<Object> buffer = args[0]->ToObject();
+  size_t length = Buffer::Length(buffer);
+
+  // libuv never completes a write of nothing.
+  if (length == 0) {
+    return ThrowException(Exception::Error(
+          String::New("Cannot write an empty buffer")));
+  }
+
+  if (wrap->IsClosing()) {
+    return ThrowException(ErrnoException(EBADF, "write"));
+  }
+
+  ReqWrap *req = new ReqWrap(wrap, "write", (void*)AfterWrite);
+  req->object_->Set(buffer_symbol, buffer);
+
+  uv_buf buf;
+  buf.base = Buffer::Data(buffer);
+  buf.len = length;
+
+  if (uv_write(&req->req_, &buf, 1)) {
+    delete req;
+    return ThrowException(UVException("write"));
+  }
+
+  wrap->UpdateWriteQueueSize();
+
+  return scope.Close(req->object_);
+}
+
+
+void StreamWrap::AfterWrite(uv_req_t *r, int status) {
+  ReqWrap *req = static_cast<ReqWrap*>(r->data);
+  StreamWrap *wrap = req->stream_;
+
+  if (status) wrap->SetClosing();
+  wrap->UpdateWriteQueueSize();
+
+  req->Complete(status);
+}
+
+
+// var req = handle.shutdown();
+Handle<Value> StreamWrap::Shutdown(const Arguments& args) {
+  HandleScope scope;
+  StreamWrap *wrap = ObjectWrap::Unwrap<StreamWrap>(args.Holder());
+
+  if (wrap->IsClosing()) {
+    return ThrowException(ErrnoException(EBADF, "shutdown"));
+  }
+
+  ReqWrap *req = new ReqWrap(wrap, "shutdown", (void*)AfterShutdown);
+
+  if (uv_shutdown(&req->req_)) {
+    delete req;
+    return ThrowException(UVException("shutdown"));
+  }
+
+  return scope.Close(req->object_);
+}
+
+
+void StreamWrap::AfterShutdown(uv_req_t *r, int status) {
+  ReqWrap *req = static_cast<ReqWrap*>(r->data);
+  StreamWrap *wrap = req->stream_;
+
+  if (status) {
+    wrap->SetClosing();
+  } else {
+    wrap->shut_ = true;
+  }
+
+  req->Complete(status);
+}
+
+
+}  // namespace node
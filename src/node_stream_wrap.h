@@ -0,0 +1,100 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef NODE_STREAM_WRAP_H_
+#define NODE_STREAM_WRAP_H_
+
+#include <node_handle_wrap.h>
+#include <v8.h>
+#include <uv.h>
+
+namespace node {
+
+class StreamWrap;
+
+// An outstanding write, shutdown or connect. The JavaScript object it
+// returns carries the oncomplete callback and keeps the written buffer
+// alive until libuv is done with it:
+//
+//   var req = handle.write(buffer);
+//   req.oncomplete = function(err, handle, req) { ... };
+//
+class ReqWrap {
+ public:
+  ReqWrap(StreamWrap *stream, const char *syscall, void *cb);
+  ~ReqWrap();
+
+  // Calls oncomplete and deletes the request.
+  void Complete(int status);
+
+  v8::Persistent<v8::Object> object_;
+  uv_req_t req_;
+
+ private:
+  friend class StreamWrap;
+
+  StreamWrap *stream_;
+  const char *syscall_;
+  ReqWrap *prev_;
+  ReqWrap *next_;
+};
+
+
+// A handle that reads and writes bytes. Reads land in a shared slab
+// buffer and reach JavaScript as
+//
+//   handle.onread = function(slab, offset, length) { ... };
+//
+// with onread(null, err) once the stream ends; err is null for EOF.
+class StreamWrap : public HandleWrap {
+ public:
+  static void Initialize(v8::Handle<v8::Object> target);
+
+  // The allocator handed to uv_init(): slices the current slab.
+  static uv_buf Alloc(uv_handle_t *handle, size_t suggested_size);
+
+  static v8::Handle<v8::Value> ReadStart(const v8::Arguments& args);
+  static v8::Handle<v8::Value> ReadStop(const v8::Arguments& args);
+  static v8::Handle<v8::Value> Write(const v8::Arguments& args);
+  static v8::Handle<v8::Value> Shutdown(const v8::Arguments& args);
+
+ protected:
+  StreamWrap(v8::Handle<v8::Object> object, uv_handle_t *handle);
+  virtual ~StreamWrap();
+
+  virtual void OnClose();
+
+  void UpdateWriteQueueSize();
+
+ private:
+  friend class ReqWrap;
+
+  static void OnRead(uv_handle_t *handle, int nread, uv_buf buf);
+  static void AfterWrite(uv_req_t *req, int status);
+  static void AfterShutdown(uv_req_t *req, int status);
+
+  ReqWrap *reqs_;
+  bool shut_;
+};
+
+}  // namespace node
+
+#endif  // NODE_STREAM_WRAP_H_
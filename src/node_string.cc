@@ -21,10 +21,65 @@
 
 #include "node_string.h"
 
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
 namespace node {
 
 using namespace v8;
 
+size_t external_string_threshold = 1024 * 1024;
+
+
+bool IsAscii(const char *src, size_t len) {
+  const char *end = src + len;
+
+  // Check a word at a time once src is aligned.
+  while (src < end && (reinterpret_cast<uintptr_t>(src) & (sizeof(long) - 1))) {
+    if (*src++ & 0x80) return false;
+  }
+
+  const unsigned long mask = static_cast<unsigned long>(0x8080808080808080ULL);
+  while (static_cast<size_t>(end - src) >= sizeof(long)) {
+    if (*reinterpret_cast<const unsigned long*>(src) & mask) return false;
+    src += sizeof(long);
+  }
+
+  while (src < end) {
+    if (*src++ & 0x80) return false;
+  }
+
+  return true;
+}
+
+
+Local<String> ImmutableAsciiCopy::New(const char *src, size_t src_len) {
+  if (external_string_threshold == 0 ||
+      src_len < external_string_threshold ||
+      !IsAscii(src, src_len)) {
+    return Local<String>();
+  }
+
+  char *copy = static_cast<char*>(malloc(src_len));
+  if (copy == NULL) return Local<String>();
+  memcpy(copy, src, src_len);
+
+  return Adopt(copy, src_len);
+}
+
+
+Local<String> ImmutableAsciiCopy::Adopt(char *src, size_t src_len) {
+  V8::AdjustAmountOfExternalAllocatedMemory(static_cast<int>(src_len));
+  return String::NewExternal(new ImmutableAsciiCopy(src, src_len));
+}
+
+
+ImmutableAsciiCopy::~ImmutableAsciiCopy() {
+  free(buffer_);
+  V8::AdjustAmountOfExternalAllocatedMemory(-static_cast<int>(buf_len_));
+}
+
 Handle<String> ImmutableAsciiSource::CreateFromLiteral(
     const char *string_literal,
     size_t length) {
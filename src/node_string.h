@@ -58,6 +58,49 @@ class ImmutableAsciiSource : public v8::String::ExternalAsciiStringResource {
   size_t buf_len_;
 };
 
+// Strings of at least this many bytes are created as external strings
+// backed by memory outside the V8 heap, when their contents allow it.
+// Zero disables external strings.
+extern size_t external_string_threshold;
+
+// Returns true when every byte of src is 7-bit ASCII.
+bool IsAscii(const char *src, size_t len);
+
+// External one-byte string resource that owns a private, immutable copy of
+// its data. The copy lives outside the V8 heap and is released only when
+// the string is garbage collected, so large strings neither get copied
+// around by the scavenger nor count against the heap limit.
+class ImmutableAsciiCopy : public v8::String::ExternalAsciiStringResource {
+ public:
+  // Returns an external string for src, or an empty handle when src is
+  // shorter than external_string_threshold or is not pure ASCII; callers
+  // then fall back to a regular heap string.
+  static v8::Local<v8::String> New(const char *src, size_t src_len);
+
+  // Returns an external string which takes ownership of src, a malloc()ed
+  // block of 7-bit ASCII, without copying it.
+  static v8::Local<v8::String> Adopt(char *src, size_t src_len);
+
+  ~ImmutableAsciiCopy();
+
+  const char *data() const {
+      return buffer_;
+  }
+
+  size_t length() const {
+      return buf_len_;
+  }
+
+ private:
+  ImmutableAsciiCopy(char *src, size_t src_len)
+      : buffer_(src),
+        buf_len_(src_len) {
+  }
+
+  char *buffer_;
+  size_t buf_len_;
+};
+
 }  // namespace node
 
 #endif  // SRC_NODE_STRING_H_
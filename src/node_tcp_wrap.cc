@@ -0,0 +1,273 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <node_tcp_wrap.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+#ifdef __POSIX__
+# include <arpa/inet.h>
+# include <netinet/in.h>
+# include <netinet/tcp.h>
+# include <sys/socket.h>
+#endif
+
+namespace node {
+
+using namespace v8;
+
+static Persistent<FunctionTemplate> constructor_template;
+
+static Persistent<String> onconnection_symbol;
+static Persistent<String> address_symbol;
+static Persistent<String> port_symbol;
+
+
+void TCPWrap::Initialize(Handle<Object> target) {
+  HandleScope scope;
+
+  StreamWrap::Initialize(target);
+
+  Local<FunctionTemplate> t = FunctionTemplate::New(TCPWrap::New);
+  constructor_template = Persistent<FunctionTemplate>::New(t);
+  constructor_template->InstanceTemplate()->SetInternalFieldCount(1);
+  constructor_template->SetClassName(String::NewSymbol("TCP"));
+
+  onconnection_symbol = NODE_PSYMBOL("onconnection");
+  address_symbol = NODE_PSYMBOL("address");
+  port_symbol = NODE_PSYMBOL("port");
+
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "close", HandleWrap::Close);
+
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "readStart",
+                            StreamWrap::ReadStart);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "readStop",
+                            StreamWrap::ReadStop);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "write", StreamWrap::Write);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "shutdown",
+                            StreamWrap::Shutdown);
+
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "bind", TCPWrap::Bind);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "listen", TCPWrap::Listen);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "connect", TCPWrap::Connect);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "getsockname",
+                            TCPWrap::GetSockName);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "getpeername",
+                            TCPWrap::GetPeerName);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "setNoDelay",
+                            TCPWrap::SetNoDelay);
+
+  target->Set(String::NewSymbol("TCP"), constructor_template->GetFunction());
+}
+
+
+TCPWrap::TCPWrap(Handle<Object> object) : StreamWrap(object, &socket_) {
+  int r = uv_tcp_init(&socket_, AfterClose, this);
+  assert(r == 0);
+}
+
+
+Handle<Value> TCPWrap::New(const Arguments& args) {
+  if (!args.IsConstructCall()) {
+    return FromConstructorTemplate(constructor_template, args);
+  }
+
+  HandleScope scope;
+  new TCPWrap(args.This());
+  return args.This();
+}
+
+
+// handle.bind(ip, port)
+Handle<Value> TCPWrap::Bind(const Arguments& args) {
+  HandleScope scope;
+  TCPWrap *wrap = ObjectWrap::Unwrap<TCPWrap>(args.Holder());
+
+  String::AsciiValue ip(args[0]->ToString());
+  int port = args[1]->Int32Value();
+
+  struct sockaddr_in address = uv_ip4_addr(*ip, port);
+
+  // EADDRINUSE is only reported by listen().
+  if (uv_bind(&wrap->socket_, (struct sockaddr*) &address)) {
+    return ThrowException(UVException("bind"));
+  }
+
+  return Undefined();
+}
+
+
+// handle.listen(backlog)
+Handle<Value> TCPWrap::Listen(const Arguments& args) {
+  HandleScope scope;
+  TCPWrap *wrap = ObjectWrap::Unwrap<TCPWrap>(args.Holder());
+
+  int backlog = args[0]->IsInt32() ? args[0]->Int32Value() : 128;
+
+  if (uv_listen(&wrap->socket_, backlog, OnConnection)) {
+    return ThrowException(UVException("listen"));
+  }
+
+  return Undefined();
+}
+
+
+void TCPWrap::OnConnection(uv_handle_t *handle) {
+  TCPWrap *wrap = static_cast<TCPWrap*>(handle->data);
+  assert(&wrap->socket_ == handle);
+
+  HandleScope scope;
+
+  Local<Object> client_obj =
+      constructor_template->GetFunction()->NewInstance();
+  TCPWrap *client = ObjectWrap::Unwrap<TCPWrap>(client_obj);
+
+  if (uv_accept(handle, &client->socket_, AfterClose, client)) {
+    // Nothing to hand out; let the unused wrapper go.
+    client->SetClosing();
+    uv_close(&client->socket_);
+    return;
+  }
+
+  Handle<Value> argv[1] = { client_obj };
+  MakeCallback(wrap->handle_, onconnection_symbol, 1, argv);
+}
+
+
+// var req = handle.connect(ip, port)
+Handle<Value> TCPWrap::Connect(const Arguments& args) {
+  HandleScope scope;
+  TCPWrap *wrap = ObjectWrap::Unwrap<TCPWrap>(args.Holder());
+
+  if (wrap->IsClosing()) {
+    return ThrowException(ErrnoException(EBADF, "connect"));
+  }
+
+  String::AsciiValue ip(args[0]->ToString());
+  int port = args[1]->Int32Value();
+
+  struct sockaddr_in address = uv_ip4_addr(*ip, port);
+
+  ReqWrap *req = new ReqWrap(wrap, "connect", (void*)AfterConnect);
+
+  if (uv_connect(&req->req_, (struct sockaddr*) &address)) {
+    delete req;
+    return ThrowException(UVException("connect"));
+  }
+
+  return scope.Close(req->object_);
+}
+
+
+void TCPWrap::AfterConnect(uv_req_t *r, int status) {
+  ReqWrap *req = static_cast<ReqWrap*>(r->data);
+  TCPWrap *wrap = static_cast<TCPWrap*>(r->handle->data);
+
+  // A failed connect is followed by libuv closing the handle.
+  if (status) wrap->SetClosing();
+
+  req->Complete(status);
+}
+
+
+#ifdef __POSIX__
+
+static Local<Object> AddressToJS(const struct sockaddr_in *address) {
+  char ip[INET_ADDRSTRLEN];
+  inet_ntop(AF_INET, &address->sin_addr, ip, sizeof ip);
+
+  Local<Object> info = Object::New();
+  info->Set(address_symbol, String::New(ip));
+  info->Set(port_symbol, Integer::New(ntohs(address->sin_port)));
+  return info;
+}
+
+
+Handle<Value> TCPWrap::GetSockName(const Arguments& args) {
+  HandleScope scope;
+  TCPWrap *wrap = ObjectWrap::Unwrap<TCPWrap>(args.Holder());
+
+  struct sockaddr_in address;
+  socklen_t len = sizeof address;
+
+  if (getsockname(wrap->socket_.fd, (struct sockaddr*) &address, &len)) {
+    return ThrowException(ErrnoException(errno, "getsockname"));
+  }
+
+  return scope.Close(AddressToJS(&address));
+}
+
+
+Handle<Value> TCPWrap::GetPeerName(const Arguments& args) {
+  HandleScope scope;
+  TCPWrap *wrap = ObjectWrap::Unwrap<TCPWrap>(args.Holder());
+
+  struct sockaddr_in address;
+  socklen_t len = sizeof address;
+
+  if (getpeername(wrap->socket_.fd, (struct sockaddr*) &address, &len)) {
+    return ThrowException(ErrnoException(errno, "getpeername"));
+  }
+
+  return scope.Close(AddressToJS(&address));
+}
+
+
+Handle<Value> TCPWrap::SetNoDelay(const Arguments& args) {
+  HandleScope scope;
+  TCPWrap *wrap = ObjectWrap::Unwrap<TCPWrap>(args.Holder());
+
+  int flags = args[0]->IsFalse() ? 0 : 1;
+
+  if (setsockopt(wrap->socket_.fd, IPPROTO_TCP, TCP_NODELAY,
+                 (void *)&flags, sizeof(flags))) {
+    return ThrowException(ErrnoException(errno, "setsockopt"));
+  }
+
+  return Undefined();
+}
+
+#else  // __MINGW32__
+
+// uv-win keeps the socket elsewhere; not wired up yet.
+
+Handle<Value> TCPWrap::GetSockName(const Arguments& args) {
+  return ThrowException(ErrnoException(ENOSYS, "getsockname"));
+}
+
+
+Handle<Value> TCPWrap::GetPeerName(const Arguments& args) {
+  return ThrowException(ErrnoException(ENOSYS, "getpeername"));
+}
+
+
+Handle<Value> TCPWrap::SetNoDelay(const Arguments& args) {
+  return Undefined();
+}
+
+#endif  // __POSIX__
+
+
+}  // namespace node
+
+NODE_MODULE(node_tcp_wrap, node::TCPWrap::Initialize);
@@ -0,0 +1,66 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef NODE_TCP_WRAP_H_
+#define NODE_TCP_WRAP_H_
+
+#include <node_stream_wrap.h>
+#include <v8.h>
+#include <uv.h>
+
+namespace node {
+
+// process.binding('tcp_wrap').TCP: an IPv4 TCP socket driven by libuv.
+//
+//   var server = new TCP();
+//   server.bind('0.0.0.0', 8000);
+//   server.onconnection = function(client) { client.readStart(); };
+//   server.listen(511);
+//
+//   var client = new TCP();
+//   var req = client.connect('127.0.0.1', 8000);
+//   req.oncomplete = function(err, handle, req) { ... };
+//
+class TCPWrap : public StreamWrap {
+ public:
+  static void Initialize(v8::Handle<v8::Object> target);
+
+ protected:
+  TCPWrap(v8::Handle<v8::Object> object);
+
+  static v8::Handle<v8::Value> New(const v8::Arguments& args);
+  static v8::Handle<v8::Value> Bind(const v8::Arguments& args);
+  static v8::Handle<v8::Value> Listen(const v8::Arguments& args);
+  static v8::Handle<v8::Value> Connect(const v8::Arguments& args);
+  static v8::Handle<v8::Value> GetSockName(const v8::Arguments& args);
+  static v8::Handle<v8::Value> GetPeerName(const v8::Arguments& args);
+  static v8::Handle<v8::Value> SetNoDelay(const v8::Arguments& args);
+
+ private:
+  static void OnConnection(uv_handle_t *handle);
+  static void AfterConnect(uv_req_t *req, int status);
+
+  uv_handle_t socket_;
+};
+
+}  // namespace node
+
+#endif  // NODE_TCP_WRAP_H_
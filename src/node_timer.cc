@@ -21,6 +21,8 @@
 
 #include <node.h>
 #include <node_timer.h>
+#include <node_loop_stats.h>
+#include <node_probes.h>
 #include <assert.h>
 
 namespace node {
@@ -88,6 +90,17 @@ void Timer::OnTimeout(EV_P_ ev_timer *watcher, int revents) {
 
   assert(revents == EV_TIMEOUT);
 
+  ev_tstamp now = ev_time();
+  LoopStats::RecordTimerLateness(now - timer->due_);
+  if (NODE_TIMER_FIRE_ENABLED()) {
+    NODE_TIMER_FIRE((int)(watcher->repeat * 1000),
+                    (int)((now - timer->due_) * 1e6));
+  }
+  if (watcher->repeat > 0) {
+    timer->due_ += watcher->repeat;
+    if (timer->due_ < now) timer->due_ = now;
+  }
+
   HandleScope scope;
 
   Local<Value> callback_v = timer->handle_->Get(callback_symbol);
@@ -145,6 +158,7 @@ Handle<Value> Timer::Start(const Arguments& args) {
   // Update the event loop time. Need to call this because processing JS can
   // take non-negligible amounts of time.
   ev_now_update(EV_DEFAULT_UC);
+  timer->due_ = ev_now(EV_DEFAULT_UC) + after;
 
   ev_timer_start(EV_DEFAULT_UC_ &timer->watcher_);
 
@@ -182,6 +196,7 @@ Handle<Value> Timer::Again(const Arguments& args) {
   }
 
   ev_timer_again(EV_DEFAULT_UC_ &timer->watcher_);
+  timer->due_ = ev_now(EV_DEFAULT_UC) + timer->watcher_.repeat;
 
   // ev_timer_again can start or stop the watcher.
   // So we need to check what happened and adjust the ref count
@@ -40,6 +40,7 @@ class Timer : ObjectWrap {
     // dummy timeout values
     ev_timer_init(&watcher_, OnTimeout, 0., 1.);
     watcher_.data = this;
+    due_ = 0;
   }
 
   ~Timer();
@@ -58,6 +59,7 @@ class Timer : ObjectWrap {
   static void OnTimeout(EV_P_ ev_timer *watcher, int revents);
   void Stop();
   ev_timer watcher_;
+  ev_tstamp due_;  // when the callback should run, for LoopStats
 };
 
 }  // namespace node
@@ -0,0 +1,478 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <node_tree_watcher.h>
+
+#ifdef HAVE_INOTIFY
+
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define DIR_BUCKETS 256
+#define CHANGE_BUCKETS 256
+
+namespace node {
+
+using namespace v8;
+
+struct TreeWatcher::Dir {
+  int wd;
+  char *path;                 // relative to root_, "" for the root
+  Dir *next;
+};
+
+struct TreeWatcher::Change {
+  char *path;
+  bool rename;
+  Change *next;               // hash chain
+  Change *next_in_order;
+};
+
+Persistent<FunctionTemplate> TreeWatcher::constructor_template;
+
+static Persistent<String> change_symbol;
+static Persistent<String> change_type_symbol;
+static Persistent<String> rename_type_symbol;
+
+
+static unsigned HashPath(const char *s) {
+  unsigned h = 5381;
+  while (*s) h = h * 33 + (unsigned char)*s++;
+  return h;
+}
+
+
+static char* JoinPath(const char *dir, const char *name) {
+  if (*dir == '\0') return strdup(name);
+  size_t len = strlen(dir) + 1 + strlen(name) + 1;
+  char *s = static_cast<char*>(malloc(len));
+  strcpy(s, dir);
+  strcat(s, "/");
+  strcat(s, name);
+  return s;
+}
+
+
+static bool UnderPath(const char *path, const char *dir) {
+  size_t len = strlen(dir);
+  return strncmp(path, dir, len) == 0 &&
+         (path[len] == '\0' || path[len] == '/');
+}
+
+
+void TreeWatcher::Initialize(Handle<Object> target) {
+  HandleScope scope;
+
+  Local<FunctionTemplate> t = FunctionTemplate::New(TreeWatcher::New);
+  constructor_template = Persistent<FunctionTemplate>::New(t);
+  constructor_template->Inherit(EventEmitter::constructor_template);
+  constructor_template->InstanceTemplate()->SetInternalFieldCount(1);
+  constructor_template->SetClassName(String::NewSymbol("TreeWatcher"));
+
+  change_symbol = NODE_PSYMBOL("change");
+  change_type_symbol = NODE_PSYMBOL("change");
+  rename_type_symbol = NODE_PSYMBOL("rename");
+
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "start", TreeWatcher::Start);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "stop", TreeWatcher::Stop);
+
+  target->Set(String::NewSymbol("TreeWatcher"),
+              constructor_template->GetFunction());
+}
+
+
+TreeWatcher::TreeWatcher() : EventEmitter() {
+  root_ = NULL;
+  active_ = persistent_ = overflow_ = false;
+  dirs_ = NULL;
+  changes_ = NULL;
+  changes_head_ = changes_tail_ = scan_ = NULL;
+  ev_init(&debounce_, TreeWatcher::OnDebounce);
+  debounce_.data = this;
+}
+
+
+TreeWatcher::~TreeWatcher() {
+  Stop();
+}
+
+
+TreeWatcher::Dir** TreeWatcher::FindDir(int wd) {
+  Dir **link = &dirs_[(unsigned)wd % DIR_BUCKETS];
+  while (*link && (*link)->wd != wd) link = &(*link)->next;
+  return link;
+}
+
+
+// Watches the directory `rel` and, recursively, the directories below it.
+// With `report` set every entry found is recorded as a rename; used for
+// directories created after the watch started, whose contents may have
+// been written before we got to them. Returns false if `rel` itself could
+// not be watched, with errno set.
+bool TreeWatcher::AddTree(const char *rel, bool report) {
+  char *full = JoinPath(root_, rel);
+
+  int wd = Inotify::Watch(full, *rel == '\0', OnInotify, this);
+  if (wd < 0) {
+    free(full);
+    return false;
+  }
+
+  Dir **link = FindDir(wd);
+  if (*link) {
+    // Reached the same directory twice, e.g. through a bind mount.
+    Inotify::Unwatch(wd, OnInotify, this);
+    free(full);
+    return true;
+  }
+
+  Dir *d = new Dir;
+  d->wd = wd;
+  d->path = strdup(rel);
+  d->next = NULL;
+  *link = d;
+
+  DIR *dp = opendir(full);
+  if (dp != NULL) {
+    struct dirent *ent;
+    while ((ent = readdir(dp)) != NULL) {
+      if (!strcmp(ent->d_name, ".") || !strcmp(ent->d_name, "..")) continue;
+
+      // Symbolic links are not followed.
+      bool is_dir = ent->d_type == DT_DIR;
+      if (ent->d_type == DT_UNKNOWN) {
+        struct stat s;
+        char *p = JoinPath(full, ent->d_name);
+        is_dir = lstat(p, &s) == 0 && S_ISDIR(s.st_mode);
+        free(p);
+      }
+
+      if (report) AddChange(rel, ent->d_name, true);
+
+      if (is_dir) {
+        char *sub = JoinPath(rel, ent->d_name);
+        AddTree(sub, report);
+        free(sub);
+      }
+    }
+    closedir(dp);
+  }
+
+  free(full);
+  return true;
+}
+
+
+// Stops watching `rel` and everything below it; for directories moved out
+// of the tree, whose watches the kernel keeps.
+void TreeWatcher::DropTree(const char *rel) {
+  for (int i = 0; i < DIR_BUCKETS; i++) {
+    Dir **link = &dirs_[i];
+    while (*link) {
+      Dir *d = *link;
+      if (*d->path != '\0' && UnderPath(d->path, rel)) {
+        *link = d->next;
+        Inotify::Unwatch(d->wd, OnInotify, this);
+        free(d->path);
+        delete d;
+      } else {
+        link = &d->next;
+      }
+    }
+  }
+}
+
+
+void TreeWatcher::AddChange(const char *rel, const char *name, bool rename) {
+  char *path = JoinPath(rel, name);
+  Change **bucket = &changes_[HashPath(path) % CHANGE_BUCKETS];
+
+  for (Change *c = *bucket; c; c = c->next) {
+    if (!strcmp(c->path, path)) {
+      c->rename = c->rename || rename;
+      free(path);
+      return;
+    }
+  }
+
+  Change *c = new Change;
+  c->path = path;
+  c->rename = rename;
+  c->next = *bucket;
+  c->next_in_order = NULL;
+  *bucket = c;
+
+  if (changes_tail_) {
+    changes_tail_->next_in_order = c;
+  } else {
+    changes_head_ = c;
+  }
+  changes_tail_ = c;
+}
+
+
+void TreeWatcher::Schedule() {
+  if (!ev_is_active(&debounce_)) {
+    ev_timer_start(EV_DEFAULT_UC_ &debounce_);
+    ev_unref(EV_DEFAULT_UC);
+  }
+}
+
+
+void TreeWatcher::OnInotify(void *data, int wd, uint32_t mask,
+                            const char *name) {
+  TreeWatcher *t = static_cast<TreeWatcher*>(data);
+
+  if (mask & IN_Q_OVERFLOW) {
+    t->overflow_ = true;
+    t->Schedule();
+    return;
+  }
+
+  Dir **link = t->FindDir(wd);
+  if (!*link) return;
+  Dir *d = *link;
+
+  if (mask & IN_IGNORED) {
+    *link = d->next;
+    free(d->path);
+    delete d;
+    return;
+  }
+
+  if (name == NULL) return;
+
+  bool rename = (mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO));
+  t->AddChange(d->path, name, rename);
+
+  // Watching must wait for the timer; queue directories to add or drop.
+  if ((mask & IN_ISDIR) && (mask & (IN_CREATE | IN_MOVED_TO | IN_MOVED_FROM))) {
+    Change *s = new Change;
+    s->path = JoinPath(d->path, name);
+    s->rename = (mask & IN_MOVED_FROM) == 0;
+    s->next = NULL;
+    s->next_in_order = t->scan_;
+    t->scan_ = s;
+  }
+
+  t->Schedule();
+}
+
+
+void TreeWatcher::FreeChanges() {
+  while (changes_head_) {
+    Change *c = changes_head_;
+    changes_head_ = c->next_in_order;
+    free(c->path);
+    delete c;
+  }
+  changes_tail_ = NULL;
+  if (changes_) memset(changes_, 0, CHANGE_BUCKETS * sizeof *changes_);
+
+  while (scan_) {
+    Change *s = scan_;
+    scan_ = s->next_in_order;
+    free(s->path);
+    delete s;
+  }
+
+  overflow_ = false;
+}
+
+
+void TreeWatcher::OnDebounce(EV_P_ ev_timer *watcher, int revents) {
+  TreeWatcher *t = static_cast<TreeWatcher*>(watcher->data);
+  assert(watcher == &t->debounce_);
+  assert(revents == EV_TIMEOUT);
+
+  // The timer has stopped by itself.
+  ev_ref(EV_DEFAULT_UC);
+
+  // scan_ is newest first; handle it in the order the events arrived.
+  Change *scan = NULL;
+  while (t->scan_) {
+    Change *s = t->scan_;
+    t->scan_ = s->next_in_order;
+    s->next_in_order = scan;
+    scan = s;
+  }
+  while (scan) {
+    Change *s = scan;
+    scan = s->next_in_order;
+    if (s->rename) {
+      t->AddTree(s->path, true);
+    } else {
+      t->DropTree(s->path);
+    }
+    free(s->path);
+    delete s;
+  }
+
+  // The listeners may stop the watcher, which frees the pending changes;
+  // take them first.
+  bool overflow = t->overflow_;
+  Change *c = t->changes_head_;
+  t->changes_head_ = t->changes_tail_ = NULL;
+  t->overflow_ = false;
+  memset(t->changes_, 0, CHANGE_BUCKETS * sizeof *t->changes_);
+
+  HandleScope scope;
+  Local<Value> argv[2];
+
+  t->Ref();
+
+  if (overflow) {
+    // Too many events; the caller has to rescan.
+    argv[0] = Local<Value>::New(rename_type_symbol);
+    argv[1] = Local<Value>::New(Null());
+    t->Emit(change_symbol, 2, argv);
+  }
+
+  while (c) {
+    Change *next = c->next_in_order;
+    if (t->active_) {
+      argv[0] = Local<Value>::New(c->rename ? rename_type_symbol
+                                            : change_type_symbol);
+      argv[1] = String::New(c->path);
+      t->Emit(change_symbol, 2, argv);
+    }
+    free(c->path);
+    delete c;
+    c = next;
+  }
+
+  t->Unref();
+}
+
+
+Handle<Value> TreeWatcher::New(const Arguments& args) {
+  if (!args.IsConstructCall()) {
+    return FromConstructorTemplate(constructor_template, args);
+  }
+
+  HandleScope scope;
+  TreeWatcher *t = new TreeWatcher();
+  t->Wrap(args.Holder());
+  return args.This();
+}
+
+
+Handle<Value> TreeWatcher::Start(const Arguments& args) {
+  HandleScope scope;
+
+  if (args.Length() < 1 || !args[0]->IsString()) {
+    return ThrowException(Exception::TypeError(String::New("Bad arguments")));
+  }
+
+  TreeWatcher *t = ObjectWrap::Unwrap<TreeWatcher>(args.Holder());
+  if (t->active_) {
+    return ThrowException(Exception::Error(
+          String::New("Watcher already started")));
+  }
+
+  String::Utf8Value path(args[0]->ToString());
+
+  struct stat s;
+  if (stat(*path, &s) < 0) {
+    return ThrowException(ErrnoException(errno, "stat", "", *path));
+  }
+  if (!S_ISDIR(s.st_mode)) {
+    return ThrowException(ErrnoException(ENOTDIR, "watchTree", "", *path));
+  }
+
+  t->root_ = strdup(*path);
+  size_t len = strlen(t->root_);
+  while (len > 1 && t->root_[len - 1] == '/') t->root_[--len] = '\0';
+
+  t->persistent_ = args[1]->IsTrue();
+
+  ev_tstamp debounce = 0.05;
+  if (args[2]->IsNumber() && args[2]->NumberValue() >= 0) {
+    debounce = NODE_V8_UNIXTIME(args[2]);
+  }
+  ev_timer_set(&t->debounce_, debounce, 0.);
+
+  t->dirs_ = static_cast<Dir**>(calloc(DIR_BUCKETS, sizeof(Dir*)));
+  t->changes_ = static_cast<Change**>(calloc(CHANGE_BUCKETS, sizeof(Change*)));
+  t->active_ = true;
+
+  if (!t->AddTree("", false)) {
+    int err = errno;
+    t->Stop();
+    return ThrowException(ErrnoException(err, "inotify_add_watch", "", *path));
+  }
+
+  if (t->persistent_) ev_ref(EV_DEFAULT_UC);
+  t->Ref();
+
+  return Undefined();
+}
+
+
+Handle<Value> TreeWatcher::Stop(const Arguments& args) {
+  HandleScope scope;
+  TreeWatcher *t = ObjectWrap::Unwrap<TreeWatcher>(args.Holder());
+  if (t->active_) {
+    if (t->persistent_) ev_unref(EV_DEFAULT_UC);
+    t->Unref();
+    t->Stop();
+  }
+  return Undefined();
+}
+
+
+void TreeWatcher::Stop() {
+  if (!active_) return;
+  active_ = false;
+
+  for (int i = 0; i < DIR_BUCKETS; i++) {
+    while (dirs_[i]) {
+      Dir *d = dirs_[i];
+      dirs_[i] = d->next;
+      Inotify::Unwatch(d->wd, OnInotify, this);
+      free(d->path);
+      delete d;
+    }
+  }
+  free(dirs_);
+  dirs_ = NULL;
+
+  FreeChanges();
+  free(changes_);
+  changes_ = NULL;
+
+  if (ev_is_active(&debounce_)) {
+    ev_ref(EV_DEFAULT_UC);
+    ev_timer_stop(EV_DEFAULT_UC_ &debounce_);
+  }
+
+  free(root_);
+  root_ = NULL;
+}
+
+
+}  // namespace node
+
+#endif  // HAVE_INOTIFY
@@ -0,0 +1,86 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef NODE_TREE_WATCHER_H_
+#define NODE_TREE_WATCHER_H_
+
+#include <node.h>
+#include <node_events.h>
+#include <node_inotify.h>
+#include <ev.h>
+
+#ifdef HAVE_INOTIFY
+
+namespace node {
+
+// Watches a directory and everything below it with inotify, one watch per
+// directory. Events are coalesced per path and emitted after `debounce`
+// seconds as 'change' (event, filename), where event is 'rename' when the
+// entry was created, deleted or moved and 'change' otherwise, and filename
+// is relative to the watched directory. Directories created later are
+// watched as they appear.
+class TreeWatcher : EventEmitter {
+ public:
+  static void Initialize(v8::Handle<v8::Object> target);
+
+ protected:
+  static v8::Persistent<v8::FunctionTemplate> constructor_template;
+
+  TreeWatcher();
+  ~TreeWatcher();
+
+  static v8::Handle<v8::Value> New(const v8::Arguments& args);
+  static v8::Handle<v8::Value> Start(const v8::Arguments& args);
+  static v8::Handle<v8::Value> Stop(const v8::Arguments& args);
+
+ private:
+  struct Dir;
+  struct Change;
+
+  static void OnInotify(void *data, int wd, uint32_t mask, const char *name);
+  static void OnDebounce(EV_P_ ev_timer *watcher, int revents);
+
+  bool AddTree(const char *rel, bool report);
+  void DropTree(const char *rel);
+  Dir** FindDir(int wd);
+  void AddChange(const char *rel, const char *name, bool rename);
+  void Schedule();
+  void FreeChanges();
+  void Stop();
+
+  char *root_;
+  bool active_;
+  bool persistent_;
+  bool overflow_;
+  ev_timer debounce_;
+
+  Dir **dirs_;                // hash by wd
+  Change **changes_;          // hash by path
+  Change *changes_head_;      // in arrival order
+  Change *changes_tail_;
+  Change *scan_;              // directories to add or drop on the next timeout
+};
+
+}  // namespace node
+
+#endif  // HAVE_INOTIFY
+
+#endif  // NODE_TREE_WATCHER_H_
@@ -0,0 +1,464 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <node_url.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace node {
+
+using namespace v8;
+
+typedef uint16_t uc;
+
+static Persistent<String> protocol_symbol;
+static Persistent<String> slashes_symbol;
+static Persistent<String> auth_symbol;
+static Persistent<String> host_symbol;
+static Persistent<String> port_symbol;
+static Persistent<String> hostname_symbol;
+static Persistent<String> href_symbol;
+static Persistent<String> hash_symbol;
+static Persistent<String> search_symbol;
+static Persistent<String> query_symbol;
+static Persistent<String> pathname_symbol;
+
+
+// A run of UTF-16 code units in the input or in a UrlBuffer.
+struct Slice {
+  const uc *p;
+  int n;
+
+  Slice() : p(NULL), n(0) {}
+  Slice(const uc *p_, int n_) : p(p_), n(n_) {}
+
+  Slice Sub(int start) const { return Slice(p + start, n - start); }
+  Slice Sub(int start, int end) const { return Slice(p + start, end - start); }
+
+  int IndexOf(uc c) const {
+    for (int i = 0; i < n; i++) {
+      if (p[i] == c) return i;
+    }
+    return -1;
+  }
+};
+
+
+class UrlBuffer {
+ public:
+  UrlBuffer() : data_(stack_), len_(0), cap_(sizeof stack_ / sizeof *stack_) {}
+  ~UrlBuffer() { if (data_ != stack_) free(data_); }
+
+  void Append(uc c) {
+    Reserve(1);
+    data_[len_++] = c;
+  }
+
+  void Append(Slice s) {
+    Reserve(s.n);
+    memcpy(data_ + len_, s.p, s.n * sizeof *data_);
+    len_ += s.n;
+  }
+
+  void Append(const char *s) {
+    while (*s) Append(static_cast<uc>(*s++));
+  }
+
+  Slice slice() const { return Slice(data_, len_); }
+
+ private:
+  void Reserve(int n) {
+    if (len_ + n <= cap_) return;
+    int cap = cap_ * 2;
+    while (cap < len_ + n) cap *= 2;
+    uc *data = static_cast<uc*>(malloc(cap * sizeof *data));
+    if (data == NULL) abort();
+    memcpy(data, data_, len_ * sizeof *data);
+    if (data_ != stack_) free(data_);
+    data_ = data;
+    cap_ = cap;
+  }
+
+  uc *data_;
+  int len_;
+  int cap_;
+  uc stack_[256];
+};
+
+
+// The character sets of lib/url.js.
+
+static inline bool IsDelim(uc c) {
+  switch (c) {
+    case '<': case '>': case '"': case '`': case ' ':
+    case '\r': case '\n': case '\t':
+      return true;
+    default:
+      return false;
+  }
+}
+
+
+static inline bool IsNonAuth(uc c) {
+  return c == '/' || c == '@' || c == '?' || c == '#' || IsDelim(c);
+}
+
+
+static inline bool IsNonHost(uc c) {
+  switch (c) {
+    case '%': case '/': case '?': case ';': case '#':
+    case '{': case '}': case '|': case '\\': case '^': case '~':
+    case '[': case ']': case '\'':
+      return true;
+    default:
+      return IsDelim(c);
+  }
+}
+
+
+static inline bool IsDigit(uc c) {
+  return c >= '0' && c <= '9';
+}
+
+
+static inline bool IsAlnum(uc c) {
+  return IsDigit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+
+static inline uc ToLower(uc c) {
+  return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+}
+
+
+static bool Equals(Slice s, const char *lit, bool ignore_case) {
+  int i;
+  for (i = 0; i < s.n && lit[i]; i++) {
+    uc c = ignore_case ? ToLower(s.p[i]) : s.p[i];
+    if (c != static_cast<uc>(lit[i])) return false;
+  }
+  return i == s.n && lit[i] == '\0';
+}
+
+
+// url.parse looks the protocol up in these tables as it was written;
+// url.format looks up the lower case one.
+static bool IsHostless(Slice proto, bool ignore_case) {
+  return Equals(proto, "javascript:", ignore_case) ||
+         Equals(proto, "file:", ignore_case);
+}
+
+
+static bool IsSlashed(Slice proto, bool ignore_case) {
+  return Equals(proto, "http:", ignore_case) ||
+         Equals(proto, "https:", ignore_case) ||
+         Equals(proto, "ftp:", ignore_case) ||
+         Equals(proto, "gopher:", ignore_case) ||
+         Equals(proto, "file:", ignore_case);
+}
+
+
+// /^\/\/[^@\/]+@[^@\/]+/
+static bool StartsWithAuth(Slice s) {
+  if (s.n < 2 || s.p[0] != '/' || s.p[1] != '/') return false;
+  int i = 2;
+  while (i < s.n && s.p[i] != '@' && s.p[i] != '/') i++;
+  if (i == 2 || i == s.n || s.p[i] != '@') return false;
+  i++;
+  return i < s.n && s.p[i] != '@' && s.p[i] != '/';
+}
+
+
+// hostnamePartPattern: /^[a-zA-Z0-9][a-z0-9A-Z-]{0,62}$/
+static bool IsHostnamePart(Slice s) {
+  if (s.n == 0 || s.n > 63 || !IsAlnum(s.p[0])) return false;
+  for (int i = 1; i < s.n; i++) {
+    if (!IsAlnum(s.p[i]) && s.p[i] != '-') return false;
+  }
+  return true;
+}
+
+
+// hostnamePartStart: /^([a-zA-Z0-9][a-z0-9A-Z-]{0,62})(.*)$/
+// Returns the length of the first group, or -1 when there is no match;
+// '.' does not match line terminators.
+static int HostnamePartStart(Slice s) {
+  if (s.n == 0 || !IsAlnum(s.p[0])) return -1;
+  int g = 1;
+  while (g < s.n && g < 63 && (IsAlnum(s.p[g]) || s.p[g] == '-')) g++;
+  for (int i = g; i < s.n; i++) {
+    uc c = s.p[i];
+    if (c == '\n' || c == '\r' || c == 0x2028 || c == 0x2029) return -1;
+  }
+  return g;
+}
+
+
+static Local<String> ToString(Slice s) {
+  return s.n ? String::New(s.p, s.n) : String::Empty();
+}
+
+
+// parse(url, parseQueryString, slashesDenoteHost)
+// Follows urlParse() in lib/url.js step by step, without the intermediate
+// strings; the result has the same properties in the same order. With
+// parseQueryString set, a query is left as a string for the caller to
+// parse.
+static Handle<Value> Parse(const Arguments& args) {
+  HandleScope scope;
+
+  if (!args[0]->IsString()) {
+    return ThrowException(Exception::TypeError(String::New("Bad argument")));
+  }
+
+  String::Value value(args[0]);
+  Slice rest(*value, value.length());
+  bool parse_query = args[1]->IsTrue();
+  bool slashes_denote_host = args[2]->IsTrue();
+
+  Local<Object> out = Object::New();
+  int i;
+
+  // Cut off any delimiters, as in "<http://foo.com>".
+  for (i = 0; i < rest.n && IsDelim(rest.p[i]); i++);
+  rest = rest.Sub(i);
+
+  // protocolPattern: /^([a-z0-9]+:)/i
+  Slice proto;
+  for (i = 0; i < rest.n && IsAlnum(rest.p[i]); i++);
+  if (i > 0 && i < rest.n && rest.p[i] == ':') {
+    proto = rest.Sub(0, i + 1);
+    rest = rest.Sub(i + 1);
+  }
+  bool has_proto = proto.n > 0;
+
+  UrlBuffer protocol;
+  for (i = 0; i < proto.n; i++) protocol.Append(ToLower(proto.p[i]));
+  if (has_proto) out->Set(protocol_symbol, ToString(protocol.slice()));
+
+  bool hostless = IsHostless(proto, false);
+  bool slashes = false;
+  bool out_slashes = false;
+
+  if (slashes_denote_host || has_proto || StartsWithAuth(rest)) {
+    slashes = rest.n >= 2 && rest.p[0] == '/' && rest.p[1] == '/';
+    if (slashes && !hostless) {
+      rest = rest.Sub(2);
+      out_slashes = true;
+      out->Set(slashes_symbol, True());
+    }
+  }
+
+  bool has_host = !hostless &&
+                  (slashes || (has_proto && !IsSlashed(proto, false)));
+  bool has_hostname = false;
+  UrlBuffer host;
+  Slice tail;                 // moved from the host name to the path
+  bool moved = false;
+
+  if (has_host) {
+    // Non-host characters are allowed to the left of the first @ sign,
+    // unless a non-auth character comes before it.
+    Slice auth;
+    bool has_auth = false;
+    int at = rest.IndexOf('@');
+    if (at >= 0) {
+      has_auth = true;
+      for (i = 0; i < at; i++) {
+        if (IsNonAuth(rest.p[i])) {
+          has_auth = false;
+          break;
+        }
+      }
+      if (has_auth) {
+        auth = rest.Sub(0, at);
+        rest = rest.Sub(at + 1);
+      }
+    }
+
+    for (i = 0; i < rest.n && !IsNonHost(rest.p[i]); i++);
+    Slice hostname = rest.Sub(0, i);
+    rest = rest.Sub(i);
+
+    // portPattern: /:[0-9]+$/
+    Slice port;
+    for (i = hostname.n; i > 0 && IsDigit(hostname.p[i - 1]); i--);
+    if (i > 0 && i < hostname.n && hostname.p[i - 1] == ':') {
+      port = hostname.Sub(i);
+      hostname = hostname.Sub(0, i - 1);
+    }
+
+    // Validate a little. The host name ends at the first label that is
+    // not valid; what follows it is put in front of the path.
+    if (hostname.n > 255) {
+      hostname = Slice();
+    } else {
+      int start = 0;
+      while (start <= hostname.n) {
+        int end = start;
+        while (end < hostname.n && hostname.p[end] != '.') end++;
+        Slice part = hostname.Sub(start, end);
+
+        if (part.n > 0 && !IsHostnamePart(part)) {
+          int valid = HostnamePartStart(part);
+          if (valid >= 0) {
+            tail = hostname.Sub(start + valid);
+            hostname = hostname.Sub(0, start + valid);
+            moved = true;
+          } else {
+            if (end < hostname.n) {
+              tail = hostname.Sub(end + 1);
+              moved = true;
+            }
+            hostname = hostname.Sub(0, start > 0 ? start - 1 : 0);
+          }
+          break;
+        }
+
+        start = end + 1;
+      }
+    }
+
+    // Host names are always lower case.
+    int hostname_start = 0;
+    if (auth.n > 0) {
+      host.Append(auth);
+      host.Append('@');
+      hostname_start = auth.n + 1;
+    }
+    for (i = 0; i < hostname.n; i++) host.Append(ToLower(hostname.p[i]));
+    if (port.n > 0) {
+      host.Append(':');
+      host.Append(port);
+    }
+
+    if (has_auth) out->Set(auth_symbol, ToString(auth));
+    out->Set(host_symbol, ToString(host.slice()));
+    if (port.n > 0) out->Set(port_symbol, ToString(port));
+    out->Set(hostname_symbol,
+             ToString(host.slice().Sub(hostname_start,
+                                       hostname_start + hostname.n)));
+    // Keeps the property order of the JavaScript version.
+    out->Set(href_symbol, String::Empty());
+
+    has_hostname = hostname.n > 0;
+  }
+
+  UrlBuffer path;
+  if (moved) {
+    path.Append('/');
+    path.Append(tail);
+    path.Append(rest);
+    rest = path.slice();
+  }
+
+  // Escape quotes and cut the path at the first delimiter, unless this is
+  // a javascript: URL.
+  UrlBuffer escaped;
+  if (!Equals(proto, "javascript:", true)) {
+    bool quote = false;
+    for (i = 0; i < rest.n && !IsDelim(rest.p[i]); i++) {
+      if (rest.p[i] == '\'') quote = true;
+    }
+    rest = rest.Sub(0, i);
+
+    if (quote) {
+      for (i = 0; i < rest.n; i++) {
+        if (rest.p[i] == '\'') {
+          escaped.Append("%27");
+        } else {
+          escaped.Append(rest.p[i]);
+        }
+      }
+      rest = escaped.slice();
+    }
+  }
+
+  Slice hash;
+  int h = rest.IndexOf('#');
+  if (h >= 0) {
+    hash = rest.Sub(h);
+    rest = rest.Sub(0, h);
+    out->Set(hash_symbol, ToString(hash));
+  }
+
+  Slice search;
+  int q = rest.IndexOf('?');
+  if (q >= 0) {
+    search = rest.Sub(q);
+    rest = rest.Sub(0, q);
+    out->Set(search_symbol, ToString(search));
+    out->Set(query_symbol, ToString(search.Sub(1)));
+  } else if (parse_query) {
+    out->Set(search_symbol, String::Empty());
+    out->Set(query_symbol, Object::New());
+  }
+
+  static const uc root[] = { '/' };
+  Slice pathname = rest;
+  if (pathname.n == 0 && has_hostname && IsSlashed(proto, false)) {
+    pathname = Slice(root, 1);
+  }
+  if (pathname.n > 0) out->Set(pathname_symbol, ToString(pathname));
+
+  // What url.format() makes of the result.
+  UrlBuffer href;
+  href.Append(protocol.slice());
+  if (out_slashes || ((!has_proto || IsSlashed(proto, true)) && has_host)) {
+    href.Append("//");
+    href.Append(host.slice());
+    if (pathname.n > 0 && pathname.p[0] != '/') href.Append('/');
+  } else if (has_host) {
+    href.Append(host.slice());
+  }
+  href.Append(pathname);
+  href.Append(search);
+  href.Append(hash);
+  out->Set(href_symbol, ToString(href.slice()));
+
+  return scope.Close(out);
+}
+
+
+void URL::Initialize(Handle<Object> target) {
+  HandleScope scope;
+
+  protocol_symbol = NODE_PSYMBOL("protocol");
+  slashes_symbol = NODE_PSYMBOL("slashes");
+  auth_symbol = NODE_PSYMBOL("auth");
+  host_symbol = NODE_PSYMBOL("host");
+  port_symbol = NODE_PSYMBOL("port");
+  hostname_symbol = NODE_PSYMBOL("hostname");
+  href_symbol = NODE_PSYMBOL("href");
+  hash_symbol = NODE_PSYMBOL("hash");
+  search_symbol = NODE_PSYMBOL("search");
+  query_symbol = NODE_PSYMBOL("query");
+  pathname_symbol = NODE_PSYMBOL("pathname");
+
+  NODE_SET_METHOD(target, "parse", Parse);
+}
+
+
+}  // namespace node
+
+NODE_MODULE(node_url, node::URL::Initialize);
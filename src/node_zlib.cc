@@ -0,0 +1,470 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include <node_zlib.h>
+#include <node_buffer.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace node {
+
+using namespace v8;
+
+Persistent<FunctionTemplate> Zlib::constructor_template;
+
+static Persistent<String> callback_symbol;
+static Persistent<String> onerror_symbol;
+static Persistent<String> errno_symbol;
+
+
+void Zlib::Initialize(Handle<Object> target) {
+  HandleScope scope;
+
+  Local<FunctionTemplate> t = FunctionTemplate::New(Zlib::New);
+  constructor_template = Persistent<FunctionTemplate>::New(t);
+  constructor_template->InstanceTemplate()->SetInternalFieldCount(1);
+  constructor_template->SetClassName(String::NewSymbol("Zlib"));
+
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "init", Zlib::Init);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "write", Zlib::Write);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "writeSync",
+                            Zlib::WriteSync);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "reset", Zlib::Reset);
+  NODE_SET_PROTOTYPE_METHOD(constructor_template, "close", Zlib::Close);
+
+  target->Set(String::NewSymbol("Zlib"), constructor_template->GetFunction());
+
+  callback_symbol = NODE_PSYMBOL("callback");
+  onerror_symbol = NODE_PSYMBOL("onerror");
+  errno_symbol = NODE_PSYMBOL("errno");
+
+  NODE_DEFINE_CONSTANT(target, DEFLATE);
+  NODE_DEFINE_CONSTANT(target, INFLATE);
+  NODE_DEFINE_CONSTANT(target, GZIP);
+  NODE_DEFINE_CONSTANT(target, GUNZIP);
+  NODE_DEFINE_CONSTANT(target, DEFLATERAW);
+  NODE_DEFINE_CONSTANT(target, INFLATERAW);
+  NODE_DEFINE_CONSTANT(target, UNZIP);
+
+  // flush values
+  NODE_DEFINE_CONSTANT(target, Z_NO_FLUSH);
+  NODE_DEFINE_CONSTANT(target, Z_SYNC_FLUSH);
+  NODE_DEFINE_CONSTANT(target, Z_FULL_FLUSH);
+  NODE_DEFINE_CONSTANT(target, Z_FINISH);
+
+  // return codes
+  NODE_DEFINE_CONSTANT(target, Z_OK);
+  NODE_DEFINE_CONSTANT(target, Z_STREAM_END);
+  NODE_DEFINE_CONSTANT(target, Z_NEED_DICT);
+  NODE_DEFINE_CONSTANT(target, Z_ERRNO);
+  NODE_DEFINE_CONSTANT(target, Z_STREAM_ERROR);
+  NODE_DEFINE_CONSTANT(target, Z_DATA_ERROR);
+  NODE_DEFINE_CONSTANT(target, Z_MEM_ERROR);
+  NODE_DEFINE_CONSTANT(target, Z_BUF_ERROR);
+  NODE_DEFINE_CONSTANT(target, Z_VERSION_ERROR);
+
+  // levels and strategies
+  NODE_DEFINE_CONSTANT(target, Z_NO_COMPRESSION);
+  NODE_DEFINE_CONSTANT(target, Z_BEST_SPEED);
+  NODE_DEFINE_CONSTANT(target, Z_BEST_COMPRESSION);
+  NODE_DEFINE_CONSTANT(target, Z_DEFAULT_COMPRESSION);
+  NODE_DEFINE_CONSTANT(target, Z_FILTERED);
+  NODE_DEFINE_CONSTANT(target, Z_HUFFMAN_ONLY);
+  NODE_DEFINE_CONSTANT(target, Z_RLE);
+  NODE_DEFINE_CONSTANT(target, Z_FIXED);
+  NODE_DEFINE_CONSTANT(target, Z_DEFAULT_STRATEGY);
+
+  target->Set(String::NewSymbol("ZLIB_VERSION"), String::New(ZLIB_VERSION));
+}
+
+
+Zlib::Zlib(ZlibMode mode) : ObjectWrap(),
+                            mode_(mode),
+                            initialized_(false),
+                            write_in_progress_(false),
+                            pending_close_(false),
+                            flush_(Z_NO_FLUSH),
+                            err_(Z_OK),
+                            dictionary_(NULL),
+                            dictionary_len_(0) {
+  memset(&strm_, 0, sizeof strm_);
+}
+
+
+Zlib::~Zlib() {
+  assert(!write_in_progress_);
+  End();
+}
+
+
+// var handle = new Zlib(mode);
+Handle<Value> Zlib::New(const Arguments& args) {
+  if (!args.IsConstructCall()) {
+    return FromConstructorTemplate(constructor_template, args);
+  }
+
+  HandleScope scope;
+
+  int mode = args[0]->Int32Value();
+  if (mode < DEFLATE || mode > UNZIP) {
+    return ThrowException(Exception::TypeError(String::New("Bad mode")));
+  }
+
+  Zlib *ctx = new Zlib(static_cast<ZlibMode>(mode));
+  ctx->Wrap(args.This());
+  return args.This();
+}
+
+
+static bool IsDeflate(ZlibMode mode) {
+  return mode == DEFLATE || mode == GZIP || mode == DEFLATERAW;
+}
+
+
+// handle.init(windowBits, level, memLevel, strategy, [dictionary])
+Handle<Value> Zlib::Init(const Arguments& args) {
+  HandleScope scope;
+  Zlib *ctx = ObjectWrap::Unwrap<Zlib>(args.Holder());
+
+  if (ctx->initialized_) {
+    return ThrowException(Exception::Error(
+          String::New("Already initialized")));
+  }
+
+  int window_bits = args[0]->Int32Value();
+  int level = args[1]->Int32Value();
+  int mem_level = args[2]->Int32Value();
+  int strategy = args[3]->Int32Value();
+
+  if (Buffer::HasInstance(args[4])) {
+    Local<Object> dictionary = args[4]->ToObject();
+    ctx->dictionary_len_ = Buffer::Length(dictionary);
+    ctx->dictionary_ = static_cast<char*>(malloc(ctx->dictionary_len_));
+    memcpy(ctx->dictionary_, Buffer::Data(dictionary), ctx->dictionary_len_);
+  }
+
+  // zlib picks the format from the window size.
+  switch (ctx->mode_) {
+    case GZIP:
+    case GUNZIP:
+      window_bits += 16;
+      break;
+    case UNZIP:
+      window_bits += 32;
+      break;
+    case DEFLATERAW:
+    case INFLATERAW:
+      window_bits = -window_bits;
+      break;
+    default:
+      break;
+  }
+
+  if (IsDeflate(ctx->mode_)) {
+    ctx->err_ = deflateInit2(&ctx->strm_, level, Z_DEFLATED, window_bits,
+                             mem_level, strategy);
+  } else {
+    ctx->err_ = inflateInit2(&ctx->strm_, window_bits);
+  }
+
+  if (ctx->err_ != Z_OK) {
+    Local<Value> exception = ctx->Error();
+    free(ctx->dictionary_);
+    ctx->dictionary_ = NULL;
+    return ThrowException(exception);
+  }
+
+  ctx->initialized_ = true;
+
+  if (ctx->dictionary_ != NULL) {
+    // Inflate asks for the dictionary when it needs it, except raw
+    // streams, which carry no dictionary id.
+    if (IsDeflate(ctx->mode_)) {
+      ctx->err_ = deflateSetDictionary(&ctx->strm_,
+                                       (const Bytef *) ctx->dictionary_,
+                                       ctx->dictionary_len_);
+    } else if (ctx->mode_ == INFLATERAW) {
+      ctx->err_ = inflateSetDictionary(&ctx->strm_,
+                                       (const Bytef *) ctx->dictionary_,
+                                       ctx->dictionary_len_);
+    }
+
+    if (ctx->err_ != Z_OK) {
+      return ThrowException(ctx->Error());
+    }
+  }
+
+  return Undefined();
+}
+
+
+bool Zlib::SetUp(const Arguments& args) {
+  flush_ = args[0]->Int32Value();
+
+  Bytef *in = NULL;
+  size_t in_off = 0, in_len = 0;
+
+  // A null input just flushes.
+  if (!args[1]->IsNull() && !args[1]->IsUndefined()) {
+    if (!Buffer::HasInstance(args[1])) return false;
+    Local<Object> in_buf = args[1]->ToObject();
+    in_off = args[2]->Uint32Value();
+    in_len = args[3]->Uint32Value();
+    if (in_off + in_len > Buffer::Length(in_buf)) return false;
+    in = reinterpret_cast<Bytef *>(Buffer::Data(in_buf) + in_off);
+  }
+
+  if (!Buffer::HasInstance(args[4])) return false;
+  Local<Object> out_buf = args[4]->ToObject();
+  size_t out_off = args[5]->Uint32Value();
+  size_t out_len = args[6]->Uint32Value();
+  if (out_off + out_len > Buffer::Length(out_buf)) return false;
+
+  strm_.next_in = in;
+  strm_.avail_in = in_len;
+  strm_.next_out = reinterpret_cast<Bytef *>(Buffer::Data(out_buf) + out_off);
+  strm_.avail_out = out_len;
+
+  return true;
+}
+
+
+// Runs in the thread pool for write().
+void Zlib::Process() {
+  if (IsDeflate(mode_)) {
+    err_ = deflate(&strm_, flush_);
+    return;
+  }
+
+  err_ = inflate(&strm_, flush_);
+
+  if (err_ == Z_NEED_DICT && dictionary_ != NULL) {
+    err_ = inflateSetDictionary(&strm_, (const Bytef *) dictionary_,
+                                dictionary_len_);
+    if (err_ == Z_OK) {
+      err_ = inflate(&strm_, flush_);
+    } else if (err_ == Z_DATA_ERROR) {
+      // Not the dictionary the stream was made with.
+      err_ = Z_NEED_DICT;
+    }
+  }
+}
+
+
+Local<Value> Zlib::Error() {
+  const char *message;
+
+  switch (err_) {
+    case Z_OK:
+    case Z_STREAM_END:
+      return Local<Value>();
+    case Z_BUF_ERROR:
+      // Only an error when the input ended early; otherwise there was
+      // just nothing to do.
+      if (flush_ != Z_FINISH || strm_.avail_out == 0) return Local<Value>();
+      message = "unexpected end of file";
+      break;
+    case Z_NEED_DICT:
+      message = dictionary_ == NULL ? "Missing dictionary" : "Bad dictionary";
+      break;
+    default:
+      message = strm_.msg != NULL ? strm_.msg : "Zlib error";
+      break;
+  }
+
+  Local<Object> e = Exception::Error(String::New(message))->ToObject();
+  e->Set(errno_symbol, Integer::New(err_));
+  return e;
+}
+
+
+void Zlib::End() {
+  if (initialized_) {
+    if (IsDeflate(mode_)) {
+      deflateEnd(&strm_);
+    } else {
+      inflateEnd(&strm_);
+    }
+    initialized_ = false;
+  }
+
+  free(dictionary_);
+  dictionary_ = NULL;
+  dictionary_len_ = 0;
+}
+
+
+// handle.write(flush, in, inOff, inLen, out, outOff, outLen)
+Handle<Value> Zlib::Write(const Arguments& args) {
+  HandleScope scope;
+  Zlib *ctx = ObjectWrap::Unwrap<Zlib>(args.Holder());
+
+  if (!ctx->initialized_ || ctx->write_in_progress_) {
+    return ThrowException(Exception::Error(
+          String::New("Stream is closed or busy")));
+  }
+
+  if (!ctx->SetUp(args)) {
+    return ThrowException(Exception::TypeError(
+          String::New("Bad arguments")));
+  }
+
+  ctx->write_in_progress_ = true;
+  ctx->Ref();
+
+  eio_custom(DoProcess, EIO_PRI_DEFAULT, After, ctx);
+
+  // Nothing else keeps the loop alive while the thread pool works.
+  ev_ref(EV_DEFAULT_UC);
+
+  return Undefined();
+}
+
+
+int Zlib::DoProcess(eio_req *req) {
+  // Note: this function is executed in the thread pool! CAREFUL
+  static_cast<Zlib*>(req->data)->Process();
+  return 0;
+}
+
+
+int Zlib::After(eio_req *req) {
+  ev_unref(EV_DEFAULT_UC);
+
+  Zlib *ctx = static_cast<Zlib*>(req->data);
+  HandleScope scope;
+
+  ctx->write_in_progress_ = false;
+
+  Local<Value> error = ctx->Error();
+  Local<Value> argv[2];
+  Local<Value> callback_v;
+  int argc;
+
+  if (error.IsEmpty()) {
+    callback_v = ctx->handle_->Get(callback_symbol);
+    argv[0] = Integer::NewFromUnsigned(ctx->strm_.avail_in);
+    argv[1] = Integer::NewFromUnsigned(ctx->strm_.avail_out);
+    argc = 2;
+  } else {
+    callback_v = ctx->handle_->Get(onerror_symbol);
+    argv[0] = error;
+    argc = 1;
+  }
+
+  if (ctx->pending_close_) ctx->End();
+
+  if (callback_v->IsFunction()) {
+    Local<Function> callback = Local<Function>::Cast(callback_v);
+
+    TryCatch try_catch;
+
+    callback->Call(ctx->handle_, argc, argv);
+
+    if (try_catch.HasCaught()) {
+      FatalException(try_catch);
+    }
+  }
+
+  ctx->Unref();
+  return 0;
+}
+
+
+// var [availInAfter, availOutAfter] = handle.writeSync(...)
+Handle<Value> Zlib::WriteSync(const Arguments& args) {
+  HandleScope scope;
+  Zlib *ctx = ObjectWrap::Unwrap<Zlib>(args.Holder());
+
+  if (!ctx->initialized_ || ctx->write_in_progress_) {
+    return ThrowException(Exception::Error(
+          String::New("Stream is closed or busy")));
+  }
+
+  if (!ctx->SetUp(args)) {
+    return ThrowException(Exception::TypeError(
+          String::New("Bad arguments")));
+  }
+
+  ctx->Process();
+
+  Local<Value> error = ctx->Error();
+  if (!error.IsEmpty()) return ThrowException(error);
+
+  Local<Array> result = Array::New(2);
+  result->Set(0, Integer::NewFromUnsigned(ctx->strm_.avail_in));
+  result->Set(1, Integer::NewFromUnsigned(ctx->strm_.avail_out));
+  return scope.Close(result);
+}
+
+
+// Starts a new stream on the same allocations.
+Handle<Value> Zlib::Reset(const Arguments& args) {
+  HandleScope scope;
+  Zlib *ctx = ObjectWrap::Unwrap<Zlib>(args.Holder());
+
+  if (!ctx->initialized_ || ctx->write_in_progress_) {
+    return ThrowException(Exception::Error(
+          String::New("Stream is closed or busy")));
+  }
+
+  if (IsDeflate(ctx->mode_)) {
+    ctx->err_ = deflateReset(&ctx->strm_);
+    if (ctx->err_ == Z_OK && ctx->dictionary_ != NULL) {
+      ctx->err_ = deflateSetDictionary(&ctx->strm_,
+                                       (const Bytef *) ctx->dictionary_,
+                                       ctx->dictionary_len_);
+    }
+  } else {
+    ctx->err_ = inflateReset(&ctx->strm_);
+    if (ctx->err_ == Z_OK && ctx->mode_ == INFLATERAW &&
+        ctx->dictionary_ != NULL) {
+      ctx->err_ = inflateSetDictionary(&ctx->strm_,
+                                       (const Bytef *) ctx->dictionary_,
+                                       ctx->dictionary_len_);
+    }
+  }
+
+  if (ctx->err_ != Z_OK) return ThrowException(ctx->Error());
+
+  return Undefined();
+}
+
+
+Handle<Value> Zlib::Close(const Arguments& args) {
+  HandleScope scope;
+  Zlib *ctx = ObjectWrap::Unwrap<Zlib>(args.Holder());
+
+  if (ctx->write_in_progress_) {
+    ctx->pending_close_ = true;
+  } else {
+    ctx->End();
+  }
+
+  return Undefined();
+}
+
+
+}  // namespace node
+
+NODE_MODULE(node_zlib, node::Zlib::Initialize);
@@ -0,0 +1,93 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef NODE_ZLIB_H_
+#define NODE_ZLIB_H_
+
+#include <node.h>
+#include <node_object_wrap.h>
+#include <v8.h>
+#include <eio.h>
+#include <zlib.h>
+
+namespace node {
+
+enum ZlibMode {
+  DEFLATE = 1,
+  INFLATE,
+  GZIP,
+  GUNZIP,
+  DEFLATERAW,
+  INFLATERAW,
+  UNZIP
+};
+
+
+// process.binding('zlib').Zlib: one z_stream, used for every chunk of a
+// stream. write() runs deflate()/inflate() in the thread pool and reports
+// back through handle.callback(availInAfter, availOutAfter):
+//
+//   var handle = new Zlib(GZIP);
+//   handle.init(windowBits, level, memLevel, strategy, dictionary);
+//   handle.callback = function(availInAfter, availOutAfter) { ... };
+//   handle.write(Z_NO_FLUSH, input, inOff, inLen, output, outOff, outLen);
+//
+class Zlib : public ObjectWrap {
+ public:
+  static void Initialize(v8::Handle<v8::Object> target);
+
+ protected:
+  static v8::Persistent<v8::FunctionTemplate> constructor_template;
+
+  Zlib(ZlibMode mode);
+  ~Zlib();
+
+  static v8::Handle<v8::Value> New(const v8::Arguments& args);
+  static v8::Handle<v8::Value> Init(const v8::Arguments& args);
+  static v8::Handle<v8::Value> Write(const v8::Arguments& args);
+  static v8::Handle<v8::Value> WriteSync(const v8::Arguments& args);
+  static v8::Handle<v8::Value> Reset(const v8::Arguments& args);
+  static v8::Handle<v8::Value> Close(const v8::Arguments& args);
+
+ private:
+  // Loads the arguments of write()/writeSync() into the z_stream.
+  bool SetUp(const v8::Arguments& args);
+  void Process();
+  v8::Local<v8::Value> Error();
+  void End();
+
+  static int DoProcess(eio_req *req);
+  static int After(eio_req *req);
+
+  ZlibMode mode_;
+  z_stream strm_;
+  bool initialized_;
+  bool write_in_progress_;
+  bool pending_close_;
+  int flush_;
+  int err_;
+  char *dictionary_;
+  size_t dictionary_len_;
+};
+
+}  // namespace node
+
+#endif  // NODE_ZLIB_H_
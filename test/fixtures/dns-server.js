@@ -0,0 +1,120 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// A minimal UDP DNS server for tests. It answers A and AAAA questions from
+// a table of the form
+//
+//   { 'example.test': { A: ['10.0.0.1'], AAAA: ['::1'], ttl: 60 } }
+//
+// Names missing from the table get NXDOMAIN; known names without records of
+// the asked type get an empty NOERROR (NODATA) answer. `server.queries`
+// counts the questions received, keyed by 'name/type'.
+
+var dgram = require('dgram');
+
+var TYPE_A = 1;
+var TYPE_AAAA = 28;
+
+function parseQuestion(msg) {
+  var labels = [];
+  var offset = 12;
+  while (msg[offset] !== 0) {
+    var len = msg[offset];
+    labels.push(msg.toString('ascii', offset + 1, offset + 1 + len));
+    offset += len + 1;
+  }
+  offset++;
+  return {
+    name: labels.join('.').toLowerCase(),
+    type: (msg[offset] << 8) | msg[offset + 1],
+    end: offset + 4
+  };
+}
+
+function encodeAddress(type, address) {
+  if (type === TYPE_A) {
+    return address.split('.').map(Number);
+  }
+
+  // expand '::' and emit 16 bytes
+  var halves = address.split('::');
+  var head = halves[0] ? halves[0].split(':') : [];
+  var tail = halves.length > 1 && halves[1] ? halves[1].split(':') : [];
+  var groups = head;
+  for (var i = head.length + tail.length; i < 8; i++) groups.push('0');
+  groups = groups.concat(tail);
+
+  var bytes = [];
+  groups.forEach(function(group) {
+    var n = parseInt(group, 16);
+    bytes.push(n >> 8, n & 0xff);
+  });
+  return bytes;
+}
+
+function buildResponse(msg, question, rcode, type, addresses, ttl) {
+  var bytes = [];
+  var i;
+
+  // header: same id, QR + RD + RA, one question, one answer per address
+  bytes.push(msg[0], msg[1], 0x81, 0x80 | rcode, 0, 1,
+             addresses.length >> 8, addresses.length & 0xff, 0, 0, 0, 0);
+  for (i = 12; i < question.end; i++) bytes.push(msg[i]);
+
+  addresses.forEach(function(address) {
+    var rdata = encodeAddress(type, address);
+    bytes.push(0xc0, 12, type >> 8, type & 0xff, 0, 1,
+               (ttl >>> 24) & 0xff, (ttl >>> 16) & 0xff,
+               (ttl >>> 8) & 0xff, ttl & 0xff,
+               rdata.length >> 8, rdata.length & 0xff);
+    bytes.push.apply(bytes, rdata);
+  });
+
+  return new Buffer(bytes);
+}
+
+exports.createServer = function(records) {
+  var server = dgram.createSocket('udp4');
+  server.queries = {};
+
+  server.on('message', function(msg, rinfo) {
+    var question = parseQuestion(msg);
+    var key = question.name + '/' + (question.type === TYPE_A ? 'A' :
+                                     question.type === TYPE_AAAA ? 'AAAA' :
+                                     question.type);
+    server.queries[key] = (server.queries[key] || 0) + 1;
+
+    var entry = records[question.name];
+    var response;
+    if (!entry) {
+      response = buildResponse(msg, question, 3, question.type, [], 0);
+    } else {
+      var addresses = (question.type === TYPE_A ? entry.A :
+                       question.type === TYPE_AAAA ? entry.AAAA : null) || [];
+      response = buildResponse(msg, question, 0, question.type, addresses,
+                               entry.ttl || 0);
+    }
+
+    server.send(response, 0, response.length, rinfo.port, rinfo.address);
+  });
+
+  return server;
+};
@@ -0,0 +1,71 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+
+var Buffer = require('buffer').Buffer;
+
+var previous = Buffer.setExternalStringThreshold(64 * 1024);
+assert.equal(typeof previous, 'number');
+
+var size = 256 * 1024;
+var b = new Buffer(size);
+for (var i = 0; i < size; i++) {
+  b[i] = 97 + (i % 26);
+}
+
+var expected = b.toString('ascii');
+assert.equal(expected.length, size);
+assert.equal(expected.slice(0, 5), 'abcde');
+assert.equal(expected.charCodeAt(size - 1), 97 + ((size - 1) % 26));
+
+// The same bytes decode identically in every one-byte encoding.
+assert.equal(b.toString('binary'), expected);
+assert.equal(b.toString('utf8'), expected);
+assert.equal(b.toString('ascii', 10, 10 + 70000), expected.substr(10, 70000));
+
+// Strings are immutable even though they are not on the V8 heap: changing
+// the buffer afterwards must not show through.
+var s = b.toString('ascii');
+b[0] = 'Z'.charCodeAt(0);
+assert.equal(s.charAt(0), 'a');
+assert.equal(b.toString('ascii').charAt(0), 'Z');
+assert.equal(s + '!', expected + '!');
+
+// Non-ASCII data falls back to regular strings.
+b[1000] = 0xe9;
+var bin = b.toString('binary');
+assert.equal(bin.length, size);
+assert.equal(bin.charCodeAt(1000), 0xe9);
+assert.equal(bin.charCodeAt(1001), 97 + (1001 % 26));
+
+// Short strings are unaffected by the threshold either way.
+assert.equal(new Buffer('hello').toString('binary'), 'hello');
+assert.equal(new Buffer([0xff]).toString('binary'), '\u00ff');
+
+// Disabling external strings.
+assert.equal(Buffer.setExternalStringThreshold(0), 64 * 1024);
+b[1000] = 97;
+assert.equal(b.toString('ascii').length, size);
+assert.throws(function() { Buffer.setExternalStringThreshold(-1); });
+
+Buffer.setExternalStringThreshold(previous);
@@ -0,0 +1,88 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var Buffer = require('buffer').Buffer;
+
+function bytes(b) {
+  var out = [];
+  for (var i = 0; i < b.length; i++) out.push(b[i]);
+  return out;
+}
+
+// round trip every byte value, at several lengths so that both the bulk and
+// the tail paths of the encoder are exercised
+for (var n = 0; n < 70; n++) {
+  var b = new Buffer(n);
+  for (var i = 0; i < n; i++) b[i] = (i * 37 + 11) & 0xff;
+  var hex = b.toString('hex');
+  assert.equal(hex.length, n * 2);
+  var expected = '';
+  for (var i = 0; i < n; i++) {
+    expected += (b[i] < 16 ? '0' : '') + b[i].toString(16);
+  }
+  assert.equal(hex, expected);
+  assert.deepEqual(bytes(new Buffer(hex, 'hex')), bytes(b));
+}
+
+// upper and mixed case digits decode the same as lower case
+assert.deepEqual(bytes(new Buffer('DEADBEEF', 'hex')), [0xde, 0xad, 0xbe, 0xef]);
+assert.deepEqual(bytes(new Buffer('dEaDbEeF', 'hex')), [0xde, 0xad, 0xbe, 0xef]);
+
+// slices encode only their own bytes
+var b = new Buffer([0x00, 0x01, 0x02, 0xfe, 0xff]);
+assert.equal(b.toString('hex', 1, 4), '0102fe');
+assert.equal(b.slice(3).toString('hex'), 'feff');
+assert.equal(b.toString('hex', 2, 2), '');
+
+// write honours offset and the space left in the buffer
+var w = new Buffer(4);
+w.fill(0);
+assert.equal(w.write('aabb', 1, 'hex'), 2);
+assert.equal(Buffer._charsWritten, 4);
+assert.deepEqual(bytes(w), [0x00, 0xaa, 0xbb, 0x00]);
+assert.equal(w.write('0102030405', 2, 'hex'), 2);
+assert.equal(Buffer._charsWritten, 4);
+assert.deepEqual(bytes(w), [0x00, 0xaa, 0x01, 0x02]);
+
+// invalid input
+assert.throws(function() {
+  new Buffer('abc', 'hex');
+}, /Invalid hex string/);
+assert.throws(function() {
+  new Buffer('zz', 'hex');
+}, /Invalid hex string/);
+assert.throws(function() {
+  new Buffer('00\u01000', 'hex');
+}, /Invalid hex string/);
+assert.throws(function() {
+  new Buffer(2).write('0g', 0, 'hex');
+}, /Invalid hex string/);
+
+// large buffers go through the same path
+var big = new Buffer(1024 * 1024 + 3);
+for (var i = 0; i < big.length; i++) big[i] = i & 0xff;
+var bigHex = big.toString('hex');
+assert.equal(bigHex.length, big.length * 2);
+assert.equal(bigHex.slice(0, 8), '00010203');
+assert.equal(bigHex.slice(-6), '000102');
+assert.equal(new Buffer(bigHex, 'hex').toString('hex'), bigHex);
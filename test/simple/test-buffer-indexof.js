@@ -0,0 +1,103 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+
+var Buffer = require('buffer').Buffer;
+var SlowBuffer = require('buffer').SlowBuffer;
+
+var b = new Buffer('abcdef');
+var buf_a = new Buffer('a');
+var buf_bc = new Buffer('bc');
+var buf_f = new Buffer('f');
+var buf_z = new Buffer('z');
+var buf_empty = new Buffer('');
+
+assert.equal(b.indexOf('a'), 0);
+assert.equal(b.indexOf('a', 1), -1);
+assert.equal(b.indexOf('a', -1), 0);
+assert.equal(b.indexOf('bc'), 1);
+assert.equal(b.indexOf('bc', 2), -1);
+assert.equal(b.indexOf('f'), 5);
+assert.equal(b.indexOf('f', 6), -1);
+assert.equal(b.indexOf('f', 7), -1);
+assert.equal(b.indexOf('z'), -1);
+assert.equal(b.indexOf('abcdefg'), -1);
+assert.equal(b.indexOf(''), 0);
+assert.equal(b.indexOf('', 3), 3);
+assert.equal(b.indexOf(buf_a), 0);
+assert.equal(b.indexOf(buf_bc), 1);
+assert.equal(b.indexOf(buf_f), 5);
+assert.equal(b.indexOf(buf_z), -1);
+assert.equal(b.indexOf(buf_empty), 0);
+assert.equal(b.indexOf(0x61), 0);
+assert.equal(b.indexOf(0x66), 5);
+assert.equal(b.indexOf(0x66, 6), -1);
+assert.equal(b.indexOf(0x7a), -1);
+assert.throws(function() { b.indexOf({}); });
+
+// Offsets are relative to the slice, and matches never leak past its end.
+var s = b.slice(2, 4);
+assert.equal(s.indexOf('c'), 0);
+assert.equal(s.indexOf('d'), 1);
+assert.equal(s.indexOf('de'), -1);
+assert.equal(s.indexOf('b'), -1);
+assert.equal(s.indexOf(0x65), -1);
+
+// utf8 needles
+var u = new Buffer('½ + ¼ = ¾');
+assert.equal(u.indexOf('¼'), 5);
+assert.equal(u.indexOf('= ¾'), 8);
+
+// SlowBuffer returns absolute positions
+var slow = new SlowBuffer(6);
+slow.write('abcabc', 0, 'ascii');
+assert.equal(slow.indexOf('ca'), 2);
+assert.equal(slow.indexOf('abc', 1), 3);
+assert.equal(slow.indexOf('abc', 1, 5), -1);
+
+// Long needles in long haystacks go through Boyer-Moore-Horspool.
+var big = new Buffer(64 * 1024);
+big.fill('-'.charCodeAt(0));
+var boundary = '--------------------------7d44e178b0434';
+big.write(boundary, 40000, 'ascii');
+assert.equal(big.indexOf(boundary), 40000);
+assert.equal(big.indexOf(new Buffer('7d44e178b0434')), 40026);
+assert.equal(big.indexOf('7d44e178b0435'), -1);
+big.write('\r\n\r\n', 60000, 'ascii');
+assert.equal(big.indexOf('\r\n\r\n'), 60000);
+assert.equal(big.indexOf('\r\n\r\n', 60001), -1);
+
+// indexOfAny reports the leftmost match and which needle it was.
+var m = new Buffer('line one\r\nline two\nline three');
+assert.equal(m.indexOfAny(['\r\n', '\n']), 8);
+assert.equal(Buffer._matchedNeedle, 0);
+assert.equal(m.indexOfAny(['\r\n', '\n'], 10), 18);
+assert.equal(Buffer._matchedNeedle, 1);
+assert.equal(m.indexOfAny([new Buffer('three'), 'two']), 15);
+assert.equal(Buffer._matchedNeedle, 1);
+assert.equal(m.indexOfAny(['four', 'five']), -1);
+assert.equal(Buffer._matchedNeedle, -1);
+assert.equal(m.slice(5, 12).indexOfAny(['\n', 'one']), 0);
+assert.equal(Buffer._matchedNeedle, 1);
+assert.throws(function() { m.indexOfAny('\n'); });
+assert.throws(function() { m.indexOfAny([10]); });
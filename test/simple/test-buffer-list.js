@@ -0,0 +1,110 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+
+var Buffer = require('buffer').Buffer;
+var BufferList = require('buffer').BufferList;
+
+var list = new BufferList();
+assert.equal(0, list.length);
+assert.equal(-1, list.indexOf('a'));
+
+assert.equal(5, list.append(new Buffer('hello')));
+assert.equal(6, list.append(new Buffer(' ')));
+list.append(new Buffer(0)); // empty chunks are ignored
+list.append(new Buffer('wor'));
+list.append(new Buffer('ld\r'));
+list.append(new Buffer('\n\r\nrest'));
+assert.equal(19, list.length);
+assert.equal('hello world\r\n\r\nrest', list.toString());
+
+// get() works across chunks
+assert.equal('h'.charCodeAt(0), list.get(0));
+assert.equal('w'.charCodeAt(0), list.get(6));
+assert.equal('t'.charCodeAt(0), list.get(18));
+assert.equal(undefined, list.get(19));
+
+// indexOf with byte, string and Buffer needles
+assert.equal(4, list.indexOf('o'.charCodeAt(0)));
+assert.equal(7, list.indexOf('o'.charCodeAt(0), 5));
+assert.equal(6, list.indexOf('world'));
+assert.equal(11, list.indexOf('\r\n\r\n'));
+assert.equal(11, list.indexOf(new Buffer('\r\n\r\n')));
+assert.equal(13, list.indexOf('\r\n', 12));
+assert.equal(-1, list.indexOf('worlds'));
+assert.equal(-1, list.indexOf('rest!'));
+assert.equal(15, list.indexOf('rest'));
+assert.equal(-1, list.indexOf('h', 1));
+assert.equal(3, list.indexOf('', 3));
+
+// slice() shares memory with the original chunks
+var sub = list.slice(3, 13);
+assert.equal(10, sub.length);
+assert.equal('lo world\r\n', sub.toString());
+assert.equal(3, sub.indexOf('world'));
+assert.equal('world', list.slice(6, 11).toString());
+assert.equal(0, list.slice(4, 4).length);
+assert.throws(function() { list.slice(0, 20); });
+assert.throws(function() { list.slice(5, 4); });
+
+// toBuffer() flattens into a single Buffer
+var flat = list.toBuffer(6, 11);
+assert.ok(Buffer.isBuffer(flat));
+assert.equal('world', flat.toString());
+assert.equal(19, list.toBuffer().length);
+
+// copy() into an existing Buffer
+var target = new Buffer(8);
+target.fill('.');
+assert.equal(5, list.copy(target, 2, 6, 11));
+assert.equal('..world.', target.toString());
+assert.equal(2, list.copy(target, 6, 0));
+assert.equal('..worlhe', target.toString());
+
+// consume() drops bytes from the front, also in the middle of a chunk
+assert.equal(12, list.consume(7));
+assert.equal('orld\r\n\r\nrest', list.toString());
+assert.equal(4, list.indexOf('\r\n\r\n'));
+list.consume(list.indexOf('\r\n\r\n') + 4);
+assert.equal('rest', list.toString());
+assert.equal(0, list.consume(100));
+assert.equal(0, list.length);
+
+// the slice is unaffected by consuming the original
+assert.equal('lo world\r\n', sub.toString());
+
+// construct from an array of Buffers
+var list2 = new BufferList([new Buffer('ab'), new Buffer('cd')]);
+assert.equal(4, list2.length);
+assert.equal(1, list2.indexOf('bc'));
+assert.throws(function() { new BufferList(['ab']); });
+assert.throws(function() { list2.append('ab'); });
+
+// a delimiter split over many single-byte chunks
+var list3 = new BufferList();
+var s = 'xx--boundary--yy';
+for (var i = 0; i < s.length; i++) {
+  list3.append(new Buffer(s[i]));
+}
+assert.equal(2, list3.indexOf('--boundary--'));
+assert.equal(12, list3.indexOf('--', 3));
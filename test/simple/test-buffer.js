@@ -577,3 +577,25 @@ assert.equal(0xee, b[0]);
 assert.equal(0xad, b[1]);
 assert.equal(0xbe, b[2]);
 assert.equal(0xef, b[3]);
+
+// Buffer.concat
+var zero = [];
+var one = [new Buffer('asdf')];
+var long = [];
+for (var i = 0; i < 10; i++) long.push(new Buffer('asdf'));
+
+var flatZero = Buffer.concat(zero);
+var flatOne = Buffer.concat(one);
+var flatLong = Buffer.concat(long);
+var flatLongLen = Buffer.concat(long, 40);
+
+assert.equal(flatZero.length, 0);
+assert.equal(flatOne.toString(), 'asdf');
+assert.equal(flatOne, one[0]);
+assert.equal(flatLong.toString(), (new Array(10 + 1).join('asdf')));
+assert.equal(flatLongLen.toString(), (new Array(10 + 1).join('asdf')));
+assert.equal(Buffer.concat(long, 6).toString(), 'asdfas');
+assert.equal(Buffer.concat([new Buffer(10000), new Buffer('x')]).length,
+             10001);
+assert.throws(function() { Buffer.concat('asdf'); });
+assert.throws(function() { Buffer.concat([new Buffer('a'), 'b']); });
@@ -0,0 +1,187 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var path = require('path');
+var dns = require('dns');
+var cares = process.binding('cares');
+var dnsServer = require(path.join(common.fixturesDir, 'dns-server'));
+
+var server = dnsServer.createServer({
+  'cached.test': { A: ['10.0.0.1', '10.0.0.2'], ttl: 1 },
+  'uncached.test': { A: ['10.0.0.3'], ttl: 0 },
+  'v6only.test': { AAAA: ['fe80::1'], ttl: 60 }
+});
+server.bind(common.PORT);
+
+var channel = dns._createChannel({ servers: ['127.0.0.1'], port: common.PORT });
+
+function queries(name) {
+  return server.queries[name] || 0;
+}
+
+function expectMiss(name, family, callback) {
+  var r = channel.lookup(name, family, callback);
+  assert.strictEqual(r, undefined);
+}
+
+var steps = [
+  // concurrent lookups for one name share a single query
+  function(next) {
+    var pending = 3;
+    function done(err, addresses) {
+      assert.ifError(err);
+      assert.deepEqual(addresses, ['10.0.0.1', '10.0.0.2']);
+      if (--pending === 0) {
+        assert.equal(queries('cached.test/A'), 1);
+        next();
+      }
+    }
+    expectMiss('cached.test', cares.AF_INET, done);
+    expectMiss('cached.test', cares.AF_INET, done);
+    expectMiss('CACHED.test', cares.AF_INET, done);
+
+    var stats = channel.cacheStats();
+    assert.equal(stats.misses, 1);
+    assert.equal(stats.coalesced, 2);
+    assert.equal(stats.inFlight, 1);
+  },
+
+  // the answer is then served from the cache, synchronously
+  function(next) {
+    var r = channel.lookup('cached.test', cares.AF_INET, assert.fail);
+    assert.deepEqual(r, ['10.0.0.1', '10.0.0.2']);
+    assert.equal(channel.cacheStats().hits, 1);
+    assert.equal(channel.cacheStats().inFlight, 0);
+    next();
+  },
+
+  // NXDOMAIN is cached as well
+  function(next) {
+    expectMiss('missing.test', cares.AF_INET, function(err, addresses) {
+      assert.ok(err);
+      assert.equal(err.code, 'ENOTFOUND');
+      var r = channel.lookup('missing.test', cares.AF_INET, assert.fail);
+      assert.ok(r instanceof Error);
+      assert.equal(r.code, 'ENOTFOUND');
+      assert.equal(channel.cacheStats().negativeHits, 1);
+      assert.equal(queries('missing.test/A'), 1);
+      next();
+    });
+  },
+
+  // and so is NODATA
+  function(next) {
+    expectMiss('v6only.test', cares.AF_INET, function(err, addresses) {
+      assert.ok(err);
+      var r = channel.lookup('v6only.test', cares.AF_INET, assert.fail);
+      assert.ok(r instanceof Error);
+      assert.equal(queries('v6only.test/A'), 1);
+
+      // the other family is a separate entry
+      expectMiss('v6only.test', cares.AF_INET6, function(err, addresses) {
+        assert.ifError(err);
+        assert.deepEqual(addresses, ['fe80::1']);
+        next();
+      });
+    });
+  },
+
+  // a zero TTL is not cached
+  function(next) {
+    expectMiss('uncached.test', cares.AF_INET, function(err, addresses) {
+      assert.ifError(err);
+      assert.deepEqual(addresses, ['10.0.0.3']);
+      expectMiss('uncached.test', cares.AF_INET, function(err, addresses) {
+        assert.ifError(err);
+        assert.equal(queries('uncached.test/A'), 2);
+        next();
+      });
+    });
+  },
+
+  // entries expire with their TTL
+  function(next) {
+    setTimeout(function() {
+      expectMiss('cached.test', cares.AF_INET, function(err, addresses) {
+        assert.ifError(err);
+        assert.equal(queries('cached.test/A'), 2);
+        next();
+      });
+    }, 1500);
+  },
+
+  // size limits evict least recently used entries; size 0 disables caching
+  function(next) {
+    var before = channel.cacheStats();
+    assert.ok(before.entries > 1);
+    channel.setCacheOptions({ size: 1 });
+    var after = channel.cacheStats();
+    assert.equal(after.entries, 1);
+    assert.equal(after.evictions - before.evictions, before.entries - 1);
+
+    channel.setCacheOptions({ size: 0 });
+    assert.equal(channel.cacheStats().entries, 0);
+    expectMiss('cached.test', cares.AF_INET, function(err, addresses) {
+      assert.ifError(err);
+      assert.equal(channel.cacheStats().entries, 0);
+      channel.setCacheOptions({ size: 100 });
+      next();
+    });
+  },
+
+  // clearCache() drops everything
+  function(next) {
+    expectMiss('cached.test', cares.AF_INET, function(err, addresses) {
+      assert.ifError(err);
+      assert.equal(channel.cacheStats().entries, 1);
+      channel.clearCache();
+      assert.equal(channel.cacheStats().entries, 0);
+      next();
+    });
+  },
+
+  // bad options are rejected
+  function(next) {
+    assert.throws(function() {
+      channel.setCacheOptions({ maxTTL: -1 });
+    }, TypeError);
+    assert.throws(function() {
+      dns.setCacheOptions({ size: 'big' });
+    }, TypeError);
+    next();
+  }
+];
+
+var step = 0;
+function next() {
+  if (step < steps.length) {
+    steps[step++](next);
+  } else {
+    server.close();
+  }
+}
+next();
+
+process.on('exit', function() {
+  assert.equal(step, steps.length);
+});
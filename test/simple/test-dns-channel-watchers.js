@@ -0,0 +1,117 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Exercises the channel's socket and timer watchers: many concurrent
+// queries over one socket, and queries that expire unanswered.
+
+var common = require('../common');
+var assert = require('assert');
+var path = require('path');
+var dgram = require('dgram');
+var dns = require('dns');
+var cares = process.binding('cares');
+var dnsServer = require(path.join(common.fixturesDir, 'dns-server'));
+
+var NAMES = 20;
+
+var records = {};
+for (var i = 0; i < NAMES; i++) {
+  records['host' + i + '.test'] = { A: ['10.0.1.' + i], ttl: 60 };
+}
+
+var server = dnsServer.createServer(records);
+server.bind(common.PORT);
+
+// never answers
+var silent = dgram.createSocket('udp4');
+silent.bind(common.PORT + 1);
+
+var channel = dns._createChannel({ servers: ['127.0.0.1'],
+                                   port: common.PORT });
+var slowChannel = dns._createChannel({ servers: ['127.0.0.1'],
+                                       port: common.PORT + 1,
+                                       timeout: 100,
+                                       tries: 2 });
+
+var answered = 0;
+var timedOut = 0;
+
+function concurrent() {
+  var pending = 2 * NAMES + 1;
+  function done() {
+    if (--pending === 0) {
+      server.close();
+      expire();
+    }
+  }
+
+  for (var i = 0; i < NAMES; i++) {
+    (function(i) {
+      var name = 'host' + i + '.test';
+      var expected = ['10.0.1.' + i];
+
+      channel.lookup(name, cares.AF_INET, function(err, addresses) {
+        assert.ifError(err);
+        assert.deepEqual(addresses, expected);
+        answered++;
+        done();
+      });
+
+      channel.query(name, cares.A, function(err, addresses) {
+        assert.ifError(err);
+        assert.deepEqual(addresses, expected);
+        answered++;
+        done();
+      });
+    })(i);
+  }
+
+  channel.query('missing.test', cares.A, function(err) {
+    assert.ok(err);
+    assert.equal(err.code, 'ENOTFOUND');
+    answered++;
+    done();
+  });
+}
+
+function expire() {
+  var start = Date.now();
+  var pending = 2;
+  function done(err) {
+    assert.ok(err);
+    assert.equal(err.errno, cares.TIMEOUT);
+    assert.equal(err.code, 'ETIMEOUT');
+    // two tries of at least 100 ms each
+    assert.ok(Date.now() - start >= 150);
+    timedOut++;
+    if (--pending === 0) silent.close();
+  }
+
+  slowChannel.lookup('silent.test', cares.AF_INET, done);
+  slowChannel.query('silent.test', cares.A, done);
+}
+
+concurrent();
+
+process.on('exit', function() {
+  assert.equal(answered, 2 * NAMES + 1);
+  assert.equal(timedOut, 2);
+});
@@ -0,0 +1,87 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var path = require('path');
+var fs = require('fs');
+var constants = process.binding('constants');
+var fn = path.join(common.tmpDir, 'mmap.bin');
+
+// a file spanning a few pages with a recognisable pattern
+var size = 3 * 4096 + 123;
+var data = new Buffer(size);
+for (var i = 0; i < size; i++) data[i] = i % 251;
+fs.writeFileSync(fn, data);
+
+var fd = fs.openSync(fn, 'r+');
+
+// whole file, read only
+var map = fs.mmap(fd, 0, size);
+assert.ok(Buffer.isBuffer(map));
+assert.equal(map.length, size);
+assert.equal(map.toString('hex'), data.toString('hex'));
+
+// unaligned offset
+var tail = fs.mmap(fd, 5000, 100);
+assert.equal(tail.length, 100);
+for (var i = 0; i < 100; i++) assert.equal(tail[i], (5000 + i) % 251);
+
+// slices keep pointing into the mapping
+assert.equal(map.slice(4096, 4100)[0], 4096 % 251);
+
+// hints are accepted by name or number
+fs.madvise(map, 'sequential');
+fs.madvise(map, 'willneed');
+fs.madvise(tail, 'random');
+fs.madvise(map.slice(10, 20), constants.MADV_NORMAL);
+assert.throws(function() {
+  fs.madvise(map, 'sometimes');
+}, /Unknown madvise hint/);
+
+// other memory is refused, whatever the hint
+assert.throws(function() {
+  fs.madvise(new Buffer(10), 'dontneed');
+}, /fs\.mmap/);
+assert.throws(function() {
+  fs.madvise(new Buffer(64 * 1024), 'normal');
+}, /fs\.mmap/);
+
+// shared writable mappings write through to the file
+var rw = fs.mmap(fd, 0, 16, constants.PROT_READ | constants.PROT_WRITE,
+                 constants.MAP_SHARED);
+rw.write('hello', 0, 'ascii');
+fs.closeSync(fd);
+assert.equal(map.toString('ascii', 0, 5), 'hello');
+assert.equal(fs.readFileSync(fn).toString('ascii', 0, 5), 'hello');
+
+// the mapping outlives the descriptor
+assert.equal(map[size - 1], (size - 1) % 251);
+
+// bad arguments
+assert.throws(function() {
+  fs.mmap(fd, 0, 0);
+});
+assert.throws(function() {
+  fs.mmap(-1, 0, 16);
+}, /EBADF/);
+
+fs.unlinkSync(fn);
@@ -0,0 +1,114 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// fs.readFile and fs.writeFile run as single native requests; check sizes
+// around the read buffer, the string fast paths and errors.
+
+var common = require('../common');
+var assert = require('assert');
+var path = require('path');
+var fs = require('fs');
+
+var fn = path.join(common.tmpDir, 'readfile-native.txt');
+var missing = path.join(common.tmpDir, 'does-not-exist', 'file.txt');
+
+var text = '';
+while (text.length < 200 * 1024) {
+  text += 'café € ' + text.length + '\n';
+}
+var buffer = new Buffer(text);
+
+var callbacks = 0;
+
+fs.writeFileSync(fn, text);
+assert.equal(text, fs.readFileSync(fn, 'utf8'));
+assert.equal(text, fs.readFileSync(fn, 'utf-8'));
+assert.equal(buffer.toString('hex'), fs.readFileSync(fn, 'hex'));
+assert.equal(buffer.toString('binary'), fs.readFileSync(fn, 'binary'));
+assert.equal(buffer.toString('base64'), fs.readFileSync(fn, 'base64'));
+
+var read = fs.readFileSync(fn);
+assert.ok(Buffer.isBuffer(read));
+assert.equal(buffer.length, read.length);
+assert.equal(text, read.toString());
+
+// Files that report no size still read to the end.
+if (process.platform === 'linux') {
+  var status = fs.readFileSync('/proc/self/status', 'utf8');
+  assert.ok(/^Name:/.test(status));
+}
+
+assert.throws(function() {
+  fs.readFileSync(missing);
+}, function(err) {
+  return err.code === 'ENOENT' && err.syscall === 'open' &&
+         err.path === missing;
+});
+
+assert.throws(function() {
+  fs.writeFileSync(missing, 'x');
+}, function(err) {
+  return err.code === 'ENOENT';
+});
+
+fs.writeFile(fn, buffer, function(err) {
+  if (err) throw err;
+  callbacks++;
+
+  fs.readFile(fn, function(err, data) {
+    if (err) throw err;
+    assert.ok(Buffer.isBuffer(data));
+    assert.equal(text, data.toString());
+    callbacks++;
+
+    fs.readFile(fn, 'ucs2', function(err, data) {
+      if (err) throw err;
+      assert.equal(buffer.toString('ucs2'), data);
+      callbacks++;
+
+      // A second, shorter write truncates.
+      fs.writeFile(fn, 'short', 'ascii', function(err) {
+        if (err) throw err;
+        fs.readFile(fn, 'utf8', function(err, data) {
+          if (err) throw err;
+          assert.equal('short', data);
+          callbacks++;
+        });
+      });
+    });
+  });
+});
+
+fs.readFile(missing, 'utf8', function(err, data) {
+  assert.equal('ENOENT', err.code);
+  assert.equal(undefined, data);
+  callbacks++;
+});
+
+fs.readFile(common.tmpDir, function(err, data) {
+  assert.equal('EISDIR', err.code);
+  callbacks++;
+});
+
+process.on('exit', function() {
+  assert.equal(6, callbacks);
+  fs.unlinkSync(fn);
+});
@@ -0,0 +1,124 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// inotify-backed fs.watchFile and fs.watchTree; Linux only.
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var path = require('path');
+
+if (process.platform !== 'linux') {
+  console.error('Skipping: inotify is only available on Linux');
+  process.exit(0);
+}
+
+function rmrf(p) {
+  try {
+    if (fs.lstatSync(p).isDirectory()) {
+      fs.readdirSync(p).forEach(function(name) {
+        rmrf(path.join(p, name));
+      });
+      fs.rmdirSync(p);
+    } else {
+      fs.unlinkSync(p);
+    }
+  } catch (e) {}
+}
+
+var dir = path.join(common.tmpDir, 'watch-inotify');
+rmrf(dir);
+fs.mkdirSync(dir, 0755);
+
+var file = path.join(dir, 'file.txt');
+var polled = path.join(dir, 'polled.txt');
+var tree = path.join(dir, 'tree');
+fs.writeFileSync(file, 'a');
+fs.writeFileSync(polled, 'a');
+fs.mkdirSync(tree, 0755);
+
+var writeLatency = -1;
+var renamed = false;
+var pollChanged = false;
+var treeEvents = {};
+
+// A write is reported well before the five second poll interval.
+var started = Date.now();
+var w = fs.watchFile(file, { interval: 5000, debounce: 10 },
+                     function(curr, prev) {
+  if (writeLatency < 0) {
+    writeLatency = Date.now() - started;
+    assert.equal(1, prev.size);
+    assert.equal(2, curr.size);
+
+    // Replace the file by a rename, as editors do; the new one is watched.
+    var tmp = path.join(dir, 'file.txt.tmp');
+    fs.writeFileSync(tmp, 'abc');
+    fs.renameSync(tmp, file);
+  } else if (curr.size === 3 && !renamed) {
+    renamed = true;
+    assert.notEqual(prev.ino, curr.ino);
+    fs.unwatchFile(file);
+    next();
+  }
+});
+assert.equal('inotify', w.backend);
+fs.writeFileSync(file, 'ab');
+
+function next() {
+  var p = fs.watchFile(polled, { poll: true, interval: 20 }, function() {
+    pollChanged = true;
+    fs.unwatchFile(polled);
+    watchTree();
+  });
+  assert.equal('poll', p.backend);
+  setTimeout(function() { fs.writeFileSync(polled, 'ab'); }, 1100);
+}
+
+function watchTree() {
+  assert.throws(function() { fs.watchTree(file, function() {}); });
+
+  fs.watchTree(tree, { debounce: 20 }, function(event, filename) {
+    treeEvents[filename] = event;
+    if (treeEvents['a/b/c.txt'] && !treeEvents['a/b/d.txt']) {
+      // a/b was created after the watch started; it is watched now too.
+      fs.writeFileSync(path.join(tree, 'a', 'b', 'd.txt'), 'x');
+    }
+    if (treeEvents['a/b/d.txt']) {
+      fs.unwatchTree(tree);
+    }
+  });
+
+  fs.mkdirSync(path.join(tree, 'a'), 0755);
+  fs.mkdirSync(path.join(tree, 'a', 'b'), 0755);
+  fs.writeFileSync(path.join(tree, 'a', 'b', 'c.txt'), 'x');
+}
+
+process.on('exit', function() {
+  assert.ok(writeLatency >= 0, 'no change event');
+  assert.ok(writeLatency < 1000, 'change took ' + writeLatency + ' ms');
+  assert.ok(renamed, 'replaced file not followed');
+  assert.ok(pollChanged, 'poll backend did not fire');
+  assert.equal('rename', treeEvents['a']);
+  assert.equal('rename', treeEvents['a/b']);
+  assert.equal('rename', treeEvents['a/b/c.txt']);
+  assert.equal('rename', treeEvents['a/b/d.txt']);
+  rmrf(dir);
+});
@@ -0,0 +1,78 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Flags: --gc-idle-slice=5
+
+var common = require('../common');
+var assert = require('assert');
+var spawn = require('child_process').spawn;
+
+var stats = process.gcSchedulerStats();
+assert.equal('adaptive', stats.scheduler);
+assert.ok(stats.budget <= 5);
+assert.equal(0, stats.lowMemoryNotifications);
+
+// Allocate in short bursts separated by waits, so that there is both
+// garbage and idle time to collect it in.
+var ticks = 0;
+var retained = [];
+
+function burst() {
+  var a = [];
+  for (var i = 0; i < 10000; i++) a.push({ i: i });
+  retained.push(a.slice(0, 100));
+
+  if (++ticks < 50) {
+    setTimeout(burst, 5);
+    return;
+  }
+
+  stats = process.gcSchedulerStats();
+  assert.ok(stats.slices > 0);
+  assert.ok(stats.sliceTime >= 0);
+  assert.ok(stats.maxSlice >= 0);
+  assert.ok(stats.delayedSlices <= stats.slices);
+  assert.ok(stats.idleAverage > 0);
+  assert.ok(stats.utilization >= 0 && stats.utilization <= 1);
+  assert.ok(stats.budget >= 1 && stats.budget <= 5);
+  assert.ok(process.gcStats().idleNotifications > 0);
+
+  checkMode('off');
+  checkMode('legacy');
+}
+
+burst();
+
+
+function checkMode(mode) {
+  var out = '';
+  var child = spawn(process.execPath, [
+    '--gc-scheduler=' + mode,
+    common.fixturesDir + '/print-gc-scheduler-stats.js'
+  ]);
+  child.stdout.on('data', function(d) { out += d; });
+  child.on('exit', function(code) {
+    assert.equal(0, code);
+    var s = JSON.parse(out);
+    assert.equal(mode, s.scheduler);
+    assert.equal(0, s.slices);
+  });
+}
@@ -0,0 +1,83 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Flags: --expose-gc
+
+var common = require('../common');
+var assert = require('assert');
+
+var stats = process.gcStats();
+var before = stats.scavenge.count + stats.markSweepCompact.count;
+
+assert.equal(stats.buckets.length + 1, stats.scavenge.histogram.length);
+assert.equal(stats.buckets.length + 1, stats.markSweepCompact.histogram.length);
+
+function sum(a) {
+  return a.reduce(function(s, n) { return s + n; }, 0);
+}
+
+var emitted = [];
+function onGC(event) {
+  emitted.push(event);
+}
+process.on('gc', onGC);
+
+gc();
+
+stats = process.gcStats();
+assert.ok(stats.markSweepCompact.count >= 1);
+assert.ok(stats.scavenge.count + stats.markSweepCompact.count > before);
+
+['scavenge', 'markSweepCompact'].forEach(function(type) {
+  var s = stats[type];
+  assert.equal(s.count, sum(s.histogram));
+  assert.ok(s.maxPause >= 0);
+  assert.ok(s.totalPause >= s.maxPause);
+});
+
+var last = stats.events[stats.events.length - 1];
+assert.equal('markSweepCompact', last.type);
+assert.ok(last.pause >= 0);
+assert.ok(last.heapBefore > 0);
+assert.ok(last.heapAfter > 0);
+assert.equal(false, last.idle);
+assert.ok(Math.abs(Date.now() - last.start) < 60 * 1000);
+
+for (var i = 1; i < stats.events.length; i++) {
+  assert.ok(stats.events[i].start >= stats.events[i - 1].start);
+}
+
+// Events are emitted from the event loop, never from inside gc().
+assert.equal(0, emitted.length);
+
+setTimeout(function() {
+  assert.ok(emitted.length >= 1);
+  assert.ok(emitted.some(function(e) {
+    return e.type === 'markSweepCompact';
+  }));
+
+  process.removeListener('gc', onGC);
+  var count = emitted.length;
+  gc();
+  setTimeout(function() {
+    assert.equal(count, emitted.length);
+  }, 10);
+}, 10);
@@ -0,0 +1,120 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var http = require('http');
+
+var connections = 0;
+
+var server = http.createServer(function(req, res) {
+  if (req.url === '/close') {
+    res.writeHead(200, { 'Connection': 'close' });
+  }
+  res.end('hello');
+});
+server.on('connection', function() {
+  connections++;
+});
+
+var agent = new http.Agent({ host: '127.0.0.1',
+                             port: common.PORT,
+                             keepAlive: true,
+                             maxSockets: 2,
+                             maxFreeSockets: 2,
+                             keepAliveTimeout: 100 });
+
+function get(path, cb) {
+  http.get({ host: '127.0.0.1', port: common.PORT, path: path, agent: agent },
+           function(res) {
+    assert.equal(200, res.statusCode);
+    res.on('end', cb);
+  });
+}
+
+var steps = [
+  // sequential requests share one connection
+  function(next) {
+    get('/', function() {
+      assert.equal(1, agent.stats().freeSockets);
+      get('/', function() {
+        get('/', function() {
+          var stats = agent.stats();
+          assert.equal(1, stats.created);
+          assert.equal(2, stats.reused);
+          assert.equal(1, connections);
+          next();
+        });
+      });
+    });
+  },
+
+  // concurrent requests open no more than maxSockets connections
+  function(next) {
+    var pending = 5;
+    for (var i = 0; i < 5; i++) {
+      get('/', function() {
+        if (--pending > 0) return;
+        var stats = agent.stats();
+        assert.equal(2, stats.created);
+        assert.equal(2, stats.sockets);
+        assert.equal(2, stats.freeSockets);
+        assert.equal(0, stats.queued);
+        next();
+      });
+    }
+    assert.equal(3, agent.stats().queued);
+  },
+
+  // idle sockets are closed after keepAliveTimeout
+  function(next) {
+    setTimeout(function() {
+      var stats = agent.stats();
+      assert.equal(0, stats.freeSockets);
+      assert.equal(2, stats.reaped);
+      next();
+    }, 300);
+  },
+
+  // a response with Connection: close is not kept
+  function(next) {
+    get('/close', function() {
+      assert.equal(0, agent.stats().freeSockets);
+      next();
+    });
+  }
+];
+
+server.listen(common.PORT, '127.0.0.1', function() {
+  (function next() {
+    var step = steps.shift();
+    if (step) {
+      step(next);
+    } else {
+      server.close();
+    }
+  })();
+});
+
+process.on('exit', function() {
+  assert.equal(0, steps.length);
+  assert.equal(3, connections);
+});
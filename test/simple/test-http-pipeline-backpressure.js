@@ -0,0 +1,104 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// A large body written synchronously while pipelined responses are being
+// batched still sees socket backpressure: write() returns false and
+// 'drain' follows. Large buffers are written as they are, not copied.
+
+var common = require('../common');
+var assert = require('assert');
+var http = require('http');
+var net = require('net');
+
+var TOTAL = 8 * 1024 * 1024;
+var chunks = {
+  '/buffer': new Buffer(64 * 1024),
+  '/string': new Array(4 * 1024 + 1).join('x')
+};
+
+var blocked = { '/buffer': 0, '/string': 0 };
+var drained = { '/buffer': 0, '/string': 0 };
+
+var maxCopy = 0;
+var concat = Buffer.concat;
+Buffer.concat = function(list, length) {
+  var b = concat.apply(this, arguments);
+  maxCopy = Math.max(maxCopy, b.length);
+  return b;
+};
+
+var server = http.createServer(function(req, res) {
+  if (req.url === '/small') {
+    res.writeHead(200, { 'Content-Length': 2 });
+    res.end('ok');
+    return;
+  }
+
+  var chunk = chunks[req.url];
+  var written = 0;
+  res.writeHead(200, { 'Content-Length': TOTAL });
+
+  function fill() {
+    while (written < TOTAL) {
+      written += chunk.length;
+      if (!res.write(chunk)) {
+        blocked[req.url]++;
+        res.once('drain', function() {
+          drained[req.url]++;
+          fill();
+        });
+        return;
+      }
+    }
+    res.end();
+  }
+  fill();
+});
+
+server.listen(common.PORT, function() {
+  var received = 0;
+  var client = net.createConnection(common.PORT);
+
+  client.on('connect', function() {
+    // all three requests in one packet, so that their responses are
+    // batched
+    client.write('GET /small HTTP/1.1\r\n\r\n' +
+                 'GET /buffer HTTP/1.1\r\n\r\n' +
+                 'GET /string HTTP/1.1\r\nConnection: close\r\n\r\n');
+  });
+
+  client.on('data', function(d) {
+    received += d.length;
+  });
+
+  client.on('end', function() {
+    assert.ok(received > 2 * TOTAL);
+    client.end();
+    server.close();
+  });
+});
+
+process.on('exit', function() {
+  assert.ok(blocked['/buffer'] > 0);
+  assert.ok(blocked['/string'] > 0);
+  assert.deepEqual(drained, blocked);
+  assert.ok(maxCopy < 64 * 1024);
+});
@@ -0,0 +1,97 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var http = require('http');
+var net = require('net');
+
+var N = 10;
+var writes = 0;
+
+var server = http.createServer(function(req, res) {
+  var n = +req.url.slice(1);
+  function respond() {
+    res.writeHead(200, { 'Content-Type': 'text/plain' });
+    res.end('response ' + n + '\n');
+  }
+  // Every third response is late, so that finished responses queue up
+  // behind it.
+  if (server.async && n % 3 === 0) {
+    setTimeout(respond, 10);
+  } else {
+    respond();
+  }
+});
+
+server.on('connection', function(socket) {
+  var write = socket.write;
+  socket.write = function() {
+    writes++;
+    return write.apply(this, arguments);
+  };
+});
+
+function pipeline(cb) {
+  var requests = '';
+  for (var i = 0; i < N; i++) {
+    requests += 'GET /' + i + ' HTTP/1.1\r\n' +
+                (i === N - 1 ? 'Connection: close\r\n' : '') + '\r\n';
+  }
+
+  var body = '';
+  var client = net.createConnection(common.PORT);
+  client.setEncoding('utf8');
+  client.on('connect', function() {
+    client.write(requests);
+  });
+  client.on('data', function(d) {
+    body += d;
+  });
+  client.on('end', function() {
+    var seen = body.match(/response \d+/g);
+    assert.equal(N, seen.length);
+    for (var i = 0; i < N; i++) {
+      assert.equal('response ' + i, seen[i]);
+    }
+    client.end();
+    cb();
+  });
+}
+
+server.listen(common.PORT, function() {
+  // Responses made in the same pass over the input share socket writes.
+  pipeline(function() {
+    console.log('sync: %d writes for %d responses', writes, N);
+    assert.ok(writes < N);
+
+    // Late responses, and a server that reads at most two requests ahead,
+    // still answer everything in order.
+    writes = 0;
+    server.async = true;
+    server.maxPipelineDepth = 2;
+    pipeline(function() {
+      console.log('async: %d writes for %d responses', writes, N);
+      assert.ok(writes < N);
+      server.close();
+    });
+  });
+});
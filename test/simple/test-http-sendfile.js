@@ -0,0 +1,149 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var http = require('http');
+var path = require('path');
+var fs = require('fs');
+
+// Big enough that sendFile() runs into EAGAIN and has to wait for the
+// socket to become writable again.
+var SIZE = 12 * 1024 * 1024;
+
+var file = path.join(common.tmpDir, 'http-sendfile.bin');
+var data = new Buffer(SIZE);
+for (var i = 0; i < SIZE; i++) data[i] = i % 251;
+fs.writeFileSync(file, data);
+
+var fd = fs.openSync(file, 'r');
+var callbacks = 0;
+var abortSocket = null;
+var abortError = null;
+
+var server = http.createServer(function(req, res) {
+  function done(err) {
+    callbacks++;
+    if (err) {
+      assert.equal(req.url, '/missing');
+      res.writeHead(404);
+      res.end();
+    }
+  }
+
+  switch (req.url) {
+    case '/full':
+      res.sendFile(file, done);
+      break;
+    case '/range':
+      res.sendFile(fd, 1000, 5000, done);
+      break;
+    case '/tail':
+      res.sendFile(fd, SIZE - 10, done);
+      break;
+    case '/missing':
+      res.sendFile(file + '.missing', done);
+      break;
+    case '/abort':
+      abortSocket = req.connection;
+      res.sendFile(file, function(err) {
+        abortError = err;
+        server.close();
+      });
+      break;
+  }
+});
+
+var expected = [
+  { method: 'GET', path: '/full', body: data },
+  { method: 'GET', path: '/range', body: data.slice(1000, 6000) },
+  { method: 'GET', path: '/tail', body: data.slice(SIZE - 10) },
+  { method: 'HEAD', path: '/full', length: SIZE, body: new Buffer(0) },
+  { method: 'GET', path: '/missing', status: 404, body: new Buffer(0) }
+];
+var responses = 0;
+
+function next() {
+  var e = expected[responses];
+  if (!e) return abort();
+
+  var req = http.request({
+    port: common.PORT,
+    method: e.method,
+    path: e.path
+  }, function(res) {
+    var chunks = [], length = 0;
+
+    assert.equal(res.statusCode, e.status || 200);
+    if (!e.status) {
+      assert.equal(res.headers['content-length'],
+                   e.length !== undefined ? e.length : e.body.length);
+    }
+
+    res.on('data', function(chunk) {
+      chunks.push(chunk);
+      length += chunk.length;
+    });
+
+    res.on('end', function() {
+      var body = Buffer.concat(chunks, length);
+      assert.equal(body.length, e.body.length);
+      for (var i = 0; i < body.length; i++) {
+        if (body[i] !== e.body[i]) {
+          assert.fail(body[i], e.body[i], e.path + ' differs at ' + i);
+        }
+      }
+      responses++;
+      next();
+    });
+  });
+  req.end();
+}
+
+// The connection is destroyed while a sendfile(2) call is on the thread
+// pool. Its fd, and the file's, must stay open until the call returns so
+// that their numbers are not reused under it.
+var sendfile = fs.sendfile;
+fs.sendfile = function(outFd) {
+  sendfile.apply(fs, arguments);
+  if (abortSocket && abortSocket.fd === outFd) {
+    assert.ok(abortSocket._sendfilePending);
+    abortSocket.destroy();
+    assert.equal(abortSocket._sendfileFd, outFd);
+  }
+};
+
+function abort() {
+  http.get({ port: common.PORT, path: '/abort' }, function(res) {
+    res.on('data', function() {});
+  }).on('error', function() {});
+}
+
+server.listen(common.PORT, next);
+
+process.on('exit', function() {
+  fs.closeSync(fd);
+  fs.unlinkSync(file);
+  assert.equal(responses, expected.length);
+  assert.equal(callbacks, expected.length);
+  assert.ok(abortError instanceof Error);
+  assert.equal(abortSocket._sendfileFd, undefined);
+});
@@ -0,0 +1,127 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// The libuv backend of net (see lib/net.js), loaded directly so it runs
+// without --use-uv.
+
+var common = require('../common');
+var assert = require('assert');
+
+var net = require('net_uv');
+
+var N = 200;
+var pings = 0;
+var pongs = 0;
+var writeCallbacks = 0;
+var serverClosed = false;
+var clientClosed = false;
+var refused = false;
+
+
+var server = net.createServer({ allowHalfOpen: true }, function(socket) {
+  assert.equal(server, socket.server);
+  assert.equal(1, server.connections);
+  assert.equal('127.0.0.1', socket.remoteAddress);
+  assert.equal('open', socket.readyState);
+
+  socket.setNoDelay();
+  socket.setEncoding('utf8');
+
+  var buffered = '';
+  socket.on('data', function(data) {
+    buffered += data;
+    var i;
+    while ((i = buffered.indexOf('\n')) >= 0) {
+      assert.equal('PING', buffered.slice(0, i));
+      buffered = buffered.slice(i + 1);
+      pings++;
+      socket.write(new Buffer('PONG\n'));
+    }
+  });
+
+  socket.on('end', function() {
+    assert.equal(true, socket.writable); // because allowHalfOpen
+    assert.equal(false, socket.readable);
+    socket.end();
+  });
+
+  socket.on('close', function(hadError) {
+    assert.equal(false, hadError);
+    server.close();
+  });
+});
+
+server.on('close', function() {
+  serverClosed = true;
+});
+
+server.listen(common.PORT, function() {
+  assert.equal(common.PORT, server.address().port);
+
+  var client = net.createConnection(common.PORT);
+  var buffered = '';
+
+  assert.equal('opening', client.readyState);
+
+  // Queued until the connection is up.
+  client.write('PING\n', function() {
+    writeCallbacks++;
+  });
+
+  client.setEncoding('ascii');
+  client.on('data', function(data) {
+    buffered += data;
+    var i;
+    while ((i = buffered.indexOf('\n')) >= 0) {
+      assert.equal('PONG', buffered.slice(0, i));
+      buffered = buffered.slice(i + 1);
+      if (++pongs < N) {
+        client.write('PING\n', 'ascii', function() {
+          writeCallbacks++;
+        });
+      } else {
+        client.end();
+      }
+    }
+  });
+
+  client.on('close', function(hadError) {
+    assert.equal(false, hadError);
+    clientClosed = true;
+
+    // Nothing listens on the port any more.
+    var c = net.createConnection(common.PORT);
+    c.on('error', function(e) {
+      assert.equal('ECONNREFUSED', e.code);
+      refused = true;
+    });
+  });
+});
+
+
+process.on('exit', function() {
+  assert.equal(N, pings);
+  assert.equal(N, pongs);
+  assert.equal(N, writeCallbacks);
+  assert.ok(serverClosed);
+  assert.ok(clientClosed);
+  assert.ok(refused);
+});
@@ -0,0 +1,77 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// The fs, dns and timer paths that carry probe sites, including their error
+// cases. This has to pass whether or not node was built with probes, with
+// or without a tracer attached.
+
+var common = require('../common');
+var assert = require('assert');
+var path = require('path');
+var fs = require('fs');
+var dns = require('dns');
+var cares = process.binding('cares');
+var dnsServer = require(path.join(common.fixturesDir, 'dns-server'));
+
+var server = dnsServer.createServer({ 'probe.test': { A: ['10.0.0.7'] } });
+server.bind(common.PORT);
+
+var channel = dns._createChannel({ servers: ['127.0.0.1'], port: common.PORT });
+var done = {};
+
+fs.stat(__filename, function(err, stats) {
+  assert.ifError(err);
+  assert.ok(stats.isFile());
+  done.stat = true;
+});
+
+fs.open(path.join(common.fixturesDir, 'does-not-exist'), 'r', function(err) {
+  assert.equal(err.code, 'ENOENT');
+  done.enoent = true;
+});
+
+fs.readFile(__filename, 'utf8', function(err, data) {
+  assert.ifError(err);
+  assert.ok(data.indexOf('probe sites') >= 0);
+  done.readFile = true;
+});
+
+channel.lookup('probe.test', cares.AF_INET, function(err, addresses) {
+  assert.ifError(err);
+  assert.deepEqual(addresses, ['10.0.0.7']);
+  done.lookup = true;
+
+  channel.query('missing.test', cares.A, function(err) {
+    assert.ok(err);
+    done.nxdomain = true;
+    server.close();
+  });
+});
+
+setTimeout(function() {
+  done.timer = true;
+}, 1);
+
+process.on('exit', function() {
+  assert.deepEqual(Object.keys(done).sort(),
+                   ['enoent', 'lookup', 'nxdomain', 'readFile', 'stat',
+                    'timer']);
+});
@@ -0,0 +1,97 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var path = require('path');
+
+var HISTOGRAMS = ['busy', 'wait', 'timerLateness', 'tickDepth'];
+
+function checkHistogram(h) {
+  assert.equal(32, h.buckets.length);
+  assert.equal(h.count, h.buckets.reduce(function(a, b) { return a + b; }));
+  assert.ok(h.p50 <= h.p90);
+  assert.ok(h.p90 <= h.p99);
+  assert.ok(h.p99 <= h.max);
+  assert.ok(h.mean <= h.max);
+}
+
+var dumpFile = path.join(common.tmpDir, 'loop-stats.log');
+try { fs.unlinkSync(dumpFile); } catch (e) {}
+var fd = fs.openSync(dumpFile, 'w');
+
+assert.throws(function() { process.dumpLoopStats('x'); }, TypeError);
+assert.throws(function() { process.dumpLoopStats(fd, 0); }, TypeError);
+process.dumpLoopStats(fd, 50);
+
+process.nextTick(function() {});
+process.nextTick(function() {});
+process.nextTick(function() {});
+
+var timers = 0;
+var start = Date.now();
+
+function next() {
+  // Keep the loop busy for a while on some iterations.
+  if (timers % 4 == 0) {
+    var until = Date.now() + 3;
+    while (Date.now() < until);
+  }
+
+  if (++timers < 30) {
+    setTimeout(next, 5);
+    return;
+  }
+
+  var stats = process.loopStats(true);
+  assert.ok(stats.iterations > 0);
+  assert.ok(stats.utilization > 0 && stats.utilization < 1);
+  HISTOGRAMS.forEach(function(name) { checkHistogram(stats[name]); });
+
+  assert.ok(stats.busy.count > 0);
+  assert.ok(stats.busy.max >= 3);
+  assert.ok(stats.wait.count > 0);
+  assert.ok(stats.timerLateness.count >= timers - 1);
+  assert.ok(stats.tickDepth.max >= 3);
+
+  stats = process.loopStats();
+  assert.equal(0, stats.iterations);
+  assert.equal(0, stats.busy.count);
+
+  process.dumpLoopStats();
+  fs.closeSync(fd);
+
+  var lines = fs.readFileSync(dumpFile, 'utf8').split('\n');
+  assert.equal('', lines.pop());
+  assert.ok(lines.length >= 1);
+  lines.forEach(function(line) {
+    var window = JSON.parse(line);
+    assert.ok(window.time >= start);
+    assert.ok(window.iterations > 0);
+    assert.equal(0, window.dropped);
+    HISTOGRAMS.forEach(function(name) {
+      assert.ok(window[name].p99 <= window[name].max);
+    });
+  });
+}
+
+setTimeout(next, 5);
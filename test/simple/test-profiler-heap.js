@@ -0,0 +1,79 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var path = require('path');
+var fs = require('fs');
+var profiler = require('profiler');
+
+function LeakyThing(i) {
+  this.i = i;
+}
+
+var things = [];
+for (var i = 0; i < 5000; i++) things.push(new LeakyThing(i));
+
+// heap statistics
+var stats = profiler.heapStatistics();
+assert.ok(stats.usedHeapSize > 0);
+assert.ok(stats.totalHeapSize >= stats.usedHeapSize);
+assert.ok(stats.totalHeapSizeExecutable <= stats.totalHeapSize);
+assert.ok(stats.heapSizeLimit >= stats.totalHeapSize);
+
+// counts by constructor
+var counts = profiler.countObjects();
+assert.ok(counts.length > 0);
+for (var i = 1; i < counts.length; i++) {
+  assert.ok(counts[i - 1].size >= counts[i].size);
+}
+var leaky = counts.filter(function(c) { return c.name === 'LeakyThing'; });
+assert.equal(leaky.length, 1);
+assert.ok(leaky[0].count >= 5000);
+
+// snapshot streamed to a file
+var fn = path.join(common.tmpDir, 'test.heapsnapshot');
+var info = profiler.writeHeapSnapshot(fn, 'test');
+assert.equal(info.title, 'test');
+assert.equal(typeof info.uid, 'number');
+
+var data = fs.readFileSync(fn, 'utf8');
+assert.equal(data.length, info.bytes);
+var snapshot = JSON.parse(data);
+assert.ok(snapshot.snapshot);
+assert.ok(Array.isArray(snapshot.nodes));
+assert.ok(Array.isArray(snapshot.strings));
+assert.ok(snapshot.strings.indexOf('LeakyThing') >= 0);
+fs.unlinkSync(fn);
+
+// writing to a bad descriptor fails cleanly
+assert.throws(function() {
+  profiler.writeHeapSnapshot(-1);
+}, /EBADF/);
+
+// snapshots are never freed, so their number is capped
+profiler.maxSnapshots = 0;
+assert.throws(function() {
+  profiler.countObjects();
+}, /limit/);
+assert.throws(function() {
+  profiler.writeHeapSnapshot(fn);
+}, /limit/);
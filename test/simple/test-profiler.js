@@ -0,0 +1,92 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var fs = require('fs');
+var profiler = require('profiler');
+
+function spin(ms) {
+  var start = Date.now(), x = 0;
+  while (Date.now() - start < ms) x += Math.sqrt(x + 1);
+  return x;
+}
+
+function walk(node, fn) {
+  fn(node);
+  node.children.forEach(function(child) { walk(child, fn); });
+}
+
+// tree output
+profiler.startProfiling('tree');
+spin(300);
+var profile = profiler.stopProfiling('tree');
+
+assert.equal(profile.title, 'tree');
+assert.equal(typeof profile.uid, 'number');
+assert.ok(Array.isArray(profile.head.children));
+
+var found = false;
+walk(profile.head, function(node) {
+  assert.equal(typeof node.functionName, 'string');
+  assert.equal(typeof node.selfSamples, 'number');
+  assert.ok(node.totalSamples >= node.selfSamples);
+  if (node.functionName === 'spin') found = true;
+});
+assert.ok(found, 'spin() missing from the profile');
+
+// stopping a profile that is not running
+assert.strictEqual(profiler.stopProfiling('nope'), undefined);
+
+// collapsed output
+profiler.startProfiling('collapsed');
+spin(300);
+var stacks = profiler.stopProfiling('collapsed', 'collapsed');
+var lines = stacks.split('\n').filter(Boolean);
+assert.ok(lines.length > 0);
+lines.forEach(function(line) {
+  assert.ok(/^[^;]+(;[^;]+)* \d+$/.test(line), line);
+});
+assert.ok(lines.some(function(line) {
+  return /(^|;)spin [^;]*test-profiler\.js:\d+ \d+$/.test(line);
+}), 'spin() missing from the collapsed stacks');
+
+// signal driven profiles; signal watchers do not keep the loop alive
+var written = null;
+var keepAlive = setInterval(function() {}, 100);
+profiler.toggleOnSignal('SIGUSR2', common.tmpDir, function(err, filename) {
+  clearInterval(keepAlive);
+  assert.ifError(err);
+  written = filename;
+  var data = fs.readFileSync(filename, 'utf8');
+  assert.ok(/spin/.test(data));
+  fs.unlinkSync(filename);
+});
+
+process.kill(process.pid, 'SIGUSR2');
+setTimeout(function() {
+  spin(300);
+  process.kill(process.pid, 'SIGUSR2');
+}, 50);
+
+process.on('exit', function() {
+  assert.ok(written);
+});
@@ -201,3 +201,44 @@ assert.equal(0xd8, b[17]);
 assert.equal(0xa2, b[18]);
 assert.equal(0xe6, b[19]);
 
+
+// Buffers are parsed without becoming strings first.
+qsTestCases.forEach(function(testCase) {
+  assert.deepEqual(testCase[2], qs.parse(new Buffer(testCase[0])));
+});
+qsColonTestCases.forEach(function(testCase) {
+  assert.deepEqual(testCase[2], qs.parse(new Buffer(testCase[0]), ';', ':'));
+});
+assert.deepEqual({ b: '2' }, qs.parse(new Buffer('a=1&b=2').slice(4)));
+assert.deepEqual({}, qs.parse(new Buffer(0)));
+
+// Multi-character separators, empty pairs and raw UTF-8.
+assert.deepEqual({ a: '1', b: ['2', '3'] },
+                 qs.parse('a=>1&&b=>2&&b=>3', '&&', '=>'));
+assert.deepEqual({ a: '1', '': ['', ''] }, qs.parse('a=1&&'));
+assert.deepEqual({ 'café': 'über' }, qs.parse('café=%C3%BCber'));
+assert.deepEqual({ 'café': 'über' },
+                 qs.parse(new Buffer('café=über')));
+
+// Malformed escapes pass through as unescapeBuffer leaves them.
+['%', '%4', '%zz', '%%41', '%4z', '+%2B'].forEach(function(s) {
+  assert.equal(qs.unescapeBuffer(s, true).toString(), qs.unescape(s, true));
+});
+
+// A replaced unescape or escape is still used.
+var unescape = qs.unescape;
+qs.unescape = function(s) { return s.toUpperCase(); };
+assert.deepEqual({ A: 'B%20' }, qs.parse('a=b%20'));
+assert.deepEqual({ A: 'B' }, qs.parse(new Buffer('a=b')));
+qs.unescape = unescape;
+
+var escape = qs.escape;
+qs.escape = function(s) { return '<' + s + '>'; };
+assert.equal('<a>=<1>', qs.stringify({ a: 1 }));
+qs.escape = escape;
+
+// Stringify matches encodeURIComponent, including its errors.
+assert.equal('a=%F0%9F%98%80%E2%82%AC%C3%A9',
+             qs.stringify({ a: '\ud83d\ude00\u20ac\u00e9' }));
+assert.equal('a=1e%2B21', qs.stringify({ a: 1e21 }));
+assert.throws(function() { qs.stringify({ a: '\ud800' }); }, URIError);
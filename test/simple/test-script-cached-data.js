@@ -0,0 +1,89 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var vm = require('vm');
+var Buffer = require('buffer').Buffer;
+
+common.globalCheck = false;
+
+var code = 'function add(a, b) { return a + b; }\n' +
+           'function mul(a, b) { return a * b; }\n' +
+           'add(x, mul(y, 2))';
+
+var script = vm.createScript(code, 'cached.vm');
+var data = script.createCachedData();
+assert.ok(Buffer.isBuffer(data));
+assert.ok(data.length > 0);
+assert.equal(data.toString('binary'),
+             script.createCachedData().toString('binary'));
+
+common.debug('compile with cached data');
+var cached = vm.createScript(code, 'cached.vm', data);
+assert.strictEqual(false, cached.cachedDataRejected);
+assert.equal(7, cached.runInNewContext({ x: 1, y: 3 }));
+assert.equal(5, cached.runInNewContext({ x: 3, y: 1 }));
+
+common.debug('data survives a round trip through a copy');
+var copy = new Buffer(data.length);
+data.copy(copy, 0, 0, data.length);
+assert.equal(9, vm.createScript(code, 'cached.vm', copy)
+                  .runInNewContext({ x: 1, y: 4 }));
+
+
+common.debug('data for other code is dropped');
+var other = 'var pad = "' + new Array(50).join('-') + '";\n' +
+            'function mul(a, b) { return a * b; }\n' +
+            'function add(a, b) { return a + b; }\n' +
+            'mul(x, add(y, 2))';
+var misfit = vm.createScript(other, 'other.vm', data);
+assert.strictEqual(true, misfit.cachedDataRejected);
+assert.equal(10, misfit.runInNewContext({ x: 2, y: 3 }));
+
+common.debug('so is an edit of the same code of the same length');
+var edited = code.replace('a + b', 'a - b');
+assert.equal(code.length, edited.length);
+misfit = vm.createScript(edited, 'cached.vm', data);
+assert.strictEqual(true, misfit.cachedDataRejected);
+assert.equal(-5, misfit.runInNewContext({ x: 1, y: 3 }));
+
+common.debug('truncated data is dropped');
+[1, 20, data.length - 4, data.length - 1].forEach(function(length) {
+  var s = vm.createScript(code, 'cached.vm', data.slice(0, length));
+  assert.strictEqual(true, s.cachedDataRejected);
+  assert.equal(7, s.runInNewContext({ x: 1, y: 3 }));
+});
+
+common.debug('damaged data is dropped');
+var damaged = new Buffer(data.length);
+data.copy(damaged, 0, 0, data.length);
+damaged[damaged.length - 5] ^= 0xff;
+var s = vm.createScript(code, 'cached.vm', damaged);
+assert.strictEqual(true, s.cachedDataRejected);
+assert.equal(7, s.runInNewContext({ x: 1, y: 3 }));
+
+common.debug('garbage is dropped');
+var garbage = new Buffer(data.length);
+for (var i = 0; i < garbage.length; i++) garbage[i] = (i * 131) & 0xff;
+s = vm.createScript(code, 'cached.vm', garbage);
+assert.strictEqual(true, s.cachedDataRejected);
+assert.equal(7, s.runInNewContext({ x: 1, y: 3 }));
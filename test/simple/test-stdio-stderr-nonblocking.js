@@ -0,0 +1,127 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// A child writes to stderr while the parent isn't reading it. The event
+// loop of the child must keep running, and nothing may get lost unless the
+// 'drop' policy says so.
+
+var common = require('../common');
+var assert = require('assert');
+var spawn = require('child_process').spawn;
+
+var BURSTS = 16;
+var BURST_SIZE = 32 * 1024;
+var chunk = new Array(1024).join('x') + '\n';
+
+if (process.argv[2] === 'child') {
+  if (process.argv[3] === 'drop') {
+    process.stderr.setOverflow('drop', 64 * 1024);
+  }
+
+  var maxLag = 0;
+  var last = Date.now();
+  var timer = setInterval(function() {
+    var now = Date.now();
+    maxLag = Math.max(maxLag, now - last - 10);
+    last = now;
+  }, 10);
+
+  var bursts = 0;
+  (function burst() {
+    for (var i = 0; i < BURST_SIZE / chunk.length; i++) {
+      process.stderr.write(chunk);
+    }
+    if (++bursts < BURSTS) return setTimeout(burst, 20);
+
+    setTimeout(function() {
+      clearInterval(timer);
+      console.log(JSON.stringify({ maxLag: maxLag,
+                                   buffered: process.stderr.bufferSize,
+                                   dropped: process.stderr.droppedBytes }));
+    }, 50);
+  })();
+  return;
+}
+
+
+var done = 0;
+
+function run(policy) {
+  var child = spawn(process.execPath, [__filename, 'child', policy]);
+  var report = '';
+  var received = 0;
+  var result;
+
+  // Don't read stderr until the child is done writing.
+  child.stderr.pause();
+
+  child.stderr.on('data', function(data) {
+    received += data.length;
+  });
+
+  child.stdout.setEncoding('utf8');
+  child.stdout.on('data', function(data) {
+    report += data;
+    if (report.indexOf('\n') < 0) return;
+    result = JSON.parse(report);
+    child.stderr.resume();
+  });
+
+  var exited = false;
+  var ended = false;
+
+  child.on('exit', function(code) {
+    assert.equal(0, code);
+    exited = true;
+    if (ended) check();
+  });
+
+  child.stderr.on('end', function() {
+    ended = true;
+    if (exited) check();
+  });
+
+  function check() {
+    assert.ok(result);
+    console.error(policy + ': ' + report.trim());
+
+    // The loop kept ticking while the pipe was full.
+    assert.ok(result.maxLag < 500, 'loop stalled for ' + result.maxLag + 'ms');
+
+    if (policy === 'drop') {
+      assert.ok(result.dropped > 0);
+      assert.ok(result.buffered <= 64 * 1024);
+    } else {
+      assert.equal(0, result.dropped);
+      assert.ok(result.buffered > 0);
+    }
+
+    assert.equal(BURSTS * BURST_SIZE - result.dropped, received);
+    done++;
+  }
+}
+
+run('block');
+run('drop');
+
+process.on('exit', function() {
+  assert.equal(2, done);
+});
@@ -746,3 +746,37 @@ relativeTests2.forEach(function(relativeTest) {
                '\n  actual=' + a);
 });
 
+
+// The native parser agrees with the JavaScript one on every URL above.
+// The native result defines the lazy `query` last, so property order is
+// not compared.
+var conformanceInputs = Object.keys(parseTests)
+  .concat(Object.keys(parseTestsWithQueryString))
+  .concat(Object.keys(formatTests));
+relativeTests.concat(relativeTests2).forEach(function(relativeTest) {
+  conformanceInputs.push(relativeTest[0], relativeTest[1], relativeTest[2]);
+});
+conformanceInputs.push('', '  <http://a.com/b>', 'javascript:alert(\'x\')',
+                       'http://a.com:8080', 'http://@a.com/', 'x://a:b@c:1',
+                       'http://a_b.c.d/e', 'http://aaa.bb$b.ccc/d?e#f',
+                       'http://' + new Array(300).join('a') + '.com/');
+
+conformanceInputs.forEach(function(u) {
+  [false, true].forEach(function(parseQueryString) {
+    [false, true].forEach(function(slashesDenoteHost) {
+      var e = url._jsParse(u, parseQueryString, slashesDenoteHost),
+          a = url.parse(u, parseQueryString, slashesDenoteHost);
+      assert.deepEqual(e, a, 'parse(' + JSON.stringify(u) + ', ' +
+                       parseQueryString + ', ' + slashesDenoteHost + ') == ' +
+                       JSON.stringify(e) + '\nactual: ' + JSON.stringify(a));
+    });
+  });
+});
+
+// The query is parsed when it is first read, and can be replaced.
+var lazy = url.parse('/a?b=c&b=d', true);
+assert.deepEqual({ b: ['c', 'd'] }, lazy.query);
+assert.strictEqual(lazy.query, lazy.query);
+lazy = url.parse('/a?b=c', true);
+lazy.query = 'x';
+assert.equal('x', lazy.query);
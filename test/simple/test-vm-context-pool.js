@@ -0,0 +1,149 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var vm = require('vm');
+
+// Reuse contexts, which is what most of this tests.
+var pool = vm.createContextPool({ size: 2, maxUses: 0 });
+assert.deepEqual({ size: 2, idle: 2, created: 2, retired: 0 },
+                 pool.stats());
+
+
+common.debug('run a string');
+assert.equal('passed', pool.run('\'passed\';'));
+
+
+common.debug('pass values in and out');
+var sandbox = { foo: 0, baz: 3 };
+pool.run('foo = 1; bar = 2; if (baz !== 3) throw new Error("test fail");',
+         sandbox);
+assert.equal(1, sandbox.foo);
+assert.equal(2, sandbox.bar);
+assert.equal(3, sandbox.baz);
+
+
+common.debug('declarations end up in the sandbox');
+sandbox = { x: 1 };
+pool.run('var x; var y = 2; function f() { return 3; }', sandbox);
+assert.equal(1, sandbox.x);
+assert.equal(2, sandbox.y);
+assert.equal(3, sandbox.f());
+
+
+common.debug('nothing leaks from one run into the next');
+for (var i = 0; i < 10; i++) {
+  assert.equal('undefined undefined undefined',
+               pool.run('[typeof y, typeof f, typeof bar].join(" ")', {}));
+}
+assert.throws(function() {
+  pool.run('bar', {});
+}, /not defined/);
+assert.equal(2, pool.stats().created);
+
+
+common.debug('builtins are still there');
+assert.equal('[1,2]', pool.run('JSON.stringify([a, b])', { a: 1, b: 2 }));
+
+
+common.debug('errors are rethrown');
+assert.throws(function() {
+  pool.run('throw new Error("test");');
+}, /test/);
+assert.throws(function() {
+  pool.run('syntax error');
+}, /SyntaxError/);
+assert.equal(2, pool.stats().idle);
+
+
+common.debug('a script compiled once runs in any pooled context');
+var script = vm.createScript('count += 1; name = "kitty"');
+sandbox = { count: 2 };
+for (i = 0; i < 10; i++) {
+  pool.run(script, sandbox);
+}
+assert.equal(12, sandbox.count);
+assert.equal('kitty', sandbox.name);
+
+
+common.debug('nested runs take another context');
+sandbox = { pool: pool };
+assert.equal(3, pool.run('pool.run("a + b", { a: 1, b: 2 })', sandbox));
+assert.equal(2, pool.stats().created);
+
+
+common.debug('maxUses retires contexts');
+var limited = vm.createContextPool({ size: 1, maxUses: 3 });
+for (i = 0; i < 6; i++) {
+  limited.run('1');
+}
+assert.equal(2, limited.stats().created);
+
+
+common.debug('non-enumerable globals are reset too');
+sandbox = {};
+pool.run('Object.defineProperty(this, "hidden", { value: 1 })', sandbox);
+assert.equal(1, sandbox.hidden);
+assert.equal('undefined', pool.run('typeof hidden', {}));
+assert.equal(0, pool.stats().retired);
+
+
+common.debug('regular expressions leave the builtins as they were');
+assert.equal('b', pool.run('/a(b)/.exec("ab"); RegExp.$1'));
+assert.equal(0, pool.stats().retired);
+
+
+common.debug('a context whose globals were redefined is retired');
+pool.run('Object.defineProperty(this, "JSON", { value: "evil" })');
+assert.equal('object', pool.run('typeof JSON'));
+pool.run('delete Math');
+assert.equal(2, pool.run('Math.max(1, 2)'));
+assert.equal(2, pool.stats().retired);
+assert.equal(3, pool.stats().created);
+
+
+common.debug('by default nothing leaks through the builtins');
+var isolated = vm.createContextPool({ size: 1 });
+isolated.run('Object.prototype.leak = 1');
+assert.equal('undefined', isolated.run('typeof ({}).leak'));
+isolated.run('JSON.parse = function() { return "evil"; }');
+assert.equal(1, isolated.run('JSON.parse("1")'));
+isolated.run('Array.prototype.map.x = 1');
+assert.equal('undefined', isolated.run('typeof [].map.x'));
+assert.deepEqual({ size: 1, idle: 0, created: 6, retired: 0 },
+                 isolated.stats());
+
+
+common.debug('reused contexts share the builtins');
+var shared = vm.createContextPool({ size: 1, maxUses: 0 });
+shared.run('Array.prototype.map.x = 1');
+assert.equal(1, shared.run('[].map.x'));
+assert.deepEqual({ size: 1, idle: 1, created: 1, retired: 0 },
+                 shared.stats());
+
+
+common.debug('dispose');
+pool.dispose();
+assert.deepEqual({ size: 0, idle: 0, created: 3, retired: 2 },
+                 pool.stats());
+assert.equal(3, pool.run('a + b', { a: 1, b: 2 }));
+assert.equal(0, pool.stats().idle);
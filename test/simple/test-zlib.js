@@ -0,0 +1,223 @@
+// Copyright Joyent, Inc. and other Node contributors.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit
+// persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN
+// NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+// USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+var common = require('../common');
+var assert = require('assert');
+var zlib = require('zlib');
+var http = require('http');
+
+// Enough repetitive text to span several output chunks.
+var text = '';
+for (var i = 0; i < 2000; i++) {
+  text += 'line ' + i + ': the quick brown fox jumps over the lazy dog\n';
+}
+var input = new Buffer(text);
+
+var pairs = [[zlib.Deflate, zlib.Inflate],
+             [zlib.Gzip, zlib.Gunzip],
+             [zlib.Gzip, zlib.Unzip],
+             [zlib.DeflateRaw, zlib.InflateRaw]];
+
+var roundTrips = 0;
+var asyncDone = 0;
+var streamErrors = 0;
+var dictionaryDone = false;
+var responses = 0;
+
+
+// Sync one-shot API.
+assert.equal(text, zlib.gunzipSync(zlib.gzipSync(text)).toString());
+assert.equal(text, zlib.inflateSync(zlib.deflateSync(input)).toString());
+assert.equal(text,
+             zlib.inflateRawSync(zlib.deflateRawSync(input)).toString());
+assert.equal(text, zlib.unzipSync(zlib.deflateSync(input)).toString());
+assert.ok(zlib.gzipSync(input).length < input.length / 10);
+assert.equal(0, zlib.gunzipSync(zlib.gzipSync('')).length);
+
+// Small output buffers take the multi-chunk path.
+assert.equal(text, zlib.gunzipSync(zlib.gzipSync(input, { chunkSize: 64 }),
+                                   { chunkSize: 64 }).toString());
+
+// Higher levels compress better.
+assert.ok(zlib.deflateSync(input, { level: 9 }).length <=
+          zlib.deflateSync(input, { level: 1 }).length);
+assert.ok(zlib.deflateSync(input, { level: 0 }).length > input.length);
+
+assert.throws(function() {
+  zlib.gunzipSync(zlib.gzipSync(input).slice(0, 100));
+}, function(err) {
+  return err.code === 'Z_BUF_ERROR';
+});
+
+assert.throws(function() {
+  zlib.inflateSync(new Buffer('not compressed at all'));
+}, function(err) {
+  return err.code === 'Z_DATA_ERROR';
+});
+
+assert.throws(function() {
+  zlib.createDeflate({ level: 10 });
+});
+
+assert.throws(function() {
+  zlib.createInflate({ windowBits: 7 });
+});
+
+
+// Streams, writing in pieces.
+pairs.forEach(function(pair) {
+  var compress = new pair[0]({ chunkSize: 1024 });
+  var decompress = new pair[1]();
+  var out = [];
+
+  compress.pipe(decompress);
+  decompress.on('data', function(chunk) {
+    out.push(chunk.toString());
+  });
+  decompress.on('end', function() {
+    assert.equal(text, out.join(''));
+    roundTrips++;
+  });
+
+  for (var i = 0; i < input.length; i += 1000) {
+    compress.write(input.slice(i, Math.min(i + 1000, input.length)));
+  }
+  compress.end();
+});
+
+
+// Async one-shot API.
+zlib.gzip(input, function(err, gzipped) {
+  if (err) throw err;
+  zlib.gunzip(gzipped, function(err, result) {
+    if (err) throw err;
+    assert.equal(text, result.toString());
+    asyncDone++;
+  });
+});
+
+zlib.inflate(new Buffer('garbage'), function(err, result) {
+  assert.ok(err);
+  assert.equal('Z_DATA_ERROR', err.code);
+  asyncDone++;
+});
+
+
+// Preset dictionary.
+(function() {
+  var dictionary = new Buffer('the quick brown fox jumps over the lazy dog');
+  var message = 'a quick fox and a lazy dog';
+
+  var plain = zlib.deflateSync(message);
+  var primed = zlib.deflateSync(message, { dictionary: dictionary });
+  assert.ok(primed.length < plain.length);
+
+  assert.equal(message,
+               zlib.inflateSync(primed, { dictionary: dictionary }).toString());
+  assert.throws(function() {
+    zlib.inflateSync(primed);
+  }, /Missing dictionary/);
+  assert.throws(function() {
+    zlib.inflateSync(primed, { dictionary: new Buffer('something else') });
+  }, /Bad dictionary/);
+
+  var raw = zlib.deflateRawSync(message, { dictionary: dictionary });
+  assert.equal(message,
+               zlib.inflateRawSync(raw, { dictionary: dictionary }).toString());
+
+  var inflate = zlib.createInflate({ dictionary: dictionary });
+  var out = '';
+  inflate.on('data', function(chunk) {
+    out += chunk;
+  });
+  inflate.on('end', function() {
+    assert.equal(message, out);
+    dictionaryDone = true;
+  });
+  inflate.end(primed);
+})();
+
+
+// Corrupt input on a stream.
+(function() {
+  var gunzip = zlib.createGunzip();
+  gunzip.on('error', function(err) {
+    assert.equal('Z_DATA_ERROR', err.code);
+    streamErrors++;
+  });
+  gunzip.end(new Buffer('this is not gzip'));
+})();
+
+
+// http.ServerResponse.compress().
+var server = http.createServer(function(req, res) {
+  var encoding = res.compress();
+  assert.equal(req.headers['x-expect'] || null, encoding);
+  res.writeHead(200, { 'Content-Type': 'text/plain',
+                       'Content-Length': input.length });
+  res.write(input.slice(0, 5000));
+  res.end(input.slice(5000));
+});
+
+var requests = [['gzip, deflate', 'gzip'],
+                ['deflate', 'deflate'],
+                ['gzip;q=0.5, deflate', 'deflate'],
+                ['*', 'gzip'],
+                ['gzip;q=0', null],
+                [null, null]];
+
+server.listen(common.PORT, function() {
+  requests.forEach(function(r) {
+    var headers = {};
+    if (r[0]) headers['Accept-Encoding'] = r[0];
+    if (r[1]) headers['X-Expect'] = r[1];
+
+    http.get({ port: common.PORT, path: '/', headers: headers },
+             function(res) {
+      var body = [];
+      var length = 0;
+      res.on('data', function(chunk) {
+        body.push(chunk);
+        length += chunk.length;
+      });
+      res.on('end', function() {
+        body = Buffer.concat(body, length);
+        assert.equal(r[1], res.headers['content-encoding'] || null);
+        if (r[1]) {
+          assert.equal(undefined, res.headers['content-length']);
+          assert.equal('Accept-Encoding', res.headers['vary']);
+          body = zlib.unzipSync(body);
+        }
+        assert.equal(text, body.toString());
+        if (++responses === requests.length) server.close();
+      });
+    });
+  });
+});
+
+
+process.on('exit', function() {
+  assert.equal(pairs.length, roundTrips);
+  assert.equal(2, asyncDone);
+  assert.equal(1, streamErrors);
+  assert.ok(dictionaryDone);
+  assert.equal(requests.length, responses);
+});